@@ -151,7 +151,10 @@ int main(int argc, char **argv) {
       ("iterations,i", po::value(&iterations)->default_value(iterations),
         "Number of repetitions per Kad operation.")
       ("max_nodes", po::value(&max_nodes)->default_value(max_nodes),
-        "Maximum number of nodes taken from id_list for Kad operations.");
+        "Maximum number of nodes taken from id_list for Kad operations.")
+      ("routing_table", po::value<int>(),
+        "Benchmark the routing table alone with the given number of contacts "
+        "and exit.");
       // TODO(Team#5#): 2010-04-19 - options: disable benchmarks, delay, sizes
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -159,6 +162,12 @@ int main(int argc, char **argv) {
       DLOG(INFO) << desc << "\n";
       return 0;
     }
+    if (vm.count("routing_table")) {
+      printf("\n[ Testing RoutingTable ]\n");
+      maidsafe::dht::benchmark::Operations::TestRoutingTable(
+          vm["routing_table"].as<int>(), iterations);
+      return 0;
+    }
     option_dependency(vm, "bs_id", "bs_ip");
     option_dependency(vm, "bs_ip", "bs_id");
     option_dependency(vm, "bs_id", "bs_port");
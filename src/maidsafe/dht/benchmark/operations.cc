@@ -43,6 +43,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "maidsafe/dht/log.h"
 #include "maidsafe/dht/node_id.h"
 #include "maidsafe/dht/node-api.h"
+#include "maidsafe/dht/routing_table.h"
 
 
 namespace maidsafe {
@@ -246,6 +247,76 @@ void Operations::TestStoreAndFind(const std::vector<NodeId> &nodes,
   }
 }
 
+/**
+ * Times the routing table's insert, refresh, closest-contacts and lookup
+ * paths in isolation, i.e. without a network.  Figures are per call, in
+ * microseconds.
+ */
+void Operations::TestRoutingTable(const int &contact_count,
+                                  const int &iterations) {
+  printf("Filling routing table with %d contacts, %d iterations...\n",
+         contact_count, iterations);
+  const uint16_t kK(16);
+  std::vector<NodeId> node_ids;
+  std::vector<Contact> contacts;
+  for (int i = 0; i < contact_count; ++i) {
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+    transport::Endpoint endpoint("127.0.0.1", 5000 + i % 1000);
+    contacts.push_back(Contact(node_ids.back(), endpoint,
+        std::vector<transport::Endpoint>(1, endpoint), endpoint, false, false,
+        "", asymm::PublicKey(), ""));
+  }
+
+  Stats<uint64_t> add_stats, refresh_stats, close_stats, get_stats;
+  for (int j = 0; j < iterations; ++j) {
+    RoutingTable routing_table(NodeId(NodeId::kRandomId), kK);
+    bptime::ptime start(bptime::microsec_clock::universal_time());
+    for (int i = 0; i < contact_count; ++i) {
+      routing_table.AddContact(contacts[i], RankInfoPtr());
+      routing_table.SetValidated(node_ids[i], true);
+    }
+    add_stats.Add((bptime::microsec_clock::universal_time() - start).
+                  total_microseconds());
+
+    // Re-adding contacts already held is the common case for a live node.
+    start = bptime::microsec_clock::universal_time();
+    for (int i = 0; i < contact_count; ++i)
+      routing_table.AddContact(contacts[i], RankInfoPtr());
+    refresh_stats.Add((bptime::microsec_clock::universal_time() - start).
+                      total_microseconds());
+
+    std::vector<Contact> close_contacts, exclude_contacts;
+    start = bptime::microsec_clock::universal_time();
+    for (int i = 0; i < contact_count; ++i) {
+      close_contacts.clear();
+      routing_table.GetCloseContacts(node_ids[i], kK, exclude_contacts,
+                                     &close_contacts);
+    }
+    close_stats.Add((bptime::microsec_clock::universal_time() - start).
+                    total_microseconds());
+
+    Contact contact;
+    start = bptime::microsec_clock::universal_time();
+    for (int i = 0; i < contact_count; ++i)
+      routing_table.GetContact(node_ids[i], &contact);
+    get_stats.Add((bptime::microsec_clock::universal_time() - start).
+                  total_microseconds());
+  }
+
+  const double kCount(contact_count);
+  printf(" AddContact:       min/avg/max %.2f/%.2f/%.2f us\n",
+         add_stats.Min() / kCount, add_stats.Mean() / kCount,
+         add_stats.Max() / kCount);
+  printf(" AddContact known: min/avg/max %.2f/%.2f/%.2f us\n",
+         refresh_stats.Min() / kCount, refresh_stats.Mean() / kCount,
+         refresh_stats.Max() / kCount);
+  printf(" GetCloseContacts: min/avg/max %.2f/%.2f/%.2f us\n",
+         close_stats.Min() / kCount, close_stats.Mean() / kCount,
+         close_stats.Max() / kCount);
+  printf(" GetContact:       min/avg/max %.2f/%.2f/%.2f us\n",
+         get_stats.Min() / kCount, get_stats.Mean() / kCount,
+         get_stats.Max() / kCount);
+}
 
 void Operations::PingCallback(const std::string &/*result*/,
                               std::shared_ptr<CallbackData> data) {
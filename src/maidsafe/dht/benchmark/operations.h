@@ -66,6 +66,7 @@ class Operations {
                        const int &iterations);
   void TestStoreAndFind(const std::vector<NodeId> &nodes,
                         const int &iterations, const bool &sign);
+  static void TestRoutingTable(const int &contact_count, const int &iterations);
   static NodeId GetModId(int iteration);
   static void PrintRpcTimings(const rpcprotocol::RpcStatsMap &rpc_timings);
  private:
@@ -0,0 +1,96 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "maidsafe/dht/closest_contacts_cache.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "maidsafe/dht/utils.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace {
+
+bool HoldsContact(const std::vector<Contact> &contacts, const NodeId &node_id) {
+  return std::find_if(contacts.begin(), contacts.end(),
+                      std::bind(&HasId, args::_1, node_id)) != contacts.end();
+}
+
+}  // unnamed namespace
+
+ClosestContactsCache::ClosestContactsCache(
+    const size_t &max_size,
+    const bptime::time_duration &time_to_live)
+    : kMaxSize_(max_size),
+      kTimeToLive_(time_to_live),
+      entries_(max_size),
+      mutex_() {}
+
+void ClosestContactsCache::Add(const NodeId &target,
+                               const std::vector<Contact> &contacts) {
+  if (kMaxSize_ == 0 || contacts.empty())
+    return;
+  const bptime::ptime kNow(bptime::microsec_clock::universal_time());
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Insert(target, contacts, kNow + kTimeToLive_, kNow);
+}
+
+bool ClosestContactsCache::Get(const NodeId &target,
+                               const size_t &count,
+                               std::vector<Contact> *contacts) {
+  if (!contacts)
+    return false;
+  boost::mutex::scoped_lock lock(mutex_);
+  const std::vector<Contact> *cached(
+      entries_.Find(target, bptime::microsec_clock::universal_time()));
+  if (!cached || cached->size() < count)
+    return false;
+  contacts->assign(cached->begin(), cached->begin() + count);
+  return true;
+}
+
+void ClosestContactsCache::Invalidate(const NodeId &node_id) {
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.EraseIf(std::bind(&HoldsContact, args::_1, node_id));
+}
+
+void ClosestContactsCache::Clear() {
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Clear();
+}
+
+size_t ClosestContactsCache::Size() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return entries_.Size();
+}
+
+}  // namespace dht
+
+}  // namespace maidsafe
@@ -0,0 +1,106 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAIDSAFE_DHT_CLOSEST_CONTACTS_CACHE_H_
+#define MAIDSAFE_DHT_CLOSEST_CONTACTS_CACHE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "boost/date_time/posix_time/posix_time_types.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include "maidsafe/dht/contact.h"
+#include "maidsafe/dht/expiring_map.h"
+#include "maidsafe/dht/node_id.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace bptime = boost::posix_time;
+
+/**
+* @class ClosestContactsCache
+* Bounded, thread-safe map from recently looked-up targets to the contacts
+* found closest to them.  Entries expire after a fixed time to live, and any
+* entry holding a contact which has since failed is dropped.
+*/
+class ClosestContactsCache {
+ public:
+  /**
+  * @param[in] max_size The maximum number of targets held.  If 0, nothing is
+  * ever cached.
+  * @param[in] time_to_live The time for which each entry is served.
+  */
+  ClosestContactsCache(const size_t &max_size,
+                       const bptime::time_duration &time_to_live);
+
+  /**
+  * Records the contacts found closest to target, replacing any existing entry.
+  * If full, expired entries are purged, then the oldest is evicted.
+  * @param[in] target The lookup's target.
+  * @param[in] contacts The verified closest contacts, closest first.
+  */
+  void Add(const NodeId &target, const std::vector<Contact> &contacts);
+
+  /**
+  * Gets the closest contacts to target if an unexpired entry holds at least
+  * count of them.
+  * @param[in] target The lookup's target.
+  * @param[in] count The number of contacts required.
+  * @param[out] contacts The count closest contacts, closest first.
+  * @return True if the contacts were found.
+  */
+  bool Get(const NodeId &target,
+           const size_t &count,
+           std::vector<Contact> *contacts);
+
+  /**
+  * Drops every entry which holds the given contact.
+  * @param[in] node_id The ID of the contact which has failed.
+  */
+  void Invalidate(const NodeId &node_id);
+
+  void Clear();
+
+  size_t Size();
+
+ private:
+  ClosestContactsCache(const ClosestContactsCache&);
+  ClosestContactsCache& operator=(const ClosestContactsCache&);
+  const size_t kMaxSize_;
+  const bptime::time_duration kTimeToLive_;
+  ExpiringMap<NodeId, std::vector<Contact>> entries_;
+  boost::mutex mutex_;
+};
+
+}  // namespace dht
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DHT_CLOSEST_CONTACTS_CACHE_H_
@@ -62,6 +62,7 @@ namespace dht {
 class Contact;
 class NodeId;
 class MessageHandler;
+class OperationHandle;
 
 enum OnlineStatus { kOffline, kOnline, kAttemptingConnect };
 
@@ -83,10 +84,26 @@ typedef std::function<void(int)> JoinFunctor, StoreFunctor, DeleteFunctor,  // N
 // and contact details of node needing a cache copy of the values.
 typedef std::function<void(FindValueReturns)> FindValueFunctor;
 
+// Functor for use in Node::FindValues.  Parameter is the FindValueReturns for
+// each key, in the order the keys were passed.
+typedef std::function<void(std::vector<FindValueReturns>)> FindValuesFunctor;
+
+// Functor for use in Node::StoreMany.  Parameter is the return code for each
+// key, in the order the keys were passed.
+typedef std::function<void(std::vector<int>)> StoreManyFunctor;
+
 // Functor for use in Node::FindNodes.  Parameters in order are: return code,
 // k closest nodes.
 typedef std::function<void(int, std::vector<Contact>)> FindNodesFunctor;
 
+// Functor for use in Node::FindNodesWithProgress.  Parameter is the nodes which
+// have responded so far, ordered by closeness to the key, closest first.
+typedef std::function<void(std::vector<Contact>)> FindNodesProgressFunctor;
+
+// Predicate for use in Node::FindNodesWithProgress.  Parameter is as for
+// FindNodesProgressFunctor.  Returning true ends the lookup with these nodes.
+typedef std::function<bool(const std::vector<Contact>&)> FindNodesStopFunctor;  // NOLINT (Fraser)
+
 // Functor for use in Node::GetContact.  Parameters in order are: return code,
 // node's contact details.
 typedef std::function<void(int, Contact)> GetContactFunctor;
@@ -108,6 +125,7 @@ typedef std::shared_ptr<asymm::Keys> KeyPairPtr;
 typedef std::shared_ptr<asymm::PrivateKey> PrivateKeyPtr;
 typedef std::shared_ptr<asymm::PublicKey> PublicKeyPtr;
 typedef std::shared_ptr<transport::Info> RankInfoPtr;
+typedef std::shared_ptr<OperationHandle> OperationHandlePtr;
 
 
 // The size of DHT keys and node IDs in bytes.
@@ -116,6 +134,102 @@ const uint16_t kKeySizeBytes(64);
 // The mean time between refreshes
 const boost::posix_time::seconds kMeanRefreshInterval(1800);
 
+// A k-bucket which has seen no activity for this long is refreshed by a lookup
+// for a random ID within its range.
+const boost::posix_time::seconds kKBucketRefreshInterval(3600);
+
+// The mean time between checks for k-buckets needing refreshed.  Each wait is
+// jittered by up to half of this either way.
+const boost::posix_time::seconds kKBucketRefreshCheckInterval(60);
+
+// The maximum number of k-bucket refresh lookups a node runs at once.
+const uint16_t kMaxConcurrentKBucketRefreshes(2);
+
+// The maximum number of lookups a node runs at once, in total and for each
+// priority class: interactive (single-key operations), maintenance (data store
+// refreshes) and bulk (FindValues and StoreMany).  A lookup's slot is held
+// until its lookup phase completes.
+const uint16_t kMaxConcurrentLookups(64);
+const uint16_t kMaxConcurrentInteractiveLookups(64);
+const uint16_t kMaxConcurrentMaintenanceLookups(8);
+const uint16_t kMaxConcurrentBulkLookups(16);
+
+// The maximum number of RPCs awaiting replies at once, in total and for each
+// of the priority classes above.  These count the RPCs of both phases of an
+// operation, including those still outstanding once its lookup has completed.
+// Further RPCs are queued.  Pings, downlists and cache notifications aren't
+// counted.
+const uint16_t kMaxRpcsInFlight(256);
+const uint16_t kMaxInteractiveRpcsInFlight(256);
+const uint16_t kMaxMaintenanceRpcsInFlight(32);
+const uint16_t kMaxBulkRpcsInFlight(64);
+
+// Unsigned RPCs are encrypted under a symmetric session key, which is itself
+// encrypted to the peer's public key only once per session.  A session key is
+// used for at most kSessionKeyLifetime or kMaxSessionMessages messages, and at
+// most kMaxSessionKeys are cached each way.  If a peer doesn't answer a
+// session request, the RPC is retried asymmetrically encrypted and no session
+// is used with that peer for kSessionFallbackPeriod.
+const boost::posix_time::minutes kSessionKeyLifetime(30);
+const uint32_t kMaxSessionMessages(10000);
+const uint16_t kMaxSessionKeys(1024);
+const boost::posix_time::minutes kSessionFallbackPeriod(10);
+
+// Signatures which have passed validation are remembered for
+// kSignatureCacheTtl, so that the same signed store or delete refreshed by each
+// of k peers every refresh interval is only checked once.  Each validator has
+// its own cache, of at most kMaxSignatureCacheSize signatures.
+const boost::posix_time::hours kSignatureCacheTtl(2);
+const uint16_t kMaxSignatureCacheSize(4096);
+
+// The public key and validation token fetched for a publisher's public key ID
+// are reused for kPublicKeyCacheTtl, or kPublicKeyCacheNegativeTtl if the key
+// fetched wasn't valid.  At most kMaxPublicKeyCacheSize IDs are remembered.
+const boost::posix_time::minutes kPublicKeyCacheTtl(10);
+const boost::posix_time::seconds kPublicKeyCacheNegativeTtl(30);
+const uint16_t kMaxPublicKeyCacheSize(1024);
+
+// The signature checks of incoming stores and deletes, and the signing of
+// values passed to Store, Delete or Update unsigned, run on kCryptoPoolThreads
+// worker threads rather than the asio threads.  Each worker takes up to
+// kCryptoPoolBatchSize tasks at once.  Beyond kMaxCryptoPoolQueueSize waiting
+// tasks, work is done inline again.
+const uint16_t kCryptoPoolThreads(2);
+const uint16_t kCryptoPoolBatchSize(16);
+const uint16_t kMaxCryptoPoolQueueSize(4096);
+
+// Bounds on the deadline after which an unanswered lookup RPC is treated as a
+// straggler, freeing its slot for the next closest contact.  Within these, the
+// deadline is derived from the peer's measured round trip times, or from those
+// of all peers if none have been measured to it.
+const boost::posix_time::milliseconds kMinLookupRpcSoftTimeout(250);
+const boost::posix_time::seconds kMaxLookupRpcSoftTimeout(3);
+
+// The time for which the closest contacts found by a lookup are reused by later
+// lookups for the same target, and the maximum number of targets remembered.
+const boost::posix_time::seconds kClosestContactsCacheTtl(30);
+const uint16_t kMaxClosestContactsCacheSize(256);
+
+// The time for which a contact which failed to answer a lookup RPC is skipped
+// by all lookups, unless it answers another RPC first, and the maximum number
+// of such suspects remembered.
+const boost::posix_time::seconds kSuspectTtl(60);
+const uint16_t kMaxSuspectListSize(256);
+
+// A value found by a lookup is cached at the closest node queried which didn't
+// hold it.  The cached copy lives for kMaxCachedValueTtl, halved for each bit
+// by which that node is further than the value holder from the key, and isn't
+// sent at all if this falls below kMinCachedValueTtl.  Each node caches values
+// under at most kMaxValueCacheSize keys.
+const boost::posix_time::seconds kMaxCachedValueTtl(3600);
+const boost::posix_time::seconds kMinCachedValueTtl(10);
+const uint16_t kMaxValueCacheSize(1024);
+
+// The maximum number of keys carried by a single batched FindValue, FindNodes
+// or Store RPC.  Larger batches for a peer are split, and larger incoming
+// batches are rejected.
+const uint16_t kMaxRpcBatchSize(64);
+
 // The ratio of k successful individual kad store RPCs to yield overall success.
 const double kMinSuccessfulPecentageStore(0.75);
 
@@ -129,6 +243,10 @@ const double kMinSuccessfulPecentageUpdate(0.75);
 // routing table.
 const uint16_t kFailedRpcTolerance(2);
 
+// The time after which an unanswered ping of a full k-bucket's oldest contact
+// is abandoned, allowing the next replacement candidate to trigger another.
+const boost::posix_time::seconds kOldestContactProbeTimeout(30);
+
 // The minimum number of directly-connected contacts returned by
 // GetBootstrapContacts.  If there are less than this, the list has all other
 // known contacts appended.
@@ -230,7 +230,7 @@ Contact& Contact::operator=(const Contact &other) {
 
 bool Contact::operator==(const Contact &other) const {
   if (node_id_ == other.node_id_)
-    return (node_id_.String() != kZeroId) ||
+    return (node_id_ != NodeId()) ||
            (endpoint().ip == other.endpoint().ip);
   else
     return false;
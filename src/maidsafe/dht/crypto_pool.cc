@@ -0,0 +1,130 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "maidsafe/dht/crypto_pool.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace {
+
+void RunAndComplete(CryptoPool::Functor task,
+                    boost::asio::io_service *completion_service,
+                    CryptoPool::Functor completion) {
+  task();
+  completion_service->post(completion);
+}
+
+}  // unnamed namespace
+
+CryptoPool::CryptoPool(const uint16_t &thread_count,
+                       const size_t &max_queue_size,
+                       const size_t &batch_size)
+    : kThreadCount_(std::max(thread_count, static_cast<uint16_t>(1))),
+      kMaxQueueSize_(max_queue_size),
+      kBatchSize_(std::max(batch_size, static_cast<size_t>(1))),
+      tasks_(),
+      stopped_(false),
+      mutex_(),
+      condition_(),
+      workers_() {
+  for (uint16_t i = 0; i != kThreadCount_; ++i)
+    workers_.create_thread(std::bind(&CryptoPool::Run, this));
+}
+
+CryptoPool::~CryptoPool() {
+  Stop();
+}
+
+bool CryptoPool::Post(Functor task) {
+  if (!task)
+    return false;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (stopped_ || tasks_.size() >= kMaxQueueSize_)
+      return false;
+    tasks_.push_back(task);
+  }
+  condition_.notify_one();
+  return true;
+}
+
+bool CryptoPool::Post(Functor task,
+                      boost::asio::io_service &completion_service,  // NOLINT
+                      Functor completion) {
+  if (!task || !completion)
+    return false;
+  return Post(std::bind(&RunAndComplete, task, &completion_service,
+                        completion));
+}
+
+void CryptoPool::Stop() {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (stopped_)
+      return;
+    stopped_ = true;
+  }
+  condition_.notify_all();
+  workers_.join_all();
+}
+
+size_t CryptoPool::QueueSize() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return tasks_.size();
+}
+
+void CryptoPool::Run() {
+  std::vector<Functor> batch;
+  for (;;) {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (tasks_.empty() && !stopped_)
+        condition_.wait(lock);
+      if (tasks_.empty())
+        return;
+      // Take a share of the queue, so that a burst is spread over the workers
+      // while each still takes several tasks per wake-up when busy.
+      size_t count(std::min(kBatchSize_, tasks_.size()));
+      count = std::max(std::min(count, tasks_.size() / kThreadCount_),
+                       static_cast<size_t>(1));
+      batch.assign(tasks_.begin(), tasks_.begin() + count);
+      tasks_.erase(tasks_.begin(), tasks_.begin() + count);
+    }
+    for (auto it = batch.begin(); it != batch.end(); ++it)
+      (*it)();
+    batch.clear();
+  }
+}
+
+}  // namespace dht
+
+}  // namespace maidsafe
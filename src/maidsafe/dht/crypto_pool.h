@@ -0,0 +1,109 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAIDSAFE_DHT_CRYPTO_POOL_H_
+#define MAIDSAFE_DHT_CRYPTO_POOL_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/thread.hpp"
+
+namespace maidsafe {
+
+namespace dht {
+
+/**
+* @class CryptoPool
+* Fixed pool of worker threads for expensive cryptographic work (signing and
+* signature validation), so that it doesn't hold up the node's asio threads
+* and the cheap RPCs they serve.  Work is queued up to a bound and taken by
+* the workers in batches.  Completions are posted back to a given io_service.
+*/
+class CryptoPool {
+ public:
+  typedef std::function<void()> Functor;
+
+  /**
+  * Starts the worker threads.
+  * @param[in] thread_count The number of workers, at least 1.
+  * @param[in] max_queue_size The maximum number of tasks waiting for a worker.
+  * @param[in] batch_size The maximum number of tasks a worker takes at once.
+  */
+  CryptoPool(const uint16_t &thread_count,
+             const size_t &max_queue_size,
+             const size_t &batch_size);
+
+  /**
+  * Runs any tasks still queued, then stops the workers.
+  */
+  ~CryptoPool();
+
+  /**
+  * Queues task to be run by a worker.
+  * @param[in] task The work to run.
+  * @return False if the queue is full or the pool is stopped, in which case
+  * task is not run and the caller should run it itself.
+  */
+  bool Post(Functor task);
+
+  /**
+  * As above, posting completion to completion_service once task has run.
+  */
+  bool Post(Functor task,
+            boost::asio::io_service &completion_service,  // NOLINT
+            Functor completion);
+
+  /**
+  * Stops accepting tasks, runs those still queued and joins the workers.
+  */
+  void Stop();
+
+  size_t QueueSize();
+
+ private:
+  CryptoPool(const CryptoPool&);
+  CryptoPool& operator=(const CryptoPool&);
+  void Run();
+  const uint16_t kThreadCount_;
+  const size_t kMaxQueueSize_, kBatchSize_;
+  std::deque<Functor> tasks_;
+  bool stopped_;
+  boost::mutex mutex_;
+  boost::condition_variable condition_;
+  boost::thread_group workers_;
+};
+
+}  // namespace dht
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DHT_CRYPTO_POOL_H_
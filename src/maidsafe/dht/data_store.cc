@@ -86,7 +86,8 @@ DataStore::DataStore(const bptime::seconds &mean_refresh_interval)
       kRefreshInterval_(mean_refresh_interval.total_seconds() +
                         (RandomInt32() % 120)),
       shared_mutex_(),
-      debug_id_("Uninitialised Debug ID") {}
+      debug_id_("Uninitialised Debug ID"),
+      signature_cache_() {}
 
 bool DataStore::HasKey(const std::string &key) const {
   if (key.empty())
@@ -262,6 +263,25 @@ bool DataStore::GetValues(
   return (!values_and_signatures->empty());
 }
 
+bool DataStore::GetStoreRequest(
+    const std::string &key,
+    RequestAndSignature *request_and_signature) const {
+  if (!request_and_signature)
+    return false;
+  KeyValueIndex::index<TagKey>::type& index_by_key =
+      key_value_index_->get<TagKey>();
+  SharedLock shared_lock(shared_mutex_);
+  auto itr_pair = index_by_key.equal_range(key);
+  bptime::ptime now = bptime::microsec_clock::universal_time();
+  for (; itr_pair.first != itr_pair.second; ++itr_pair.first) {
+    if (((*itr_pair.first).expire_time > now) && !(*itr_pair.first).deleted) {
+      *request_and_signature = (*itr_pair.first).request_and_signature;
+      return true;
+    }
+  }
+  return false;
+}
+
 void DataStore::Refresh(std::vector<KeyValueTuple> *key_value_tuples) {
   KeyValueIndex::index<TagExpireTime>::type& index_by_expire_time =
       key_value_index_->get<TagExpireTime>();
@@ -332,6 +352,11 @@ bool DataStore::DifferentSigner(
   if ((*it).key_value_signature.signature == key_value_signature.signature)
     return false;
 
+  if (signature_cache_) {
+    return !signature_cache_->Validate((*it).key_value_signature.value,
+                                       (*it).key_value_signature.signature,
+                                       public_key);
+  }
   return !asymm::Validate((*it).key_value_signature.value,
                          (*it).key_value_signature.signature,
                          public_key);
@@ -52,6 +52,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "maidsafe/common/rsa.h"
 
 #include "maidsafe/dht/config.h"
+#include "maidsafe/dht/signature_cache.h"
 
 namespace bptime = boost::posix_time;
 
@@ -204,6 +205,11 @@ class DataStore {
   // true.
   bool GetValues(const std::string &key,
                  std::vector<ValueAndSignature> *values_and_signatures) const;
+  // If any values exist under key and are not marked as deleted, the store
+  // request and signature of one of them is set and the method returns true.
+  // All values under a key share a signer, so this identifies it.
+  bool GetStoreRequest(const std::string &key,
+                       RequestAndSignature *request_and_signature) const;
   // Refreshes datastore.  Values which have expired confirm times and which are
   // marked as deleted are removed from the datastore.  Values with expired
   // expire times are marked as deleted.  All values with expired refresh times
@@ -215,6 +221,10 @@ class DataStore {
   // public_key.
   bool DifferentSigner(const KeyValueSignature &key_value_signature,
                        const asymm::PublicKey &public_key) const;
+  // Once set, DifferentSigner validates signatures through signature_cache.
+  void set_signature_cache(std::shared_ptr<SignatureCache> signature_cache) {
+    signature_cache_ = signature_cache;
+  }
   bptime::seconds kRefreshInterval() const { return kRefreshInterval_; }
   void set_debug_id(const std::string &debug_id) { debug_id_ = debug_id; }
   friend class test::DataStoreTest;
@@ -235,6 +245,7 @@ class DataStore {
   const bptime::seconds kRefreshInterval_;
   mutable boost::shared_mutex shared_mutex_;
   std::string debug_id_;
+  std::shared_ptr<SignatureCache> signature_cache_;
 };
 
 }  // namespace dht
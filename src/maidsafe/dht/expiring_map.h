@@ -0,0 +1,167 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAIDSAFE_DHT_EXPIRING_MAP_H_
+#define MAIDSAFE_DHT_EXPIRING_MAP_H_
+
+#include <map>
+
+#include "boost/date_time/posix_time/posix_time_types.hpp"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace bptime = boost::posix_time;
+
+/**
+* @class ExpiringMap
+* Bounded map whose entries each expire at a given time, underlying the node's
+* caches.  Expired entries are dropped as they are found, and when a new key is
+* inserted into a full map, expired entries are purged, then the entry closest
+* to expiry is evicted.  Not thread-safe; the owner serialises access.
+*/
+template <typename Key, typename Value>
+class ExpiringMap {
+ public:
+  /**
+  * @param[in] max_size The maximum number of entries held.  If 0, nothing is
+  * ever held.
+  */
+  explicit ExpiringMap(const size_t &max_size)
+      : kMaxSize_(max_size), entries_() {}
+
+  /**
+  * Inserts or replaces the entry for key, making room for it if required.
+  * @param[in] key The entry's key.
+  * @param[in] value The entry's value.
+  * @param[in] expiry_time The time after which the entry is no longer found.
+  * @param[in] now The current time.
+  * @return The value held, or NULL if the map holds nothing.
+  */
+  Value* Insert(const Key &key,
+                const Value &value,
+                const bptime::ptime &expiry_time,
+                const bptime::ptime &now) {
+    if (kMaxSize_ == 0)
+      return NULL;
+    if (entries_.size() >= kMaxSize_ && entries_.find(key) == entries_.end()) {
+      auto soonest(entries_.end());
+      for (auto it = entries_.begin(); it != entries_.end();) {
+        if ((*it).second.expiry_time <= now) {
+          entries_.erase(it++);
+          continue;
+        }
+        if (soonest == entries_.end() ||
+            (*it).second.expiry_time < (*soonest).second.expiry_time)
+          soonest = it;
+        ++it;
+      }
+      if (entries_.size() >= kMaxSize_)
+        entries_.erase(soonest);
+    }
+    Entry &entry(entries_[key]);
+    entry.value = value;
+    entry.expiry_time = expiry_time;
+    return &entry.value;
+  }
+
+  /**
+  * Finds the unexpired entry for key, dropping it if it has expired.
+  * @param[in] key The entry's key.
+  * @param[in] now The current time.
+  * @return The value held, or NULL if there is none.  Valid until the map is
+  * next modified.
+  */
+  Value* Find(const Key &key, const bptime::ptime &now) {
+    auto it(entries_.find(key));
+    if (it == entries_.end())
+      return NULL;
+    if ((*it).second.expiry_time <= now) {
+      entries_.erase(it);
+      return NULL;
+    }
+    return &(*it).second.value;
+  }
+
+  /**
+  * @param[in] key The entry's key.
+  * @return True if an entry, expired or not, was removed.
+  */
+  bool Erase(const Key &key) { return entries_.erase(key) != 0U; }
+
+  /**
+  * Removes every entry whose value matches predicate.
+  * @param[in] predicate Called with each value held.
+  */
+  template <typename Predicate>
+  void EraseIf(Predicate predicate) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (predicate((*it).second.value))
+        entries_.erase(it++);
+      else
+        ++it;
+    }
+  }
+
+  /**
+  * Drops expired entries, then calls functor with each unexpired value.
+  * @param[in] now The current time.
+  * @param[in] functor Called with each value held.
+  */
+  template <typename Functor>
+  void ForEach(const bptime::ptime &now, Functor functor) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if ((*it).second.expiry_time <= now) {
+        entries_.erase(it++);
+      } else {
+        functor((*it).second.value);
+        ++it;
+      }
+    }
+  }
+
+  void Clear() { entries_.clear(); }
+
+  /** @return The number of entries held, including any not yet purged. */
+  size_t Size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    Entry() : value(), expiry_time() {}
+    Value value;
+    bptime::ptime expiry_time;
+  };
+  const size_t kMaxSize_;
+  std::map<Key, Entry> entries_;
+};
+
+}  // namespace dht
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DHT_EXPIRING_MAP_H_
@@ -0,0 +1,215 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "maidsafe/dht/lookup_scheduler.h"
+
+#include <utility>
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace {
+// The order in which queues are offered a free slot: interactive lookups or
+// RPCs get four turns and maintenance two for each turn of bulk.
+const LookupScheduler::Priority kTurns[] = {
+    LookupScheduler::kInteractive, LookupScheduler::kMaintenance,
+    LookupScheduler::kInteractive, LookupScheduler::kBulk,
+    LookupScheduler::kInteractive, LookupScheduler::kMaintenance,
+    LookupScheduler::kInteractive
+};
+const size_t kTurnCount(sizeof(kTurns) / sizeof(kTurns[0]));
+}  // unnamed namespace
+
+LookupScheduler::Slot::Slot(std::shared_ptr<LookupScheduler> scheduler,
+                            SlotType type,
+                            Priority priority)
+    : scheduler_(scheduler),
+      kType_(type),
+      kPriority_(priority),
+      released_(false) {}
+
+LookupScheduler::Slot::~Slot() {
+  Release();
+}
+
+void LookupScheduler::Slot::Release() {
+  std::shared_ptr<LookupScheduler> scheduler(scheduler_.lock());
+  if (scheduler)
+    scheduler->Release(this);
+}
+
+LookupScheduler::Limits::Limits(const uint16_t &max_total,
+                                const uint16_t &max_interactive,
+                                const uint16_t &max_maintenance,
+                                const uint16_t &max_bulk)
+    : kMaxTotal(max_total),
+      total_running(0),
+      next_turn(0) {
+  max_running[kInteractive] = max_interactive;
+  max_running[kMaintenance] = max_maintenance;
+  max_running[kBulk] = max_bulk;
+  for (int i = 0; i != kPriorityCount; ++i)
+    running[i] = 0;
+}
+
+LookupScheduler::LookupScheduler(
+    boost::asio::io_service &asio_service,  // NOLINT (Fraser)
+    const uint16_t &max_running,
+    const uint16_t &max_interactive,
+    const uint16_t &max_maintenance,
+    const uint16_t &max_bulk,
+    const uint16_t &max_rpcs,
+    const uint16_t &max_interactive_rpcs,
+    const uint16_t &max_maintenance_rpcs,
+    const uint16_t &max_bulk_rpcs)
+    : asio_service_(asio_service),
+      lookup_limits_(max_running, max_interactive, max_maintenance, max_bulk),
+      rpc_limits_(max_rpcs, max_interactive_rpcs, max_maintenance_rpcs,
+                  max_bulk_rpcs),
+      mutex_() {}
+
+void LookupScheduler::Schedule(Priority priority, StartFunctor start) {
+  Runnable runnable;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    Enqueue(kLookupSlot, priority, start, &runnable);
+  }
+  for (auto it = runnable.begin(); it != runnable.end(); ++it)
+    (*it).first((*it).second);
+}
+
+void LookupScheduler::ScheduleRpc(Priority priority, StartFunctor send) {
+  Runnable runnable;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    Enqueue(kRpcSlot, priority, send, &runnable);
+  }
+  for (auto it = runnable.begin(); it != runnable.end(); ++it)
+    (*it).first((*it).second);
+}
+
+void LookupScheduler::QueueRpc(Priority priority, StartFunctor send) {
+  Runnable runnable;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    Enqueue(kRpcSlot, priority, send, &runnable);
+  }
+  PostRunnable(runnable);
+}
+
+LookupScheduler::SlotPtr LookupScheduler::TryAcquireRpcSlot(
+    Priority priority) {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (rpc_limits_.total_running >= rpc_limits_.kMaxTotal ||
+      rpc_limits_.running[priority] >= rpc_limits_.max_running[priority] ||
+      !rpc_limits_.queues[priority].empty())
+    return SlotPtr();
+  ++rpc_limits_.running[priority];
+  ++rpc_limits_.total_running;
+  return SlotPtr(new Slot(shared_from_this(), kRpcSlot, priority));
+}
+
+size_t LookupScheduler::RunningCount(Priority priority) {
+  boost::mutex::scoped_lock lock(mutex_);
+  return lookup_limits_.running[priority];
+}
+
+size_t LookupScheduler::QueuedCount(Priority priority) {
+  boost::mutex::scoped_lock lock(mutex_);
+  return lookup_limits_.queues[priority].size();
+}
+
+size_t LookupScheduler::RpcsInFlight(Priority priority) {
+  boost::mutex::scoped_lock lock(mutex_);
+  return rpc_limits_.running[priority];
+}
+
+size_t LookupScheduler::QueuedRpcCount(Priority priority) {
+  boost::mutex::scoped_lock lock(mutex_);
+  return rpc_limits_.queues[priority].size();
+}
+
+LookupScheduler::Limits& LookupScheduler::LimitsFor(SlotType type) {
+  return type == kLookupSlot ? lookup_limits_ : rpc_limits_;
+}
+
+void LookupScheduler::Release(Slot *slot) {
+  Runnable runnable;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (slot->released_)
+      return;
+    slot->released_ = true;
+    Limits &limits(LimitsFor(slot->kType_));
+    --limits.running[slot->kPriority_];
+    --limits.total_running;
+    DequeueRunnable(slot->kType_, &runnable);
+  }
+  // This may be running with a lookup's mutex held, so start the next lookups
+  // or RPCs afresh.
+  PostRunnable(runnable);
+}
+
+void LookupScheduler::Enqueue(SlotType type,
+                              Priority priority,
+                              StartFunctor start,
+                              Runnable *runnable) {
+  LimitsFor(type).queues[priority].push_back(start);
+  DequeueRunnable(type, runnable);
+}
+
+void LookupScheduler::DequeueRunnable(SlotType type, Runnable *runnable) {
+  Limits &limits(LimitsFor(type));
+  while (limits.total_running < limits.kMaxTotal) {
+    bool found(false);
+    for (size_t i = 0; i != kTurnCount && !found; ++i) {
+      const Priority kPriority(kTurns[(limits.next_turn + i) % kTurnCount]);
+      if (limits.queues[kPriority].empty() ||
+          limits.running[kPriority] >= limits.max_running[kPriority])
+        continue;
+      found = true;
+      limits.next_turn = (limits.next_turn + i + 1) % kTurnCount;
+      ++limits.running[kPriority];
+      ++limits.total_running;
+      runnable->push_back(std::make_pair(limits.queues[kPriority].front(),
+          SlotPtr(new Slot(shared_from_this(), type, kPriority))));
+      limits.queues[kPriority].pop_front();
+    }
+    if (!found)
+      return;
+  }
+}
+
+void LookupScheduler::PostRunnable(const Runnable &runnable) {
+  for (auto it = runnable.begin(); it != runnable.end(); ++it)
+    asio_service_.post(std::bind((*it).first, (*it).second));
+}
+
+}  // namespace dht
+
+}  // namespace maidsafe
@@ -0,0 +1,189 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAIDSAFE_DHT_LOOKUP_SCHEDULER_H_
+#define MAIDSAFE_DHT_LOOKUP_SCHEDULER_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/thread/mutex.hpp"
+
+namespace maidsafe {
+
+namespace dht {
+
+/**
+* @class LookupScheduler
+* Limits the number of lookups a node runs at once, and the number of RPCs they
+* have awaiting replies, both in total and per priority class.  Lookups and
+* RPCs which can't start immediately are queued, and as slots free up the
+* queues are served in a weighted round robin, so that interactive work is
+* favoured without starving the other classes.
+*/
+class LookupScheduler : public std::enable_shared_from_this<LookupScheduler> {
+ public:
+  enum Priority {
+    kInteractive,
+    kMaintenance,
+    kBulk,
+    kPriorityCount
+  };
+
+  enum SlotType {
+    kLookupSlot,
+    kRpcSlot
+  };
+
+  /**
+  * @class Slot
+  * Held by a running lookup or an RPC awaiting its reply.  Releasing or
+  * destroying it frees the slot for the next queued lookup or RPC.
+  */
+  class Slot {
+   public:
+    Slot(std::shared_ptr<LookupScheduler> scheduler,
+         SlotType type,
+         Priority priority);
+    ~Slot();
+    /** Frees the slot.  Later calls, and destroying it, do nothing more. */
+    void Release();
+   private:
+    Slot(const Slot&);
+    Slot& operator=(const Slot&);
+    std::weak_ptr<LookupScheduler> scheduler_;
+    const SlotType kType_;
+    const Priority kPriority_;
+    bool released_;
+  };
+  typedef std::shared_ptr<Slot> SlotPtr;
+  typedef std::function<void(SlotPtr)> StartFunctor;
+
+  /**
+  * @param[in] asio_service Used to start lookups and send RPCs dequeued as
+  * slots free up.
+  * @param[in] max_running The maximum number of lookups run at once.
+  * @param[in] max_interactive The maximum number of interactive lookups.
+  * @param[in] max_maintenance The maximum number of maintenance lookups.
+  * @param[in] max_bulk The maximum number of bulk lookups.
+  * @param[in] max_rpcs The maximum number of RPCs awaiting replies at once.
+  * @param[in] max_interactive_rpcs The maximum number of interactive RPCs.
+  * @param[in] max_maintenance_rpcs The maximum number of maintenance RPCs.
+  * @param[in] max_bulk_rpcs The maximum number of bulk RPCs.
+  */
+  LookupScheduler(boost::asio::io_service &asio_service,  // NOLINT (Fraser)
+                  const uint16_t &max_running,
+                  const uint16_t &max_interactive,
+                  const uint16_t &max_maintenance,
+                  const uint16_t &max_bulk,
+                  const uint16_t &max_rpcs,
+                  const uint16_t &max_interactive_rpcs,
+                  const uint16_t &max_maintenance_rpcs,
+                  const uint16_t &max_bulk_rpcs);
+
+  /**
+  * Invokes start with a slot now if there is room for a lookup of the given
+  * priority, otherwise queues it to be posted to asio_service later.
+  * @param[in] priority The lookup's priority class.
+  * @param[in] start Starts the lookup, which must hold the slot until done.
+  */
+  void Schedule(Priority priority, StartFunctor start);
+
+  /**
+  * Invokes send with a slot now if there is room for an RPC of the given
+  * priority, otherwise queues it as QueueRpc does.
+  * @param[in] priority The RPC's priority class.
+  * @param[in] send Sends the RPC, which must hold the slot until answered.
+  */
+  void ScheduleRpc(Priority priority, StartFunctor send);
+
+  /**
+  * Queues send to be posted to asio_service with a slot once there is room for
+  * an RPC of the given priority.  send is never invoked before this returns.
+  * @param[in] priority The RPC's priority class.
+  * @param[in] send Sends the RPC, which must hold the slot until answered.
+  */
+  void QueueRpc(Priority priority, StartFunctor send);
+
+  /**
+  * @param[in] priority The RPC's priority class.
+  * @return A slot if there is room for an RPC of the given priority and none
+  * of that priority is queued, otherwise NULL.
+  */
+  SlotPtr TryAcquireRpcSlot(Priority priority);
+
+  size_t RunningCount(Priority priority);
+
+  size_t QueuedCount(Priority priority);
+
+  size_t RpcsInFlight(Priority priority);
+
+  size_t QueuedRpcCount(Priority priority);
+
+  friend class Slot;
+
+ private:
+  struct Limits {
+    Limits(const uint16_t &max_total,
+           const uint16_t &max_interactive,
+           const uint16_t &max_maintenance,
+           const uint16_t &max_bulk);
+    const uint16_t kMaxTotal;
+    uint16_t max_running[kPriorityCount];
+    uint16_t running[kPriorityCount];
+    uint16_t total_running;
+    std::deque<StartFunctor> queues[kPriorityCount];
+    size_t next_turn;
+  };
+  typedef std::deque<std::pair<StartFunctor, SlotPtr>> Runnable;
+  LookupScheduler(const LookupScheduler&);
+  LookupScheduler& operator=(const LookupScheduler&);
+  Limits& LimitsFor(SlotType type);
+  /** Frees slot unless it has been freed already. */
+  void Release(Slot *slot);
+  /** Queues start and takes whatever may now run.  mutex_ must be held. */
+  void Enqueue(SlotType type,
+               Priority priority,
+               StartFunctor start,
+               Runnable *runnable);
+  /** Takes as many queued entries as may now run.  mutex_ must be held. */
+  void DequeueRunnable(SlotType type, Runnable *runnable);
+  void PostRunnable(const Runnable &runnable);
+  boost::asio::io_service &asio_service_;
+  Limits lookup_limits_, rpc_limits_;
+  boost::mutex mutex_;
+};
+
+}  // namespace dht
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DHT_LOOKUP_SCHEDULER_H_
@@ -37,18 +37,49 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifdef __MSVC__
 #  pragma warning(pop)
 #endif
+#include "maidsafe/dht/session_cache.h"
+#include "maidsafe/dht/signature_cache.h"
 
 namespace maidsafe {
 
 namespace dht {
 
+namespace {
+
+// Whether a message of this type may be carried in a session message.  Signed
+// messages (stores, deletes and their refreshes) are always sent
+// asymmetrically encrypted.  A StoreBatch isn't signed as a whole, since each
+// of its store requests carries its own signature.
+bool IsSessionMessageType(const int &message_type, const bool &is_request) {
+  switch (message_type) {
+    case kPingRequest:
+    case kFindValueRequest:
+    case kFindNodesRequest:
+    case kFindValueBatchRequest:
+    case kFindNodesBatchRequest:
+    case kStoreBatchRequest:
+      return is_request;
+    case kPingResponse:
+    case kFindValueResponse:
+    case kFindNodesResponse:
+    case kFindValueBatchResponse:
+    case kFindNodesBatchResponse:
+    case kStoreBatchResponse:
+      return !is_request;
+    default:
+      return false;
+  }
+}
+
+}  // unnamed namespace
+
 std::string MessageHandler::WrapMessage(
     const protobuf::PingRequest &msg,
     const asymm::PublicKey &recipient_public_key) {
   if (!msg.IsInitialized())
     return "";
-  return MakeSerialisedWrapperMessage(kPingRequest, msg.SerializeAsString(),
-                                      kAsymmetricEncrypt, recipient_public_key);
+  return WrapRequest(kPingRequest, msg.SerializeAsString(),
+                     recipient_public_key);
 }
 
 std::string MessageHandler::WrapMessage(
@@ -65,9 +96,8 @@ std::string MessageHandler::WrapMessage(
     const asymm::PublicKey &recipient_public_key) {
   if (!msg.IsInitialized())
     return "";
-  return MakeSerialisedWrapperMessage(kFindValueRequest,
-                                      msg.SerializeAsString(),
-                                      kAsymmetricEncrypt, recipient_public_key);
+  return WrapRequest(kFindValueRequest, msg.SerializeAsString(),
+                     recipient_public_key);
 }
 
 std::string MessageHandler::WrapMessage(
@@ -86,10 +116,8 @@ std::string MessageHandler::WrapMessage(
     const asymm::PublicKey &recipient_public_key) {
   if (!msg.IsInitialized())
     return "";
-  return MakeSerialisedWrapperMessage(kFindNodesRequest,
-                                      msg.SerializeAsString(),
-                                      kAsymmetricEncrypt,
-                                      recipient_public_key);
+  return WrapRequest(kFindNodesRequest, msg.SerializeAsString(),
+                     recipient_public_key);
 }
 
 std::string MessageHandler::WrapMessage(
@@ -198,6 +226,172 @@ std::string MessageHandler::WrapMessage(
                                       recipient_public_key);
 }
 
+std::string MessageHandler::WrapMessage(
+    const protobuf::StoreCacheNotification &msg,
+    const asymm::PublicKey &recipient_public_key) {
+  if (!msg.IsInitialized())
+    return "";
+  return MakeSerialisedWrapperMessage(kStoreCacheNotification,
+                                      msg.SerializeAsString(),
+                                      kAsymmetricEncrypt,
+                                      recipient_public_key);
+}
+
+std::string MessageHandler::WrapMessage(
+    const protobuf::FindValueBatchRequest &msg,
+    const asymm::PublicKey &recipient_public_key) {
+  if (!msg.IsInitialized())
+    return "";
+  return WrapRequest(kFindValueBatchRequest, msg.SerializeAsString(),
+                     recipient_public_key);
+}
+
+std::string MessageHandler::WrapMessage(
+    const protobuf::FindValueBatchResponse &msg,
+    const asymm::PublicKey &recipient_public_key) {
+  if (!msg.IsInitialized())
+    return "";
+  return MakeSerialisedWrapperMessage(kFindValueBatchResponse,
+                                      msg.SerializeAsString(),
+                                      kAsymmetricEncrypt,
+                                      recipient_public_key);
+}
+
+std::string MessageHandler::WrapMessage(
+    const protobuf::FindNodesBatchRequest &msg,
+    const asymm::PublicKey &recipient_public_key) {
+  if (!msg.IsInitialized())
+    return "";
+  return WrapRequest(kFindNodesBatchRequest, msg.SerializeAsString(),
+                     recipient_public_key);
+}
+
+std::string MessageHandler::WrapMessage(
+    const protobuf::FindNodesBatchResponse &msg,
+    const asymm::PublicKey &recipient_public_key) {
+  if (!msg.IsInitialized())
+    return "";
+  return MakeSerialisedWrapperMessage(kFindNodesBatchResponse,
+                                      msg.SerializeAsString(),
+                                      kAsymmetricEncrypt,
+                                      recipient_public_key);
+}
+
+std::string MessageHandler::WrapMessage(
+    const protobuf::StoreBatchRequest &msg,
+    const asymm::PublicKey &recipient_public_key) {
+  if (!msg.IsInitialized())
+    return "";
+  return WrapRequest(kStoreBatchRequest, msg.SerializeAsString(),
+                     recipient_public_key);
+}
+
+std::string MessageHandler::WrapMessage(
+    const protobuf::StoreBatchResponse &msg,
+    const asymm::PublicKey &recipient_public_key) {
+  if (!msg.IsInitialized())
+    return "";
+  return MakeSerialisedWrapperMessage(kStoreBatchResponse,
+                                      msg.SerializeAsString(),
+                                      kAsymmetricEncrypt,
+                                      recipient_public_key);
+}
+
+void MessageHandler::set_session_cache(
+    std::shared_ptr<SessionCache> session_cache) {
+  session_cache_ = session_cache;
+}
+
+void MessageHandler::set_signature_cache(
+    std::shared_ptr<SignatureCache> signature_cache) {
+  signature_cache_ = signature_cache;
+}
+
+bool MessageHandler::ValidateSignature(const std::string &message,
+                                       const std::string &message_signature,
+                                       const asymm::PublicKey &public_key) {
+  if (signature_cache_)
+    return signature_cache_->Validate(message, message_signature, public_key);
+  return asymm::Validate(message, message_signature, public_key);
+}
+
+std::string MessageHandler::WrapRequest(
+    const int &message_type,
+    const std::string &payload,
+    const asymm::PublicKey &recipient_public_key) {
+  if (session_cache_) {
+    std::string session_key, encrypted_session_key;
+    if (session_cache_->GetOutgoingSession(recipient_public_key, &session_key,
+                                           &encrypted_session_key)) {
+      std::string message(WrapSessionMessage(true, message_type, payload,
+                                             recipient_public_key, session_key,
+                                             encrypted_session_key));
+      if (!message.empty()) {
+        boost::mutex::scoped_lock lock(session_mutex_);
+        session_key_ = session_key;
+        session_request_ = true;
+        session_request_type_ = message_type;
+        session_request_payload_ = payload;
+        session_recipient_public_key_ = recipient_public_key;
+        fallback_request_.clear();
+        return message;
+      }
+    }
+  }
+  return MakeSerialisedWrapperMessage(message_type, payload, kAsymmetricEncrypt,
+                                      recipient_public_key);
+}
+
+std::string MessageHandler::WrapSessionFallback() {
+  boost::mutex::scoped_lock lock(session_mutex_);
+  if (!session_request_)
+    return "";
+  if (fallback_request_.empty()) {
+    fallback_request_ = MakeSerialisedWrapperMessage(
+        session_request_type_, session_request_payload_, kAsymmetricEncrypt,
+        session_recipient_public_key_);
+    if (session_cache_)
+      session_cache_->SuspendOutgoingSessions(session_recipient_public_key_);
+  }
+  return fallback_request_;
+}
+
+template <typename Response>
+std::string MessageHandler::WrapResponse(
+    const Response &response,
+    const int &message_type,
+    const asymm::PublicKey &recipient_public_key,
+    const std::string &session_key) {
+  if (session_key.empty())
+    return WrapMessage(response, recipient_public_key);
+  if (!response.IsInitialized())
+    return "";
+  return WrapSessionMessage(false, message_type, response.SerializeAsString(),
+                            recipient_public_key, session_key, "");
+}
+
+std::string MessageHandler::WrapSessionMessage(
+    const bool &is_request,
+    const int &message_type,
+    const std::string &payload,
+    const asymm::PublicKey &recipient_public_key,
+    const std::string &session_key,
+    const std::string &encrypted_session_key) {
+  protobuf::SessionPayload session_payload;
+  session_payload.set_message_type(message_type);
+  session_payload.set_payload(payload);
+  protobuf::SessionMessage session_message;
+  if (!SessionCache::Seal(session_key, is_request,
+                          session_payload.SerializeAsString(),
+                          &session_message))
+    return "";
+  if (!encrypted_session_key.empty())
+    session_message.set_encrypted_session_key(encrypted_session_key);
+  return MakeSerialisedWrapperMessage(
+      is_request ? kSessionRequest : kSessionResponse,
+      session_message.SerializeAsString(), kNone, recipient_public_key);
+}
+
 void MessageHandler::ProcessSerialisedMessage(
     const int &message_type,
     const std::string &payload,
@@ -206,6 +400,61 @@ void MessageHandler::ProcessSerialisedMessage(
     const transport::Info &info,
     std::string *message_response,
     transport::Timeout* timeout) {
+  if (message_type == kSessionRequest || message_type == kSessionResponse) {
+    message_response->clear();
+    *timeout = transport::kImmediateTimeout;
+    if (security_type == kNone)
+      ProcessSessionMessage(message_type == kSessionRequest, payload, info,
+                            message_response, timeout);
+    return;
+  }
+  ProcessMessage(message_type, payload, security_type, message_signature, info,
+                 "", message_response, timeout);
+}
+
+void MessageHandler::ProcessSessionMessage(const bool &is_request,
+                                           const std::string &payload,
+                                           const transport::Info &info,
+                                           std::string *message_response,
+                                           transport::Timeout *timeout) {
+  protobuf::SessionMessage session_message;
+  if (!session_message.ParseFromString(payload) ||
+      !session_message.IsInitialized())
+    return;
+  std::string session_key;
+  if (is_request) {
+    if (!session_cache_ || !session_message.has_encrypted_session_key() ||
+        !session_cache_->GetIncomingSession(
+            session_message.encrypted_session_key(), &session_key))
+      return;
+  } else {
+    boost::mutex::scoped_lock lock(session_mutex_);
+    session_key = session_key_;
+  }
+  std::string plain_text;
+  protobuf::SessionPayload session_payload;
+  if (!SessionCache::Open(session_key, is_request, session_message,
+                          &plain_text) ||
+      !session_payload.ParseFromString(plain_text) ||
+      !session_payload.IsInitialized() ||
+      !IsSessionMessageType(session_payload.message_type(), is_request))
+    return;
+  // The payload was authenticated and decrypted with a key only the peer and
+  // this node hold, so it is handled as if it had been sent asymmetrically
+  // encrypted.  Responses to session requests are sealed with the same key.
+  ProcessMessage(session_payload.message_type(), session_payload.payload(),
+                 kAsymmetricEncrypt, "", info, is_request ? session_key : "",
+                 message_response, timeout);
+}
+
+void MessageHandler::ProcessMessage(const int &message_type,
+                                    const std::string &payload,
+                                    const SecurityType &security_type,
+                                    const std::string &message_signature,
+                                    const transport::Info &info,
+                                    const std::string &session_key,
+                                    std::string *message_response,
+                                    transport::Timeout *timeout) {
   message_response->clear();
   *timeout = transport::kImmediateTimeout;
   switch (message_type) {
@@ -219,8 +468,8 @@ void MessageHandler::ProcessSerialisedMessage(
         asymm::PublicKey sender_public_key;
         asymm::DecodePublicKey(request.sender().public_key(),
                               &sender_public_key);
-        *message_response = WrapMessage(response,
-                                        sender_public_key);
+        *message_response = WrapResponse(response, kPingResponse,
+                                         sender_public_key, session_key);
       }
       break;
     }
@@ -242,8 +491,8 @@ void MessageHandler::ProcessSerialisedMessage(
         asymm::PublicKey sender_public_key;
         asymm::DecodePublicKey(request.sender().public_key(),
                               &sender_public_key);
-        *message_response = WrapMessage(response,
-                                        sender_public_key);
+        *message_response = WrapResponse(response, kFindValueResponse,
+                                         sender_public_key, session_key);
       }
       break;
     }
@@ -265,8 +514,8 @@ void MessageHandler::ProcessSerialisedMessage(
         asymm::PublicKey sender_public_key;
         asymm::DecodePublicKey(request.sender().public_key(),
                               &sender_public_key);
-        *message_response = WrapMessage(response,
-                                        sender_public_key);
+        *message_response = WrapResponse(response, kFindNodesResponse,
+                                         sender_public_key, session_key);
       }
       break;
     }
@@ -299,7 +548,7 @@ void MessageHandler::ProcessSerialisedMessage(
         asymm::DecodePublicKey(public_key, &asym_public_key);
         if (!asymm::ValidateKey(asym_public_key))
           return;
-        if (!asymm::Validate(message, message_signature, asym_public_key))
+        if (!ValidateSignature(message, message_signature, asym_public_key))
           return;
         protobuf::StoreResponse response;
         (*on_store_request_)(info, request, payload, message_signature,
@@ -339,7 +588,7 @@ void MessageHandler::ProcessSerialisedMessage(
         asymm::DecodePublicKey(public_key, &asym_public_key);
         if (!asymm::ValidateKey(asym_public_key))
           return;
-        if (!asymm::Validate(message, message_signature, asym_public_key))
+        if (!ValidateSignature(message, message_signature, asym_public_key))
           return;
         protobuf::StoreRefreshResponse response;
         (*on_store_refresh_request_)(info, request, &response, timeout);
@@ -380,7 +629,7 @@ void MessageHandler::ProcessSerialisedMessage(
         asymm::DecodePublicKey(public_key, &asym_public_key);
         if (!asymm::ValidateKey(asym_public_key))
           return;
-        if (!asymm::Validate(message, message_signature, asym_public_key))
+        if (!ValidateSignature(message, message_signature, asym_public_key))
           return;
         protobuf::DeleteResponse response;
         (*on_delete_request_)(info, request, payload, message_signature,
@@ -420,7 +669,7 @@ void MessageHandler::ProcessSerialisedMessage(
         asymm::DecodePublicKey(public_key, &asym_public_key);
         if (!asymm::ValidateKey(asym_public_key))
           return;
-        if (!asymm::Validate(message, message_signature, asym_public_key))
+        if (!ValidateSignature(message, message_signature, asym_public_key))
           return;
         protobuf::DeleteRefreshResponse response;
         (*on_delete_refresh_request_)(info, request, &response, timeout);
@@ -448,6 +697,88 @@ void MessageHandler::ProcessSerialisedMessage(
         (*on_downlist_notification_)(info, request, timeout);
       break;
     }
+    case kStoreCacheNotification: {
+      if (security_type != kAsymmetricEncrypt)
+        return;
+      protobuf::StoreCacheNotification request;
+      if (request.ParseFromString(payload) && request.IsInitialized())
+        (*on_store_cache_notification_)(info, request, timeout);
+      break;
+    }
+    case kFindValueBatchRequest: {
+      if (security_type != kAsymmetricEncrypt)
+        return;
+      protobuf::FindValueBatchRequest request;
+      if (request.ParseFromString(payload) && request.IsInitialized()) {
+        protobuf::FindValueBatchResponse response;
+        (*on_find_value_batch_request_)(info, request, &response, timeout);
+        asymm::PublicKey sender_public_key;
+        asymm::DecodePublicKey(request.sender().public_key(),
+                              &sender_public_key);
+        *message_response = WrapResponse(response, kFindValueBatchResponse,
+                                         sender_public_key, session_key);
+      }
+      break;
+    }
+    case kFindValueBatchResponse: {
+      if (security_type != kAsymmetricEncrypt)
+        return;
+      protobuf::FindValueBatchResponse response;
+      if (response.ParseFromString(payload) && response.IsInitialized())
+        (*on_find_value_batch_response_)(info, response);
+      break;
+    }
+    case kFindNodesBatchRequest: {
+      if (security_type != kAsymmetricEncrypt)
+        return;
+      protobuf::FindNodesBatchRequest request;
+      if (request.ParseFromString(payload) && request.IsInitialized()) {
+        protobuf::FindNodesBatchResponse response;
+        (*on_find_nodes_batch_request_)(info, request, &response, timeout);
+        asymm::PublicKey sender_public_key;
+        asymm::DecodePublicKey(request.sender().public_key(),
+                              &sender_public_key);
+        *message_response = WrapResponse(response, kFindNodesBatchResponse,
+                                         sender_public_key, session_key);
+      }
+      break;
+    }
+    case kFindNodesBatchResponse: {
+      if (security_type != kAsymmetricEncrypt)
+        return;
+      protobuf::FindNodesBatchResponse response;
+      if (response.ParseFromString(payload) && response.IsInitialized())
+        (*on_find_nodes_batch_response_)(info, response);
+      break;
+    }
+    case kStoreBatchRequest: {
+      // Each store request is checked against its own signature by Service.
+      if (security_type != kAsymmetricEncrypt)
+        return;
+      protobuf::StoreBatchRequest request;
+      if (request.ParseFromString(payload) && request.IsInitialized()) {
+        if (!request.sender().has_node_id())
+          return;
+        asymm::PublicKey asym_public_key;
+        asymm::DecodePublicKey(request.sender().public_key(),
+                              &asym_public_key);
+        if (!asymm::ValidateKey(asym_public_key))
+          return;
+        protobuf::StoreBatchResponse response;
+        (*on_store_batch_request_)(info, request, &response, timeout);
+        *message_response = WrapResponse(response, kStoreBatchResponse,
+                                         asym_public_key, session_key);
+      }
+      break;
+    }
+    case kStoreBatchResponse: {
+      if (security_type != kAsymmetricEncrypt)
+        return;
+      protobuf::StoreBatchResponse response;
+      if (response.ParseFromString(payload) && response.IsInitialized())
+        (*on_store_batch_response_)(info, response);
+      break;
+    }
     default:
       transport::MessageHandler::ProcessSerialisedMessage(message_type,
                                                           payload,
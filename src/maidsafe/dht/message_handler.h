@@ -32,6 +32,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include "boost/concept_check.hpp"
 #include "boost/signals2/signal.hpp"
+#include "boost/thread/mutex.hpp"
 #include "maidsafe/transport/message_handler.h"
 
 #include "maidsafe/dht/config.h"
@@ -67,8 +68,18 @@ class DeleteRefreshResponse;
 class UpdateRequest;
 class UpdateResponse;
 class DownlistNotification;
+class StoreCacheNotification;
+class FindValueBatchRequest;
+class FindValueBatchResponse;
+class FindNodesBatchRequest;
+class FindNodesBatchResponse;
+class StoreBatchRequest;
+class StoreBatchResponse;
 }  // namespace protobuf
 
+class SessionCache;
+class SignatureCache;
+
 namespace test {
 class KademliaMessageHandlerTest_BEH_WrapMessagePingResponse_Test;
 class KademliaMessageHandlerTest_BEH_WrapMessageFindValueResponse_Test;
@@ -92,6 +103,7 @@ class KademliaMessageHandlerTest_BEH_ProcessSerialisedMessageDeleteRsp_Test;
 class KademliaMessageHandlerTest_BEH_ProcessSerialisedMessageDeleteRefRqst_Test;
 class KademliaMessageHandlerTest_BEH_ProcessSerialisedMessageDeleteRefRsp_Test;
 class KademliaMessageHandlerTest_BEH_ProcessSerialisedMessageDownlist_Test;
+class KademliaMessageHandlerTest_BEH_ProcessSerialisedMessageSession_Test;
 class KademliaMessageHandlerTest;
 }  // namespace test
 
@@ -113,7 +125,16 @@ enum MessageType {
   kDeleteResponse,
   kDeleteRefreshRequest,
   kDeleteRefreshResponse,
-  kDownlistNotification
+  kDownlistNotification,
+  kStoreCacheNotification,
+  kFindValueBatchRequest,
+  kFindValueBatchResponse,
+  kFindNodesBatchRequest,
+  kFindNodesBatchResponse,
+  kStoreBatchRequest,
+  kStoreBatchResponse,
+  kSessionRequest,
+  kSessionResponse
 };
 
 class MessageHandler : public transport::MessageHandler {
@@ -197,6 +218,41 @@ class MessageHandler : public transport::MessageHandler {
            const protobuf::DownlistNotification&,
            transport::Timeout*)>> DownlistNtfSigPtr;
 
+  typedef std::shared_ptr<bs2::signal<  // NOLINT
+      void(const transport::Info&,
+           const protobuf::StoreCacheNotification&,
+           transport::Timeout*)>> StoreCacheNtfSigPtr;
+
+  typedef std::shared_ptr<bs2::signal<  // NOLINT
+      void(const transport::Info&,
+           const protobuf::FindValueBatchRequest&,
+           protobuf::FindValueBatchResponse*,
+           transport::Timeout*)>> FindValueBatchReqSigPtr;
+
+  typedef std::shared_ptr<bs2::signal<  // NOLINT
+      void(const transport::Info&,
+           const protobuf::FindValueBatchResponse&)>> FindValueBatchRspSigPtr;
+
+  typedef std::shared_ptr<bs2::signal<  // NOLINT
+      void(const transport::Info&,
+           const protobuf::FindNodesBatchRequest&,
+           protobuf::FindNodesBatchResponse*,
+           transport::Timeout*)>> FindNodesBatchReqSigPtr;
+
+  typedef std::shared_ptr<bs2::signal<  // NOLINT
+      void(const transport::Info&,
+           const protobuf::FindNodesBatchResponse&)>> FindNodesBatchRspSigPtr;
+
+  typedef std::shared_ptr<bs2::signal<  // NOLINT
+      void(const transport::Info&,
+           const protobuf::StoreBatchRequest&,
+           protobuf::StoreBatchResponse*,
+           transport::Timeout*)>> StoreBatchReqSigPtr;
+
+  typedef std::shared_ptr<bs2::signal<  // NOLINT
+      void(const transport::Info&,
+           const protobuf::StoreBatchResponse&)>> StoreBatchRspSigPtr;
+
   explicit MessageHandler(PrivateKeyPtr private_key)
     : transport::MessageHandler(private_key),
       on_ping_request_(new PingReqSigPtr::element_type),
@@ -213,7 +269,25 @@ class MessageHandler : public transport::MessageHandler {
       on_delete_response_(new DeleteRspSigPtr::element_type),
       on_delete_refresh_request_(new DeleteRefreshReqSigPtr::element_type),
       on_delete_refresh_response_(new DeleteRefreshRspSigPtr::element_type),
-      on_downlist_notification_(new DownlistNtfSigPtr::element_type) {}
+      on_downlist_notification_(new DownlistNtfSigPtr::element_type),
+      on_store_cache_notification_(new StoreCacheNtfSigPtr::element_type),
+      on_find_value_batch_request_(new FindValueBatchReqSigPtr::element_type),
+      on_find_value_batch_response_(
+          new FindValueBatchRspSigPtr::element_type),
+      on_find_nodes_batch_request_(new FindNodesBatchReqSigPtr::element_type),
+      on_find_nodes_batch_response_(
+          new FindNodesBatchRspSigPtr::element_type),
+      on_store_batch_request_(new StoreBatchReqSigPtr::element_type),
+      on_store_batch_response_(new StoreBatchRspSigPtr::element_type),
+      session_cache_(),
+      session_key_(),
+      session_request_(false),
+      session_request_type_(0),
+      session_request_payload_(),
+      session_recipient_public_key_(),
+      fallback_request_(),
+      session_mutex_(),
+      signature_cache_() {}
   virtual ~MessageHandler() {}
 
   std::string WrapMessage(const protobuf::PingRequest &msg,
@@ -232,6 +306,28 @@ class MessageHandler : public transport::MessageHandler {
                           const asymm::PublicKey &recipient_public_key);
   std::string WrapMessage(const protobuf::DownlistNotification &msg,
                           const asymm::PublicKey &recipient_public_key);
+  std::string WrapMessage(const protobuf::StoreCacheNotification &msg,
+                          const asymm::PublicKey &recipient_public_key);
+  std::string WrapMessage(const protobuf::FindValueBatchRequest &msg,
+                          const asymm::PublicKey &recipient_public_key);
+  std::string WrapMessage(const protobuf::FindNodesBatchRequest &msg,
+                          const asymm::PublicKey &recipient_public_key);
+  std::string WrapMessage(const protobuf::StoreBatchRequest &msg,
+                          const asymm::PublicKey &recipient_public_key);
+
+  // Once set, unsigned requests are sent symmetrically encrypted under a
+  // session key from session_cache, and incoming session requests can be read.
+  void set_session_cache(std::shared_ptr<SessionCache> session_cache);
+
+  // If the last request wrapped was sent under a session, returns it wrapped
+  // asymmetrically encrypted instead, for a retry in case the peer can't read
+  // session messages, and suspends sessions with the peer.  Otherwise returns
+  // an empty string.
+  std::string WrapSessionFallback();
+
+  // Once set, signatures of signed requests are validated through
+  // signature_cache, skipping ones which have already been checked.
+  void set_signature_cache(std::shared_ptr<SignatureCache> signature_cache);
 
   PingReqSigPtr on_ping_request() { return on_ping_request_; }
   PingRspSigPtr on_ping_response() { return on_ping_response_; }
@@ -262,6 +358,27 @@ class MessageHandler : public transport::MessageHandler {
   DownlistNtfSigPtr on_downlist_notification() {
     return on_downlist_notification_;
   }
+  StoreCacheNtfSigPtr on_store_cache_notification() {
+    return on_store_cache_notification_;
+  }
+  FindValueBatchReqSigPtr on_find_value_batch_request() {
+    return on_find_value_batch_request_;
+  }
+  FindValueBatchRspSigPtr on_find_value_batch_response() {
+    return on_find_value_batch_response_;
+  }
+  FindNodesBatchReqSigPtr on_find_nodes_batch_request() {
+    return on_find_nodes_batch_request_;
+  }
+  FindNodesBatchRspSigPtr on_find_nodes_batch_response() {
+    return on_find_nodes_batch_response_;
+  }
+  StoreBatchReqSigPtr on_store_batch_request() {
+    return on_store_batch_request_;
+  }
+  StoreBatchRspSigPtr on_store_batch_response() {
+    return on_store_batch_response_;
+  }
 
  protected:
   virtual void ProcessSerialisedMessage(const int &message_type,
@@ -295,11 +412,43 @@ class MessageHandler : public transport::MessageHandler {
   friend class test::KademliaMessageHandlerTest_BEH_ProcessSerialisedMessageDeleteRefRqst_Test;  // NOLINT
   friend class test::KademliaMessageHandlerTest_BEH_ProcessSerialisedMessageDeleteRefRsp_Test;  // NOLINT
   friend class test::KademliaMessageHandlerTest_BEH_ProcessSerialisedMessageDownlist_Test;  // NOLINT
+  friend class test::KademliaMessageHandlerTest_BEH_ProcessSerialisedMessageSession_Test;  // NOLINT
   friend class test::KademliaMessageHandlerTest;
 
   MessageHandler(const MessageHandler&);
   MessageHandler& operator=(const MessageHandler&);
 
+  void ProcessMessage(const int &message_type,
+                      const std::string &payload,
+                      const SecurityType &security_type,
+                      const std::string &message_signature,
+                      const transport::Info &info,
+                      const std::string &session_key,
+                      std::string *message_response,
+                      transport::Timeout *timeout);
+  void ProcessSessionMessage(const bool &is_request,
+                             const std::string &payload,
+                             const transport::Info &info,
+                             std::string *message_response,
+                             transport::Timeout *timeout);
+  bool ValidateSignature(const std::string &message,
+                         const std::string &message_signature,
+                         const asymm::PublicKey &public_key);
+  std::string WrapRequest(const int &message_type,
+                          const std::string &payload,
+                          const asymm::PublicKey &recipient_public_key);
+  template <typename Response>
+  std::string WrapResponse(const Response &response,
+                           const int &message_type,
+                           const asymm::PublicKey &recipient_public_key,
+                           const std::string &session_key);
+  std::string WrapSessionMessage(const bool &is_request,
+                                 const int &message_type,
+                                 const std::string &payload,
+                                 const asymm::PublicKey &recipient_public_key,
+                                 const std::string &session_key,
+                                 const std::string &encrypted_session_key);
+
   std::string WrapMessage(const protobuf::PingResponse &msg,
                           const asymm::PublicKey &recipient_public_key);
   std::string WrapMessage(const protobuf::FindValueResponse &msg,
@@ -314,6 +463,12 @@ class MessageHandler : public transport::MessageHandler {
                           const asymm::PublicKey &recipient_public_key);
   std::string WrapMessage(const protobuf::DeleteRefreshResponse &msg,
                           const asymm::PublicKey &recipient_public_key);
+  std::string WrapMessage(const protobuf::FindValueBatchResponse &msg,
+                          const asymm::PublicKey &recipient_public_key);
+  std::string WrapMessage(const protobuf::FindNodesBatchResponse &msg,
+                          const asymm::PublicKey &recipient_public_key);
+  std::string WrapMessage(const protobuf::StoreBatchResponse &msg,
+                          const asymm::PublicKey &recipient_public_key);
 
   PingReqSigPtr on_ping_request_;
   PingRspSigPtr on_ping_response_;
@@ -330,6 +485,25 @@ class MessageHandler : public transport::MessageHandler {
   DeleteRefreshReqSigPtr on_delete_refresh_request_;
   DeleteRefreshRspSigPtr on_delete_refresh_response_;
   DownlistNtfSigPtr on_downlist_notification_;
+  StoreCacheNtfSigPtr on_store_cache_notification_;
+  FindValueBatchReqSigPtr on_find_value_batch_request_;
+  FindValueBatchRspSigPtr on_find_value_batch_response_;
+  FindNodesBatchReqSigPtr on_find_nodes_batch_request_;
+  FindNodesBatchRspSigPtr on_find_nodes_batch_response_;
+  StoreBatchReqSigPtr on_store_batch_request_;
+  StoreBatchRspSigPtr on_store_batch_response_;
+  std::shared_ptr<SessionCache> session_cache_;
+  // The session key of the last request sent, used to read its response.
+  std::string session_key_;
+  // The last request sent under a session, kept in case it must be resent
+  // without one, and that resend once made.
+  bool session_request_;
+  int session_request_type_;
+  std::string session_request_payload_;
+  asymm::PublicKey session_recipient_public_key_;
+  std::string fallback_request_;
+  boost::mutex session_mutex_;
+  std::shared_ptr<SignatureCache> signature_cache_;
 };
 
 }  // namespace dht
@@ -34,12 +34,14 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MAIDSAFE_DHT_NODE_API_H_
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "boost/asio/io_service.hpp"
 #include "boost/date_time/posix_time/posix_time_types.hpp"
+#include "boost/thread/mutex.hpp"
 
 #include "maidsafe/common/version.h"
 
@@ -59,6 +61,29 @@ namespace dht {
 
 class NodeImpl;
 
+// Allows an asynchronous Node operation to be abandoned before it completes.
+// Pass a handle to the operation, then call Cancel to have the operation's
+// callback invoked with kOperationCancelled and no further lookup RPCs sent
+// for it.  Cancelling after the callback has been invoked has no effect.  A
+// handle should only be passed to a single operation.
+class OperationHandle {
+ public:
+  OperationHandle();
+  void Cancel();
+  bool cancelled() const;
+
+ private:
+  friend class NodeImpl;
+  OperationHandle(const OperationHandle&);
+  OperationHandle &operator=(const OperationHandle&);
+  // Sets the functor invoked by Cancel, invoking it at once if Cancel has
+  // already been called.
+  void set_cancel_functor(std::function<void()> cancel_functor);
+  mutable boost::mutex mutex_;
+  bool cancelled_;
+  std::function<void()> cancel_functor_;
+};
+
 // This class represents a kademlia node providing the API to join the network,
 // find nodes and values, store, delete and update values, as well as the
 // methods to access the local storage of the node and its routing table.
@@ -87,6 +112,13 @@ class Node {
   //
   // mean_refresh_interval indicates the average interval between calls to
   // refresh values.
+  //
+  // Store, Delete, Update, FindValue, FindNodes, GetContact and Ping each take
+  // an optional timeout and OperationHandle.  If the operation hasn't
+  // completed within timeout of being called, its callback is invoked with
+  // kOperationDeadlineExpired and no further lookup RPCs are sent for it.
+  // Cancelling via the handle does likewise with kOperationCancelled.  Such
+  // operations never share a lookup with concurrent identical requests.
   Node(boost::asio::io_service &asio_service,                 // NOLINT (Fraser)
        TransportPtr listening_transport,
        MessageHandlerPtr message_handler,
@@ -122,7 +154,26 @@ class Node {
              const std::string &signature,
              const boost::posix_time::time_duration &ttl,
              PrivateKeyPtr private_key,
-             StoreFunctor callback);
+             StoreFunctor callback,
+             const boost::posix_time::time_duration &timeout =
+                 boost::posix_time::pos_infin,
+             OperationHandlePtr handle = OperationHandlePtr());
+
+  // Store each <keys[i],values_and_signatures[i]> for ttl as Store would.
+  // Where several keys' lookups or stores involve the same peer, their RPCs to
+  // it are combined into batched RPCs, saving per-RPC overhead on bulk stores.
+  // The callback is passed the return code for each key in the order of keys.
+  // If keys and values_and_signatures differ in size, every return code is
+  // kGeneralError.  The timeout and handle apply to each key's store as they
+  // would to Store.
+  void StoreMany(const std::vector<Key> &keys,
+                 const std::vector<ValueAndSignature> &values_and_signatures,
+                 const boost::posix_time::time_duration &ttl,
+                 PrivateKeyPtr private_key,
+                 StoreManyFunctor callback,
+                 const boost::posix_time::time_duration &timeout =
+                     boost::posix_time::pos_infin,
+                 OperationHandlePtr handle = OperationHandlePtr());
 
   // Delete <key,value,signature> from network.  If signature is empty, the
   // value is signed using securifier, unless it is invalid, in which case
@@ -134,7 +185,10 @@ class Node {
               const std::string &value,
               const std::string &signature,
               PrivateKeyPtr private_key,
-              DeleteFunctor callback);
+              DeleteFunctor callback,
+              const boost::posix_time::time_duration &timeout =
+                  boost::posix_time::pos_infin,
+              OperationHandlePtr handle = OperationHandlePtr());
 
   // Replace <key,old_value,old_signature> with <key,new_value,new_signature>
   // on the network.  If either signature is empty, the corresponding value is
@@ -151,7 +205,10 @@ class Node {
               const std::string &old_signature,
               const boost::posix_time::time_duration &ttl,
               PrivateKeyPtr private_key,
-              UpdateFunctor callback);
+              UpdateFunctor callback,
+              const boost::posix_time::time_duration &timeout =
+                  boost::posix_time::pos_infin,
+              OperationHandlePtr handle = OperationHandlePtr());
 
   // Find value(s) on the network.  The callback will always have passed to it
   // the contact details of the node needing a cache copy of the value(s) (i.e.
@@ -182,20 +239,59 @@ class Node {
                  PrivateKeyPtr private_key,
                  FindValueFunctor callback,
                  const uint16_t &extra_contacts = 0,
-                 bool cache = true);
+                 bool cache = true,
+                 const boost::posix_time::time_duration &timeout =
+                     boost::posix_time::pos_infin,
+                 OperationHandlePtr handle = OperationHandlePtr());
+
+  // Find value(s) under each of keys as FindValue would.  Where several keys'
+  // lookups query the same peer, their RPCs to it are combined into batched
+  // RPCs.  The callback is passed the FindValueReturns for each key in the
+  // order of keys.  The timeout and handle apply to each key's lookup as they
+  // would to FindValue.
+  void FindValues(const std::vector<Key> &keys,
+                  PrivateKeyPtr private_key,
+                  FindValuesFunctor callback,
+                  const uint16_t &extra_contacts = 0,
+                  bool cache = true,
+                  const boost::posix_time::time_duration &timeout =
+                      boost::posix_time::pos_infin,
+                  OperationHandlePtr handle = OperationHandlePtr());
 
   // Find details of (k + extra) nodes closest to key.  The details are passed
   // in callback, ordered by kademlia closeness to key, closest first.
   // N.B. This node could be returned as one of the closest contacts.
   void FindNodes(const Key &key,
                  FindNodesFunctor callback,
-                 const uint16_t &extra_contacts = 0);
+                 const uint16_t &extra_contacts = 0,
+                 const boost::posix_time::time_duration &timeout =
+                     boost::posix_time::pos_infin,
+                 OperationHandlePtr handle = OperationHandlePtr());
+
+  // Find nodes close to key as FindNodes would, but report progress along the
+  // way.  Each time the set of nodes which have responded changes, the (up to
+  // k + extra) closest of them are passed to progress_functor, then to
+  // stop_functor.  If stop_functor returns true, the lookup ends and callback
+  // is passed those nodes with a return code of kSuccess.  Either functor may
+  // be empty.  Such a lookup is never shared with other callers.
+  void FindNodesWithProgress(const Key &key,
+                             FindNodesFunctor callback,
+                             FindNodesProgressFunctor progress_functor,
+                             FindNodesStopFunctor stop_functor,
+                             const uint16_t &extra_contacts = 0,
+                             const boost::posix_time::time_duration &timeout =
+                                 boost::posix_time::pos_infin,
+                             OperationHandlePtr handle = OperationHandlePtr());
 
   // Find the contact details of a node.  If the target node is not in this
   // node's routing table (and is not this node), a FindNode will be executed.
   // If the node is offline, a default-constructed Contact will be passed back
   // in the callback.
-  void GetContact(const NodeId &node_id, GetContactFunctor callback);
+  void GetContact(const NodeId &node_id,
+                  GetContactFunctor callback,
+                  const boost::posix_time::time_duration &timeout =
+                      boost::posix_time::pos_infin,
+                  OperationHandlePtr handle = OperationHandlePtr());
 
   // Setter for the functor which will be called by Node and Service to retrieve
   // the public key and public key validation token for a given contact.
@@ -234,7 +330,11 @@ class Node {
   void GetBootstrapContacts(std::vector<Contact> *contacts);
 
   // Checks whether the contact is online or not
-  void Ping(const Contact &contact, PingFunctor callback);
+  void Ping(const Contact &contact,
+            PingFunctor callback,
+            const boost::posix_time::time_duration &timeout =
+                boost::posix_time::pos_infin,
+            OperationHandlePtr handle = OperationHandlePtr());
 
   // Sets a functor which is invoked whenever this node's Service receives a
   // FindValue RPC.  If the functor returns true, the node responds that it has
@@ -242,6 +342,18 @@ class Node {
   // DataStore), and hence causes the peer's lookup to terminate.
   void set_check_cache_functor(const CheckCacheFunctor &check_cache_functor);
 
+  // Sets whether lookups query the contact with the lowest measured round trip
+  // time first when several unqueried contacts are near-equally close to the
+  // target (i.e. share the same number of leading bits with it).  Off by
+  // default.
+  void set_latency_aware_lookups(bool latency_aware_lookups);
+
+  // Sets a file to which the routing table is saved on Leave and from which it
+  // is reloaded on the next Join.  Reloaded contacts are used as bootstrap
+  // contacts if none are passed to Join, and are re-verified by pinging a few
+  // at a time in the background.  Must be set before Join to take effect.
+  void set_routing_table_file(const fs::path &routing_table_file);
+
   // This node's contact details
   Contact contact() const;
 
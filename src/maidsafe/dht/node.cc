@@ -33,6 +33,41 @@ namespace maidsafe {
 
 namespace dht {
 
+OperationHandle::OperationHandle()
+    : mutex_(),
+      cancelled_(false),
+      cancel_functor_() {}
+
+void OperationHandle::Cancel() {
+  std::function<void()> cancel_functor;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (cancelled_)
+      return;
+    cancelled_ = true;
+    cancel_functor.swap(cancel_functor_);
+  }
+  if (cancel_functor)
+    cancel_functor();
+}
+
+bool OperationHandle::cancelled() const {
+  boost::mutex::scoped_lock lock(mutex_);
+  return cancelled_;
+}
+
+void OperationHandle::set_cancel_functor(
+    std::function<void()> cancel_functor) {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (!cancelled_) {
+      cancel_functor_ = cancel_functor;
+      return;
+    }
+  }
+  cancel_functor();
+}
+
 Node::Node(boost::asio::io_service &asio_service,             // NOLINT (Fraser)
            TransportPtr listening_transport,
            MessageHandlerPtr message_handler,
@@ -63,16 +98,34 @@ void Node::Store(const Key &key,
                  const std::string &signature,
                  const boost::posix_time::time_duration &ttl,
                  PrivateKeyPtr private_key,
-                 StoreFunctor callback) {
-  pimpl_->Store(key, value, signature, ttl, private_key, callback);
+                 StoreFunctor callback,
+                 const boost::posix_time::time_duration &timeout,
+                 OperationHandlePtr handle) {
+  pimpl_->Store(key, value, signature, ttl, private_key, callback, timeout,
+                handle);
+}
+
+void Node::StoreMany(
+    const std::vector<Key> &keys,
+    const std::vector<ValueAndSignature> &values_and_signatures,
+    const boost::posix_time::time_duration &ttl,
+    PrivateKeyPtr private_key,
+    StoreManyFunctor callback,
+    const boost::posix_time::time_duration &timeout,
+    OperationHandlePtr handle) {
+  pimpl_->StoreMany(keys, values_and_signatures, ttl, private_key, callback,
+                    timeout, handle);
 }
 
 void Node::Delete(const Key &key,
                  const std::string &value,
                  const std::string &signature,
                  PrivateKeyPtr private_key,
-                 DeleteFunctor callback) {
-  pimpl_->Delete(key, value, signature, private_key, callback);
+                 DeleteFunctor callback,
+                 const boost::posix_time::time_duration &timeout,
+                 OperationHandlePtr handle) {
+  pimpl_->Delete(key, value, signature, private_key, callback, timeout,
+                 handle);
 }
 
 void Node::Update(const Key &key,
@@ -82,27 +135,60 @@ void Node::Update(const Key &key,
                   const std::string &old_signature,
                   const boost::posix_time::time_duration &ttl,
                   PrivateKeyPtr private_key,
-                  UpdateFunctor callback) {
+                  UpdateFunctor callback,
+                  const boost::posix_time::time_duration &timeout,
+                  OperationHandlePtr handle) {
   pimpl_->Update(key, new_value, new_signature, old_value, old_signature,
-                 ttl, private_key, callback);
+                 ttl, private_key, callback, timeout, handle);
 }
 
 void Node::FindValue(const Key &key,
                      PrivateKeyPtr private_key,
                      FindValueFunctor callback,
                      const uint16_t &extra_contacts,
-                     bool cache) {
-  pimpl_->FindValue(key, private_key, callback, extra_contacts, cache);
+                     bool cache,
+                     const boost::posix_time::time_duration &timeout,
+                     OperationHandlePtr handle) {
+  pimpl_->FindValue(key, private_key, callback, extra_contacts, cache, timeout,
+                    handle);
+}
+
+void Node::FindValues(const std::vector<Key> &keys,
+                      PrivateKeyPtr private_key,
+                      FindValuesFunctor callback,
+                      const uint16_t &extra_contacts,
+                      bool cache,
+                      const boost::posix_time::time_duration &timeout,
+                      OperationHandlePtr handle) {
+  pimpl_->FindValues(keys, private_key, callback, extra_contacts, cache,
+                     timeout, handle);
 }
 
 void Node::FindNodes(const Key &key,
                      FindNodesFunctor callback,
-                     const uint16_t &extra_contacts) {
-  pimpl_->FindNodes(key, callback, extra_contacts);
+                     const uint16_t &extra_contacts,
+                     const boost::posix_time::time_duration &timeout,
+                     OperationHandlePtr handle) {
+  pimpl_->FindNodes(key, callback, extra_contacts, timeout, handle);
+}
+
+void Node::FindNodesWithProgress(
+    const Key &key,
+    FindNodesFunctor callback,
+    FindNodesProgressFunctor progress_functor,
+    FindNodesStopFunctor stop_functor,
+    const uint16_t &extra_contacts,
+    const boost::posix_time::time_duration &timeout,
+    OperationHandlePtr handle) {
+  pimpl_->FindNodesWithProgress(key, callback, progress_functor, stop_functor,
+                                extra_contacts, timeout, handle);
 }
 
-void Node::GetContact(const NodeId &node_id, GetContactFunctor callback) {
-  pimpl_->GetContact(node_id, callback);
+void Node::GetContact(const NodeId &node_id,
+                      GetContactFunctor callback,
+                      const boost::posix_time::time_duration &timeout,
+                      OperationHandlePtr handle) {
+  pimpl_->GetContact(node_id, callback, timeout, handle);
 }
 
 void Node::SetContactValidationGetter(
@@ -143,8 +229,11 @@ void Node::GetBootstrapContacts(std::vector<Contact> *contacts) {
   pimpl_->GetBootstrapContacts(contacts);
 }
 
-void Node::Ping(const Contact &contact, PingFunctor callback) {
-  pimpl_->Ping(contact, callback);
+void Node::Ping(const Contact &contact,
+                PingFunctor callback,
+                const boost::posix_time::time_duration &timeout,
+                OperationHandlePtr handle) {
+  pimpl_->Ping(contact, callback, timeout, handle);
 }
 
 void Node::set_check_cache_functor(
@@ -152,6 +241,14 @@ void Node::set_check_cache_functor(
   pimpl_->set_check_cache_functor(check_cache_functor);
 }
 
+void Node::set_latency_aware_lookups(bool latency_aware_lookups) {
+  pimpl_->set_latency_aware_lookups(latency_aware_lookups);
+}
+
+void Node::set_routing_table_file(const fs::path &routing_table_file) {
+  pimpl_->set_routing_table_file(routing_table_file);
+}
+
 Contact Node::contact() const {
   return pimpl_->contact();
 }
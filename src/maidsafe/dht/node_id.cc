@@ -26,7 +26,9 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "maidsafe/dht/node_id.h"
+#include <algorithm>
 #include <bitset>
+#include "boost/static_assert.hpp"
 #include "maidsafe/dht/log.h"
 #include "maidsafe/common/utils.h"
 
@@ -34,83 +36,115 @@ namespace maidsafe {
 
 namespace dht {
 
+BOOST_STATIC_ASSERT(kKeySizeBytes % sizeof(uint64_t) == 0);
+
+namespace {
+
+const size_t kBytesPerWord(sizeof(uint64_t));
+
+// Reads kBytesPerWord bytes of a raw id as a big-endian word so that word-wise
+// comparison gives the same ordering as byte-wise comparison of the string.
+uint64_t ReadWord(const std::string &raw_id, const size_t &offset) {
+  uint64_t word(0);
+  for (size_t i = 0; i < kBytesPerWord; ++i)
+    word = (word << 8) | static_cast<unsigned char>(raw_id[offset + i]);
+  return word;
+}
+
+void WriteWord(const uint64_t &word, const size_t &offset,
+               std::string *raw_id) {
+  for (size_t i = 0; i < kBytesPerWord; ++i) {
+    (*raw_id)[offset + i] =
+        static_cast<char>(word >> (8 * (kBytesPerWord - 1 - i)));
+  }
+}
+
+uint16_t CountLeadingZeros(const uint64_t &word) {
+#if defined(__GNUC__)
+  return static_cast<uint16_t>(__builtin_clzll(word));
+#else
+  uint16_t count(0);
+  for (uint64_t mask(uint64_t(1) << 63); (word & mask) == 0; mask >>= 1)
+    ++count;
+  return count;
+#endif
+}
+
+}  // unnamed namespace
+
 size_t BitToByteCount(const size_t &bit_count) {
   return static_cast<size_t>(0.999999 + static_cast<double>(bit_count) / 8);
 }
 
-NodeId::NodeId() : raw_id_(kZeroId) {}
+NodeId::NodeId() : words_(), valid_(true) {}
 
-NodeId::NodeId(const NodeId &other) : raw_id_(other.raw_id_) {}
+NodeId::NodeId(const NodeId &other) : words_(), valid_(other.valid_) {
+  std::copy(other.words_, other.words_ + kWordCount, words_);
+}
 
-NodeId::NodeId(const KadIdType &type) : raw_id_(kKeySizeBytes, -1) {
+NodeId::NodeId(const KadIdType &type) : words_(), valid_(true) {
   switch (type) {
     case kMaxId :
-      break;  // already set
+      std::fill(words_, words_ + kWordCount, ~uint64_t(0));
+      break;
     case kRandomId :
-      std::generate(raw_id_.begin(), raw_id_.end(),
-                    std::bind(&RandomUint32));
+      for (uint16_t i = 0; i < kWordCount; ++i) {
+        words_[i] = (static_cast<uint64_t>(RandomUint32()) << 32) |
+                    RandomUint32();
+      }
       break;
     default :
       break;
   }
 }
 
-NodeId::NodeId(const std::string &id) : raw_id_(id) {
-  if (!IsValid())
-    raw_id_.clear();
+NodeId::NodeId(const std::string &id) : words_(), valid_(false) {
+  DecodeFromRaw(id);
 }
 
 NodeId::NodeId(const std::string &id, const EncodingType &encoding_type)
-    : raw_id_() {
+    : words_(), valid_(false) {
   try {
     switch (encoding_type) {
       case kBinary : DecodeFromBinary(id);
         break;
-      case kHex : raw_id_ = DecodeFromHex(id);
+      case kHex : DecodeFromRaw(DecodeFromHex(id));
         break;
-      case kBase32 : raw_id_ = DecodeFromBase32(id);
+      case kBase32 : DecodeFromRaw(DecodeFromBase32(id));
         break;
-      case kBase64 : raw_id_ = DecodeFromBase64(id);
+      case kBase64 : DecodeFromRaw(DecodeFromBase64(id));
         break;
-      default : raw_id_ = id;
+      default : DecodeFromRaw(id);
     }
   }
   catch(const std::exception &e) {
     DLOG(ERROR) << "NodeId Ctor: " << e.what();
-    raw_id_.clear();
-    return;
+    Invalidate();
   }
-  if (!IsValid())
-    raw_id_.clear();
 }
 
-NodeId::NodeId(const uint16_t &power) : raw_id_(kZeroId) {
+NodeId::NodeId(const uint16_t &power) : words_(), valid_(true) {
   if (power >= kKeySizeBits) {
-    raw_id_.clear();
+    Invalidate();
     return;
   }
-  uint16_t shift = power % 8;
-  if (shift != 0) {
-    raw_id_[kKeySizeBytes - BitToByteCount(power)] += 1 << shift;
-  } else {
-    raw_id_[kKeySizeBytes - BitToByteCount(power) - 1] = 1;
-  }
+  words_[kWordCount - 1 - (power / 64)] = uint64_t(1) << (power % 64);
 }
 
-NodeId::NodeId(const NodeId &id1, const NodeId &id2) : raw_id_(kZeroId) {
+NodeId::NodeId(const NodeId &id1, const NodeId &id2)
+    : words_(), valid_(true) {
   if (!id1.IsValid() || !id2.IsValid()) {
-    raw_id_.clear();
+    Invalidate();
     return;
   }
   if (id1 == id2) {
-    raw_id_ = id1.raw_id_;
+    *this = id1;
     return;
   }
-  std::string min_id(id1.raw_id_), max_id(id2.raw_id_);
-  if (id1 > id2) {
-    max_id = id1.raw_id_;
-    min_id = id2.raw_id_;
-  }
+  // Rarely used, so the range is walked byte-wise on the raw representation.
+  std::string min_id(id1.String()), max_id(id2.String()), raw_id(kZeroId);
+  if (id1 > id2)
+    min_id.swap(max_id);
   bool less_than_upper_limit(false);
   bool greater_than_lower_limit(false);
   unsigned char max_id_char(0), min_id_char(0), this_char(0);
@@ -119,45 +153,60 @@ NodeId::NodeId(const NodeId &id1, const NodeId &id2) : raw_id_(kZeroId) {
       max_id_char = max_id[pos];
       min_id_char = greater_than_lower_limit ? 0 : min_id[pos];
       if (max_id_char == 0) {
-        raw_id_[pos] = 0;
+        raw_id[pos] = 0;
       } else {
-        raw_id_[pos] = (RandomUint32() % (max_id_char - min_id_char + 1))
-                       + min_id_char;
-        this_char = raw_id_[pos];
+        raw_id[pos] = (RandomUint32() % (max_id_char - min_id_char + 1))
+                      + min_id_char;
+        this_char = raw_id[pos];
         less_than_upper_limit = (this_char < max_id_char);
         greater_than_lower_limit = (this_char > min_id_char);
       }
     } else if (!greater_than_lower_limit) {
       min_id_char = min_id[pos];
-      raw_id_[pos] = static_cast<char>(RandomUint32() % (256 - min_id_char))
-                     + min_id_char;
-      this_char = raw_id_[pos];
+      raw_id[pos] = static_cast<char>(RandomUint32() % (256 - min_id_char))
+                    + min_id_char;
+      this_char = raw_id[pos];
       greater_than_lower_limit = (this_char > min_id_char);
     } else {
-      raw_id_[pos] = static_cast<char>(RandomUint32());
+      raw_id[pos] = static_cast<char>(RandomUint32());
     }
   }
+  DecodeFromRaw(raw_id);
 }
 
 std::string NodeId::EncodeToBinary() const {
   std::string binary;
-  binary.reserve(kKeySizeBytes);
-  for (size_t i = 0; i < kKeySizeBytes; ++i) {
-    std::bitset<8> temp(static_cast<int>(raw_id_[i]));
-    binary += temp.to_string();
-  }
+  binary.reserve(kKeySizeBits);
+  for (uint16_t i = 0; i < kWordCount; ++i)
+    binary += std::bitset<64>(words_[i]).to_string();
   return binary;
 }
 
 void NodeId::DecodeFromBinary(const std::string &binary_id) {
-  std::bitset<kKeySizeBits> binary_bitset(binary_id);
-  if (!IsValid()) {
-    raw_id_.assign(kKeySizeBytes, 0);
+  if (binary_id.size() != kKeySizeBits) {
+    Invalidate();
+    return;
   }
-  for (size_t i = 0; i < kKeySizeBytes; ++i) {
-    std::bitset<8> temp(binary_id.substr(i * 8, 8));
-    raw_id_[i] = static_cast<char>(temp.to_ulong());
+  for (uint16_t i = 0; i < kWordCount; ++i) {
+    std::bitset<64> word(binary_id.substr(i * 64, 64));
+    words_[i] = word.to_ullong();
   }
+  valid_ = true;
+}
+
+void NodeId::DecodeFromRaw(const std::string &raw_id) {
+  if (raw_id.size() != kKeySizeBytes) {
+    Invalidate();
+    return;
+  }
+  for (uint16_t i = 0; i < kWordCount; ++i)
+    words_[i] = ReadWord(raw_id, i * kBytesPerWord);
+  valid_ = true;
+}
+
+void NodeId::Invalidate() {
+  std::fill(words_, words_ + kWordCount, 0);
+  valid_ = false;
 }
 
 bool NodeId::CloserToTarget(const NodeId &id1,
@@ -165,20 +214,33 @@ bool NodeId::CloserToTarget(const NodeId &id1,
                             const NodeId &target_id) {
   if (!id1.IsValid() || !id2.IsValid() || !target_id.IsValid())
     return false;
-  std::string raw_id1(id1.raw_id_);
-  std::string raw_id2(id2.raw_id_);
-  std::string raw_id_target(target_id.raw_id_);
-  for (uint16_t i = 0; i < kKeySizeBytes; ++i) {
-    unsigned char result1 = raw_id1[i] ^ raw_id_target[i];
-    unsigned char result2 = raw_id2[i] ^ raw_id_target[i];
+  for (uint16_t i = 0; i < kWordCount; ++i) {
+    uint64_t result1 = id1.words_[i] ^ target_id.words_[i];
+    uint64_t result2 = id2.words_[i] ^ target_id.words_[i];
     if (result1 != result2)
       return result1 < result2;
   }
   return false;
 }
 
+uint16_t NodeId::CommonLeadingBits(const NodeId &other) const {
+  if (!IsValid() || !other.IsValid())
+    return 0;
+  for (uint16_t i = 0; i < kWordCount; ++i) {
+    uint64_t difference(words_[i] ^ other.words_[i]);
+    if (difference != 0)
+      return i * 64 + CountLeadingZeros(difference);
+  }
+  return kKeySizeBits;
+}
+
 const std::string NodeId::String() const {
-  return raw_id_;
+  if (!IsValid())
+    return "";
+  std::string raw_id(kKeySizeBytes, 0);
+  for (uint16_t i = 0; i < kWordCount; ++i)
+    WriteWord(words_[i], i * kBytesPerWord, &raw_id);
+  return raw_id;
 }
 
 const std::string NodeId::ToStringEncoded(
@@ -189,59 +251,74 @@ const std::string NodeId::ToStringEncoded(
     case kBinary:
       return EncodeToBinary();
     case kHex:
-      return EncodeToHex(raw_id_);
+      return EncodeToHex(String());
     case kBase32:
-      return EncodeToBase32(raw_id_);
+      return EncodeToBase32(String());
     case kBase64:
-      return EncodeToBase64(raw_id_);
+      return EncodeToBase64(String());
     default:
-      return raw_id_;
+      return String();
   }
 }
 
 bool NodeId::IsValid() const {
-  return raw_id_.size() == kKeySizeBytes;
+  return valid_;
 }
 
 bool NodeId::operator == (const NodeId &rhs) const {
-  return raw_id_ == rhs.raw_id_;
+  if (valid_ != rhs.valid_)
+    return false;
+  return std::equal(words_, words_ + kWordCount, rhs.words_);
 }
 
 bool NodeId::operator != (const NodeId &rhs) const {
-  return raw_id_ != rhs.raw_id_;
+  return !(*this == rhs);
 }
 
 bool NodeId::operator < (const NodeId &rhs) const {
-  return raw_id_ < rhs.raw_id_;
+  // An invalid id compares as the empty string did, i.e. less than any valid id
+  if (valid_ != rhs.valid_)
+    return !valid_;
+  for (uint16_t i = 0; i < kWordCount; ++i) {
+    if (words_[i] != rhs.words_[i])
+      return words_[i] < rhs.words_[i];
+  }
+  return false;
 }
 
 bool NodeId::operator > (const NodeId &rhs) const {
-  return raw_id_ > rhs.raw_id_;
+  return rhs < *this;
 }
 
 bool NodeId::operator <= (const NodeId &rhs) const {
-  return raw_id_ <= rhs.raw_id_;
+  return !(rhs < *this);
 }
 
 bool NodeId::operator >= (const NodeId &rhs) const {
-  return raw_id_ >= rhs.raw_id_;
+  return !(*this < rhs);
 }
 
 NodeId& NodeId::operator = (const NodeId &rhs) {
-  this->raw_id_ = rhs.raw_id_;
+  std::copy(rhs.words_, rhs.words_ + kWordCount, words_);
+  valid_ = rhs.valid_;
   return *this;
 }
 
 const NodeId NodeId::operator ^ (const NodeId &rhs) const {
   NodeId result;
-  std::string::const_iterator this_it = raw_id_.begin();
-  std::string::const_iterator rhs_it = rhs.raw_id_.begin();
-  std::string::iterator result_it = result.raw_id_.begin();
-  for (; this_it != raw_id_.end(); ++this_it, ++rhs_it, ++result_it)
-    *result_it = *this_it ^ *rhs_it;
+  for (uint16_t i = 0; i < kWordCount; ++i)
+    result.words_[i] = words_[i] ^ rhs.words_[i];
+  result.valid_ = valid_ && rhs.valid_;
   return result;
 }
 
+size_t NodeIdHash::operator()(const NodeId &node_id) const {
+  uint64_t hash(0);
+  for (uint16_t i = 0; i < NodeId::kWordCount; ++i)
+    hash = (hash ^ node_id.words_[i]) * 0x100000001b3ULL;
+  return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
 std::string DebugId(const NodeId &node_id) {
   std::string hex(node_id.ToStringEncoded(NodeId::kHex));
   return hex.substr(0, 7) + ".." +hex.substr(hex.size() - 7);
@@ -58,6 +58,8 @@ size_t BitToByteCount(const size_t &bit_count);
 /**
 * @class NodeId
 * Class used to contain a valid kademlia id in the range [0, 2 ^ kKeySizeBits)
+* The id is held inline as an array of 64-bit words, most significant word
+* first, so that copying, XOR and comparison never touch the heap.
 */
 
 class NodeId {
@@ -121,6 +123,15 @@ class NodeId {
                              const NodeId &id2,
                              const NodeId &target_id);
 
+  /**
+  * Length of the common prefix shared with another id, i.e. the number of
+  * leading zero bits in (this XOR other).
+  * @param other NodeId object to compare against.
+  * @return The number of common leading bits, kKeySizeBits if the ids are
+  * equal, or 0 if either id is invalid.
+  */
+  uint16_t CommonLeadingBits(const NodeId &other) const;
+
   /** Decoded representation of the kademlia id.
   * @return A decoded string representation of the kademlia id.
   */
@@ -133,7 +144,7 @@ class NodeId {
   const std::string ToStringEncoded(const EncodingType &encoding_type) const;
 
   /**
-  * Checks that raw_id_ has size kKeySizeBytes.
+  * Checks that the id was constructed from valid input.
   */
   bool IsValid() const;
 
@@ -153,9 +164,20 @@ class NodeId {
   const NodeId operator ^ (const NodeId &rhs) const;
 
  private:
+  friend class NodeIdBlock;
+  friend struct NodeIdHash;
+  static const uint16_t kWordCount = kKeySizeBytes / sizeof(uint64_t);
   std::string EncodeToBinary() const;
   void DecodeFromBinary(const std::string &binary_id);
-  std::string raw_id_;
+  void DecodeFromRaw(const std::string &raw_id);
+  void Invalidate();
+  uint64_t words_[kWordCount];
+  bool valid_;
+};
+
+/** Hash functor allowing NodeId to be used as a key in unordered containers */
+struct NodeIdHash {
+  size_t operator()(const NodeId &node_id) const;
 };
 
 /** Returns an abbreviated hex representation of node_id */
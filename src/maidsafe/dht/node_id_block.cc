@@ -0,0 +1,135 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "maidsafe/dht/node_id_block.h"
+
+#include <algorithm>
+#include <functional>
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#endif
+
+namespace args = std::placeholders;
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace {
+
+// Sets distances[i] = words[i] ^ target_word for i in [0, count).
+void XorWords(const uint64_t *words,
+              const uint64_t &target_word,
+              const size_t &count,
+              uint64_t *distances) {
+  size_t i(0);
+#if defined(__AVX2__)
+  const __m256i kTarget(_mm256_set1_epi64x(static_cast<int64_t>(target_word)));
+  for (; i + 4 <= count; i += 4) {
+    __m256i block(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+        words + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(distances + i),
+                        _mm256_xor_si256(block, kTarget));
+  }
+#endif
+  for (; i < count; ++i)
+    distances[i] = words[i] ^ target_word;
+}
+
+}  // unnamed namespace
+
+NodeIdBlock::NodeIdBlock() : columns_(), valid_(), leading_distances_() {}
+
+void NodeIdBlock::Reserve(const size_t &capacity) {
+  for (uint16_t i = 0; i < NodeId::kWordCount; ++i)
+    columns_[i].reserve(capacity);
+  valid_.reserve(capacity);
+  leading_distances_.reserve(capacity);
+}
+
+void NodeIdBlock::Add(const NodeId &node_id) {
+  for (uint16_t i = 0; i < NodeId::kWordCount; ++i)
+    columns_[i].push_back(node_id.words_[i]);
+  valid_.push_back(node_id.IsValid());
+}
+
+void NodeIdBlock::Clear() {
+  for (uint16_t i = 0; i < NodeId::kWordCount; ++i)
+    columns_[i].clear();
+  valid_.clear();
+}
+
+size_t NodeIdBlock::Size() const {
+  return valid_.size();
+}
+
+void NodeIdBlock::SelectClosest(const NodeId &target,
+                                const size_t &count,
+                                std::vector<size_t> *indices) {
+  if (!indices)
+    return;
+  indices->clear();
+  if (!target.IsValid() || count == 0 || valid_.empty())
+    return;
+
+  leading_distances_.resize(Size());
+  XorWords(&columns_[0][0], target.words_[0], Size(), &leading_distances_[0]);
+
+  indices->reserve(Size());
+  for (size_t i = 0; i < Size(); ++i) {
+    if (valid_[i])
+      indices->push_back(i);
+  }
+
+  auto closer(std::bind(&NodeIdBlock::Closer, this, args::_1, args::_2,
+                        std::cref(target)));
+  if (count < indices->size()) {
+    std::nth_element(indices->begin(), indices->begin() + count,
+                     indices->end(), closer);
+    indices->resize(count);
+  }
+  std::sort(indices->begin(), indices->end(), closer);
+}
+
+bool NodeIdBlock::Closer(const size_t &lhs,
+                         const size_t &rhs,
+                         const NodeId &target) const {
+  if (leading_distances_[lhs] != leading_distances_[rhs])
+    return leading_distances_[lhs] < leading_distances_[rhs];
+  for (uint16_t i = 1; i < NodeId::kWordCount; ++i) {
+    uint64_t lhs_distance(columns_[i][lhs] ^ target.words_[i]);
+    uint64_t rhs_distance(columns_[i][rhs] ^ target.words_[i]);
+    if (lhs_distance != rhs_distance)
+      return lhs_distance < rhs_distance;
+  }
+  // Duplicate IDs are ranked in the order in which they were added.
+  return lhs < rhs;
+}
+
+}  // namespace dht
+
+}  // namespace maidsafe
@@ -0,0 +1,89 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAIDSAFE_DHT_NODE_ID_BLOCK_H_
+#define MAIDSAFE_DHT_NODE_ID_BLOCK_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "maidsafe/dht/node_id.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+/**
+* @class NodeIdBlock
+* Contiguous structure-of-arrays store of node IDs used to rank many IDs by XOR
+* distance to a single target in one pass.  Column i holds word i of every ID,
+* so the leading-word distances are computed with wide (AVX2 where the build
+* allows) XORs, and only ties fall back to the remaining words.
+*/
+class NodeIdBlock {
+ public:
+  NodeIdBlock();
+
+  /** Reserves space for capacity IDs. */
+  void Reserve(const size_t &capacity);
+
+  /**
+  * Appends an ID.  Its index is the number of IDs previously added.  Invalid
+  * IDs are held to keep the indices aligned, but are never selected.
+  * @param[in] node_id The ID to append.
+  */
+  void Add(const NodeId &node_id);
+
+  void Clear();
+
+  size_t Size() const;
+
+  /**
+  * Finds the IDs closest to target.
+  * @param[in] target The ID to which XOR distances are measured.
+  * @param[in] count The maximum number of indices to return.
+  * @param[out] indices The indices (as passed to Add) of up to count valid IDs,
+  * closest first.
+  */
+  void SelectClosest(const NodeId &target,
+                     const size_t &count,
+                     std::vector<size_t> *indices);
+
+ private:
+  NodeIdBlock(const NodeIdBlock&);
+  NodeIdBlock& operator=(const NodeIdBlock&);
+  bool Closer(const size_t &lhs, const size_t &rhs, const NodeId &target) const;
+  std::vector<uint64_t> columns_[NodeId::kWordCount];
+  std::vector<bool> valid_;
+  std::vector<uint64_t> leading_distances_;
+};
+
+}  // namespace dht
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DHT_NODE_ID_BLOCK_H_
@@ -63,6 +63,59 @@ bool FindResultError(int result) {
           result != kFoundCachedCopyHolder &&
           result != kFailedToFindValue);
 }
+
+// Run on the crypto pool.  Signs value unless signature already holds one,
+// and leaves signature empty if signing fails.
+void SignOnCryptoPool(const std::string &value,
+                      PrivateKeyPtr private_key,
+                      std::shared_ptr<std::string> signature) {
+  if (signature->empty() &&
+      asymm::Sign(value, *private_key, signature.get()) != kSuccess)
+    signature->clear();
+}
+
+// Run on the crypto pool for the two values of an Update.
+void SignPairOnCryptoPool(const std::string &old_value,
+                          const std::string &new_value,
+                          PrivateKeyPtr private_key,
+                          std::shared_ptr<std::string> old_signature,
+                          std::shared_ptr<std::string> new_signature) {
+  SignOnCryptoPool(old_value, private_key, old_signature);
+  SignOnCryptoPool(new_value, private_key, new_signature);
+}
+
+// Frees an RPC's scheduler slot before handling its reply, so that RPCs sent
+// from the callback can take it.
+void CallAfterRelease(LookupScheduler::SlotPtr rpc_slot,
+                      RpcStoreFunctor callback,
+                      RankInfoPtr rank_info,
+                      const int &result) {
+  rpc_slot->Release();
+  callback(rank_info, result);
+}
+
+void CallFindNodesAfterRelease(LookupScheduler::SlotPtr rpc_slot,
+                               RpcFindNodesFunctor callback,
+                               RankInfoPtr rank_info,
+                               const int &result,
+                               const std::vector<Contact> &contacts) {
+  rpc_slot->Release();
+  callback(rank_info, result, contacts);
+}
+
+void CallFindValueAfterRelease(
+    LookupScheduler::SlotPtr rpc_slot,
+    RpcFindValueFunctor callback,
+    RankInfoPtr rank_info,
+    const int &result,
+    const std::vector<ValueAndSignature> &values_and_signatures,
+    const std::vector<Contact> &contacts,
+    const Contact &cached_copy_holder,
+    const asymm::Identity &signer_public_key_id) {
+  rpc_slot->Release();
+  callback(rank_info, result, values_and_signatures, contacts,
+           cached_copy_holder, signer_public_key_id);
+}
 }  // unnamed namespace
 
 NodeImpl::NodeImpl(boost::asio::io_service &asio_service,     // NOLINT (Fraser)
@@ -102,8 +155,36 @@ NodeImpl::NodeImpl(boost::asio::io_service &asio_service,     // NOLINT (Fraser)
       validate_contact_(),
       ping_down_contact_(),
       refresh_data_store_timer_(asio_service_),
+      refresh_kbuckets_timer_(asio_service_),
+      kbucket_refreshes_in_flight_(0),
+      kbucket_refresh_mutex_(),
+      routing_table_file_(),
+      unverified_contacts_(),
       join_mutex_(),
-      check_cache_functor_() {
+      check_cache_functor_(),
+      latency_aware_lookups_(false),
+      closest_contacts_cache_(new ClosestContactsCache(
+          kMaxClosestContactsCacheSize, kClosestContactsCacheTtl)),
+      suspect_list_(new SuspectList(kMaxSuspectListSize, kSuspectTtl)),
+      lookup_scheduler_(new LookupScheduler(asio_service_,
+          kMaxConcurrentLookups, kMaxConcurrentInteractiveLookups,
+          kMaxConcurrentMaintenanceLookups, kMaxConcurrentBulkLookups,
+          kMaxRpcsInFlight, kMaxInteractiveRpcsInFlight,
+          kMaxMaintenanceRpcsInFlight, kMaxBulkRpcsInFlight)),
+      session_cache_(),
+      signature_cache_(new SignatureCache(kMaxSignatureCacheSize,
+                                          kSignatureCacheTtl)),
+      public_key_cache_(new PublicKeyCache(kMaxPublicKeyCacheSize,
+          kPublicKeyCacheTtl, kPublicKeyCacheNegativeTtl)),
+      crypto_pool_(),
+      pending_find_values_(),
+      pending_find_nodes_(),
+      pending_lookups_mutex_(),
+      rpc_batches_(),
+      rpc_batches_mutex_(),
+      rtt_average_(0),
+      rtt_variance_(0),
+      rtt_mutex_() {
   if (default_asym_key_pair) {
     default_private_key_ = PrivateKeyPtr(
         new asymm::PrivateKey(default_asym_key_pair->private_key));
@@ -150,6 +231,22 @@ void NodeImpl::Join(const NodeId &node_id,
     rpcs_.reset(new Rpcs<transport::TcpTransport>(asio_service_,
                                                   default_private_key_));
   }
+  if (!session_cache_) {
+    session_cache_.reset(new SessionCache(default_private_key_,
+                                          kMaxSessionKeys, kSessionKeyLifetime,
+                                          kMaxSessionMessages,
+                                          kSessionFallbackPeriod));
+  }
+  rpcs_->set_session_cache(session_cache_);
+  if (!crypto_pool_) {
+    crypto_pool_.reset(new CryptoPool(kCryptoPoolThreads,
+                                      kMaxCryptoPoolQueueSize,
+                                      kCryptoPoolBatchSize));
+  }
+  if (message_handler_) {
+    message_handler_->set_session_cache(session_cache_);
+    message_handler_->set_signature_cache(signature_cache_);
+  }
   // TODO(Fraser#5#): 2011-07-08 - Need to update code for local endpoints.
   if (!client_only_node_) {
     std::vector<transport::Endpoint> local_endpoints;
@@ -181,6 +278,16 @@ void NodeImpl::Join(const NodeId &node_id,
   ConnectValidateContact();
   ConnectPingDownContact();
 
+  if (!routing_table_file_.empty() &&
+      routing_table_->ReadFromFile(routing_table_file_) == kSuccess) {
+    {
+      boost::mutex::scoped_lock lock(kbucket_refresh_mutex_);
+      routing_table_->GetAllContacts(&unverified_contacts_);
+    }
+    if (bootstrap_contacts.empty())
+      routing_table_->GetBootstrapContacts(&bootstrap_contacts);
+  }
+
   if (bootstrap_contacts.empty()) {
     // This is the first node on the network.
     asio_service_.post(std::bind(&NodeImpl::JoinSucceeded, this, callback));
@@ -245,6 +352,7 @@ void NodeImpl::JoinSucceeded(JoinFunctor callback) {
   joined_ = true;
   if (!client_only_node_) {
     data_store_.reset(new DataStore(kMeanRefreshInterval_));
+    data_store_->set_signature_cache(signature_cache_);
     service_.reset(new Service(routing_table_, data_store_,
                                default_private_key_, k_));
     service_->set_node_joined(true);
@@ -254,11 +362,15 @@ void NodeImpl::JoinSucceeded(JoinFunctor callback) {
     service_->set_contact_validator(contact_validator_);
     service_->set_validate(validate_functor_);
     service_->set_check_cache_functor(check_cache_functor_);
+    service_->set_signature_cache(signature_cache_);
+    service_->set_public_key_cache(public_key_cache_);
+    service_->set_crypto_pool(crypto_pool_, asio_service_);
     refresh_data_store_timer_.expires_from_now(kDataStoreCheckInterval_);
     refresh_data_store_timer_.async_wait(
         std::bind(&NodeImpl::RefreshDataStore, this, args::_1));
     data_store_->set_debug_id(DebugId(contact_));
   }
+  ScheduleKBucketRefresh();
   callback(kSuccess);
 }
 
@@ -269,6 +381,13 @@ void NodeImpl::JoinFailed(JoinFunctor callback, int result) {
 void NodeImpl::Leave(std::vector<Contact> *bootstrap_contacts) {
   joined_ = false;
   refresh_data_store_timer_.cancel();
+  refresh_kbuckets_timer_.cancel();
+  {
+    boost::mutex::scoped_lock lock(kbucket_refresh_mutex_);
+    unverified_contacts_.clear();
+  }
+  if (routing_table_ && !routing_table_file_.empty())
+    routing_table_->WriteToFile(routing_table_file_);
   ping_oldest_contact_.disconnect();
   validate_contact_.disconnect();
   ping_down_contact_.disconnect();
@@ -303,11 +422,197 @@ void NodeImpl::FailedValidation(T callback) {
   callback(kFailedValidation);
 }
 
+OperationGuardPtr NodeImpl::MakeOperationGuard(
+    const bptime::time_duration &timeout,
+    OperationHandlePtr handle) {
+  if (timeout == bptime::pos_infin && !handle)
+    return OperationGuardPtr();
+  return OperationGuardPtr(new OperationGuard);
+}
+
+template <typename T>
+T NodeImpl::GuardCallback(T callback, OperationGuardPtr guard) {
+  if (!guard)
+    return callback;
+  return std::bind(&NodeImpl::GuardedResultCallback, guard, callback,
+                   args::_1);
+}
+
+template <>
+FindValueFunctor NodeImpl::GuardCallback<FindValueFunctor>(
+    FindValueFunctor callback,
+    OperationGuardPtr guard) {
+  if (!guard)
+    return callback;
+  return std::bind(&NodeImpl::GuardedFindValueCallback, guard, callback,
+                   args::_1);
+}
+
+template <>
+FindNodesFunctor NodeImpl::GuardCallback<FindNodesFunctor>(
+    FindNodesFunctor callback,
+    OperationGuardPtr guard) {
+  if (!guard)
+    return callback;
+  return std::bind(&NodeImpl::GuardedFindNodesCallback, guard, callback,
+                   args::_1, args::_2);
+}
+
+template <>
+GetContactFunctor NodeImpl::GuardCallback<GetContactFunctor>(
+    GetContactFunctor callback,
+    OperationGuardPtr guard) {
+  if (!guard)
+    return callback;
+  return std::bind(&NodeImpl::GuardedGetContactCallback, guard, callback,
+                   args::_1, args::_2);
+}
+
+void NodeImpl::GuardedResultCallback(OperationGuardPtr guard,
+                                     std::function<void(int)> callback,  // NOLINT (Fraser)
+                                     int result) {
+  if (guard->Complete())
+    callback(result);
+}
+
+void NodeImpl::GuardedFindValueCallback(OperationGuardPtr guard,
+                                        FindValueFunctor callback,
+                                        FindValueReturns find_value_returns) {
+  if (guard->Complete())
+    callback(find_value_returns);
+}
+
+void NodeImpl::GuardedFindNodesCallback(OperationGuardPtr guard,
+                                        FindNodesFunctor callback,
+                                        int result,
+                                        std::vector<Contact> contacts) {
+  if (guard->Complete())
+    callback(result, contacts);
+}
+
+void NodeImpl::GuardedGetContactCallback(OperationGuardPtr guard,
+                                         GetContactFunctor callback,
+                                         int result,
+                                         Contact contact) {
+  if (guard->Complete())
+    callback(result, contact);
+}
+
+template <typename T>
+void NodeImpl::ArmOperationGuard(OperationGuardPtr guard,
+                                 T callback,
+                                 LookupArgsPtr lookup_args,
+                                 const bptime::time_duration &timeout,
+                                 OperationHandlePtr handle) {
+  if (!guard)
+    return;
+  {
+    boost::mutex::scoped_lock lock(guard->mutex);
+    // The operation may have completed already, e.g. from cached contacts.
+    if (guard->completed)
+      return;
+    guard->stop = std::bind(&NodeImpl::StopOperation<T>,
+                            std::weak_ptr<LookupArgs>(lookup_args), callback,
+                            args::_1);
+    if (timeout != bptime::pos_infin) {
+      guard->deadline_timer.reset(
+          new boost::asio::deadline_timer(asio_service_, timeout));
+      guard->deadline_timer->async_wait(
+          std::bind(&NodeImpl::HandleOperationDeadline, args::_1, guard));
+    }
+  }
+  if (handle) {
+    handle->set_cancel_functor(std::bind(&NodeImpl::StopGuardedOperation,
+                                         guard, kOperationCancelled));
+  }
+}
+
+void NodeImpl::HandleOperationDeadline(
+    const boost::system::error_code &error_code,
+    OperationGuardPtr guard) {
+  if (error_code)
+    return;
+  StopGuardedOperation(guard, kOperationDeadlineExpired);
+}
+
+void NodeImpl::StopGuardedOperation(OperationGuardPtr guard, int result) {
+  if (guard->Complete())
+    guard->stop(result);
+}
+
+std::vector<OperationHandlePtr> NodeImpl::MakeSubHandles(
+    size_t count,
+    OperationHandlePtr handle) {
+  std::vector<OperationHandlePtr> sub_handles(count);
+  if (!handle)
+    return sub_handles;
+  for (size_t i = 0; i < count; ++i)
+    sub_handles[i].reset(new OperationHandle);
+  handle->set_cancel_functor(std::bind(&NodeImpl::CancelSubHandles,
+                                       sub_handles));
+  return sub_handles;
+}
+
+void NodeImpl::CancelSubHandles(std::vector<OperationHandlePtr> sub_handles) {
+  for (size_t i = 0; i < sub_handles.size(); ++i)
+    sub_handles[i]->Cancel();
+}
+
+template <typename T>
+void NodeImpl::InvokeWithResult(T callback, int result) {
+  callback(result);
+}
+
+template <>
+void NodeImpl::InvokeWithResult<FindValueFunctor>(FindValueFunctor callback,
+                                                  int result) {
+  callback(FindValueReturns(result, std::vector<ValueAndSignature>(),
+                            std::vector<Contact>(), Contact(), Contact()));
+}
+
+template <>
+void NodeImpl::InvokeWithResult<FindNodesFunctor>(FindNodesFunctor callback,
+                                                  int result) {
+  callback(result, std::vector<Contact>());
+}
+
+template <>
+void NodeImpl::InvokeWithResult<GetContactFunctor>(GetContactFunctor callback,
+                                                   int result) {
+  callback(result, Contact());
+}
+
+template <typename T>
+void NodeImpl::StopOperation(std::weak_ptr<LookupArgs> lookup_args,
+                             T callback,
+                             int result) {
+  LookupArgsPtr args(lookup_args.lock());
+  if (args) {
+    boost::mutex::scoped_lock lock(args->mutex);
+    args->lookup_phase_complete = true;
+    args->slot.reset();
+  }
+  InvokeWithResult<T>(callback, result);
+}
+
 OrderedContacts NodeImpl::GetClosestContactsLocally(
     const Key &key,
     const uint16_t &total_contacts) {
-  std::vector<Contact> close_nodes, excludes;
+  std::vector<Contact> close_nodes, excludes(suspect_list_->GetSuspects());
   routing_table_->GetCloseContacts(key, total_contacts, excludes, &close_nodes);
+  if (close_nodes.size() < total_contacts && !excludes.empty()) {
+    // Top up with the closest suspects rather than start with too few.
+    std::vector<Contact> all_close_nodes;
+    routing_table_->GetCloseContacts(key, total_contacts,
+                                     std::vector<Contact>(), &all_close_nodes);
+    for (auto it = all_close_nodes.begin();
+         it != all_close_nodes.end() && close_nodes.size() < total_contacts;
+         ++it) {
+      if (std::find(close_nodes.begin(), close_nodes.end(), *it) ==
+          close_nodes.end())
+        close_nodes.push_back(*it);
+    }
+  }
   OrderedContacts close_contacts(CreateOrderedContacts(close_nodes.begin(),
                                                        close_nodes.end(), key));
   // This node's ID will not be held in the routing table, so add it now.  The
@@ -326,12 +631,97 @@ int NodeImpl::SignIfEmpty(const std::string &value,
   return kSuccess;
 }
 
+template <typename T>
+void NodeImpl::BatchedResultCallback(
+    T result,
+    size_t index,
+    std::shared_ptr<BatchedResults<T>> results) {
+  {
+    boost::mutex::scoped_lock lock(results->mutex);
+    results->results[index] = result;
+    if (--results->pending != 0)
+      return;
+  }
+  results->callback(results->results);
+}
+
 void NodeImpl::Store(const Key &key,
                      const std::string &value,
                      const std::string &signature,
                      const bptime::time_duration &ttl,
                      PrivateKeyPtr private_key,
-                     StoreFunctor callback) {
+                     StoreFunctor callback,
+                     const bptime::time_duration &timeout,
+                     OperationHandlePtr handle) {
+  DoStore(key, value, signature, ttl, private_key, callback, timeout, handle,
+          false);
+}
+
+void NodeImpl::StoreMany(
+    const std::vector<Key> &keys,
+    const std::vector<ValueAndSignature> &values_and_signatures,
+    const bptime::time_duration &ttl,
+    PrivateKeyPtr private_key,
+    StoreManyFunctor callback,
+    const bptime::time_duration &timeout,
+    OperationHandlePtr handle) {
+  if (keys.empty() || keys.size() != values_and_signatures.size()) {
+    asio_service_.post(std::bind(callback, std::vector<int>(keys.size(),
+        keys.empty() ? kSuccess : kGeneralError)));
+    return;
+  }
+  std::shared_ptr<BatchedResults<int>> results(
+      new BatchedResults<int>(keys.size(), callback));
+  std::vector<OperationHandlePtr> sub_handles(
+      MakeSubHandles(keys.size(), handle));
+  for (size_t i = 0; i < keys.size(); ++i) {
+    DoStore(keys[i], values_and_signatures[i].first,
+            values_and_signatures[i].second, ttl, private_key,
+            std::bind(&NodeImpl::BatchedResultCallback<int>, args::_1, i,
+                      results),
+            timeout, sub_handles[i], true);
+  }
+}
+
+void NodeImpl::PrepareStore(
+    const Key &key,
+    const std::string &value,
+    const bptime::time_duration &ttl,
+    PrivateKeyPtr private_key,
+    std::shared_ptr<std::string> signature,
+    std::shared_ptr<RequestAndSignature> store_request) {
+  SignOnCryptoPool(value, private_key, signature);
+  if (signature->empty())
+    return;
+  *store_request = rpcs_->MakeStoreRequestAndSignature(key, value, *signature,
+      bptime::seconds(ttl.total_seconds()), private_key);
+}
+
+void NodeImpl::SignedStore(const Key &key,
+                           const std::string &value,
+                           std::shared_ptr<std::string> signature,
+                           std::shared_ptr<RequestAndSignature> store_request,
+                           const bptime::time_duration &ttl,
+                           PrivateKeyPtr private_key,
+                           StoreFunctor callback,
+                           const bptime::time_duration &timeout,
+                           OperationHandlePtr handle,
+                           bool batched) {
+  if (signature->empty())
+    return FailedValidation<StoreFunctor>(callback);
+  StartStore(key, value, *signature, *store_request, ttl, private_key,
+             callback, timeout, handle, batched);
+}
+
+void NodeImpl::DoStore(const Key &key,
+                       const std::string &value,
+                       const std::string &signature,
+                       const bptime::time_duration &ttl,
+                       PrivateKeyPtr private_key,
+                       StoreFunctor callback,
+                       const bptime::time_duration &timeout,
+                       OperationHandlePtr handle,
+                       bool batched) {
   if (!joined_) {
     return asio_service_.post(std::bind(&NodeImpl::NotJoined<StoreFunctor>,
                                         this, callback));
@@ -340,24 +730,59 @@ void NodeImpl::Store(const Key &key,
   if (!private_key)
     private_key = default_private_key_;
 
+  if (crypto_pool_) {
+    std::shared_ptr<std::string> pool_signature(new std::string(signature));
+    std::shared_ptr<RequestAndSignature> store_request(
+        new RequestAndSignature);
+    if (crypto_pool_->Post(
+            std::bind(&NodeImpl::PrepareStore, this, key, value, ttl,
+                      private_key, pool_signature, store_request),
+            asio_service_,
+            std::bind(&NodeImpl::SignedStore, this, key, value, pool_signature,
+                      store_request, ttl, private_key, callback, timeout,
+                      handle, batched)))
+      return;
+  }
+
   std::string sig(signature);
   if (SignIfEmpty(value, private_key, &sig) != kSuccess) {
     return asio_service_.post(
         std::bind(&NodeImpl::FailedValidation<StoreFunctor>, this, callback));
   }
+  StartStore(key, value, sig, RequestAndSignature(), ttl, private_key,
+             callback, timeout, handle, batched);
+}
 
+void NodeImpl::StartStore(const Key &key,
+                          const std::string &value,
+                          const std::string &signature,
+                          const RequestAndSignature &store_request,
+                          const bptime::time_duration &ttl,
+                          PrivateKeyPtr private_key,
+                          StoreFunctor callback,
+                          const bptime::time_duration &timeout,
+                          OperationHandlePtr handle,
+                          bool batched) {
   OrderedContacts close_contacts(GetClosestContactsLocally(key, k_));
+  OperationGuardPtr guard(MakeOperationGuard(timeout, handle));
   StoreArgsPtr store_args(new StoreArgs(key, k_, close_contacts,
-      static_cast<int>(k_ * kMinSuccessfulPecentageStore), value, sig, ttl,
-      private_key, callback));
+      static_cast<int>(k_ * kMinSuccessfulPecentageStore), value, signature,
+      ttl, private_key, GuardCallback(callback, guard)));
+  store_args->store_request_and_signature = store_request;
+  store_args->batched = batched;
+  if (batched)
+    store_args->priority = LookupScheduler::kBulk;
   StartLookup(store_args);
+  ArmOperationGuard(guard, callback, store_args, timeout, handle);
 }
 
 void NodeImpl::Delete(const Key &key,
                       const std::string &value,
                       const std::string &signature,
                       PrivateKeyPtr private_key,
-                      DeleteFunctor callback) {
+                      DeleteFunctor callback,
+                      const bptime::time_duration &timeout,
+                      OperationHandlePtr handle) {
   if (!joined_) {
     return asio_service_.post(std::bind(&NodeImpl::NotJoined<DeleteFunctor>,
                                         this, callback));
@@ -366,6 +791,16 @@ void NodeImpl::Delete(const Key &key,
   if (!private_key)
     private_key = default_private_key_;
 
+  if (signature.empty() && crypto_pool_) {
+    std::shared_ptr<std::string> pool_signature(new std::string);
+    if (crypto_pool_->Post(
+            std::bind(&SignOnCryptoPool, value, private_key, pool_signature),
+            asio_service_,
+            std::bind(&NodeImpl::SignedDelete, this, key, value,
+                      pool_signature, private_key, callback, timeout, handle)))
+      return;
+  }
+
   std::string sig(signature);
   if (SignIfEmpty(value, private_key, &sig) != kSuccess) {
     return asio_service_.post(
@@ -373,10 +808,12 @@ void NodeImpl::Delete(const Key &key,
   }
 
   OrderedContacts close_contacts(GetClosestContactsLocally(key, k_));
+  OperationGuardPtr guard(MakeOperationGuard(timeout, handle));
   DeleteArgsPtr delete_args(new DeleteArgs(key, k_, close_contacts,
       static_cast<int>(k_ * kMinSuccessfulPecentageDelete), value, sig,
-      private_key, callback));
+      private_key, GuardCallback(callback, guard)));
   StartLookup(delete_args);
+  ArmOperationGuard(guard, callback, delete_args, timeout, handle);
 }
 
 void NodeImpl::Update(const Key &key,
@@ -386,7 +823,9 @@ void NodeImpl::Update(const Key &key,
                       const std::string &old_signature,
                       const bptime::time_duration &ttl,
                       PrivateKeyPtr private_key,
-                      UpdateFunctor callback) {
+                      UpdateFunctor callback,
+                      const bptime::time_duration &timeout,
+                      OperationHandlePtr handle) {
   if (!joined_) {
     return asio_service_.post(std::bind(&NodeImpl::NotJoined<UpdateFunctor>,
                                         this, callback));
@@ -395,6 +834,21 @@ void NodeImpl::Update(const Key &key,
   if (!private_key)
     private_key = default_private_key_;
 
+  if ((new_signature.empty() || old_signature.empty()) && crypto_pool_) {
+    std::shared_ptr<std::string> pool_new_signature(
+        new std::string(new_signature));
+    std::shared_ptr<std::string> pool_old_signature(
+        new std::string(old_signature));
+    if (crypto_pool_->Post(
+            std::bind(&SignPairOnCryptoPool, old_value, new_value, private_key,
+                      pool_old_signature, pool_new_signature),
+            asio_service_,
+            std::bind(&NodeImpl::SignedUpdate, this, key, new_value,
+                      pool_new_signature, old_value, pool_old_signature, ttl,
+                      private_key, callback, timeout, handle)))
+      return;
+  }
+
   std::string new_sig(new_signature), old_sig(old_signature);
   if (SignIfEmpty(old_value, private_key, &old_sig) != kSuccess ||
       SignIfEmpty(new_value, private_key, &new_sig) != kSuccess) {
@@ -403,17 +857,85 @@ void NodeImpl::Update(const Key &key,
   }
 
   OrderedContacts close_contacts(GetClosestContactsLocally(key, k_));
+  OperationGuardPtr guard(MakeOperationGuard(timeout, handle));
   UpdateArgsPtr update_args(new UpdateArgs(key, k_, close_contacts,
       static_cast<int>(k_ * kMinSuccessfulPecentageUpdate), old_value,
-      old_sig, new_value, new_sig, ttl, private_key, callback));
+      old_sig, new_value, new_sig, ttl, private_key,
+      GuardCallback(callback, guard)));
   StartLookup(update_args);
+  ArmOperationGuard(guard, callback, update_args, timeout, handle);
+}
+
+void NodeImpl::SignedDelete(const Key &key,
+                            const std::string &value,
+                            std::shared_ptr<std::string> signature,
+                            PrivateKeyPtr private_key,
+                            DeleteFunctor callback,
+                            const bptime::time_duration &timeout,
+                            OperationHandlePtr handle) {
+  if (signature->empty())
+    return FailedValidation<DeleteFunctor>(callback);
+  Delete(key, value, *signature, private_key, callback, timeout, handle);
+}
+
+void NodeImpl::SignedUpdate(const Key &key,
+                            const std::string &new_value,
+                            std::shared_ptr<std::string> new_signature,
+                            const std::string &old_value,
+                            std::shared_ptr<std::string> old_signature,
+                            const bptime::time_duration &ttl,
+                            PrivateKeyPtr private_key,
+                            UpdateFunctor callback,
+                            const bptime::time_duration &timeout,
+                            OperationHandlePtr handle) {
+  if (new_signature->empty() || old_signature->empty())
+    return FailedValidation<UpdateFunctor>(callback);
+  Update(key, new_value, *new_signature, old_value, *old_signature, ttl,
+         private_key, callback, timeout, handle);
 }
 
 void NodeImpl::FindValue(const Key &key,
                          PrivateKeyPtr private_key,
                          FindValueFunctor callback,
                          const uint16_t &extra_contacts,
-                         bool cache) {
+                         bool cache,
+                         const bptime::time_duration &timeout,
+                         OperationHandlePtr handle) {
+  DoFindValue(key, private_key, callback, extra_contacts, cache, timeout,
+              handle, false);
+}
+
+void NodeImpl::FindValues(const std::vector<Key> &keys,
+                          PrivateKeyPtr private_key,
+                          FindValuesFunctor callback,
+                          const uint16_t &extra_contacts,
+                          bool cache,
+                          const bptime::time_duration &timeout,
+                          OperationHandlePtr handle) {
+  if (keys.empty()) {
+    asio_service_.post(std::bind(callback, std::vector<FindValueReturns>()));
+    return;
+  }
+  std::shared_ptr<BatchedResults<FindValueReturns>> results(
+      new BatchedResults<FindValueReturns>(keys.size(), callback));
+  std::vector<OperationHandlePtr> sub_handles(
+      MakeSubHandles(keys.size(), handle));
+  for (size_t i = 0; i < keys.size(); ++i) {
+    DoFindValue(keys[i], private_key,
+                std::bind(&NodeImpl::BatchedResultCallback<FindValueReturns>,
+                          args::_1, i, results),
+                extra_contacts, cache, timeout, sub_handles[i], true);
+  }
+}
+
+void NodeImpl::DoFindValue(const Key &key,
+                           PrivateKeyPtr private_key,
+                           FindValueFunctor callback,
+                           const uint16_t &extra_contacts,
+                           bool cache,
+                           const bptime::time_duration &timeout,
+                           OperationHandlePtr handle,
+                           bool batched) {
   if (!joined_) {
     return asio_service_.post(std::bind(&NodeImpl::NotJoined<FindValueFunctor>,
                                         this, callback));
@@ -452,8 +974,41 @@ void NodeImpl::FindValue(const Key &key,
     }
   }
 
+  // An operation with its own deadline or handle runs its own lookup, so that
+  // ending it early doesn't affect any other caller.
+  OperationGuardPtr guard(MakeOperationGuard(timeout, handle));
+  if (guard) {
+    FindValueArgsPtr find_value_args(new FindValueArgs(key,
+        k_ + extra_contacts, close_contacts, cache, private_key,
+        GuardCallback(callback, guard)));
+    find_value_args->batched = batched;
+    if (batched)
+      find_value_args->priority = LookupScheduler::kBulk;
+    StartLookup(find_value_args);
+    ArmOperationGuard(guard, callback, find_value_args, timeout, handle);
+    return;
+  }
+
+  // If an identical lookup is already in flight, wait for its result instead.
+  LookupKey lookup_key(LookupArgs::kFindValue, key, k_ + extra_contacts,
+                       private_key, cache, batched,
+                       batched ? LookupScheduler::kBulk :
+                                 LookupScheduler::kInteractive);
+  {
+    boost::mutex::scoped_lock lock(pending_lookups_mutex_);
+    std::vector<FindValueFunctor> &callbacks(pending_find_values_[lookup_key]);
+    callbacks.push_back(callback);
+    if (callbacks.size() != 1U)
+      return;
+  }
+
   FindValueArgsPtr find_value_args(new FindValueArgs(key, k_ + extra_contacts,
-      close_contacts, cache, private_key, callback));
+      close_contacts, cache, private_key,
+      std::bind(&NodeImpl::FindValueCoalescedCallback, this, args::_1,
+                lookup_key)));
+  find_value_args->batched = batched;
+  if (batched)
+    find_value_args->priority = LookupScheduler::kBulk;
   StartLookup(find_value_args);
 }
 
@@ -462,21 +1017,117 @@ void NodeImpl::FoundValueLocally(const FindValueReturns &find_value_returns,
   callback(find_value_returns);
 }
 
+void NodeImpl::FindValueCoalescedCallback(FindValueReturns find_value_returns,
+                                          LookupKey lookup_key) {
+  std::vector<FindValueFunctor> callbacks;
+  {
+    boost::mutex::scoped_lock lock(pending_lookups_mutex_);
+    auto it(pending_find_values_.find(lookup_key));
+    if (it == pending_find_values_.end())
+      return;
+    callbacks.swap((*it).second);
+    pending_find_values_.erase(it);
+  }
+  for (auto it = callbacks.begin(); it != callbacks.end(); ++it)
+    (*it)(find_value_returns);
+}
+
 void NodeImpl::FindNodes(const Key &key,
                          FindNodesFunctor callback,
-                         const uint16_t &extra_contacts) {
+                         const uint16_t &extra_contacts,
+                         const bptime::time_duration &timeout,
+                         OperationHandlePtr handle) {
+  DoFindNodes(key, callback, extra_contacts, timeout, handle,
+              LookupScheduler::kInteractive);
+}
+
+void NodeImpl::DoFindNodes(const Key &key,
+                           FindNodesFunctor callback,
+                           const uint16_t &extra_contacts,
+                           const bptime::time_duration &timeout,
+                           OperationHandlePtr handle,
+                           LookupScheduler::Priority priority) {
   if (!joined_) {
     return asio_service_.post(std::bind(&NodeImpl::NotJoined<FindNodesFunctor>,
                                         this, callback));
   }
+  // An operation with its own deadline or handle runs its own lookup, so that
+  // ending it early doesn't affect any other caller.
+  OperationGuardPtr guard(MakeOperationGuard(timeout, handle));
+  if (guard) {
+    OrderedContacts close_contacts(
+        GetClosestContactsLocally(key, k_ + extra_contacts));
+    FindNodesArgsPtr find_nodes_args(new FindNodesArgs(key,
+        k_ + extra_contacts, close_contacts, default_private_key_,
+        GuardCallback(callback, guard)));
+    find_nodes_args->priority = priority;
+    StartLookup(find_nodes_args);
+    ArmOperationGuard(guard, callback, find_nodes_args, timeout, handle);
+    return;
+  }
+  // If an identical lookup is already in flight, wait for its result instead.
+  LookupKey lookup_key(LookupArgs::kFindNodes, key, k_ + extra_contacts,
+                       default_private_key_, false, false, priority);
+  {
+    boost::mutex::scoped_lock lock(pending_lookups_mutex_);
+    std::vector<FindNodesFunctor> &callbacks(pending_find_nodes_[lookup_key]);
+    callbacks.push_back(callback);
+    if (callbacks.size() != 1U)
+      return;
+  }
   OrderedContacts close_contacts(
       GetClosestContactsLocally(key, k_ + extra_contacts));
   FindNodesArgsPtr find_nodes_args(new FindNodesArgs(key, k_ + extra_contacts,
-      close_contacts, default_private_key_, callback));
+      close_contacts, default_private_key_,
+      std::bind(&NodeImpl::FindNodesCoalescedCallback, this, args::_1,
+                args::_2, lookup_key)));
+  find_nodes_args->priority = priority;
   StartLookup(find_nodes_args);
 }
 
-void NodeImpl::GetContact(const NodeId &node_id, GetContactFunctor callback) {
+void NodeImpl::FindNodesWithProgress(const Key &key,
+                                     FindNodesFunctor callback,
+                                     FindNodesProgressFunctor progress_functor,
+                                     FindNodesStopFunctor stop_functor,
+                                     const uint16_t &extra_contacts,
+                                     const bptime::time_duration &timeout,
+                                     OperationHandlePtr handle) {
+  if (!joined_) {
+    return asio_service_.post(std::bind(&NodeImpl::NotJoined<FindNodesFunctor>,
+                                        this, callback));
+  }
+  // Progress is reported to this caller alone, so the lookup isn't coalesced.
+  OrderedContacts close_contacts(
+      GetClosestContactsLocally(key, k_ + extra_contacts));
+  OperationGuardPtr guard(MakeOperationGuard(timeout, handle));
+  FindNodesArgsPtr find_nodes_args(new FindNodesArgs(key, k_ + extra_contacts,
+      close_contacts, default_private_key_, GuardCallback(callback, guard)));
+  find_nodes_args->progress_functor = progress_functor;
+  find_nodes_args->stop_functor = stop_functor;
+  StartLookup(find_nodes_args);
+  ArmOperationGuard(guard, callback, find_nodes_args, timeout, handle);
+}
+
+void NodeImpl::FindNodesCoalescedCallback(int result,
+                                          std::vector<Contact> contacts,
+                                          LookupKey lookup_key) {
+  std::vector<FindNodesFunctor> callbacks;
+  {
+    boost::mutex::scoped_lock lock(pending_lookups_mutex_);
+    auto it(pending_find_nodes_.find(lookup_key));
+    if (it == pending_find_nodes_.end())
+      return;
+    callbacks.swap((*it).second);
+    pending_find_nodes_.erase(it);
+  }
+  for (auto it = callbacks.begin(); it != callbacks.end(); ++it)
+    (*it)(result, contacts);
+}
+
+void NodeImpl::GetContact(const NodeId &node_id,
+                          GetContactFunctor callback,
+                          const bptime::time_duration &timeout,
+                          OperationHandlePtr handle) {
   if (node_id == contact_.node_id()) {
     asio_service_.post(std::bind(&NodeImpl::GetOwnContact, this, callback));
     return;
@@ -494,16 +1145,20 @@ void NodeImpl::GetContact(const NodeId &node_id, GetContactFunctor callback) {
                                                        node_id));
   // If we have the contact in our own routing table, ping it, otherwise start
   // a lookup for it.
+  OperationGuardPtr guard(MakeOperationGuard(timeout, handle));
   if ((*close_contacts.begin()).node_id() == node_id) {
     rpcs_->Ping(default_private_key_,
                 *close_contacts.begin(),
                 std::bind(&NodeImpl::GetContactPingCallback, this, args::_1,
-                          args::_2, *close_contacts.begin(), callback));
+                          args::_2, *close_contacts.begin(),
+                          GuardCallback(callback, guard)));
+    ArmOperationGuard(guard, callback, LookupArgsPtr(), timeout, handle);
   } else {
     GetContactArgsPtr get_contact_args(
         new GetContactArgs(node_id, k_, close_contacts, default_private_key_,
-                           callback));
+                           GuardCallback(callback, guard)));
     StartLookup(get_contact_args);
+    ArmOperationGuard(guard, callback, get_contact_args, timeout, handle);
   }
 }
 
@@ -542,15 +1197,20 @@ void NodeImpl::GetContactPingCallback(RankInfoPtr rank_info,
     callback(kFailedToGetContact, Contact());
 }
 
-void NodeImpl::Ping(const Contact &contact, PingFunctor callback) {
+void NodeImpl::Ping(const Contact &contact,
+                    PingFunctor callback,
+                    const bptime::time_duration &timeout,
+                    OperationHandlePtr handle) {
   if (!joined_) {
     return asio_service_.post(std::bind(&NodeImpl::NotJoined<PingFunctor>,
                                         this, callback));
   }
+  OperationGuardPtr guard(MakeOperationGuard(timeout, handle));
   rpcs_->Ping(default_private_key_,
               contact,
               std::bind(&NodeImpl::PingCallback, this, args::_1, args::_2,
-                        contact, callback));
+                        contact, GuardCallback(callback, guard)));
+  ArmOperationGuard(guard, callback, LookupArgsPtr(), timeout, handle);
 }
 
 void NodeImpl::PingCallback(RankInfoPtr rank_info,
@@ -607,10 +1267,60 @@ void NodeImpl::GetBootstrapContacts(std::vector<Contact> *contacts) {
 
 void NodeImpl::StartLookup(LookupArgsPtr lookup_args) {
   BOOST_ASSERT(lookup_args->kNumContactsRequested >= k_);
+  lookup_scheduler_->Schedule(lookup_args->priority,
+      std::bind(&NodeImpl::StartScheduledLookup, this, args::_1, lookup_args));
+}
+
+void NodeImpl::StartScheduledLookup(LookupScheduler::SlotPtr slot,
+                                    LookupArgsPtr lookup_args) {
   boost::mutex::scoped_lock lock(lookup_args->mutex);
+  // The operation may have been stopped while the lookup was queued.
+  if (lookup_args->lookup_phase_complete)
+    return;
+  lookup_args->slot = slot;
+  if (UseCachedClosestContacts(lookup_args))
+    return;
   DoLookupIteration(lookup_args);
 }
 
+bool NodeImpl::UseCachedClosestContacts(LookupArgsPtr lookup_args) {
+  std::vector<Contact> cached_contacts;
+  if (lookup_args->kOperationType == LookupArgs::kGetContact ||
+      !closest_contacts_cache_->Get(lookup_args->kTarget,
+                                    lookup_args->kNumContactsRequested,
+                                    &cached_contacts)) {
+    return false;
+  }
+  OrderedContacts close_contacts(CreateOrderedContacts(
+      cached_contacts.begin(), cached_contacts.end(), lookup_args->kTarget));
+  switch (lookup_args->kOperationType) {
+    case LookupArgs::kStore:
+    case LookupArgs::kDelete:
+    case LookupArgs::kUpdate:
+    case LookupArgs::kStoreRefresh:
+    case LookupArgs::kDeleteRefresh: {
+      // The cached contacts all responded to a recent lookup for this target,
+      // so treat them as the result of this one.
+      DLOG(INFO) << DebugId(contact_) << ": Skipping lookup for "
+                 << DebugId(lookup_args->kTarget) << " using cached contacts.";
+      lookup_args->lookup_contacts.clear();
+      ContactInfo contact_info;
+      contact_info.rpc_state = ContactInfo::kRepliedOK;
+      for (auto it = close_contacts.begin(); it != close_contacts.end(); ++it)
+        lookup_args->lookup_contacts.insert(std::make_pair(*it, contact_info));
+      lookup_args->lookup_phase_complete = true;
+      HandleCompletedLookup(lookup_args, GetShortlistUpperBound(lookup_args),
+                            static_cast<int>(close_contacts.size()));
+      return true;
+    }
+    default: {
+      InsertCloseContacts(close_contacts, lookup_args,
+                          lookup_args->lookup_contacts.end());
+      return false;
+    }
+  }
+}
+
 void NodeImpl::DoLookupIteration(LookupArgsPtr lookup_args) {
   lookup_args->rpcs_in_flight_for_current_iteration = 0;
   lookup_args->lookup_phase_complete = false;
@@ -620,9 +1330,17 @@ void NodeImpl::DoLookupIteration(LookupArgsPtr lookup_args) {
   if (itr != lookup_args->lookup_contacts.end() && !client_only_node_) {
     (*itr).second.rpc_state = ContactInfo::kRepliedOK;
   }
+  // contacts queried ahead of closer ones, already accounted for below
+  std::vector<LookupContacts::iterator> sent_out_of_order;
   itr = lookup_args->lookup_contacts.begin();
   while (itr != lookup_args->lookup_contacts.end() &&
          !wait_for_in_flight_rpcs) {
+    if (std::find(sent_out_of_order.begin(), sent_out_of_order.end(), itr) !=
+        sent_out_of_order.end()) {
+      ++itr;
+      continue;
+    }
+    auto peer(itr);
     switch ((*itr).second.rpc_state) {
       case ContactInfo::kNotSent: {
         if (!client_only_node_ && (*itr).first == contact_) {
@@ -630,31 +1348,36 @@ void NodeImpl::DoLookupIteration(LookupArgsPtr lookup_args) {
           // already added the closest it knows of at the start of the op.
           (*itr).second.rpc_state = ContactInfo::kRepliedOK;
         } else {
-          if (lookup_args->kOperationType == LookupArgs::kFindValue) {
-            DLOG(INFO) << "Sending FindValue " << DebugId(lookup_args->kTarget)
-                       << " to " << DebugId((*itr).first);
-            rpcs_->FindValue(lookup_args->kTarget,
-                             lookup_args->kNumContactsRequested,
-                             lookup_args->private_key,
-                             (*itr).first,
-                             std::bind(&NodeImpl::IterativeFindCallback,
-                                       this, args::_1, args::_2, args::_3,
-                                       args::_4, args::_5, (*itr).first,
-                                       lookup_args));
+          if (latency_aware_lookups_)
+            peer = FastestNearTie(lookup_args, itr);
+          if (lookup_args->batched) {
+            bool find_value(
+                lookup_args->kOperationType == LookupArgs::kFindValue);
+            QueueBatchedRpc(RpcBatchKey(
+                find_value ? LookupArgs::kFindValue : LookupArgs::kFindNodes,
+                (*peer).first.node_id(), lookup_args->kNumContactsRequested,
+                find_value ? lookup_args->private_key : default_private_key_),
+                lookup_args, (*peer).first);
+            StartLookupRpcSoftDeadline(peer, lookup_args);
           } else {
-            rpcs_->FindNodes(lookup_args->kTarget,
-                             lookup_args->kNumContactsRequested,
-                             default_private_key_,
-                             (*itr).first,
-                             std::bind(&NodeImpl::IterativeFindCallback,
-                                       this, args::_1, args::_2,
-                                       std::vector<ValueAndSignature>(),
-                                       args::_3, Contact(), (*itr).first,
-                                       lookup_args));
+            // An RPC which has to wait for a slot starts its soft deadline
+            // once it is sent.
+            LookupScheduler::SlotPtr rpc_slot(
+                lookup_scheduler_->TryAcquireRpcSlot(lookup_args->priority));
+            if (rpc_slot) {
+              SendLookupRpc(rpc_slot, lookup_args, (*peer).first);
+              StartLookupRpcSoftDeadline(peer, lookup_args);
+            } else {
+              lookup_scheduler_->QueueRpc(lookup_args->priority,
+                  std::bind(&NodeImpl::SendQueuedLookupRpc, this, args::_1,
+                            lookup_args, (*peer).first));
+            }
           }
           ++lookup_args->total_lookup_rpcs_in_flight;
           ++lookup_args->rpcs_in_flight_for_current_iteration;
-          (*itr).second.rpc_state = ContactInfo::kSent;
+          (*peer).second.rpc_state = ContactInfo::kSent;
+          if (peer != itr)
+            sent_out_of_order.push_back(peer);
         }
         break;
       }
@@ -678,16 +1401,248 @@ void NodeImpl::DoLookupIteration(LookupArgsPtr lookup_args) {
         ((lookup_args->rpcs_in_flight_for_current_iteration +
             pending_result_count + good_contact_count) ==
             lookup_args->kNumContactsRequested);
-    ++itr;
+    // if a further contact was queried in place of this one, reconsider this
+    // one before moving on
+    if (peer == itr)
+      ++itr;
+  }
+}
+
+void NodeImpl::SendLookupRpc(LookupScheduler::SlotPtr rpc_slot,
+                             LookupArgsPtr lookup_args,
+                             const Contact &peer) {
+  if (lookup_args->kOperationType == LookupArgs::kFindValue) {
+    DLOG(INFO) << "Sending FindValue " << DebugId(lookup_args->kTarget)
+               << " to " << DebugId(peer);
+    RpcFindValueFunctor callback(std::bind(&NodeImpl::IterativeFindCallback,
+                                           this, args::_1, args::_2, args::_3,
+                                           args::_4, args::_5, args::_6, peer,
+                                           lookup_args));
+    rpcs_->FindValue(lookup_args->kTarget,
+                     lookup_args->kNumContactsRequested,
+                     lookup_args->private_key,
+                     peer,
+                     std::bind(&CallFindValueAfterRelease, rpc_slot, callback,
+                               args::_1, args::_2, args::_3, args::_4,
+                               args::_5, args::_6));
+  } else {
+    RpcFindNodesFunctor callback(std::bind(&NodeImpl::IterativeFindCallback,
+                                           this, args::_1, args::_2,
+                                           std::vector<ValueAndSignature>(),
+                                           args::_3, Contact(),
+                                           asymm::Identity(), peer,
+                                           lookup_args));
+    rpcs_->FindNodes(lookup_args->kTarget,
+                     lookup_args->kNumContactsRequested,
+                     default_private_key_,
+                     peer,
+                     std::bind(&CallFindNodesAfterRelease, rpc_slot, callback,
+                               args::_1, args::_2, args::_3));
+  }
+}
+
+void NodeImpl::SendQueuedLookupRpc(LookupScheduler::SlotPtr rpc_slot,
+                                   LookupArgsPtr lookup_args,
+                                   const Contact &peer) {
+  {
+    boost::mutex::scoped_lock lock(lookup_args->mutex);
+    // As with a batched RPC, one queued until after the lookup phase completed
+    // is dropped.
+    if (lookup_args->lookup_phase_complete) {
+      if (--lookup_args->total_lookup_rpcs_in_flight == 0)
+        SendDownlist(lookup_args->downlist, lookup_args->lookup_contacts);
+      return;
+    }
+    auto this_peer(lookup_args->lookup_contacts.find(peer));
+    if (this_peer != lookup_args->lookup_contacts.end() &&
+        (*this_peer).second.rpc_state == ContactInfo::kSent)
+      StartLookupRpcSoftDeadline(this_peer, lookup_args);
+  }
+  SendLookupRpc(rpc_slot, lookup_args, peer);
+}
+
+void NodeImpl::SendStoreRpc(LookupScheduler::SlotPtr rpc_slot,
+                            StoreArgsPtr store_args,
+                            const Contact &peer) {
+  RpcStoreFunctor callback(std::bind(&NodeImpl::StoreCallback, this, args::_1,
+                                     args::_2, peer, store_args));
+  rpcs_->Store(store_args->kTarget,
+               store_args->kValue,
+               store_args->kSignature,
+               store_args->kSecondsToLive,
+               store_args->private_key,
+               peer,
+               std::bind(&CallAfterRelease, rpc_slot, callback, args::_1,
+                         args::_2));
+}
+
+void NodeImpl::SendDeleteRpc(LookupScheduler::SlotPtr rpc_slot,
+                             LookupArgsPtr lookup_args,
+                             const std::string &value,
+                             const std::string &signature,
+                             const Contact &peer) {
+  RpcDeleteFunctor callback;
+  if (lookup_args->kOperationType == LookupArgs::kStore) {
+    callback = std::bind(&NodeImpl::HandleRpcCallback, this, peer, args::_1,
+                         args::_2);
+  } else {
+    callback = std::bind(&NodeImpl::DeleteCallback, this, args::_1, args::_2,
+                         peer, lookup_args);
+  }
+  rpcs_->Delete(lookup_args->kTarget,
+                value,
+                signature,
+                lookup_args->private_key,
+                peer,
+                std::bind(&CallAfterRelease, rpc_slot, callback, args::_1,
+                          args::_2));
+}
+
+void NodeImpl::SendUpdateStoreRpc(LookupScheduler::SlotPtr rpc_slot,
+                                  UpdateArgsPtr update_args,
+                                  const Contact &peer) {
+  RpcStoreFunctor callback(std::bind(&NodeImpl::UpdateCallback, this,
+                                     args::_1, args::_2, peer, update_args));
+  rpcs_->Store(update_args->kTarget,
+               update_args->kNewValue,
+               update_args->kNewSignature,
+               update_args->kSecondsToLive,
+               update_args->private_key,
+               peer,
+               std::bind(&CallAfterRelease, rpc_slot, callback, args::_1,
+                         args::_2));
+}
+
+void NodeImpl::SendRefreshRpc(LookupScheduler::SlotPtr rpc_slot,
+                              RefreshArgsPtr refresh_args,
+                              const Contact &peer) {
+  RpcStoreRefreshFunctor callback(std::bind(&NodeImpl::HandleRpcCallback, this,
+                                            peer, args::_1, args::_2));
+  if (refresh_args->kOperationType == LookupArgs::kStoreRefresh) {
+    rpcs_->StoreRefresh(refresh_args->kSerialisedRequest,
+                        refresh_args->kSerialisedRequestSignature,
+                        refresh_args->private_key, peer,
+                        std::bind(&CallAfterRelease, rpc_slot, callback,
+                                  args::_1, args::_2));
+  } else {
+    rpcs_->DeleteRefresh(refresh_args->kSerialisedRequest,
+                         refresh_args->kSerialisedRequestSignature,
+                         refresh_args->private_key, peer,
+                         std::bind(&CallAfterRelease, rpc_slot, callback,
+                                   args::_1, args::_2));
+  }
+}
+
+void NodeImpl::QueueBatchedRpc(const RpcBatchKey &batch_key,
+                               LookupArgsPtr lookup_args,
+                               const Contact &peer) {
+  boost::mutex::scoped_lock lock(rpc_batches_mutex_);
+  std::vector<BatchedRpc> &batch(rpc_batches_[batch_key]);
+  batch.push_back(BatchedRpc(lookup_args, peer));
+  if (batch.size() == 1U)
+    asio_service_.post(std::bind(&NodeImpl::SendRpcBatch, this, batch_key));
+}
+
+void NodeImpl::SendRpcBatch(const RpcBatchKey &batch_key) {
+  std::vector<BatchedRpc> batch;
+  {
+    boost::mutex::scoped_lock lock(rpc_batches_mutex_);
+    auto it(rpc_batches_.find(batch_key));
+    if (it == rpc_batches_.end())
+      return;
+    batch.swap((*it).second);
+    rpc_batches_.erase(it);
+  }
+  if (batch_key.operation_type != LookupArgs::kStore) {
+    batch.erase(std::remove_if(batch.begin(), batch.end(),
+                               std::bind(&NodeImpl::LookupPhaseComplete,
+                                         args::_1)),
+                batch.end());
+  }
+  auto begin(batch.begin());
+  while (begin != batch.end()) {
+    auto end(begin + std::min(static_cast<ptrdiff_t>(kMaxRpcBatchSize),
+                              batch.end() - begin));
+    lookup_scheduler_->ScheduleRpc((*begin).lookup_args->priority,
+        std::bind(&NodeImpl::SendBatchedRpcs, this, args::_1, batch_key,
+                  std::vector<BatchedRpc>(begin, end)));
+    begin = end;
+  }
+}
+
+void NodeImpl::SendBatchedRpcs(LookupScheduler::SlotPtr rpc_slot,
+                               const RpcBatchKey &batch_key,
+                               const std::vector<BatchedRpc> &batch) {
+  const Contact &peer(batch.front().peer);
+  if (batch.size() == 1U) {
+    if (batch_key.operation_type == LookupArgs::kStore) {
+      StoreArgsPtr store_args(
+          std::static_pointer_cast<StoreArgs>(batch.front().lookup_args));
+      SendStoreRpc(rpc_slot, store_args, peer);
+    } else {
+      SendLookupRpc(rpc_slot, batch.front().lookup_args, peer);
+    }
+  } else if (batch_key.operation_type == LookupArgs::kStore) {
+    std::vector<std::pair<std::string, std::string>> store_requests;
+    std::vector<RpcStoreFunctor> callbacks;
+    for (auto it = batch.begin(); it != batch.end(); ++it) {
+      StoreArgsPtr store_args(
+          std::static_pointer_cast<StoreArgs>((*it).lookup_args));
+      store_requests.push_back(store_args->store_request_and_signature);
+      RpcStoreFunctor callback(std::bind(&NodeImpl::StoreCallback, this,
+                                         args::_1, args::_2, peer, store_args));
+      callbacks.push_back(std::bind(&CallAfterRelease, rpc_slot, callback,
+                                    args::_1, args::_2));
+    }
+    rpcs_->StoreBatch(store_requests, batch.front().lookup_args->private_key,
+                      peer, callbacks);
+  } else {
+    bool find_value(batch_key.operation_type == LookupArgs::kFindValue);
+    std::vector<Key> keys;
+    std::vector<RpcFindValueFunctor> find_value_callbacks;
+    std::vector<RpcFindNodesFunctor> find_nodes_callbacks;
+    for (auto it = batch.begin(); it != batch.end(); ++it) {
+      keys.push_back((*it).lookup_args->kTarget);
+      if (find_value) {
+        RpcFindValueFunctor callback(std::bind(
+            &NodeImpl::IterativeFindCallback, this, args::_1, args::_2,
+            args::_3, args::_4, args::_5, args::_6, peer, (*it).lookup_args));
+        find_value_callbacks.push_back(std::bind(&CallFindValueAfterRelease,
+            rpc_slot, callback, args::_1, args::_2, args::_3, args::_4,
+            args::_5, args::_6));
+      } else {
+        RpcFindNodesFunctor callback(std::bind(
+            &NodeImpl::IterativeFindCallback, this, args::_1, args::_2,
+            std::vector<ValueAndSignature>(), args::_3, Contact(),
+            asymm::Identity(), peer, (*it).lookup_args));
+        find_nodes_callbacks.push_back(std::bind(&CallFindNodesAfterRelease,
+            rpc_slot, callback, args::_1, args::_2, args::_3));
+      }
+    }
+    if (find_value) {
+      rpcs_->FindValueBatch(keys, batch_key.num_contacts_requested,
+                            batch.front().lookup_args->private_key, peer,
+                            find_value_callbacks);
+    } else {
+      rpcs_->FindNodesBatch(keys, batch_key.num_contacts_requested,
+                            default_private_key_, peer,
+                            find_nodes_callbacks);
+    }
   }
 }
 
+bool NodeImpl::LookupPhaseComplete(const BatchedRpc &batched_rpc) {
+  boost::mutex::scoped_lock lock(batched_rpc.lookup_args->mutex);
+  return batched_rpc.lookup_args->lookup_phase_complete;
+}
+
 void NodeImpl::IterativeFindCallback(
     RankInfoPtr rank_info,
     int result,
     const std::vector<ValueAndSignature> &values_and_signatures,
     const std::vector<Contact> &contacts,
     const Contact &cached_copy_holder,
+    const asymm::Identity &signer_public_key_id,
     Contact peer,
     LookupArgsPtr lookup_args) {
   // It is only OK for a node to return no meaningful information if this is
@@ -713,9 +1668,15 @@ void NodeImpl::IterativeFindCallback(
   // Note - if the RPC isn't from this iteration, it will be marked as kDelayed.
   if ((*this_peer).second.rpc_state == ContactInfo::kSent)
     --lookup_args->rpcs_in_flight_for_current_iteration;
+  // peer has answered, so it can no longer straggle
+  if ((*this_peer).second.soft_deadline) {
+    (*this_peer).second.soft_deadline->cancel();
+    (*this_peer).second.soft_deadline.reset();
+  }
 
   // If the RPC returned an error, move peer to the downlist.
   if (FindResultError(result)) {
+    suspect_list_->Add(peer);
     lookup_args->downlist.insert(*this_peer);
     lookup_args->lookup_contacts.erase(this_peer);
   }
@@ -724,7 +1685,7 @@ void NodeImpl::IterativeFindCallback(
   // the last callback, in which case, send the downlist notifications out.
   if (lookup_args->lookup_phase_complete) {
     if (lookup_args->total_lookup_rpcs_in_flight == 0)
-      SendDownlist(lookup_args->downlist);
+      SendDownlist(lookup_args->downlist, lookup_args->lookup_contacts);
     return;
   }
 
@@ -733,10 +1694,11 @@ void NodeImpl::IterativeFindCallback(
 
   // If we should stop early (found value, or found single contact), do so.
   if (AbortLookup(result, values_and_signatures, contacts, cached_copy_holder,
-                  peer, second_node, lookup_args))
+                  signer_public_key_id, peer, second_node, lookup_args))
     return;
 
-  // Handle result if RPC was successful.
+  // Handle result if RPC was successful.  Inserting close contacts invalidates
+  // this_peer.
   auto shortlist_upper_bound(lookup_args->lookup_contacts.begin());
   if (FindResultError(result)) {
     shortlist_upper_bound = GetShortlistUpperBound(lookup_args);
@@ -745,6 +1707,7 @@ void NodeImpl::IterativeFindCallback(
     OrderedContacts close_contacts(CreateOrderedContacts(contacts.begin(),
         contacts.end(), lookup_args->kTarget));
     RemoveDownlistedContacts(lookup_args, this_peer, &close_contacts);
+    RemoveSuspectContacts(lookup_args, &close_contacts);
     shortlist_upper_bound = InsertCloseContacts(close_contacts, lookup_args,
                                                 this_peer);
   }
@@ -760,8 +1723,9 @@ void NodeImpl::IterativeFindCallback(
   // table.
   if (lookup_args->lookup_phase_complete &&
       shortlist_ok_count != lookup_args->kNumContactsRequested) {
-    std::vector<Contact> close_nodes, excludes;
-    excludes.reserve(shortlist_ok_count + lookup_args->downlist.size());
+    std::vector<Contact> close_nodes, excludes(suspect_list_->GetSuspects());
+    excludes.reserve(excludes.size() + shortlist_ok_count +
+                     lookup_args->downlist.size());
     auto shortlist_itr(lookup_args->lookup_contacts.begin());
     while (shortlist_itr != lookup_args->lookup_contacts.end())
       excludes.push_back((*shortlist_itr++).first);
@@ -784,21 +1748,42 @@ void NodeImpl::IterativeFindCallback(
     }
   }
 
-  // If the lookup phase is still not finished, set cache candidate and start
-  // next iteration if due.
+  // If the lookup phase is still not finished, set cache candidate to the
+  // closest responder so far and start next iteration if due.
   if (!lookup_args->lookup_phase_complete) {
-    if (!FindResultError(result))
-      lookup_args->cache_candidate = (*this_peer).first;
+    bool report_progress(!FindResultError(result) &&
+                         QueueFindNodesProgress(lookup_args));
+    if (!FindResultError(result) &&
+        (lookup_args->cache_candidate == Contact() ||
+         NodeId::CloserToTarget(peer.node_id(),
+                                lookup_args->cache_candidate.node_id(),
+                                lookup_args->kTarget))) {
+      lookup_args->cache_candidate = peer;
+    }
     if (iteration_complete)
       DoLookupIteration(lookup_args);
+    if (report_progress) {
+      lock.unlock();
+      ReportFindNodesProgress(lookup_args);
+    }
     return;
   }
 
+  if (lookup_args->kOperationType != LookupArgs::kGetContact &&
+      shortlist_ok_count == lookup_args->kNumContactsRequested) {
+    std::vector<Contact> closest_contacts;
+    closest_contacts.reserve(shortlist_ok_count);
+    for (auto it = lookup_args->lookup_contacts.begin();
+         it != shortlist_upper_bound; ++it)
+      closest_contacts.push_back((*it).first);
+    closest_contacts_cache_->Add(lookup_args->kTarget, closest_contacts);
+  }
+
   HandleCompletedLookup(lookup_args, shortlist_upper_bound, shortlist_ok_count);
 
   // If this is the last lookup callback, send the downlist notifications out.
   if (lookup_args->total_lookup_rpcs_in_flight == 0)
-    SendDownlist(lookup_args->downlist);
+    SendDownlist(lookup_args->downlist, lookup_args->lookup_contacts);
 }
 
 bool NodeImpl::AbortLookup(
@@ -806,6 +1791,7 @@ bool NodeImpl::AbortLookup(
     const std::vector<ValueAndSignature> &values_and_signatures,
     const std::vector<Contact> &contacts,
     const Contact &cached_copy_holder,
+    const asymm::Identity &signer_public_key_id,
     const Contact &peer,
     bool second_node,
     LookupArgsPtr lookup_args) {
@@ -827,10 +1813,13 @@ bool NodeImpl::AbortLookup(
                                           contacts, cached_copy_holder,
                                           lookup_args->cache_candidate);
       lookup_args->lookup_phase_complete = true;
-      std::static_pointer_cast<FindValueArgs>(lookup_args)->callback(
-          find_value_returns);
-      // TODO(Fraser#5#): 2011-08-16 - Send value to cache_candidate here.
-//      if (std::static_pointer_cast<FindValueArgs>(lookup_args)->cache)
+      lookup_args->slot.reset();
+      FindValueArgsPtr find_value_args(
+          std::static_pointer_cast<FindValueArgs>(lookup_args));
+      find_value_args->callback(find_value_returns);
+      if (result == kSuccess && find_value_args->cache)
+        SendStoreCache(values_and_signatures, signer_public_key_id, peer,
+                       find_value_args);
     }
     return lookup_args->lookup_phase_complete;
   } else if (lookup_args->kOperationType == LookupArgs::kGetContact) {
@@ -838,6 +1827,7 @@ bool NodeImpl::AbortLookup(
     // RPC timed out or not.
     if (peer.node_id() == lookup_args->kTarget) {
       lookup_args->lookup_phase_complete = true;
+      lookup_args->slot.reset();
       if (result == kSuccess) {
         std::static_pointer_cast<GetContactArgs>(lookup_args)->callback(
             kSuccess, peer);
@@ -851,6 +1841,86 @@ bool NodeImpl::AbortLookup(
   return false;
 }
 
+LookupContacts::iterator NodeImpl::FastestNearTie(
+    LookupArgsPtr lookup_args,
+    LookupContacts::iterator this_peer) {
+  const uint16_t kCommonLeadingBits(
+      lookup_args->kTarget.CommonLeadingBits((*this_peer).first.node_id()));
+  LookupContacts::iterator fastest(this_peer);
+  double fastest_rtt(
+      routing_table_->GetAverageRtt((*this_peer).first.node_id()));
+  auto itr(this_peer);
+  for (++itr; itr != lookup_args->lookup_contacts.end(); ++itr) {
+    if (lookup_args->kTarget.CommonLeadingBits((*itr).first.node_id()) !=
+        kCommonLeadingBits)
+      break;
+    if ((*itr).second.rpc_state != ContactInfo::kNotSent ||
+        (*itr).first == contact_)
+      continue;
+    double rtt(routing_table_->GetAverageRtt((*itr).first.node_id()));
+    if (rtt != 0 && (fastest_rtt == 0 || rtt < fastest_rtt)) {
+      fastest = itr;
+      fastest_rtt = rtt;
+    }
+  }
+  return fastest;
+}
+
+bptime::time_duration NodeImpl::LookupRpcSoftTimeout(const Contact &peer) {
+  double timeout(routing_table_->GetRttTimeout(peer.node_id()));
+  if (timeout == 0) {
+    boost::mutex::scoped_lock lock(rtt_mutex_);
+    if (rtt_average_ == 0)
+      return kMaxLookupRpcSoftTimeout;
+    timeout = rtt_average_ + 4 * rtt_variance_;
+  }
+  bptime::time_duration soft_timeout(
+      bptime::milliseconds(static_cast<int64_t>(timeout)));
+  if (soft_timeout < kMinLookupRpcSoftTimeout)
+    return kMinLookupRpcSoftTimeout;
+  if (soft_timeout > kMaxLookupRpcSoftTimeout)
+    return kMaxLookupRpcSoftTimeout;
+  return soft_timeout;
+}
+
+void NodeImpl::StartLookupRpcSoftDeadline(LookupContacts::iterator peer,
+                                          LookupArgsPtr lookup_args) {
+  std::shared_ptr<boost::asio::deadline_timer> timer(
+      new boost::asio::deadline_timer(asio_service_,
+                                      LookupRpcSoftTimeout((*peer).first)));
+  timer->async_wait(std::bind(&NodeImpl::HandleStragglingLookupRpc, this,
+                              args::_1, (*peer).first,
+                              std::weak_ptr<LookupArgs>(lookup_args)));
+  (*peer).second.soft_deadline = timer;
+}
+
+void NodeImpl::HandleStragglingLookupRpc(
+    const boost::system::error_code &error_code,
+    Contact peer,
+    std::weak_ptr<LookupArgs> weak_lookup_args) {
+  if (error_code)
+    return;
+  LookupArgsPtr lookup_args(weak_lookup_args.lock());
+  if (!lookup_args)
+    return;
+  boost::mutex::scoped_lock lock(lookup_args->mutex);
+  if (lookup_args->lookup_phase_complete)
+    return;
+  // If the peer has replied, failed or was overtaken by a later iteration,
+  // there's nothing to do.
+  auto this_peer(lookup_args->lookup_contacts.find(peer));
+  if (this_peer == lookup_args->lookup_contacts.end() ||
+      (*this_peer).second.rpc_state != ContactInfo::kSent)
+    return;
+  DLOG(INFO) << DebugId(contact_) << ": " << DebugId(peer)
+             << " is straggling in lookup for "
+             << DebugId(lookup_args->kTarget);
+  (*this_peer).second.rpc_state = ContactInfo::kDelayed;
+  --lookup_args->rpcs_in_flight_for_current_iteration;
+  if (lookup_args->rpcs_in_flight_for_current_iteration <= kAlpha_ - kBeta_)
+    DoLookupIteration(lookup_args);
+}
+
 LookupContacts::iterator NodeImpl::GetShortlistUpperBound(
     LookupArgsPtr lookup_args) {
   uint16_t count(0);
@@ -866,17 +1936,91 @@ LookupContacts::iterator NodeImpl::GetShortlistUpperBound(
 void NodeImpl::RemoveDownlistedContacts(LookupArgsPtr lookup_args,
                                         LookupContacts::iterator this_peer,
                                         OrderedContacts *contacts) {
-  auto downlist_itr(lookup_args->downlist.begin());
+  if (lookup_args->downlist.empty())
+    return;
+  const NodeId kProvider((*this_peer).first.node_id());
   auto contacts_itr(contacts->begin());
-  while (downlist_itr != lookup_args->downlist.end() &&
-         contacts_itr != contacts->end()) {
-    if (contacts->key_comp()((*downlist_itr).first, *contacts_itr)) {
-      ++downlist_itr;
-    } else if (contacts->key_comp()(*contacts_itr, (*downlist_itr).first)) {
-      ++contacts_itr;
+  while (contacts_itr != contacts->end()) {
+    auto downlist_itr(lookup_args->downlist.find(*contacts_itr));
+    if (downlist_itr != lookup_args->downlist.end()) {
+      (*downlist_itr).second.providers.push_back(kProvider);
+      contacts->erase(contacts_itr++);
     } else {
-      (*downlist_itr++).second.providers.push_back((*this_peer).first);
+      ++contacts_itr;
+    }
+  }
+}
+
+bool NodeImpl::QueueFindNodesProgress(LookupArgsPtr lookup_args) {
+  if (lookup_args->kOperationType != LookupArgs::kFindNodes)
+    return false;
+  FindNodesArgsPtr find_nodes_args(
+      std::static_pointer_cast<FindNodesArgs>(lookup_args));
+  if (!find_nodes_args->progress_functor && !find_nodes_args->stop_functor)
+    return false;
+  std::vector<Contact> contacts;
+  contacts.reserve(lookup_args->kNumContactsRequested);
+  for (auto it = lookup_args->lookup_contacts.begin();
+       it != lookup_args->lookup_contacts.end() &&
+           contacts.size() < lookup_args->kNumContactsRequested;
+       ++it) {
+    if ((*it).second.rpc_state == ContactInfo::kRepliedOK)
+      contacts.push_back((*it).first);
+  }
+  if (contacts == find_nodes_args->reported_contacts)
+    return false;
+  find_nodes_args->reported_contacts = contacts;
+  find_nodes_args->pending_reports.push_back(contacts);
+  // If another thread is already passing reports on, it will pass this one.
+  if (find_nodes_args->reporting)
+    return false;
+  find_nodes_args->reporting = true;
+  return true;
+}
+
+void NodeImpl::ReportFindNodesProgress(LookupArgsPtr lookup_args) {
+  FindNodesArgsPtr find_nodes_args(
+      std::static_pointer_cast<FindNodesArgs>(lookup_args));
+  boost::mutex::scoped_lock lock(lookup_args->mutex);
+  while (!find_nodes_args->pending_reports.empty() &&
+         !lookup_args->lookup_phase_complete) {
+    std::vector<Contact> contacts(find_nodes_args->pending_reports.front());
+    find_nodes_args->pending_reports.pop_front();
+    lock.unlock();
+    if (find_nodes_args->progress_functor)
+      find_nodes_args->progress_functor(contacts);
+    bool stop(find_nodes_args->stop_functor &&
+              find_nodes_args->stop_functor(contacts));
+    lock.lock();
+    // The lookup may have finished or been stopped while unlocked.
+    if (stop && !lookup_args->lookup_phase_complete) {
+      DLOG(INFO) << DebugId(contact_) << ": Ending lookup for "
+                 << DebugId(lookup_args->kTarget) << " early with "
+                 << contacts.size() << " contacts.";
+      lookup_args->lookup_phase_complete = true;
+      lookup_args->slot.reset();
+      find_nodes_args->pending_reports.clear();
+      find_nodes_args->reporting = false;
+      if (lookup_args->total_lookup_rpcs_in_flight == 0)
+        SendDownlist(lookup_args->downlist, lookup_args->lookup_contacts);
+      lock.unlock();
+      find_nodes_args->callback(kSuccess, contacts);
+      return;
+    }
+  }
+  find_nodes_args->pending_reports.clear();
+  find_nodes_args->reporting = false;
+}
+
+void NodeImpl::RemoveSuspectContacts(LookupArgsPtr lookup_args,
+                                     OrderedContacts *contacts) {
+  auto contacts_itr(contacts->begin());
+  while (contacts_itr != contacts->end()) {
+    if ((*contacts_itr).node_id() != lookup_args->kTarget &&
+        suspect_list_->IsSuspect((*contacts_itr).node_id())) {
       contacts->erase(contacts_itr++);
+    } else {
+      ++contacts_itr;
     }
   }
 }
@@ -886,38 +2030,21 @@ LookupContacts::iterator NodeImpl::InsertCloseContacts(
     LookupArgsPtr lookup_args,
     LookupContacts::iterator this_peer) {
   if (!contacts.empty()) {
-    auto existing_contacts_itr(lookup_args->lookup_contacts.begin());
-    auto new_contacts_itr(contacts.begin());
-    auto insertion_point(lookup_args->lookup_contacts.end());
+    // Take the provider's ID before inserting, as inserts invalidate this_peer.
+    const bool kHasProvider(this_peer != lookup_args->lookup_contacts.end());
     ContactInfo contact_info;
-    if (existing_contacts_itr != lookup_args->lookup_contacts.end()) {
-      if (this_peer != lookup_args->lookup_contacts.end())
-        contact_info = ContactInfo((*this_peer).first);
-      while ((new_contacts_itr != contacts.end()) &&
-             (existing_contacts_itr != lookup_args->lookup_contacts.end())) {
-        if (contacts.key_comp()((*existing_contacts_itr).first,
-                                 *new_contacts_itr)) {
-          insertion_point = existing_contacts_itr++;
-        } else if (contacts.key_comp()(*new_contacts_itr,
-                                       (*existing_contacts_itr).first)) {
-          insertion_point = lookup_args->lookup_contacts.insert(
-              insertion_point, std::make_pair(*new_contacts_itr++,
-                                              contact_info));
-        } else {
-          insertion_point = existing_contacts_itr;
-          if (this_peer != lookup_args->lookup_contacts.end()) {
-            (*existing_contacts_itr++).second.providers.push_back(
-                (*this_peer).first);
-          }
-          ++new_contacts_itr;
-        }
+    if (kHasProvider)
+      contact_info = ContactInfo((*this_peer).first.node_id());
+    lookup_args->lookup_contacts.reserve(lookup_args->lookup_contacts.size() +
+                                         contacts.size());
+    for (auto it(contacts.begin()); it != contacts.end(); ++it) {
+      auto insert_result(lookup_args->lookup_contacts.insert(
+          std::make_pair(*it, contact_info)));
+      if (!insert_result.second && kHasProvider) {
+        (*insert_result.first).second.providers.push_back(
+            contact_info.providers.front());
       }
     }
-    while (new_contacts_itr != contacts.end()) {
-      insertion_point = lookup_args->lookup_contacts.insert(
-          insertion_point, std::make_pair(*new_contacts_itr++,
-                                          contact_info));
-    }
   }
   auto itr = lookup_args->lookup_contacts.find(contact_);
   if (itr != lookup_args->lookup_contacts.end() && !client_only_node_) {
@@ -955,6 +2082,9 @@ void NodeImpl::HandleCompletedLookup(
     LookupArgsPtr lookup_args,
     LookupContacts::iterator closest_upper_bound,
     const int &closest_count) {
+  // Let the next queued lookup start now, rather than once the last straggling
+  // RPC or soft deadline timer lets go of these arguments.
+  lookup_args->slot.reset();
   switch (lookup_args->kOperationType) {
     case LookupArgs::kFindNodes:
     case LookupArgs::kFindValue: {
@@ -1030,19 +2160,30 @@ void NodeImpl::InitiateStorePhase(StoreArgsPtr store_args,
     }
     return;
   }
+  // Made with the signature on crypto_pool_ if possible.
+  if (store_args->batched &&
+      store_args->store_request_and_signature.first.empty()) {
+    store_args->store_request_and_signature =
+        rpcs_->MakeStoreRequestAndSignature(store_args->kTarget,
+                                            store_args->kValue,
+                                            store_args->kSignature,
+                                            store_args->kSecondsToLive,
+                                            store_args->private_key);
+  }
   auto itr(store_args->lookup_contacts.begin());
   while (itr != closest_upper_bound) {
     if (!client_only_node_ && ((*itr).first == contact_)) {
       HandleStoreToSelf(store_args);
     } else {
-      rpcs_->Store(store_args->kTarget,
-                   store_args->kValue,
-                   store_args->kSignature,
-                   store_args->kSecondsToLive,
-                   store_args->private_key,
-                   (*itr).first,
-                   std::bind(&NodeImpl::StoreCallback, this, args::_1, args::_2,
-                             (*itr).first, store_args));
+      if (store_args->batched) {
+        QueueBatchedRpc(RpcBatchKey(LookupArgs::kStore, (*itr).first.node_id(),
+                                    0, store_args->private_key),
+                        store_args, (*itr).first);
+      } else {
+        lookup_scheduler_->ScheduleRpc(store_args->priority,
+            std::bind(&NodeImpl::SendStoreRpc, this, args::_1, store_args,
+                      (*itr).first));
+      }
       ++store_args->second_phase_rpcs_in_flight;
     }
     ++itr;
@@ -1069,13 +2210,10 @@ void NodeImpl::InitiateDeletePhase(DeleteArgsPtr delete_args,
     if (!client_only_node_ && ((*itr).first == contact_)) {
       HandleDeleteToSelf(delete_args);
     } else {
-      rpcs_->Delete(delete_args->kTarget,
-                    delete_args->kValue,
-                    delete_args->kSignature,
-                    delete_args->private_key,
-                    (*itr).first,
-                    std::bind(&NodeImpl::DeleteCallback, this, args::_1,
-                              args::_2, (*itr).first, delete_args));
+      lookup_scheduler_->ScheduleRpc(delete_args->priority,
+          std::bind(&NodeImpl::SendDeleteRpc, this, args::_1,
+                    LookupArgsPtr(delete_args), delete_args->kValue,
+                    delete_args->kSignature, (*itr).first));
       ++delete_args->second_phase_rpcs_in_flight;
     }
     ++itr;
@@ -1102,14 +2240,9 @@ void NodeImpl::InitiateUpdatePhase(UpdateArgsPtr update_args,
     if (!client_only_node_ && ((*itr).first == contact_)) {
       HandleUpdateToSelf(update_args);
     } else {
-      rpcs_->Store(update_args->kTarget,
-                   update_args->kNewValue,
-                   update_args->kNewSignature,
-                   update_args->kSecondsToLive,
-                   update_args->private_key,
-                   (*itr).first,
-                   std::bind(&NodeImpl::UpdateCallback, this, args::_1,
-                             args::_2, (*itr).first, update_args));
+      lookup_scheduler_->ScheduleRpc(update_args->priority,
+          std::bind(&NodeImpl::SendUpdateStoreRpc, this, args::_1,
+                    update_args, (*itr).first));
       ++update_args->store_rpcs_in_flight;
       // Increment second_phase_rpcs_in_flight (representing the subsequent
       // Delete RPC) to avoid the DeleteCallback finishing early.  This assumes
@@ -1136,19 +2269,9 @@ void NodeImpl::InitiateRefreshPhase(
     if (!client_only_node_ && ((*itr).first == contact_)) {
       this_node_within_closest = true;
     } else {
-      if (refresh_args->kOperationType == LookupArgs::kStoreRefresh) {
-        rpcs_->StoreRefresh(refresh_args->kSerialisedRequest,
-                            refresh_args->kSerialisedRequestSignature,
-                            refresh_args->private_key, (*itr).first,
-                            std::bind(&NodeImpl::HandleRpcCallback, this,
-                                      (*itr).first, args::_1, args::_2));
-      } else {
-        rpcs_->DeleteRefresh(refresh_args->kSerialisedRequest,
-                             refresh_args->kSerialisedRequestSignature,
-                             refresh_args->private_key, (*itr).first,
-                             std::bind(&NodeImpl::HandleRpcCallback, this,
-                                       (*itr).first, args::_1, args::_2));
-      }
+      lookup_scheduler_->ScheduleRpc(refresh_args->priority,
+          std::bind(&NodeImpl::SendRefreshRpc, this, args::_1, refresh_args,
+                    (*itr).first));
     }
     ++itr;
   }
@@ -1182,16 +2305,19 @@ void NodeImpl::HandleStoreToSelf(StoreArgsPtr store_args) {
     return;
   }
 
-  // Store the value
-  RequestAndSignature store_request_and_signature(
-      rpcs_->MakeStoreRequestAndSignature(store_args->kTarget,
-                                          store_args->kValue,
-                                          store_args->kSignature,
-                                          store_args->kSecondsToLive,
-                                          store_args->private_key));
+  // Store the value.  The request is made with the signature on crypto_pool_
+  // if possible.
+  if (store_args->store_request_and_signature.first.empty()) {
+    store_args->store_request_and_signature =
+        rpcs_->MakeStoreRequestAndSignature(store_args->kTarget,
+                                            store_args->kValue,
+                                            store_args->kSignature,
+                                            store_args->kSecondsToLive,
+                                            store_args->private_key);
+  }
   int result(data_store_->StoreValue(key_value_signature,
                                      store_args->kSecondsToLive,
-                                     store_request_and_signature,
+                                     store_args->store_request_and_signature,
                                      false));
   if (result == kSuccess) {
     HandleSecondPhaseCallback<StoreArgsPtr>(kSuccess, store_args);
@@ -1352,13 +2478,10 @@ void NodeImpl::StoreCallback(RankInfoPtr rank_info,
                         << "from self after bad store.";
         }
       } else {
-        rpcs_->Delete(store_args->kTarget,
-                      store_args->kValue,
-                      store_args->kSignature,
-                      store_args->private_key,
-                      (*itr).first,
-                      std::bind(&NodeImpl::HandleRpcCallback, this,
-                                (*itr).first, args::_1, args::_2));
+        lookup_scheduler_->ScheduleRpc(store_args->priority,
+            std::bind(&NodeImpl::SendDeleteRpc, this, args::_1,
+                      LookupArgsPtr(store_args), store_args->kValue,
+                      store_args->kSignature, (*itr).first));
       }
       ++itr;
       ++count;
@@ -1397,13 +2520,10 @@ void NodeImpl::UpdateCallback(RankInfoPtr rank_info,
       update_args->store_successes + update_args->store_rpcs_in_flight) {
     ++update_args->store_successes;
     if (update_args->kOldValue != update_args->kNewValue)
-      rpcs_->Delete(update_args->kTarget,
-                    update_args->kOldValue,
-                    update_args->kOldSignature,
-                    update_args->private_key,
-                    peer,
-                    std::bind(&NodeImpl::DeleteCallback, this, args::_1,
-                              args::_2, peer, update_args));
+      lookup_scheduler_->ScheduleRpc(update_args->priority,
+          std::bind(&NodeImpl::SendDeleteRpc, this, args::_1,
+                    LookupArgsPtr(update_args), update_args->kOldValue,
+                    update_args->kOldSignature, peer));
     else
       HandleSecondPhaseCallback<UpdateArgsPtr>(result,
           std::static_pointer_cast<UpdateArgs>(update_args));
@@ -1447,33 +2567,59 @@ void NodeImpl::HandleSecondPhaseCallback(int result, T args) {
   }
 }
 
-void NodeImpl::SendDownlist(const Downlist &downlist) {
-  // Convert map of <down_contact, vector<providers>> to
-  // map<provider, vector<down_ids>>.
-  std::map<Contact, std::vector<NodeId>> downlist_by_provider;
+void NodeImpl::SendDownlist(const Downlist &downlist,
+                            const LookupContacts &lookup_contacts) {
+  // Convert list of <down_contact, vector<provider_ids>> to
+  // map<provider, vector<down_ids>>.  Providers are resolved from the
+  // shortlist, or from the downlist if they have since failed themselves.
+  std::map<NodeId, std::vector<NodeId>> down_ids_by_provider;
   auto downlist_itr(downlist.begin());
   while (downlist_itr != downlist.end()) {
     auto provider_itr((*downlist_itr).second.providers.begin());
     while (provider_itr != (*downlist_itr).second.providers.end()) {
-      auto insert_result(downlist_by_provider.insert(std::make_pair(
-          *provider_itr,
-          std::vector<NodeId>(1, (*downlist_itr).first.node_id()))));
-      if (!insert_result.second) {
-        (insert_result.first)->second.push_back(
-            (*downlist_itr).first.node_id());
-      }
+      down_ids_by_provider[*provider_itr].push_back(
+          (*downlist_itr).first.node_id());
       ++provider_itr;
     }
     ++downlist_itr;
   }
   // Send RPCs
-  auto itr(downlist_by_provider.begin());
-  while (joined_ && itr != downlist_by_provider.end()) {
-    rpcs_->Downlist((*itr).second, default_private_key_, (*itr).first);
+  auto itr(down_ids_by_provider.begin());
+  while (joined_ && itr != down_ids_by_provider.end()) {
+    auto provider(lookup_contacts.find((*itr).first));
+    if (provider != lookup_contacts.end()) {
+      rpcs_->Downlist((*itr).second, default_private_key_, (*provider).first);
+    } else {
+      provider = downlist.find((*itr).first);
+      if (provider != downlist.end())
+        rpcs_->Downlist((*itr).second, default_private_key_, (*provider).first);
+    }
     ++itr;
   }
 }
 
+void NodeImpl::SendStoreCache(
+    const std::vector<ValueAndSignature> &values_and_signatures,
+    const asymm::Identity &signer_public_key_id,
+    const Contact &holder,
+    FindValueArgsPtr find_value_args) {
+  const Contact &candidate(find_value_args->cache_candidate);
+  if (candidate == Contact() || candidate == contact_ ||
+      values_and_signatures.empty() || signer_public_key_id.empty())
+    return;
+  const NodeId &kTarget(find_value_args->kTarget);
+  int holder_bits(kTarget.CommonLeadingBits(holder.node_id()));
+  int candidate_bits(kTarget.CommonLeadingBits(candidate.node_id()));
+  bptime::time_duration ttl(kMaxCachedValueTtl);
+  for (int i(candidate_bits); i < holder_bits && ttl >= kMinCachedValueTtl; ++i)
+    ttl /= 2;
+  if (ttl < kMinCachedValueTtl)
+    return;
+  rpcs_->StoreCache(kTarget, values_and_signatures, signer_public_key_id,
+                    bptime::seconds(ttl.total_seconds()),
+                    find_value_args->private_key, candidate);
+}
+
 void NodeImpl::RefreshDataStore(const boost::system::error_code &error_code) {
   if (error_code) {
     if (error_code != boost::asio::error::operation_aborted) {
@@ -1495,6 +2641,73 @@ void NodeImpl::RefreshDataStore(const boost::system::error_code &error_code) {
                                                  this, args::_1));
 }
 
+void NodeImpl::RefreshKBuckets(const boost::system::error_code &error_code) {
+  if (error_code) {
+    if (error_code != boost::asio::error::operation_aborted) {
+      DLOG(ERROR) << DebugId(contact_) << ": k-bucket refresh timer error: "
+                  << error_code.message();
+    } else {
+      return;
+    }
+  }
+  if (!joined_)
+    return;
+  std::vector<NodeId> refresh_ids;
+  {
+    boost::mutex::scoped_lock lock(kbucket_refresh_mutex_);
+    if (kbucket_refreshes_in_flight_ < kMaxConcurrentKBucketRefreshes) {
+      routing_table_->GetRefreshIds(
+          kKBucketRefreshInterval,
+          kMaxConcurrentKBucketRefreshes - kbucket_refreshes_in_flight_,
+          &refresh_ids);
+      kbucket_refreshes_in_flight_ +=
+          static_cast<uint16_t>(refresh_ids.size());
+    }
+  }
+  for (auto it = refresh_ids.begin(); it != refresh_ids.end(); ++it) {
+    DLOG(INFO) << DebugId(contact_) << ": Refreshing k-bucket with lookup for "
+               << DebugId(*it);
+    DoFindNodes(Key(*it), std::bind(&NodeImpl::RefreshKBucketCallback, this,
+                                    args::_1, args::_2),
+                0, bptime::pos_infin, OperationHandlePtr(),
+                LookupScheduler::kMaintenance);
+  }
+  VerifyReloadedContacts();
+  ScheduleKBucketRefresh();
+}
+
+void NodeImpl::RefreshKBucketCallback(int result,
+                                      std::vector<Contact> /*contacts*/) {
+  if (result != kSuccess)
+    DLOG(INFO) << DebugId(contact_) << ": k-bucket refresh lookup returned "
+               << result;
+  boost::mutex::scoped_lock lock(kbucket_refresh_mutex_);
+  --kbucket_refreshes_in_flight_;
+}
+
+void NodeImpl::VerifyReloadedContacts() {
+  std::vector<Contact> contacts_to_ping;
+  {
+    boost::mutex::scoped_lock lock(kbucket_refresh_mutex_);
+    while (!unverified_contacts_.empty() &&
+           contacts_to_ping.size() < kAlpha_) {
+      contacts_to_ping.push_back(unverified_contacts_.back());
+      unverified_contacts_.pop_back();
+    }
+  }
+  for (auto it = contacts_to_ping.begin(); it != contacts_to_ping.end(); ++it)
+    PingDownContact(*it);
+}
+
+void NodeImpl::ScheduleKBucketRefresh() {
+  const int64_t kCheckIntervalMs(
+      kKBucketRefreshCheckInterval.total_milliseconds());
+  refresh_kbuckets_timer_.expires_from_now(bptime::milliseconds(
+      kCheckIntervalMs / 2 + RandomUint32() % (kCheckIntervalMs + 1)));
+  refresh_kbuckets_timer_.async_wait(
+      std::bind(&NodeImpl::RefreshKBuckets, this, args::_1));
+}
+
 void NodeImpl::RefreshData(const KeyValueTuple &key_value_tuple) {
   OrderedContacts close_contacts(
       GetClosestContactsLocally(Key(key_value_tuple.key()), k_));
@@ -1505,6 +2718,7 @@ void NodeImpl::RefreshData(const KeyValueTuple &key_value_tuple) {
       NodeId(key_value_tuple.key()), k_, close_contacts, default_private_key_,
       key_value_tuple.request_and_signature.first,
       key_value_tuple.request_and_signature.second));
+  refresh_args->priority = LookupScheduler::kMaintenance;
   StartLookup(refresh_args);
 }
 
@@ -1587,6 +2801,8 @@ void NodeImpl::PingDownContactCallback(Contact down_contact,
                                        RankInfoPtr rank_info,
                                        const int &result) {
   if (result != kSuccess) {
+    closest_contacts_cache_->Invalidate(down_contact.node_id());
+    suspect_list_->Add(down_contact);
     // Increment failed RPC count until down contact is removed from the routing
     // table
     for (int i = 0, result = 0;
@@ -1594,6 +2810,7 @@ void NodeImpl::PingDownContactCallback(Contact down_contact,
       result = routing_table_->IncrementFailedRpcCount(down_contact.node_id());
   } else {
     // Add the contact again to update its last_seen to now
+    suspect_list_->Remove(down_contact.node_id());
     routing_table_->AddContact(down_contact, rank_info);
   }
 }
@@ -1610,9 +2827,16 @@ void NodeImpl::HandleRpcCallback(const Contact &contact,
                                  const int &result) {
   int routing_table_result(kSuccess);
   if (!FindResultError(result)) {
-    // Add the contact to update its last_seen to now
+    // Add the contact to update its last_seen to now and fold the RPC's RTT
+    // into its average
+    suspect_list_->Remove(contact.node_id());
     routing_table_result = routing_table_->AddContact(contact, rank_info);
+    if (rank_info && rank_info->rtt != 0) {
+      boost::mutex::scoped_lock lock(rtt_mutex_);
+      ChangeRtt::Update(rank_info->rtt, &rtt_average_, &rtt_variance_);
+    }
   } else {
+    closest_contacts_cache_->Invalidate(contact.node_id());
     routing_table_result =
         routing_table_->IncrementFailedRpcCount(contact.node_id());
   }
@@ -1631,6 +2855,14 @@ void NodeImpl::AsyncHandleRpcCallback(const Contact &contact,
                                rank_info, result));
 }
 
+void NodeImpl::set_latency_aware_lookups(bool latency_aware_lookups) {
+  latency_aware_lookups_ = latency_aware_lookups;
+}
+
+void NodeImpl::set_routing_table_file(const fs::path &routing_table_file) {
+  routing_table_file_ = routing_table_file;
+}
+
 void NodeImpl::set_check_cache_functor(
     const CheckCacheFunctor &check_cache_functor) {
   boost::mutex::scoped_lock lock(join_mutex_);
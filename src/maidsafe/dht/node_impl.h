@@ -29,6 +29,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MAIDSAFE_DHT_NODE_IMPL_H_
 
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -39,9 +40,15 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "boost/signals2/connection.hpp"
 #include "boost/thread/mutex.hpp"
 
+#include "maidsafe/dht/closest_contacts_cache.h"
+#include "maidsafe/dht/crypto_pool.h"
 #include "maidsafe/dht/node_impl_structs.h"
 #include "maidsafe/dht/config.h"
 #include "maidsafe/dht/node-api.h"
+#include "maidsafe/dht/public_key_cache.h"
+#include "maidsafe/dht/session_cache.h"
+#include "maidsafe/dht/signature_cache.h"
+#include "maidsafe/dht/suspect_list.h"
 #include "maidsafe/dht/contact.h"
 #include "maidsafe/dht/node_container.h"
 
@@ -104,13 +111,36 @@ class NodeImpl {
    *  @param[in] signature The signature to store.
    *  @param[in] ttl The ttl for the new data.
    *  @param[in] private_key The private key to pass further.
-   *  @param[in] callback The callback to report the results. */
+   *  @param[in] callback The callback to report the results.
+   *  @param[in] timeout Time after which the operation is abandoned.
+   *  @param[in] handle Handle by which the operation can be cancelled. */
   void Store(const Key &key,
              const std::string &value,
              const std::string &signature,
              const bptime::time_duration &ttl,
              PrivateKeyPtr private_key,
-             StoreFunctor callback);
+             StoreFunctor callback,
+             const bptime::time_duration &timeout = bptime::pos_infin,
+             OperationHandlePtr handle = OperationHandlePtr());
+
+  /** Function to STORE several values to the Kademlia network.  Each is
+   *  stored as by Store, but lookups and store RPCs sharing a peer are sent
+   *  to it as batched RPCs.
+   *  @param[in] keys The keys to store under.
+   *  @param[in] values_and_signatures The value and signature for each key.
+   *  An empty signature is replaced by one made with private_key.
+   *  @param[in] ttl The ttl for the new data.
+   *  @param[in] private_key The private key to pass further.
+   *  @param[in] callback The callback to report the result for each key.
+   *  @param[in] timeout Time after which each key's store is abandoned.
+   *  @param[in] handle Handle by which every key's store can be cancelled. */
+  void StoreMany(const std::vector<Key> &keys,
+                 const std::vector<ValueAndSignature> &values_and_signatures,
+                 const bptime::time_duration &ttl,
+                 PrivateKeyPtr private_key,
+                 StoreManyFunctor callback,
+                 const bptime::time_duration &timeout = bptime::pos_infin,
+                 OperationHandlePtr handle = OperationHandlePtr());
 
   /** Function to DELETE the content of a <key, value> in the Kademlia network.
    *  The operation will delete the original one then store the new one.
@@ -118,12 +148,16 @@ class NodeImpl {
    *  @param[in] value The value to delete.
    *  @param[in] signature The signature to delete.
    *  @param[in] private_key The private key to pass further.
-   *  @param[in] callback The callback to report the results. */
+   *  @param[in] callback The callback to report the results.
+   *  @param[in] timeout Time after which the operation is abandoned.
+   *  @param[in] handle Handle by which the operation can be cancelled. */
   void Delete(const Key &key,
               const std::string &value,
               const std::string &signature,
               PrivateKeyPtr private_key,
-              DeleteFunctor callback);
+              DeleteFunctor callback,
+              const bptime::time_duration &timeout = bptime::pos_infin,
+              OperationHandlePtr handle = OperationHandlePtr());
 
   /** Function to UPDATE the content of a <key, value> in the Kademlia network.
    *  The operation will delete the original one then store the new one.
@@ -134,7 +168,9 @@ class NodeImpl {
    *  @param[in] old_signature The old_signature to delete.
    *  @param[in] ttl The ttl for the new data.
    *  @param[in] private_key The private key to pass further.
-   *  @param[in] callback The callback to report the results. */
+   *  @param[in] callback The callback to report the results.
+   *  @param[in] timeout Time after which the operation is abandoned.
+   *  @param[in] handle Handle by which the operation can be cancelled. */
   void Update(const Key &key,
               const std::string &new_value,
               const std::string &new_signature,
@@ -142,7 +178,9 @@ class NodeImpl {
               const std::string &old_signature,
               const bptime::time_duration &ttl,
               PrivateKeyPtr private_key,
-              UpdateFunctor callback);
+              UpdateFunctor callback,
+              const bptime::time_duration &timeout = bptime::pos_infin,
+              OperationHandlePtr handle = OperationHandlePtr());
 
   /** Function to FIND VALUES of the Key from the Kademlia network.
    *  @param[in] Key The key to find
@@ -150,26 +188,78 @@ class NodeImpl {
    *  @param[in] callback The callback to report the results.
    *  @param[in] extra_contacts The number of additional to k contacts to
    *  return.
-   *  @param[in] cache Whether to cache the value(s) if found. */
+   *  @param[in] cache Whether to cache the value(s) if found.
+   *  @param[in] timeout Time after which the operation is abandoned.
+   *  @param[in] handle Handle by which the operation can be cancelled. */
   void FindValue(const Key &key,
                  PrivateKeyPtr private_key,
                  FindValueFunctor callback,
                  const uint16_t &extra_contacts = 0,
-                 bool cache = true);
+                 bool cache = true,
+                 const bptime::time_duration &timeout = bptime::pos_infin,
+                 OperationHandlePtr handle = OperationHandlePtr());
+
+  /** Function to FIND VALUES of several Keys from the Kademlia network.  Each
+   *  is found as by FindValue, but lookups sharing a peer send it batched
+   *  RPCs.
+   *  @param[in] keys The keys to find.
+   *  @param[in] private_key The private key to pass further.
+   *  @param[in] callback The callback to report the result for each key.
+   *  @param[in] extra_contacts The number of additional to k contacts to
+   *  return.
+   *  @param[in] cache Whether to cache the value(s) if found.
+   *  @param[in] timeout Time after which each key's lookup is abandoned.
+   *  @param[in] handle Handle by which every key's lookup can be cancelled. */
+  void FindValues(const std::vector<Key> &keys,
+                  PrivateKeyPtr private_key,
+                  FindValuesFunctor callback,
+                  const uint16_t &extra_contacts = 0,
+                  bool cache = true,
+                  const bptime::time_duration &timeout = bptime::pos_infin,
+                  OperationHandlePtr handle = OperationHandlePtr());
 
   /** Function to FIND k-closest NODES to the Key from the Kademlia network.
    *  @param[in] Key The key to locate
    *  @param[in] callback The callback to report the results.
    *  @param[in] extra_contacts The number of additional to k contacts to
-   *  return. */
+   *  return.
+   *  @param[in] timeout Time after which the operation is abandoned.
+   *  @param[in] handle Handle by which the operation can be cancelled. */
   void FindNodes(const Key &key,
                  FindNodesFunctor callback,
-                 const uint16_t &extra_contacts = 0);
+                 const uint16_t &extra_contacts = 0,
+                 const bptime::time_duration &timeout = bptime::pos_infin,
+                 OperationHandlePtr handle = OperationHandlePtr());
+
+  /** Function to FIND k-closest NODES to the Key, reporting progress.
+   *  @param[in] Key The key to locate
+   *  @param[in] callback The callback to report the results.
+   *  @param[in] progress_functor Passed the closest responded contacts each
+   *  time they change.
+   *  @param[in] stop_functor Ends the lookup early if it returns true for the
+   *  closest responded contacts.
+   *  @param[in] extra_contacts The number of additional to k contacts to
+   *  return.
+   *  @param[in] timeout Time after which the operation is abandoned.
+   *  @param[in] handle Handle by which the operation can be cancelled. */
+  void FindNodesWithProgress(
+      const Key &key,
+      FindNodesFunctor callback,
+      FindNodesProgressFunctor progress_functor,
+      FindNodesStopFunctor stop_functor,
+      const uint16_t &extra_contacts = 0,
+      const bptime::time_duration &timeout = bptime::pos_infin,
+      OperationHandlePtr handle = OperationHandlePtr());
 
   /** Function to get a contact info from the Kademlia network.
    *  @param[in] node_id The node_id to locate
-   *  @param[in] callback The callback to report the results. */
-  void GetContact(const NodeId &node_id, GetContactFunctor callback);
+   *  @param[in] callback The callback to report the results.
+   *  @param[in] timeout Time after which the operation is abandoned.
+   *  @param[in] handle Handle by which the operation can be cancelled. */
+  void GetContact(const NodeId &node_id,
+                  GetContactFunctor callback,
+                  const bptime::time_duration &timeout = bptime::pos_infin,
+                  OperationHandlePtr handle = OperationHandlePtr());
 
   // Setter for the functor which will be called by Node and Service to retrieve
   // the public key and public key validation token for a given contact.
@@ -187,8 +277,13 @@ class NodeImpl {
 
   /** Investigates the contact's online/offline status
    *  @param[in] contact the contact to be pinged
-   *  @param[in] callback The callback to report the result. */
-  void Ping(const Contact &contact, PingFunctor callback);
+   *  @param[in] callback The callback to report the result.
+   *  @param[in] timeout Time after which the operation is abandoned.
+   *  @param[in] handle Handle by which the operation can be cancelled. */
+  void Ping(const Contact &contact,
+            PingFunctor callback,
+            const bptime::time_duration &timeout = bptime::pos_infin,
+            OperationHandlePtr handle = OperationHandlePtr());
 
   /** Function to set the contact's last_seen to now.
    *  @param[in] contact The contact to set */
@@ -218,6 +313,10 @@ class NodeImpl {
 
   void set_check_cache_functor(const CheckCacheFunctor &check_cache_functor);
 
+  void set_latency_aware_lookups(bool latency_aware_lookups);
+
+  void set_routing_table_file(const fs::path &routing_table_file);
+
   Contact contact() const { return contact_; }
 
   bool joined() const { return joined_; }
@@ -264,8 +363,71 @@ class NodeImpl {
   template <typename T>
   void FailedValidation(T callback);
 
+  /** Returns a guard for an operation if it has a deadline or cancellation
+   *  handle, else a null pointer. */
+  OperationGuardPtr MakeOperationGuard(const bptime::time_duration &timeout,
+                                       OperationHandlePtr handle);
+
+  /** Returns callback wrapped so that it does nothing if guard has already
+   *  completed the operation.  Returns callback unchanged if guard is null. */
+  template <typename T>
+  T GuardCallback(T callback, OperationGuardPtr guard);
+
+  static void GuardedResultCallback(OperationGuardPtr guard,
+                                    std::function<void(int)> callback,  // NOLINT (Fraser)
+                                    int result);
+
+  static void GuardedFindValueCallback(OperationGuardPtr guard,
+                                       FindValueFunctor callback,
+                                       FindValueReturns find_value_returns);
+
+  static void GuardedFindNodesCallback(OperationGuardPtr guard,
+                                       FindNodesFunctor callback,
+                                       int result,
+                                       std::vector<Contact> contacts);
+
+  static void GuardedGetContactCallback(OperationGuardPtr guard,
+                                        GetContactFunctor callback,
+                                        int result,
+                                        Contact contact);
+
+  /** Starts the deadline timer and connects the cancellation handle for an
+   *  operation.  lookup_args may be null if the operation has no lookup. */
+  template <typename T>
+  void ArmOperationGuard(OperationGuardPtr guard,
+                         T callback,
+                         LookupArgsPtr lookup_args,
+                         const bptime::time_duration &timeout,
+                         OperationHandlePtr handle);
+
+  static void HandleOperationDeadline(
+      const boost::system::error_code &error_code,
+      OperationGuardPtr guard);
+
+  static void StopGuardedOperation(OperationGuardPtr guard, int result);
+
+  /** Returns count handles, one for each operation of a StoreMany or
+   *  FindValues call, which are all cancelled when handle is.  The handles are
+   *  null if handle is. */
+  static std::vector<OperationHandlePtr> MakeSubHandles(
+      size_t count,
+      OperationHandlePtr handle);
+
+  static void CancelSubHandles(std::vector<OperationHandlePtr> sub_handles);
+
+  /** Marks the lookup complete so that no further RPCs are sent for it, then
+   *  invokes callback with result. */
+  template <typename T>
+  static void StopOperation(std::weak_ptr<LookupArgs> lookup_args,
+                            T callback,
+                            int result);
+
+  template <typename T>
+  static void InvokeWithResult(T callback, int result);
+
   /** Returns the closest contacts to key from this node's routing table.  If
-   *  this node is within the required closest, it is included in the result. */
+   *  this node is within the required closest, it is included in the result.
+   *  Suspects are only included if there are too few other contacts. */
   OrderedContacts GetClosestContactsLocally(const Key &key,
                                             const uint16_t &total_contacts);
 
@@ -275,11 +437,121 @@ class NodeImpl {
                   PrivateKeyPtr private_key,
                   std::string *signature);
 
+  /** Run on crypto_pool_.  Signs value unless signature already holds one,
+   *  then makes the store request and its signature, as used to store to self
+   *  or in a batch.  Leaves signature empty if signing failed. */
+  void PrepareStore(const Key &key,
+                    const std::string &value,
+                    const bptime::time_duration &ttl,
+                    PrivateKeyPtr private_key,
+                    std::shared_ptr<std::string> signature,
+                    std::shared_ptr<std::pair<std::string, std::string>>
+                        store_request);
+
+  /** Continues DoStore with the results of PrepareStore */
+  void SignedStore(const Key &key,
+                   const std::string &value,
+                   std::shared_ptr<std::string> signature,
+                   std::shared_ptr<std::pair<std::string, std::string>>
+                       store_request,
+                   const bptime::time_duration &ttl,
+                   PrivateKeyPtr private_key,
+                   StoreFunctor callback,
+                   const bptime::time_duration &timeout,
+                   OperationHandlePtr handle,
+                   bool batched);
+
+  /** Implements Store and StoreMany.  If batched, the lookup and store RPCs
+   *  may share batched RPCs with those of other batched operations.  The
+   *  signing is done on crypto_pool_ if possible. */
+  void DoStore(const Key &key,
+               const std::string &value,
+               const std::string &signature,
+               const bptime::time_duration &ttl,
+               PrivateKeyPtr private_key,
+               StoreFunctor callback,
+               const bptime::time_duration &timeout,
+               OperationHandlePtr handle,
+               bool batched);
+
+  /** Starts the lookup of a signed store.  store_request is made later if
+   *  empty. */
+  void StartStore(const Key &key,
+                  const std::string &value,
+                  const std::string &signature,
+                  const std::pair<std::string, std::string> &store_request,
+                  const bptime::time_duration &ttl,
+                  PrivateKeyPtr private_key,
+                  StoreFunctor callback,
+                  const bptime::time_duration &timeout,
+                  OperationHandlePtr handle,
+                  bool batched);
+
+  /** Continues Delete with a signature made on crypto_pool_, which is empty
+   *  if signing failed */
+  void SignedDelete(const Key &key,
+                    const std::string &value,
+                    std::shared_ptr<std::string> signature,
+                    PrivateKeyPtr private_key,
+                    DeleteFunctor callback,
+                    const bptime::time_duration &timeout,
+                    OperationHandlePtr handle);
+
+  /** Continues Update with signatures made on crypto_pool_, either of which
+   *  is empty if signing failed */
+  void SignedUpdate(const Key &key,
+                    const std::string &new_value,
+                    std::shared_ptr<std::string> new_signature,
+                    const std::string &old_value,
+                    std::shared_ptr<std::string> old_signature,
+                    const bptime::time_duration &ttl,
+                    PrivateKeyPtr private_key,
+                    UpdateFunctor callback,
+                    const bptime::time_duration &timeout,
+                    OperationHandlePtr handle);
+
+  /** Implements FindValue and FindValues.  If batched, the lookup RPCs may
+   *  share batched RPCs with those of other batched operations. */
+  void DoFindValue(const Key &key,
+                   PrivateKeyPtr private_key,
+                   FindValueFunctor callback,
+                   const uint16_t &extra_contacts,
+                   bool cache,
+                   const bptime::time_duration &timeout,
+                   OperationHandlePtr handle,
+                   bool batched);
+
+  /** Implements FindNodes, running the lookup at the given priority. */
+  void DoFindNodes(const Key &key,
+                   FindNodesFunctor callback,
+                   const uint16_t &extra_contacts,
+                   const bptime::time_duration &timeout,
+                   OperationHandlePtr handle,
+                   LookupScheduler::Priority priority);
+
+  /** Records the result for one key of a FindValues or StoreMany call, and
+   *  invokes the call's callback once every key has its result. */
+  template <typename T>
+  static void BatchedResultCallback(T result,
+                                    size_t index,
+                                    std::shared_ptr<BatchedResults<T>> results);
+
   /** Runs the FindValue callback for the case where this node has the value(s)
    *  locally (i.e. cached outside of kademlia or in data_store_). */
   void FoundValueLocally(const FindValueReturns &find_value_returns,
                          FindValueFunctor callback);
 
+  /** Passes the result of a FindValue lookup to every caller which requested
+   *  it while it was in flight. */
+  void FindValueCoalescedCallback(FindValueReturns find_value_returns,
+                                  LookupKey lookup_key);
+
+  /** Passes the result of a FindNodes lookup to every caller which requested
+   *  it while it was in flight. */
+  void FindNodesCoalescedCallback(int result,
+                                  std::vector<Contact> contacts,
+                                  LookupKey lookup_key);
+
   /** Runs the GetContact callback for the case where it's this node's Contact
    *  which is the target. */
   void GetOwnContact(GetContactFunctor callback);
@@ -296,12 +568,83 @@ class NodeImpl {
                     Contact peer,
                     PingFunctor callback);
 
+  /** Queues the lookup with lookup_scheduler_ under its priority. */
   void StartLookup(LookupArgsPtr lookup_args);
 
+  /** Starts the lookup once lookup_scheduler_ has given it a slot. */
+  void StartScheduledLookup(LookupScheduler::SlotPtr slot,
+                            LookupArgsPtr lookup_args);
+
+  /** If closest_contacts_cache_ holds enough fresh contacts for the lookup's
+   *  target, a lookup with a second phase (store, delete, update or refresh)
+   *  goes straight to it using those contacts, while any other lookup adds
+   *  them to its shortlist.  Returns true if the lookup phase was skipped. */
+  bool UseCachedClosestContacts(LookupArgsPtr lookup_args);
+
   /** Function to execute iterative rpc->findnode or findvalue requests.
    *  @param[in] find_args The arguments struct holding all shared info. */
   void DoLookupIteration(LookupArgsPtr lookup_args);
 
+  /** Sends the lookup's FindValue or FindNodes RPC to peer.  rpc_slot is
+   *  released when the RPC is answered.  The RPCs of an operation's second
+   *  phase are sent in the same way by the Send*Rpc functions below, once
+   *  lookup_scheduler_ has given them a slot under the operation's priority. */
+  void SendLookupRpc(LookupScheduler::SlotPtr rpc_slot,
+                     LookupArgsPtr lookup_args,
+                     const Contact &peer);
+
+  /** Sends a lookup RPC which lookup_scheduler_ had queued, starting its soft
+   *  deadline if peer is still awaited. */
+  void SendQueuedLookupRpc(LookupScheduler::SlotPtr rpc_slot,
+                           LookupArgsPtr lookup_args,
+                           const Contact &peer);
+
+  /** Sends the store's second phase Store RPC to peer.  Unlike a StoreBatch,
+   *  each Store message is signed for its peer as it is wrapped. */
+  void SendStoreRpc(LookupScheduler::SlotPtr rpc_slot,
+                    StoreArgsPtr store_args,
+                    const Contact &peer);
+
+  /** Sends a Delete RPC for value to peer, for a delete or update operation's
+   *  second phase, or to undo a store which failed, in which case the reply
+   *  only updates peer's rank. */
+  void SendDeleteRpc(LookupScheduler::SlotPtr rpc_slot,
+                     LookupArgsPtr lookup_args,
+                     const std::string &value,
+                     const std::string &signature,
+                     const Contact &peer);
+
+  /** Sends the update's second phase Store RPC to peer. */
+  void SendUpdateStoreRpc(LookupScheduler::SlotPtr rpc_slot,
+                          UpdateArgsPtr update_args,
+                          const Contact &peer);
+
+  /** Sends the refresh's StoreRefresh or DeleteRefresh RPC to peer. */
+  void SendRefreshRpc(LookupScheduler::SlotPtr rpc_slot,
+                      RefreshArgsPtr refresh_args,
+                      const Contact &peer);
+
+  /** Queues an RPC of a batched operation for peer.  The first RPC queued
+   *  under batch_key schedules SendRpcBatch, so that RPCs queued by other
+   *  batched operations before it runs share the same batched RPC. */
+  void QueueBatchedRpc(const RpcBatchKey &batch_key,
+                       LookupArgsPtr lookup_args,
+                       const Contact &peer);
+
+  /** Schedules the RPCs queued under batch_key, in batched RPCs of at most
+   *  kMaxRpcBatchSize keys.  Lookup RPCs of operations stopped while they
+   *  were queued are dropped. */
+  void SendRpcBatch(const RpcBatchKey &batch_key);
+
+  /** Sends one batched RPC to the peer of the RPCs in batch.  A lone RPC is
+   *  sent as an ordinary one. */
+  void SendBatchedRpcs(LookupScheduler::SlotPtr rpc_slot,
+                       const RpcBatchKey &batch_key,
+                       const std::vector<BatchedRpc> &batch);
+
+  /** Returns whether the lookup which queued batched_rpc has finished. */
+  static bool LookupPhaseComplete(const BatchedRpc &batched_rpc);
+
   /** Callback from the rpc->findvalue or findnodes requests.
    *  @param[in] rank_info rank info
    *  @param[in] result Indicator from the rpc. Any negative value shall be
@@ -309,6 +652,7 @@ class NodeImpl {
    *  @param[in] values_and_signatures The values and signatures of the key.
    *  @param[in] contacts The closest contacts.
    *  @param[in] cached_copy_holder The cached copy holder's contact.
+   *  @param[in] signer_public_key_id The identity of the values' signer.
    *  @param[in] peer The Contact being queried.
    *  @param[in] lookup_args The arguments struct holding all shared info. */
   void IterativeFindCallback(
@@ -317,6 +661,7 @@ class NodeImpl {
       const std::vector<ValueAndSignature> &values_and_signatures,
       const std::vector<Contact> &contacts,
       const Contact &cached_copy_holder,
+      const asymm::Identity &signer_public_key_id,
       Contact peer,
       LookupArgsPtr lookup_args);
 
@@ -324,20 +669,67 @@ class NodeImpl {
                    const std::vector<ValueAndSignature> &values_and_signatures,
                    const std::vector<Contact> &contacts,
                    const Contact &cached_copy_holder,
+                   const asymm::Identity &signer_public_key_id,
                    const Contact &peer,
                    bool second_node,
                    LookupArgsPtr lookup_args);
 
   LookupContacts::iterator GetShortlistUpperBound(LookupArgsPtr lookup_args);
 
+  /** Of this_peer and the unqueried contacts following it in the shortlist
+   *  which have the same number of common leading bits with the target, returns
+   *  the one with the lowest average RTT.  Contacts with no measured RTT are
+   *  only chosen if none has one, in which case this_peer is returned. */
+  LookupContacts::iterator FastestNearTie(LookupArgsPtr lookup_args,
+                                          LookupContacts::iterator this_peer);
+
+  /** Returns the time after which a lookup RPC to peer is deemed to straggle:
+   *  the RTT timeout of peer if measured, otherwise that of all RPCs, within
+   *  kMinLookupRpcSoftTimeout and kMaxLookupRpcSoftTimeout. */
+  bptime::time_duration LookupRpcSoftTimeout(const Contact &peer);
+
+  /** Starts a timer which calls HandleStragglingLookupRpc if the lookup RPC
+   *  just sent to peer is still unanswered after LookupRpcSoftTimeout.  The
+   *  timer is held by peer's ContactInfo, is cancelled when peer answers and
+   *  doesn't keep the lookup alive.  Must be called while holding
+   *  lookup_args->mutex. */
+  void StartLookupRpcSoftDeadline(LookupContacts::iterator peer,
+                                  LookupArgsPtr lookup_args);
+
+  /** If the RPC to peer is still outstanding in the current iteration, marks
+   *  it kDelayed so that its slot is freed, and starts the next iteration if
+   *  this completes the current one.  A late reply is still handled as usual
+   *  by IterativeFindCallback. */
+  void HandleStragglingLookupRpc(
+      const boost::system::error_code &error_code,
+      Contact peer,
+      std::weak_ptr<LookupArgs> lookup_args);
+
   /** Moves any Contacts found in the downlist from "contacts" to the
    *  downlist */
   void RemoveDownlistedContacts(LookupArgsPtr lookup_args,
                                 LookupContacts::iterator this_peer,
                                 OrderedContacts *contacts);
 
+  /** For a FindNodes lookup with a progress or stop functor, queues a report
+   *  of the closest responded contacts if they have changed.  Called with the
+   *  lookup's mutex held; returns true if the caller must then pass the
+   *  queued reports on via ReportFindNodesProgress. */
+  bool QueueFindNodesProgress(LookupArgsPtr lookup_args);
+
+  /** Passes the queued reports to the progress and stop functors in order,
+   *  without holding the lookup's mutex, so that they may cancel the
+   *  operation.  If the stop functor is satisfied, completes the lookup. */
+  void ReportFindNodesProgress(LookupArgsPtr lookup_args);
+
+  /** Removes any suspects other than the lookup's target from "contacts" so
+   *  that no lookup waits on a contact which another has just seen fail */
+  void RemoveSuspectContacts(LookupArgsPtr lookup_args,
+                             OrderedContacts *contacts);
+
   /** Adds "contacts" to the current lookup shortlist and return an iterator to
-   *  the current (n+1)th closest where n is the number of contacts requested */
+   *  the current (n+1)th closest where n is the number of contacts requested.
+   *  Invalidates this_peer and any other iterators into the shortlist. */
   LookupContacts::iterator InsertCloseContacts(
       const OrderedContacts &contacts,
       LookupArgsPtr lookup_args,
@@ -411,12 +803,45 @@ class NodeImpl {
   template <typename T>
   void HandleSecondPhaseCallback(int result, T args);
 
-  void SendDownlist(const Downlist &downlist);
+  void SendDownlist(const Downlist &downlist,
+                    const LookupContacts &lookup_contacts);
+
+  /** Asks the lookup's cache candidate (the closest responder which didn't
+   *  hold the value) to cache the values found at holder.  The time to live
+   *  halves for each bit by which the candidate is further from the target
+   *  than the holder; nothing is sent if it falls below kMinCachedValueTtl.
+   *  @param[in] values_and_signatures The values found.
+   *  @param[in] signer_public_key_id The identity of the values' signer, with
+   *  which the candidate validates them.  Nothing is sent if it is empty.
+   *  @param[in] holder The peer which returned the values.
+   *  @param[in] find_value_args The FindValue lookup's arguments struct. */
+  void SendStoreCache(
+      const std::vector<ValueAndSignature> &values_and_signatures,
+      const asymm::Identity &signer_public_key_id,
+      const Contact &holder,
+      FindValueArgsPtr find_value_args);
 
   void RefreshDataStore(const boost::system::error_code &error_code);
 
   void RefreshData(const KeyValueTuple &key_value_tuple);
 
+  /** Starts a FindNodes lookup for a random ID within each k-bucket which has
+   *  been idle for kKBucketRefreshInterval, up to a total of
+   *  kMaxConcurrentKBucketRefreshes lookups in flight, then reschedules itself
+   *  after a jittered kKBucketRefreshCheckInterval. */
+  void RefreshKBuckets(const boost::system::error_code &error_code);
+
+  void RefreshKBucketCallback(int result, std::vector<Contact> contacts);
+
+  /** Pings up to kAlpha_ of the contacts reloaded from routing_table_file_
+   *  which have not yet been heard from.  Those which fail to respond are
+   *  dropped from the routing table via PingDownContactCallback. */
+  void VerifyReloadedContacts();
+
+  /** Sets refresh_kbuckets_timer_ to expire after a random time within half of
+   *  kKBucketRefreshCheckInterval either side of it. */
+  void ScheduleKBucketRefresh();
+
   /** returns true if the code conveys that the node has not been reached
    *  @param[in] code  the code denoting the response type*/
   bool NodeContacted(const int &code);
@@ -523,8 +948,49 @@ class NodeImpl {
   boost::signals2::connection ping_oldest_contact_, validate_contact_,
                               ping_down_contact_;
   boost::asio::deadline_timer refresh_data_store_timer_;
+  boost::asio::deadline_timer refresh_kbuckets_timer_;
+  /** Number of k-bucket refresh lookups in flight */
+  uint16_t kbucket_refreshes_in_flight_;
+  boost::mutex kbucket_refresh_mutex_;
+  /** Where the routing table is saved on Leave and reloaded from on Join */
+  fs::path routing_table_file_;
+  /** Contacts reloaded from routing_table_file_ still to be pinged, guarded by
+   *  kbucket_refresh_mutex_ */
+  std::vector<Contact> unverified_contacts_;
   boost::mutex join_mutex_;
   CheckCacheFunctor check_cache_functor_;
+  /** Whether lookups query the fastest of near-equally close contacts first */
+  bool latency_aware_lookups_;
+  /** Closest contacts found by recent lookups, used to seed or skip later ones
+   *  for the same target */
+  std::shared_ptr<ClosestContactsCache> closest_contacts_cache_;
+  /** Contacts which recently failed a lookup RPC, skipped by all lookups */
+  std::shared_ptr<SuspectList> suspect_list_;
+  /** Limits and orders the lookups run at once by priority class */
+  std::shared_ptr<LookupScheduler> lookup_scheduler_;
+  /** Symmetric session keys shared by the unsigned RPCs sent and received */
+  std::shared_ptr<SessionCache> session_cache_;
+  /** Signatures already validated, shared by the message handler, service and
+   *  data store */
+  std::shared_ptr<SignatureCache> signature_cache_;
+  /** Publishers' public keys fetched recently by the service */
+  std::shared_ptr<PublicKeyCache> public_key_cache_;
+  /** Worker threads for signing and validation, keeping them off the asio
+   *  threads */
+  std::shared_ptr<CryptoPool> crypto_pool_;
+  /** Callers waiting on each FindValue and FindNodes lookup in flight, guarded
+   *  by pending_lookups_mutex_ */
+  std::map<LookupKey, std::vector<FindValueFunctor>> pending_find_values_;
+  std::map<LookupKey, std::vector<FindNodesFunctor>> pending_find_nodes_;
+  boost::mutex pending_lookups_mutex_;
+  /** RPCs of batched operations waiting to be sent to each peer, guarded by
+   *  rpc_batches_mutex_ */
+  std::map<RpcBatchKey, std::vector<BatchedRpc>> rpc_batches_;
+  boost::mutex rpc_batches_mutex_;
+  /** Smoothed RTT and RTT variance in milliseconds over all RPCs, guarded by
+   *  rtt_mutex_ */
+  double rtt_average_, rtt_variance_;
+  boost::mutex rtt_mutex_;
 };
 
 }  // namespace dht
@@ -28,11 +28,14 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef MAIDSAFE_DHT_NODE_IMPL_STRUCTS_H_
 #define MAIDSAFE_DHT_NODE_IMPL_STRUCTS_H_
 
-#include <map>
+#include <algorithm>
+#include <deque>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "boost/asio/deadline_timer.hpp"
 #include "boost/thread/mutex.hpp"
 #ifdef __MSVC__
 #  pragma warning(push)
@@ -49,6 +52,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "maidsafe/dht/config.h"
 #include "maidsafe/dht/contact.h"
+#include "maidsafe/dht/lookup_scheduler.h"
 #include "maidsafe/dht/node_id.h"
 #include "maidsafe/dht/rpcs.h"
 #include "maidsafe/dht/utils.h"
@@ -59,17 +63,88 @@ namespace dht {
 
 struct ContactInfo {
   enum RpcState { kNotSent, kSent, kDelayed, kRepliedOK };
-  ContactInfo() : providers(), rpc_state(kNotSent) {}
-  explicit ContactInfo(const Contact &provider) : providers(1, provider),
-                                                  rpc_state(kNotSent) {}
-  std::vector<Contact> providers;
+  ContactInfo() : providers(), rpc_state(kNotSent), soft_deadline() {}
+  explicit ContactInfo(const NodeId &provider) : providers(1, provider),
+                                                 rpc_state(kNotSent),
+                                                 soft_deadline() {}
+  std::vector<NodeId> providers;
   RpcState rpc_state;
+  // Pending while the lookup RPC to this contact is unanswered.  Destroying it
+  // along with the lookup cancels it.
+  std::shared_ptr<boost::asio::deadline_timer> soft_deadline;
 };
 
-typedef std::map<Contact,
-                 ContactInfo,
-                 std::function<bool(const Contact&,  // NOLINT (Fraser)
-                                    const Contact&)>> LookupContacts, Downlist;
+// Contacts of a lookup held contiguously in order of closeness to the target.
+// Each contact's XOR distance to the target is computed once on insertion and
+// kept in a parallel array, so searches and ordered inserts compare distances
+// directly rather than recomputing them.  Inserting or erasing invalidates
+// iterators.
+class LookupContacts {
+ public:
+  typedef std::pair<Contact, ContactInfo> value_type;
+  typedef std::vector<value_type>::iterator iterator;
+  typedef std::vector<value_type>::const_iterator const_iterator;
+  LookupContacts() : target_(), distances_(), entries_() {}
+  explicit LookupContacts(const NodeId &target)
+      : target_(target),
+        distances_(),
+        entries_() {}
+  iterator begin() { return entries_.begin(); }
+  iterator end() { return entries_.end(); }
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  void reserve(size_t count) {
+    distances_.reserve(count);
+    entries_.reserve(count);
+  }
+  void clear() {
+    distances_.clear();
+    entries_.clear();
+  }
+  iterator find(const Contact &contact) { return find(contact.node_id()); }
+  iterator find(const NodeId &node_id) {
+    return entries_.begin() + IndexOf(node_id);
+  }
+  const_iterator find(const NodeId &node_id) const {
+    return entries_.begin() + IndexOf(node_id);
+  }
+  // Inserts value in order unless a contact with the same ID is already held,
+  // in which case returns that entry and false.
+  std::pair<iterator, bool> insert(const value_type &value) {
+    const NodeId kDistance(value.first.node_id() ^ target_);
+    size_t index(LowerBound(kDistance));
+    if (index != distances_.size() && distances_[index] == kDistance)
+      return std::make_pair(entries_.begin() + index, false);
+    distances_.insert(distances_.begin() + index, kDistance);
+    return std::make_pair(entries_.insert(entries_.begin() + index, value),
+                          true);
+  }
+  iterator erase(iterator position) {
+    distances_.erase(distances_.begin() + (position - entries_.begin()));
+    return entries_.erase(position);
+  }
+
+ private:
+  // Returns the index of the contact with the given ID, or size() if absent.
+  size_t IndexOf(const NodeId &node_id) const {
+    const NodeId kDistance(node_id ^ target_);
+    size_t index(LowerBound(kDistance));
+    if (index == distances_.size() || distances_[index] != kDistance)
+      return distances_.size();
+    return index;
+  }
+  size_t LowerBound(const NodeId &distance) const {
+    return std::lower_bound(distances_.begin(), distances_.end(), distance) -
+           distances_.begin();
+  }
+  NodeId target_;
+  std::vector<NodeId> distances_;
+  std::vector<value_type> entries_;
+};
+
+typedef LookupContacts Downlist;
 
 struct LookupArgs {
   enum OperationType {
@@ -87,26 +162,23 @@ struct LookupArgs {
              const OrderedContacts &close_contacts,
              const uint16_t &num_contacts_requested,
              PrivateKeyPtr priv_key)
-      : lookup_contacts(std::bind(static_cast<bool(*)(const Contact&,  // NOLINT (Fraser)
-            const Contact&, const NodeId&)>(&CloserToTarget),
-            args::_1, args::_2, target)),
-        downlist(std::bind(static_cast<bool(*)(const Contact&,  // NOLINT (Fraser)
-                 const Contact&, const NodeId&)>(&CloserToTarget),
-                 args::_1, args::_2, target)),
+      : lookup_contacts(target),
+        downlist(target),
         cache_candidate(),
         mutex(),
         total_lookup_rpcs_in_flight(0),
         rpcs_in_flight_for_current_iteration(0),
         lookup_phase_complete(false),
+        batched(false),
+        priority(LookupScheduler::kInteractive),
+        slot(),
         kOperationType(operation_type),
         kTarget(target),
         kNumContactsRequested(num_contacts_requested),
         private_key(priv_key) {
-    auto insert_itr(lookup_contacts.end());
-    for (auto it(close_contacts.begin()); it != close_contacts.end(); ++it) {
-      insert_itr = lookup_contacts.insert(insert_itr,
-                                          std::make_pair((*it), ContactInfo()));
-    }
+    lookup_contacts.reserve(close_contacts.size());
+    for (auto it(close_contacts.begin()); it != close_contacts.end(); ++it)
+      lookup_contacts.insert(std::make_pair((*it), ContactInfo()));
   }
   virtual ~LookupArgs() {}
   LookupContacts lookup_contacts;
@@ -115,12 +187,60 @@ struct LookupArgs {
   boost::mutex mutex;
   int total_lookup_rpcs_in_flight, rpcs_in_flight_for_current_iteration;
   bool lookup_phase_complete;
+  // If true, this lookup's RPCs (and a store's second phase RPCs) may be sent
+  // in one batched RPC with those of other lookups to the same peer.
+  bool batched;
+  LookupScheduler::Priority priority;
+  // Held from the start of the lookup until its lookup phase is complete.
+  LookupScheduler::SlotPtr slot;
   const OperationType kOperationType;
   const NodeId kTarget;
   const uint16_t kNumContactsRequested;
   PrivateKeyPtr private_key;
 };
 
+// Identifies lookups whose results are interchangeable, so that identical
+// concurrent requests can share a single iterative lookup.  Lookups which
+// differ in caching, batching or priority are run separately, as each of
+// these changes how (or how soon) the lookup is carried out.
+struct LookupKey {
+  LookupKey(LookupArgs::OperationType operation_type,
+            const NodeId &target,
+            const uint16_t &num_contacts_requested,
+            PrivateKeyPtr private_key,
+            bool cache,
+            bool batched,
+            LookupScheduler::Priority priority)
+      : operation_type(operation_type),
+        target(target),
+        num_contacts_requested(num_contacts_requested),
+        private_key(private_key.get()),
+        cache(cache),
+        batched(batched),
+        priority(priority) {}
+  bool operator<(const LookupKey &other) const {
+    if (operation_type != other.operation_type)
+      return operation_type < other.operation_type;
+    if (target != other.target)
+      return target < other.target;
+    if (num_contacts_requested != other.num_contacts_requested)
+      return num_contacts_requested < other.num_contacts_requested;
+    if (private_key != other.private_key)
+      return private_key < other.private_key;
+    if (cache != other.cache)
+      return cache < other.cache;
+    if (batched != other.batched)
+      return batched < other.batched;
+    return priority < other.priority;
+  }
+  LookupArgs::OperationType operation_type;
+  NodeId target;
+  uint16_t num_contacts_requested;
+  const asymm::PrivateKey *private_key;
+  bool cache, batched;
+  LookupScheduler::Priority priority;
+};
+
 struct FindNodesArgs : public LookupArgs {
   FindNodesArgs(const NodeId &target,
                 const uint16_t &num_contacts_requested,
@@ -129,8 +249,21 @@ struct FindNodesArgs : public LookupArgs {
                 FindNodesFunctor callback_in)
       : LookupArgs(kFindNodes, target, close_contacts, num_contacts_requested,
                    private_key),
-        callback(callback_in) {}
+        callback(callback_in),
+        progress_functor(),
+        stop_functor(),
+        reported_contacts(),
+        pending_reports(),
+        reporting(false) {}
   FindNodesFunctor callback;
+  FindNodesProgressFunctor progress_functor;
+  FindNodesStopFunctor stop_functor;
+  // The responded contacts last queued for progress_functor and stop_functor.
+  std::vector<Contact> reported_contacts;
+  // Reports not yet passed to the functors, in the order they arose, and
+  // whether a thread is currently passing them.
+  std::deque<std::vector<Contact>> pending_reports;
+  bool reporting;
 };
 
 struct FindValueArgs : public LookupArgs {
@@ -166,12 +299,16 @@ struct StoreArgs : public LookupArgs {
         kValue(value),
         kSignature(signature),
         kSecondsToLive(time_to_live.total_seconds()),
-        callback(callback_in) {}
+        callback(callback_in),
+        store_request_and_signature() {}
   const int kSuccessThreshold;
   int second_phase_rpcs_in_flight, successes;
   const std::string kValue, kSignature;
   const bptime::seconds kSecondsToLive;
   StoreFunctor callback;
+  // Made once for all the batched store RPCs of the second phase and the
+  // store to self, on the crypto pool if possible.
+  std::pair<std::string, std::string> store_request_and_signature;
 };
 
 struct DeleteArgs : public LookupArgs {
@@ -263,6 +400,27 @@ struct RefreshArgs : public LookupArgs {
   const std::string kSerialisedRequest, kSerialisedRequestSignature;
 };
 
+// Shared by an operation's callback, its deadline timer and its cancellation
+// handle so that whichever of these fires first completes the operation.
+struct OperationGuard {
+  OperationGuard() : mutex(), completed(false), deadline_timer(), stop() {}
+  // Returns true if this call is the one which completes the operation.
+  bool Complete() {
+    boost::mutex::scoped_lock lock(mutex);
+    if (completed)
+      return false;
+    completed = true;
+    if (deadline_timer)
+      deadline_timer->cancel();
+    return true;
+  }
+  boost::mutex mutex;
+  bool completed;
+  std::shared_ptr<boost::asio::deadline_timer> deadline_timer;
+  // Ends the operation early, invoking its callback with the given result.
+  std::function<void(int)> stop;
+};
+
 typedef std::shared_ptr<LookupArgs> LookupArgsPtr;
 typedef std::shared_ptr<FindNodesArgs> FindNodesArgsPtr;
 typedef std::shared_ptr<FindValueArgs> FindValueArgsPtr;
@@ -271,6 +429,56 @@ typedef std::shared_ptr<DeleteArgs> DeleteArgsPtr;
 typedef std::shared_ptr<UpdateArgs> UpdateArgsPtr;
 typedef std::shared_ptr<GetContactArgs> GetContactArgsPtr;
 typedef std::shared_ptr<RefreshArgs> RefreshArgsPtr;
+typedef std::shared_ptr<OperationGuard> OperationGuardPtr;
+
+// Identifies RPCs which can be sent to a peer as a single batched RPC.
+struct RpcBatchKey {
+  RpcBatchKey(LookupArgs::OperationType operation_type,
+              const NodeId &peer_id,
+              const uint16_t &num_contacts_requested,
+              PrivateKeyPtr private_key)
+      : operation_type(operation_type),
+        peer_id(peer_id),
+        num_contacts_requested(num_contacts_requested),
+        private_key(private_key.get()) {}
+  bool operator<(const RpcBatchKey &other) const {
+    if (operation_type != other.operation_type)
+      return operation_type < other.operation_type;
+    if (peer_id != other.peer_id)
+      return peer_id < other.peer_id;
+    if (num_contacts_requested != other.num_contacts_requested)
+      return num_contacts_requested < other.num_contacts_requested;
+    return private_key < other.private_key;
+  }
+  LookupArgs::OperationType operation_type;
+  NodeId peer_id;
+  uint16_t num_contacts_requested;
+  const asymm::PrivateKey *private_key;
+};
+
+// An RPC for one lookup or store, waiting to be sent as part of a batch.
+struct BatchedRpc {
+  BatchedRpc(LookupArgsPtr lookup_args, const Contact &peer)
+      : lookup_args(lookup_args),
+        peer(peer) {}
+  LookupArgsPtr lookup_args;
+  Contact peer;
+};
+
+// Collects the results of the per-key operations of a Node::FindValues or
+// Node::StoreMany call, invoking callback once all have arrived.
+template <typename T>
+struct BatchedResults {
+  BatchedResults(size_t size, std::function<void(std::vector<T>)> callback_in)
+      : mutex(),
+        results(size),
+        pending(size),
+        callback(callback_in) {}
+  boost::mutex mutex;
+  std::vector<T> results;
+  size_t pending;
+  std::function<void(std::vector<T>)> callback;
+};
 
 }  // namespace dht
 
@@ -0,0 +1,91 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "maidsafe/dht/public_key_cache.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+PublicKeyCache::PublicKeyCache(
+    const size_t &max_size,
+    const bptime::time_duration &time_to_live,
+    const bptime::time_duration &negative_time_to_live)
+    : kMaxSize_(max_size),
+      kTimeToLive_(time_to_live),
+      kNegativeTimeToLive_(negative_time_to_live),
+      entries_(max_size),
+      mutex_() {}
+
+void PublicKeyCache::Add(const asymm::Identity &public_key_id,
+                         const asymm::PublicKey &public_key,
+                         const asymm::ValidationToken &validation_token) {
+  if (kMaxSize_ == 0 || public_key_id.empty())
+    return;
+  const bptime::ptime kNow(bptime::microsec_clock::universal_time());
+  const bptime::ptime kExpiryTime(kNow + (asymm::ValidateKey(public_key) ?
+                                          kTimeToLive_ : kNegativeTimeToLive_));
+  Entry entry;
+  entry.public_key = public_key;
+  entry.validation_token = validation_token;
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Insert(public_key_id, entry, kExpiryTime, kNow);
+}
+
+bool PublicKeyCache::Get(const asymm::Identity &public_key_id,
+                         asymm::PublicKey *public_key,
+                         asymm::ValidationToken *validation_token) {
+  if (!public_key || !validation_token)
+    return false;
+  boost::mutex::scoped_lock lock(mutex_);
+  const Entry *entry(entries_.Find(public_key_id,
+                                   bptime::microsec_clock::universal_time()));
+  if (!entry)
+    return false;
+  *public_key = entry->public_key;
+  *validation_token = entry->validation_token;
+  return true;
+}
+
+void PublicKeyCache::Remove(const asymm::Identity &public_key_id) {
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Erase(public_key_id);
+}
+
+void PublicKeyCache::Clear() {
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Clear();
+}
+
+size_t PublicKeyCache::Size() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return entries_.Size();
+}
+
+}  // namespace dht
+
+}  // namespace maidsafe
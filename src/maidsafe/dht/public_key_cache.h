@@ -0,0 +1,111 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAIDSAFE_DHT_PUBLIC_KEY_CACHE_H_
+#define MAIDSAFE_DHT_PUBLIC_KEY_CACHE_H_
+
+#include <string>
+
+#include "boost/date_time/posix_time/posix_time_types.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include "maidsafe/dht/config.h"
+#include "maidsafe/dht/expiring_map.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace bptime = boost::posix_time;
+
+/**
+* @class PublicKeyCache
+* Bounded, thread-safe cache of the public keys and validation tokens returned
+* by the contact validation getter, keyed by public key ID.  This lets the
+* service run a store or delete task at once for a publisher whose key it has
+* fetched recently, rather than fetching it again.  Results which don't hold a
+* valid public key are cached too, for a shorter time, so that requests citing
+* an unknown ID don't each cause a fetch.
+*/
+class PublicKeyCache {
+ public:
+  /**
+  * @param[in] max_size The maximum number of IDs held.  If 0, nothing is ever
+  * held.
+  * @param[in] time_to_live The time for which a valid public key is held.
+  * @param[in] negative_time_to_live The time for which an invalid one is held.
+  */
+  PublicKeyCache(const size_t &max_size,
+                 const bptime::time_duration &time_to_live,
+                 const bptime::time_duration &negative_time_to_live);
+
+  /**
+  * Adds or replaces the result of fetching public_key_id.  If full, expired
+  * entries are purged, then the one closest to expiry is evicted.
+  * @param[in] public_key_id The ID which was fetched.
+  * @param[in] public_key The public key returned.
+  * @param[in] validation_token The validation token returned.
+  */
+  void Add(const asymm::Identity &public_key_id,
+           const asymm::PublicKey &public_key,
+           const asymm::ValidationToken &validation_token);
+
+  /**
+  * @param[in] public_key_id The ID to look up.
+  * @param[out] public_key The cached public key, which may be invalid.
+  * @param[out] validation_token The cached validation token.
+  * @return True if an unexpired result is cached for public_key_id.
+  */
+  bool Get(const asymm::Identity &public_key_id,
+           asymm::PublicKey *public_key,
+           asymm::ValidationToken *validation_token);
+
+  void Remove(const asymm::Identity &public_key_id);
+
+  void Clear();
+
+  size_t Size();
+
+ private:
+  struct Entry {
+    Entry() : public_key(), validation_token() {}
+    asymm::PublicKey public_key;
+    asymm::ValidationToken validation_token;
+  };
+  PublicKeyCache(const PublicKeyCache&);
+  PublicKeyCache& operator=(const PublicKeyCache&);
+  const size_t kMaxSize_;
+  const bptime::time_duration kTimeToLive_, kNegativeTimeToLive_;
+  ExpiringMap<asymm::Identity, Entry> entries_;
+  boost::mutex mutex_;
+};
+
+}  // namespace dht
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DHT_PUBLIC_KEY_CACHE_H_
@@ -65,6 +65,8 @@ enum ReturnCode {
   kFailedToUpdateRankInfo = -302008,
   kFailedToSetPreferredEndpoint = -302009,
   kFailedToIncrementFailedRpcCount = -302010,
+  kFailedToSaveRoutingTable = -302011,
+  kFailedToLoadRoutingTable = -302012,
 
   // Node
   kNoOnlineBootstrapContacts = -303001,
@@ -83,6 +85,8 @@ enum ReturnCode {
   kContactFailedToRespond = -303014,
   kValueAlreadyExists = -303015,
   kFailedValidation = -303016,
+  kOperationDeadlineExpired = -303017,
+  kOperationCancelled = -303018,
 
   // Contact
   kSerialisation = -304001,
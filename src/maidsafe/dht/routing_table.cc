@@ -27,8 +27,21 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "maidsafe/dht/routing_table.h"
 
+#include <algorithm>
+#include <fstream>
+#include <unordered_set>
+
 #include "maidsafe/common/utils.h"
 
+#ifdef __MSVC__
+#  pragma warning(push)
+#  pragma warning(disable: 4127 4244 4267)
+#endif
+#include "maidsafe/dht/kademlia.pb.h"
+#ifdef __MSVC__
+#  pragma warning(pop)
+#endif
+#include "maidsafe/dht/node_id_block.h"
 #include "maidsafe/dht/return_codes.h"
 #include "maidsafe/dht/utils.h"
 
@@ -36,22 +49,42 @@ namespace maidsafe {
 
 namespace dht {
 
+namespace {
+
+// Bumped whenever RoutingTableState changes incompatibly.
+const int32_t kRoutingTableFileVersion(1);
+
+const bptime::ptime kEpoch(boost::gregorian::date(1970, 1, 1));
+
+}  // unnamed namespace
+
 RoutingTable::RoutingTable(const NodeId &this_id, const uint16_t &k)
     : kThisId_(this_id),
       kDebugId_(DebugId(kThisId_)),
       k_(k),
-      contacts_(),
+      kbuckets_(kKeySizeBits + 1),
+      kbucket_index_by_id_(),
+      public_keys_(),
+      replacement_caches_(kKeySizeBits + 1),
+      kbucket_last_activity_(kKeySizeBits + 1),
       unvalidated_contacts_(),
       ping_oldest_contact_(new PingOldestContactPtr::element_type),
       validate_contact_(new ValidateContactPtr::element_type),
       ping_down_contact_(new PingDownContactPtr::element_type),
       shared_mutex_(),
-      bucket_of_holder_(0) {}
+      snapshot_(),
+      bucket_of_holder_(0) {
+  PublishSnapshot(0, 0);
+}
 
 RoutingTable::~RoutingTable() {
   UniqueLock unique_lock(shared_mutex_);
   unvalidated_contacts_.clear();
-  contacts_.clear();
+  replacement_caches_.clear();
+  kbucket_last_activity_.clear();
+  kbucket_index_by_id_.clear();
+  public_keys_.clear();
+  kbuckets_.clear();
 }
 
 int RoutingTable::AddContact(const Contact &contact, RankInfoPtr rank_info) {
@@ -66,21 +99,39 @@ int RoutingTable::AddContact(const Contact &contact, RankInfoPtr rank_info) {
   // Check if the contact is already in the routing table; if so, set its last
   // seen time to now (will bring it to the top)
   std::shared_ptr<UpgradeLock> upgrade_lock(new UpgradeLock(shared_mutex_));
-  ContactsById key_indx = contacts_.get<NodeIdTag>();
-  auto it_node = key_indx.find(node_id);
-  if (it_node != key_indx.end()) {
+  RoutingTableContact *existing_contact(FindContact(node_id));
+  if (existing_contact) {
     UpgradeToUniqueLock unique_lock(*upgrade_lock);
     // will update the num_failed_rpcs to 0 as well and update the IPs ports if
     // changed.
-    if (contacts_.modify(it_node, ChangeLastSeen(contact))) {
-      DLOG(WARNING) << kDebugId_ << ": Contact already in routing table "
-                    << DebugId(contact);
-      return kSuccess;
-    } else {
+    ChangeLastSeen change_last_seen(contact);
+    change_last_seen(*existing_contact);
+    // a contact whose keys don't match keeps its place and any probe of it
+    if (!change_last_seen.accepted) {
       DLOG(WARNING) << kDebugId_ << ": Failed to update last seen time for "
                     << DebugId(contact);
       return kFailedToUpdateLastSeenTime;
     }
+    if (rank_info && rank_info->rtt != 0) {
+      ChangeRtt change_rtt(rank_info->rtt);
+      change_rtt(*existing_contact);
+    }
+    // move the contact to the most recently seen end of its k-bucket
+    const uint16_t kKBucketIndex(existing_contact->kbucket_index);
+    KBucket &kbucket(kbuckets_[kKBucketIndex]);
+    auto it = kbucket.begin() + (existing_contact - &kbucket[0]);
+    const bool kReordered(it + 1 != kbucket.end());
+    std::rotate(it, it + 1, kbucket.end());
+    kbucket_last_activity_[kKBucketIndex] =
+        bptime::microsec_clock::universal_time();
+    EndProbe(node_id, kKBucketIndex);
+    // readers only see membership, order and contact details, so a refresh of
+    // the most recently seen contact needs no new view
+    if (kReordered || change_last_seen.contact_changed)
+      PublishSnapshot(kKBucketIndex, kKBucketIndex);
+    DLOG(WARNING) << kDebugId_ << ": Contact already in routing table "
+                  << DebugId(contact);
+    return kSuccess;
   } else {
     // put the contact into the unvalidated contacts container
     UnValidatedContactsById contact_indx =
@@ -117,22 +168,36 @@ void RoutingTable::InsertContact(const Contact &contact,
                                              rank_info, upgrade_lock));
       if (force_k_result != kSuccess &&
           force_k_result != kFailedToInsertNewContact) {
-        Contact oldest_contact = GetLastSeenContact(target_kbucket_index);
-        // fire a signal here to notify
-        (*ping_oldest_contact_)(oldest_contact, contact, rank_info);
+        // keep the contact as a replacement, and fire a signal here to notify
+        // unless the oldest contact is already being pinged
+        Contact oldest_contact;
+        if (CacheReplacement(contact, rank_info, target_kbucket_index,
+                             &oldest_contact, upgrade_lock))
+          (*ping_oldest_contact_)(oldest_contact, contact, rank_info);
       }
     }
   } else {
     // bucket not full, insert the contact into routing table
-    RoutingTableContact new_routing_table_contact(contact, kThisId_,
-                                                  rank_info,
-                                                  common_leading_bits);
-    new_routing_table_contact.kbucket_index = target_kbucket_index;
+    RoutingTableContact new_routing_table_contact(contact, rank_info,
+                                                  common_leading_bits,
+                                                  target_kbucket_index);
     UpgradeToUniqueLock unique_lock(*upgrade_lock);
-    auto result = contacts_.insert(new_routing_table_contact);
-    if (result.second) {
+    if (kbucket_index_by_id_.insert(std::make_pair(contact.node_id(),
+                                    target_kbucket_index)).second) {
+      kbuckets_[target_kbucket_index].push_back(new_routing_table_contact);
+      kbucket_last_activity_[target_kbucket_index] =
+          new_routing_table_contact.last_seen;
+      std::vector<UnValidatedContact> &replacements(
+          replacement_caches_[target_kbucket_index].contacts);
+      for (auto it = replacements.begin(); it != replacements.end(); ++it) {
+        if ((*it).node_id == contact.node_id()) {
+          replacements.erase(it);
+          break;
+        }
+      }
+      PublishSnapshot(target_kbucket_index, target_kbucket_index);
       DLOG(INFO) << kDebugId_ << ": Added node " << DebugId(contact) << ".  "
-                 << contacts_.size() << " contacts.";
+                 << kbucket_index_by_id_.size() << " contacts.";
     } else {
       DLOG(WARNING) << kDebugId_ << ": Failed to insert node "
                     << DebugId(contact);
@@ -146,10 +211,9 @@ int RoutingTable::GetContact(const NodeId &node_id, Contact *contact) {
     return kInvalidPointer;
   }
   SharedLock shared_lock(shared_mutex_);
-  ContactsById key_indx = contacts_.get<NodeIdTag>();
-  auto it = key_indx.find(node_id);
-  if (it != key_indx.end()) {
-    *contact = (*it).contact;
+  RoutingTableContact *routing_table_contact(FindContact(node_id));
+  if (routing_table_contact) {
+    *contact = *routing_table_contact->contact;
     return kSuccess;
   } else {
     *contact = Contact();
@@ -166,131 +230,121 @@ void RoutingTable::GetCloseContacts(
     DLOG(WARNING) << kDebugId_ << ": Null pointer passed.";
     return;
   }
-  SharedLock shared_lock(shared_mutex_);
+  // work against the current view, without blocking (or being blocked by)
+  // writers
+  RoutingTableSnapshotPtr snapshot(Snapshot());
+  const std::vector<std::shared_ptr<const KBucketView>> &kbuckets(
+      snapshot->kbuckets);
+  const uint16_t kBucketOfHolder(static_cast<uint16_t>(kbuckets.size() - 1));
   // the search will begin from a bucket having the similiar k-distance as the
   // target node to the current holder
   // then extend the range follows the rule:
   //      all kbuckets contains more common leading bits shall be considered
   //      if the total still smaller than the count, then recursively add
   //      kbuckets containing less leading bits till reach the count cap
-  uint16_t start_kbucket_index = KBucketIndex(target_id);
+  uint16_t start_kbucket_index = std::min(KDistanceTo(target_id),
+                                          kBucketOfHolder);
   uint16_t end_kbucket_index = start_kbucket_index +1;
 
-  uint32_t potential_size = KBucketSizeForKey(start_kbucket_index);
+  uint32_t potential_size =
+      static_cast<uint32_t>(kbuckets[start_kbucket_index]->size());
   uint32_t target_size = static_cast<uint32_t>(count + exclude_contacts.size());
   // extend the search range step 1: add all kbuckets containing more
   // common leading bits, the bucket contains the holder will always be the last
-  while (end_kbucket_index <= bucket_of_holder_) {
-    potential_size = potential_size + KBucketSizeForKey(end_kbucket_index);
+  while (end_kbucket_index <= kBucketOfHolder) {
+    potential_size = potential_size +
+        static_cast<uint32_t>(kbuckets[end_kbucket_index]->size());
     ++end_kbucket_index;
   }
   // extend the search range step 2:recursively add kbuckets containing
   // less common leading bits till reach the count cap
   while ((potential_size < target_size) && (start_kbucket_index > 0)) {
     --start_kbucket_index;
-    potential_size = potential_size + KBucketSizeForKey(start_kbucket_index);
+    potential_size = potential_size +
+        static_cast<uint32_t>(kbuckets[start_kbucket_index]->size());
+  }
+  // hash the excluded IDs once, rather than scanning the exclusion list for
+  // every candidate
+  std::unordered_set<NodeId, NodeIdHash> exclude_ids;
+  if (!exclude_contacts.empty()) {
+    exclude_ids.reserve(exclude_contacts.size());
+    for (auto it = exclude_contacts.begin(); it != exclude_contacts.end(); ++it)
+      exclude_ids.insert((*it).node_id());
   }
   // once we have the search range, put all contacts in the range buckets into
-  // a candidate container, using target_id to re-calculate the distance
-  RoutingTableContactsContainer candidate_contacts;
+  // a candidate block, then rank them by distance to target_id in one pass
+  std::vector<const Contact*> candidate_contacts;
+  candidate_contacts.reserve(potential_size);
+  NodeIdBlock candidate_ids;
+  candidate_ids.Reserve(potential_size);
   while (start_kbucket_index < end_kbucket_index) {
-    bmi::index_iterator<RoutingTableContactsContainer,
-        KBucketTag>::type ic0, ic1;
-    boost::tuples::tie(ic0, ic1)
-      = bmi::get<KBucketTag>(contacts_).equal_range(start_kbucket_index);
-    while (ic0 != ic1) {
-      // check if the candidate in the exclusion list
-      auto it = std::find(exclude_contacts.begin(),
-                          exclude_contacts.end(),
-                          (*ic0).contact);
+    const KBucketView &kbucket(*kbuckets[start_kbucket_index]);
+    for (auto it_contact = kbucket.begin(); it_contact != kbucket.end();
+         ++it_contact) {
       // if not in the exclusion list, add the contact into the candidates
-      // container
-      if (it == exclude_contacts.end()) {
-        RoutingTableContact new_contact((*ic0).contact, target_id, 0);
-        candidate_contacts.insert(new_contact);
+      const Contact &contact(**it_contact);
+      if (!Excluded(contact, exclude_ids, exclude_contacts)) {
+        candidate_contacts.push_back(&contact);
+        candidate_ids.Add(contact.node_id());
       }
-      ++ic0;
     }
     ++start_kbucket_index;
   }
   // populate the result with the count defined top contacts
-  // indexed by the new calculated distance
-  ContactsByDistanceToThisId key_dist_indx
-    = candidate_contacts.get<DistanceToThisIdTag>();
-  uint32_t counter(0);
-  auto it = key_dist_indx.begin();
-  while ((counter < count) && (it != key_dist_indx.end())) {
-    close_contacts->push_back((*it).contact);
-    ++counter;
-    ++it;
-  }
-  return;
+  std::vector<size_t> closest;
+  candidate_ids.SelectClosest(target_id, count, &closest);
+  for (size_t i = 0; i < closest.size(); ++i)
+    close_contacts->push_back(*candidate_contacts[closest[i]]);
 }
 
 void RoutingTable::Downlist(const NodeId &node_id) {
   SharedLock shared_lock(shared_mutex_);
-  ContactsById key_indx = contacts_.get<NodeIdTag>();
-  auto it = key_indx.find(node_id);
-  if (it != key_indx.end())
-    (*ping_down_contact_)((*it).contact);
+  RoutingTableContact *routing_table_contact(FindContact(node_id));
+  if (routing_table_contact)
+    (*ping_down_contact_)(*routing_table_contact->contact);
 }
 
 int RoutingTable::SetPublicKey(const NodeId &node_id,
                                const std::string &new_public_key) {
   UpgradeLock upgrade_lock(shared_mutex_);
-  ContactsById key_indx = contacts_.get<NodeIdTag>();
-  auto it = key_indx.find(node_id);
-  if (it == key_indx.end()) {
+  RoutingTableContact *routing_table_contact(FindContact(node_id));
+  if (!routing_table_contact) {
     DLOG(WARNING) << kDebugId_ << ": Failed to find node " << DebugId(node_id);
     return kFailedToFindContact;
   }
   UpgradeToUniqueLock unique_lock(upgrade_lock);
-  if (key_indx.modify(it, ChangePublicKey(new_public_key))) {
-    return kSuccess;
-  } else {
-    DLOG(WARNING) << kDebugId_ << ": Failed to set public key for node "
-                  << DebugId(node_id);
-    return kFailedToSetPublicKey;
-  }
+  public_keys_[node_id] = new_public_key;
+  return kSuccess;
 }
 
 int RoutingTable::UpdateRankInfo(const NodeId &node_id,
                                  RankInfoPtr new_rank_info) {
   UpgradeLock upgrade_lock(shared_mutex_);
-  ContactsById key_indx = contacts_.get<NodeIdTag>();
-  auto it = key_indx.find(node_id);
-  if (it == key_indx.end()) {
+  RoutingTableContact *routing_table_contact(FindContact(node_id));
+  if (!routing_table_contact) {
     DLOG(WARNING) << kDebugId_ << ": Failed to find node " << DebugId(node_id);
     return kFailedToFindContact;
   }
   UpgradeToUniqueLock unique_lock(upgrade_lock);
-  if (key_indx.modify(it, ChangeRankInfo(new_rank_info))) {
-    return kSuccess;
-  } else {
-    DLOG(WARNING) << kDebugId_ << ": Failed to update rank info for node "
-                  << DebugId(node_id);
-    return kFailedToUpdateRankInfo;
-  }
+  routing_table_contact->rank_info = new_rank_info;
+  return kSuccess;
 }
 
 int RoutingTable::SetPreferredEndpoint(const NodeId &node_id, const IP &ip) {
   UpgradeLock upgrade_lock(shared_mutex_);
-  ContactsById key_indx = contacts_.get<NodeIdTag>();
-  auto it = key_indx.find(node_id);
-  if (it == key_indx.end()) {
+  RoutingTableContact *routing_table_contact(FindContact(node_id));
+  if (!routing_table_contact) {
     DLOG(WARNING) << kDebugId_ << ": Failed to find node " << DebugId(node_id);
     return kFailedToFindContact;
   }
-  Contact new_local_contact((*it).contact);
-  new_local_contact.SetPreferredEndpoint(ip);
+  std::shared_ptr<Contact> new_local_contact(
+      new Contact(*routing_table_contact->contact));
+  new_local_contact->SetPreferredEndpoint(ip);
   UpgradeToUniqueLock unique_lock(upgrade_lock);
-  if (key_indx.modify(it, ChangeContact(new_local_contact))) {
-    return kSuccess;
-  } else {
-    DLOG(WARNING) << kDebugId_ << ": Failed to set preferred endpt for node "
-                  << DebugId(node_id);
-    return kFailedToSetPreferredEndpoint;
-  }
+  routing_table_contact->contact = new_local_contact;
+  PublishSnapshot(routing_table_contact->kbucket_index,
+                  routing_table_contact->kbucket_index);
+  return kSuccess;
 }
 
 int RoutingTable::SetValidated(const NodeId &node_id, bool validated) {
@@ -312,98 +366,236 @@ int RoutingTable::SetValidated(const NodeId &node_id, bool validated) {
     return kSuccess;
   }
 
-  ContactsById key_indx = contacts_.get<NodeIdTag>();
-  auto it = key_indx.find(node_id);
-  if (it == key_indx.end()) {
+  if (!FindContact(node_id)) {
     DLOG(WARNING) << kDebugId_ << ": Failed to find node " << DebugId(node_id);
     return kFailedToFindContact;
   }
 
   if (!validated) {
     // if the contact proved to be invalid, remove it from the routing_table.
+    UpgradeToUniqueLock unique_lock(*upgrade_lock);
+    EraseContact(node_id);
     DLOG(WARNING) << kDebugId_ << ": Node " << DebugId(node_id)
                   << " removed from routing table - failed to validate.  "
-                  << contacts_.size() << " contacts.";
-    UpgradeToUniqueLock unique_lock(*upgrade_lock);
-    key_indx.erase(it);
+                  << kbucket_index_by_id_.size() << " contacts.";
   }
   return kSuccess;
 }
 
 int RoutingTable::IncrementFailedRpcCount(const NodeId &node_id) {
   UpgradeLock upgrade_lock(shared_mutex_);
-  ContactsById key_indx = contacts_.get<NodeIdTag>();
-  auto it = key_indx.find(node_id);
-  if (it == key_indx.end()) {
+  RoutingTableContact *routing_table_contact(FindContact(node_id));
+  if (!routing_table_contact) {
     DLOG(INFO) << kDebugId_ << ": Failed to find node " << DebugId(node_id);
     return kFailedToFindContact;
   }
-  uint16_t num_failed_rpcs = (*it).num_failed_rpcs + 1;
+  uint16_t num_failed_rpcs = routing_table_contact->num_failed_rpcs + 1;
   UpgradeToUniqueLock unique_lock(upgrade_lock);
   if (num_failed_rpcs > kFailedRpcTolerance) {
-    key_indx.erase(it);
+    EraseContact(node_id);
     DLOG(INFO) << kDebugId_ << ": Removed node " << DebugId(node_id) << ".  "
-               << contacts_.size() << " contacts.";
-    return kSuccess;
+               << kbucket_index_by_id_.size() << " contacts.";
   } else {
-    if (key_indx.modify(it, ChangeNumFailedRpc(num_failed_rpcs))) {
-      DLOG(INFO) << kDebugId_ << ": Incremented failed rpc count for node "
-                 << DebugId(node_id) << " to " << num_failed_rpcs;
-      return kSuccess;
-    } else {
-      DLOG(WARNING) << kDebugId_ << ": Failed to increment failed rpc count "
-                    << "for node " << DebugId(node_id);
-      return kFailedToIncrementFailedRpcCount;
-    }
+    routing_table_contact->num_failed_rpcs = num_failed_rpcs;
+    EndProbe(node_id, routing_table_contact->kbucket_index);
+    DLOG(INFO) << kDebugId_ << ": Incremented failed rpc count for node "
+               << DebugId(node_id) << " to " << num_failed_rpcs;
   }
+  return kSuccess;
 }
 
 void RoutingTable::GetBootstrapContacts(std::vector<Contact> *contacts) {
   if (!contacts)
     return;
 
-  SharedLock shared_lock(shared_mutex_);
-  auto it = contacts_.get<BootstrapTag>().equal_range(true);
+  RoutingTableSnapshotPtr snapshot(Snapshot());
   contacts->clear();
-  while (it.first != it.second)
-    contacts->push_back((*it.first++).contact);
+  std::vector<Contact> indirect_contacts;
+  for (auto it_kbucket = snapshot->kbuckets.begin();
+       it_kbucket != snapshot->kbuckets.end(); ++it_kbucket) {
+    const KBucketView &kbucket(**it_kbucket);
+    for (auto it = kbucket.begin(); it != kbucket.end(); ++it) {
+      if ((*it)->IsDirectlyConnected())
+        contacts->push_back(**it);
+      else
+        indirect_contacts.push_back(**it);
+    }
+  }
 
   if (contacts->size() < kMinBootstrapContacts) {
-    it = contacts_.get<BootstrapTag>().equal_range(false);
-    while (it.first != it.second)
-      contacts->push_back((*it.first++).contact);
+    contacts->insert(contacts->end(), indirect_contacts.begin(),
+                     indirect_contacts.end());
   }
 }
 
 RankInfoPtr RoutingTable::GetLocalRankInfo(const Contact &contact) {
   SharedLock shared_lock(shared_mutex_);
-  ContactsById key_indx = contacts_.get<NodeIdTag>();
-  auto it = key_indx.find(contact.node_id());
-  if (it == key_indx.end()) {
+  RoutingTableContact *routing_table_contact(FindContact(contact.node_id()));
+  if (!routing_table_contact) {
     DLOG(WARNING) << kDebugId_ << ": Failed to find node " << DebugId(contact);
     return RankInfoPtr();
   } else {
-    return (*it).rank_info;
+    return routing_table_contact->rank_info;
   }
 }
 
+double RoutingTable::GetAverageRtt(const NodeId &node_id) {
+  SharedLock shared_lock(shared_mutex_);
+  RoutingTableContact *routing_table_contact(FindContact(node_id));
+  return routing_table_contact ? routing_table_contact->rtt_average : 0;
+}
+
+double RoutingTable::GetRttTimeout(const NodeId &node_id) {
+  SharedLock shared_lock(shared_mutex_);
+  RoutingTableContact *routing_table_contact(FindContact(node_id));
+  if (!routing_table_contact || routing_table_contact->rtt_average == 0)
+    return 0;
+  return routing_table_contact->rtt_average +
+         4 * routing_table_contact->rtt_variance;
+}
+
 void RoutingTable::GetAllContacts(std::vector<Contact> *contacts) {
   if (!contacts) {
     DLOG(WARNING) << kDebugId_ << ": Null pointer passed.";
     return;
   }
-  SharedLock shared_lock(shared_mutex_);
-  ContactsById key_indx = contacts_.get<NodeIdTag>();
-  auto it = key_indx.begin();
-  auto it_end = key_indx.end();
+  RoutingTableSnapshotPtr snapshot(Snapshot());
   contacts->clear();
-  contacts->reserve(distance(it, it_end));
-  while (it != it_end) {
-    contacts->push_back((*it).contact);
-    ++it;
+  contacts->reserve(snapshot->contact_count);
+  for (auto it_kbucket = snapshot->kbuckets.begin();
+       it_kbucket != snapshot->kbuckets.end(); ++it_kbucket) {
+    const KBucketView &kbucket(**it_kbucket);
+    for (auto it = kbucket.begin(); it != kbucket.end(); ++it)
+      contacts->push_back(**it);
   }
 }
 
+void RoutingTable::GetRefreshIds(const bptime::time_duration &max_idle,
+                                 const size_t &max_count,
+                                 std::vector<NodeId> *refresh_ids) {
+  if (!refresh_ids)
+    return;
+  refresh_ids->clear();
+  UniqueLock unique_lock(shared_mutex_);
+  bptime::ptime now(bptime::microsec_clock::universal_time());
+  const std::string kHolderBits(kThisId_.ToStringEncoded(NodeId::kBinary));
+  for (uint16_t i = 0;
+       i <= bucket_of_holder_ && refresh_ids->size() < max_count; ++i) {
+    // a k-bucket's idle time starts when it is first checked
+    if (kbucket_last_activity_[i].is_not_a_date_time()) {
+      kbucket_last_activity_[i] = now;
+      continue;
+    }
+    if (now < kbucket_last_activity_[i] + max_idle)
+      continue;
+    // IDs in k-bucket i share i leading bits with the holder (at least i for
+    // the holder's own k-bucket) and differ in the next one
+    std::string lower(kHolderBits.substr(0, i));
+    if (i < bucket_of_holder_)
+      lower += (kHolderBits[i] == '0' ? '1' : '0');
+    std::string upper(lower);
+    lower.append(kKeySizeBits - lower.size(), '0');
+    upper.append(kKeySizeBits - upper.size(), '1');
+    refresh_ids->push_back(NodeId(NodeId(lower, NodeId::kBinary),
+                                  NodeId(upper, NodeId::kBinary)));
+    kbucket_last_activity_[i] = now;
+  }
+}
+
+int RoutingTable::WriteToFile(const fs::path &filename) {
+  protobuf::RoutingTableState state;
+  state.set_version(kRoutingTableFileVersion);
+  state.set_holder_id(kThisId_.String());
+  {
+    // the per-contact statistics aren't part of the published view
+    SharedLock shared_lock(shared_mutex_);
+    state.set_bucket_of_holder(bucket_of_holder_);
+    for (uint16_t i = 0; i <= bucket_of_holder_; ++i) {
+      const KBucket &kbucket(kbuckets_[i]);
+      for (auto it = kbucket.begin(); it != kbucket.end(); ++it) {
+        protobuf::RoutingTableContact *pb_contact(state.add_contact());
+        *pb_contact->mutable_contact() = ToProtobuf(*(*it).contact);
+        pb_contact->set_last_seen((*it).last_seen.is_special() ? 0 :
+            ((*it).last_seen - kEpoch).total_microseconds());
+        pb_contact->set_num_failed_rpcs((*it).num_failed_rpcs);
+        pb_contact->set_rtt_average((*it).rtt_average);
+        pb_contact->set_rtt_variance((*it).rtt_variance);
+      }
+    }
+  }
+  std::ofstream ofs(filename.c_str(), std::ios::binary | std::ios::trunc);
+  if (!state.SerializeToOstream(&ofs)) {
+    DLOG(WARNING) << kDebugId_ << ": Failed to write routing table to "
+                  << filename.string();
+    return kFailedToSaveRoutingTable;
+  }
+  return kSuccess;
+}
+
+int RoutingTable::ReadFromFile(const fs::path &filename) {
+  protobuf::RoutingTableState state;
+  {
+    std::ifstream ifs(filename.c_str(), std::ios::binary);
+    if (!ifs.is_open()) {
+      DLOG(WARNING) << kDebugId_ << ": Failed to open file : "
+                    << filename.string();
+      return kFailedToLoadRoutingTable;
+    }
+    if (!state.ParseFromIstream(&ifs)) {
+      DLOG(WARNING) << kDebugId_ << ": Failed to parse routing table.";
+      return kFailedToLoadRoutingTable;
+    }
+  }
+  if (state.version() != kRoutingTableFileVersion ||
+      NodeId(state.holder_id()) != kThisId_ ||
+      state.bucket_of_holder() < 0 ||
+      state.bucket_of_holder() > kKeySizeBits) {
+    DLOG(WARNING) << kDebugId_ << ": Routing table in " << filename.string()
+                  << " is incompatible.";
+    return kFailedToLoadRoutingTable;
+  }
+
+  UniqueLock unique_lock(shared_mutex_);
+  unvalidated_contacts_.clear();
+  for (uint16_t i = 0; i <= bucket_of_holder_; ++i) {
+    kbuckets_[i].clear();
+    replacement_caches_[i] = ReplacementCache();
+    kbucket_last_activity_[i] = bptime::ptime();
+  }
+  kbucket_index_by_id_.clear();
+  public_keys_.clear();
+  bucket_of_holder_ = static_cast<uint16_t>(state.bucket_of_holder());
+  // contacts were written in last seen order within each k-bucket, so
+  // appending them in turn restores that order
+  for (int i = 0; i < state.contact_size(); ++i) {
+    const protobuf::RoutingTableContact &pb_contact(state.contact(i));
+    Contact contact(FromProtobuf(pb_contact.contact()));
+    uint16_t common_leading_bits(KDistanceTo(contact.node_id()));
+    uint16_t kbucket_index(KBucketIndex(common_leading_bits));
+    if (contact.node_id() == kThisId_ ||
+        kbuckets_[kbucket_index].size() >= k_ ||
+        !kbucket_index_by_id_.insert(std::make_pair(contact.node_id(),
+                                     kbucket_index)).second)
+      continue;
+    RoutingTableContact routing_table_contact(contact, RankInfoPtr(),
+                                              common_leading_bits,
+                                              kbucket_index);
+    routing_table_contact.num_failed_rpcs =
+        static_cast<uint16_t>(pb_contact.num_failed_rpcs());
+    if (pb_contact.last_seen() != 0) {
+      routing_table_contact.last_seen =
+          kEpoch + bptime::microseconds(pb_contact.last_seen());
+    }
+    routing_table_contact.rtt_average = pb_contact.rtt_average();
+    routing_table_contact.rtt_variance = pb_contact.rtt_variance();
+    kbuckets_[kbucket_index].push_back(routing_table_contact);
+  }
+  PublishSnapshot(0, bucket_of_holder_);
+  DLOG(INFO) << kDebugId_ << ": Loaded " << kbucket_index_by_id_.size()
+             << " contacts from " << filename.string();
+  return kSuccess;
+}
+
 PingOldestContactPtr RoutingTable::ping_oldest_contact() {
   return ping_oldest_contact_;
 }
@@ -417,18 +609,16 @@ PingDownContactPtr RoutingTable::ping_down_contact() {
 }
 
 Contact RoutingTable::GetLastSeenContact(const uint16_t &kbucket_index) {
-  auto pit = contacts_.get<KBucketLastSeenTag>().equal_range(boost::make_tuple(
-      kbucket_index));
-  return (*pit.first).contact;
+  const KBucket &kbucket(kbuckets_[kbucket_index]);
+  if (kbucket.empty())
+    return Contact();
+  return *kbucket.front().contact;
 }
 
 uint16_t RoutingTable::KBucketIndex(const NodeId &key) {
 //   if (key > NodeId::kMaxId)
 //     return -1;
-  uint16_t common_leading_bits = KDistanceTo(key);
-  if (common_leading_bits > bucket_of_holder_)
-    common_leading_bits = bucket_of_holder_;
-  return common_leading_bits;
+  return KBucketIndex(KDistanceTo(key));
 }
 
 uint16_t RoutingTable::KBucketIndex(const uint16_t &common_leading_bits) {
@@ -442,13 +632,7 @@ uint16_t RoutingTable::KBucketCount() const {
 }
 
 uint16_t RoutingTable::KBucketSizeForKey(const uint16_t &key) {
-  if (key > bucket_of_holder_) {
-    auto pit = contacts_.get<KBucketTag>().equal_range(bucket_of_holder_);
-    return static_cast<uint16_t>(distance(pit.first, pit.second));
-  } else {
-    auto pit = contacts_.get<KBucketTag>().equal_range(key);
-    return static_cast<uint16_t>(distance(pit.first, pit.second));
-  }
+  return static_cast<uint16_t>(kbuckets_[KBucketIndex(key)].size());
 }
 
 void RoutingTable::SplitKbucket(std::shared_ptr<UpgradeLock> upgrade_lock) {
@@ -456,28 +640,26 @@ void RoutingTable::SplitKbucket(std::shared_ptr<UpgradeLock> upgrade_lock) {
   //    split the bucket of holder, contacts having common leading bits
   //    (bucket_of_holder_, 512) into (bucket_of_holder_+1,512) and
   //    bucket_of_holder_
-  // modify all related contacts's kbucket index tag in the contact container
-  auto pit = contacts_.get<KBucketTag>().equal_range(bucket_of_holder_);
-  auto it_begin = pit.first;
-  auto it_end = pit.second;
-  std::vector<NodeId> contacts_need_change;
-  while (it_begin != it_end) {
-    if ((*it_begin).common_leading_bits > bucket_of_holder_) {
-      // note, change the KBucket value here will cause re-sorting of the
-      // multi-index container. So we can only collect the node_id of the
-      // contacts need to be changed, then change their kbucket value later
-      contacts_need_change.push_back((*it_begin).node_id);
-    }
-    ++it_begin;
-  }
-  ContactsById key_node_indx = contacts_.get<NodeIdTag>();
+  // contacts keep their relative last seen order in both buckets
   UpgradeToUniqueLock unique_lock(*upgrade_lock);
-  for (auto it = contacts_need_change.begin();
-       it != contacts_need_change.end(); ++it) {
-    auto it_contact = key_node_indx.find(*it);
-    key_node_indx.modify(it_contact, ChangeKBucketIndex(bucket_of_holder_+1));
+  const uint16_t kNewBucketOfHolder(bucket_of_holder_ + 1);
+  KBucket &holder_kbucket(kbuckets_[bucket_of_holder_]);
+  KBucket &new_holder_kbucket(kbuckets_[kNewBucketOfHolder]);
+  KBucket remaining;
+  remaining.reserve(holder_kbucket.size());
+  for (auto it = holder_kbucket.begin(); it != holder_kbucket.end(); ++it) {
+    if ((*it).common_leading_bits > bucket_of_holder_) {
+      new_holder_kbucket.push_back(*it);
+      new_holder_kbucket.back().kbucket_index = kNewBucketOfHolder;
+      kbucket_index_by_id_[(*it).contact->node_id()] = kNewBucketOfHolder;
+    } else {
+      remaining.push_back(*it);
+    }
   }
-  ++bucket_of_holder_;
+  holder_kbucket.swap(remaining);
+  const uint16_t kOldBucketOfHolder(bucket_of_holder_);
+  bucket_of_holder_ = kNewBucketOfHolder;
+  PublishSnapshot(kOldBucketOfHolder, kNewBucketOfHolder);
 }
 
 int RoutingTable::ForceKAcceptNewPeer(
@@ -498,78 +680,224 @@ int RoutingTable::ForceKAcceptNewPeer(
   if (closest_outwith_bucket_of_holder <= 0)
     return kOutwithClosest;
 
-  // sort the brother bucket based on contacts' distance to the holder
-  auto pit = contacts_.get<KBucketDistanceToThisIdTag>().equal_range(
-      boost::make_tuple(target_bucket));
-  // check if the new contact is among the k closest
+  // find the contact in the brother bucket furthest from the holder and check
+  // if the new contact is closer than it
+  KBucket &kbucket(kbuckets_[target_bucket]);
+  if (kbucket.empty())
+    return kFailedToInsertNewContact;
   NodeId distance_to_target = kThisId_ ^ new_contact.node_id();
-  // pit.second shall point to the furthest contact (need one step forward)
-  // as the list will sorted from least to highest
-  // while the least value of XOR distance means the nearest
-  auto it_end = pit.second;
-  --it_end;
-  ContactsById key_node_indx = contacts_.get<NodeIdTag>();
-  NodeId furthest_distance = (*it_end).distance_to_this_id;
-  NodeId furthest_node = (*it_end).node_id;
-  auto it_furthest = key_node_indx.find(furthest_node);
+  auto it_furthest = kbucket.begin();
+  NodeId furthest_distance(kThisId_ ^ (*it_furthest).contact->node_id());
+  for (auto it = kbucket.begin() + 1; it != kbucket.end(); ++it) {
+    NodeId distance(kThisId_ ^ (*it).contact->node_id());
+    if (furthest_distance < distance) {
+      it_furthest = it;
+      furthest_distance = distance;
+    }
+  }
 
   if (furthest_distance <= distance_to_target)
     return kOutwithClosest;
 
   UpgradeToUniqueLock unique_lock(*upgrade_lock);
-  contacts_.erase(it_furthest);
-  RoutingTableContact new_local_contact(new_contact, kThisId_,
-                                        rank_info,
-                                        KDistanceTo(new_contact.node_id()));
-  new_local_contact.kbucket_index = target_bucket;
-  auto result = contacts_.insert(new_local_contact);
-  if (result.second) {
-    DLOG(INFO) << kDebugId_ << ": Added node " << DebugId(new_contact)
-               << " via ForceK.  " << contacts_.size() << " contacts.";
-    return kSuccess;
-  } else {
+  RoutingTableContact new_local_contact(new_contact, rank_info,
+                                        KDistanceTo(new_contact.node_id()),
+                                        target_bucket);
+  if (!kbucket_index_by_id_.insert(std::make_pair(new_contact.node_id(),
+                                   target_bucket)).second) {
     DLOG(WARNING) << kDebugId_ << ": Failed to insert node "
                   << DebugId(new_contact) << " via ForceK.";
     return kFailedToInsertNewContact;
   }
+  kbucket_index_by_id_.erase((*it_furthest).contact->node_id());
+  public_keys_.erase((*it_furthest).contact->node_id());
+  kbucket.erase(it_furthest);
+  kbucket.push_back(new_local_contact);
+  PublishSnapshot(target_bucket, target_bucket);
+  DLOG(INFO) << kDebugId_ << ": Added node " << DebugId(new_contact)
+             << " via ForceK.  " << kbucket_index_by_id_.size()
+             << " contacts.";
+  return kSuccess;
 }
 
 int RoutingTable::GetLeastCommonLeadingBitInKClosestContact() {
   std::vector<Contact> contacts, exclude_contacts;
   GetCloseContacts(kThisId_, k_, exclude_contacts, &contacts);
-  ContactsById key_id_indx = contacts_.get<NodeIdTag>();
-  auto it = key_id_indx.find(contacts[0].node_id());
-  uint16_t kclosest_bucket_index = (*it).common_leading_bits;
+  if (contacts.empty())
+    return 0;
+  uint16_t kclosest_bucket_index =
+      FindContact(contacts[0].node_id())->common_leading_bits;
   for (size_t i = 1; i < contacts.size(); ++i) {
-    it = key_id_indx.find(contacts[i].node_id());
-    if (kclosest_bucket_index > (*it).common_leading_bits)
-      kclosest_bucket_index = (*it).common_leading_bits;
+    uint16_t common_leading_bits =
+        FindContact(contacts[i].node_id())->common_leading_bits;
+    if (kclosest_bucket_index > common_leading_bits)
+      kclosest_bucket_index = common_leading_bits;
   }
   return kclosest_bucket_index;
 }
 
 uint16_t RoutingTable::KDistanceTo(const NodeId &rhs) const {
-  uint16_t distance = 0;
-  std::string this_id_binary = kThisId_.ToStringEncoded(NodeId::kBinary);
-  std::string rhs_id_binary = rhs.ToStringEncoded(NodeId::kBinary);
-  std::string::const_iterator this_it = this_id_binary.begin();
-  std::string::const_iterator rhs_it = rhs_id_binary.begin();
-  for (; ((this_it != this_id_binary.end()) && (*this_it == *rhs_it));
-      ++this_it, ++rhs_it)
-    ++distance;
-  return distance;
+  return kThisId_.CommonLeadingBits(rhs);
+}
+
+bool RoutingTable::CacheReplacement(
+    const Contact &contact,
+    RankInfoPtr rank_info,
+    const uint16_t &kbucket_index,
+    Contact *oldest_contact,
+    std::shared_ptr<UpgradeLock> upgrade_lock) {
+  UpgradeToUniqueLock unique_lock(*upgrade_lock);
+  ReplacementCache &replacement_cache(replacement_caches_[kbucket_index]);
+  std::vector<UnValidatedContact> &replacements(replacement_cache.contacts);
+  // move the contact to the most recently seen end of the cache
+  for (auto it = replacements.begin(); it != replacements.end(); ++it) {
+    if ((*it).node_id == contact.node_id()) {
+      replacements.erase(it);
+      break;
+    }
+  }
+  replacements.push_back(UnValidatedContact(contact, rank_info));
+  if (replacements.size() > k_)
+    replacements.erase(replacements.begin());
+
+  bptime::ptime now(bptime::microsec_clock::universal_time());
+  if (!replacement_cache.probe_time.is_not_a_date_time() &&
+      now < replacement_cache.probe_time + kOldestContactProbeTimeout) {
+    DLOG(INFO) << kDebugId_ << ": Cached node " << DebugId(contact)
+               << " as a replacement; oldest contact already being pinged.";
+    return false;
+  }
+  *oldest_contact = GetLastSeenContact(kbucket_index);
+  replacement_cache.probed_id = oldest_contact->node_id();
+  replacement_cache.probe_time = now;
+  return true;
+}
+
+void RoutingTable::EndProbe(const NodeId &node_id,
+                            const uint16_t &kbucket_index) {
+  ReplacementCache &replacement_cache(replacement_caches_[kbucket_index]);
+  if (!replacement_cache.probe_time.is_not_a_date_time() &&
+      replacement_cache.probed_id == node_id) {
+    replacement_cache.probed_id = NodeId();
+    replacement_cache.probe_time = bptime::ptime();
+  }
+}
+
+RoutingTableSnapshotPtr RoutingTable::Snapshot() const {
+  return std::atomic_load(&snapshot_);
+}
+
+void RoutingTable::PublishSnapshot(const uint16_t &first_kbucket_index,
+                                   const uint16_t &last_kbucket_index) {
+  RoutingTableSnapshotPtr current(std::atomic_load(&snapshot_));
+  std::shared_ptr<RoutingTableSnapshot> next(new RoutingTableSnapshot);
+  next->kbuckets.reserve(bucket_of_holder_ + 1);
+  for (uint16_t i = 0; i <= bucket_of_holder_; ++i) {
+    if (current && i < current->kbuckets.size() &&
+        (i < first_kbucket_index || i > last_kbucket_index)) {
+      next->kbuckets.push_back(current->kbuckets[i]);
+    } else {
+      // only the contact pointers are copied, not the contacts themselves
+      std::shared_ptr<KBucketView> kbucket(new KBucketView);
+      kbucket->reserve(kbuckets_[i].size());
+      for (auto it = kbuckets_[i].begin(); it != kbuckets_[i].end(); ++it)
+        kbucket->push_back((*it).contact);
+      next->kbuckets.push_back(kbucket);
+    }
+  }
+  next->contact_count = kbucket_index_by_id_.size();
+  next->version = current ? current->version + 1 : 0;
+  // readers still holding the previous view keep it alive until they finish
+  std::atomic_store(&snapshot_, RoutingTableSnapshotPtr(next));
+}
+
+bool RoutingTable::Excluded(
+    const Contact &contact,
+    const std::unordered_set<NodeId, NodeIdHash> &exclude_ids,
+    const std::vector<Contact> &exclude_contacts) const {
+  if (exclude_ids.find(contact.node_id()) == exclude_ids.end())
+    return false;
+  // contacts with a default ID only match on IP, so defer to operator==
+  if (contact.node_id() == NodeId()) {
+    return std::find(exclude_contacts.begin(), exclude_contacts.end(),
+                     contact) != exclude_contacts.end();
+  }
+  return true;
+}
+
+RoutingTableContact* RoutingTable::FindContact(const NodeId &node_id) {
+  auto it_index = kbucket_index_by_id_.find(node_id);
+  if (it_index == kbucket_index_by_id_.end())
+    return NULL;
+  KBucket &kbucket(kbuckets_[(*it_index).second]);
+  for (auto it = kbucket.begin(); it != kbucket.end(); ++it) {
+    if ((*it).contact->node_id() == node_id)
+      return &(*it);
+  }
+  return NULL;
+}
+
+void RoutingTable::EraseContact(const NodeId &node_id) {
+  auto it_index = kbucket_index_by_id_.find(node_id);
+  if (it_index == kbucket_index_by_id_.end())
+    return;
+  KBucket &kbucket(kbuckets_[(*it_index).second]);
+  for (auto it = kbucket.begin(); it != kbucket.end(); ++it) {
+    if ((*it).contact->node_id() == node_id) {
+      kbucket.erase(it);
+      break;
+    }
+  }
+  const uint16_t kKBucketIndex((*it_index).second);
+  kbucket_index_by_id_.erase(it_index);
+  public_keys_.erase(node_id);
+  EndProbe(node_id, kKBucketIndex);
+  // fill the freed slot with the fastest replacement, or failing that the most
+  // recently seen one
+  std::vector<UnValidatedContact> &replacements(
+      replacement_caches_[kKBucketIndex].contacts);
+  while (!replacements.empty()) {
+    auto it_replacement = replacements.end() - 1;
+    for (auto it = replacements.begin(); it != replacements.end(); ++it) {
+      if ((*it).rank_info && (*it).rank_info->rtt != 0 &&
+          (!(*it_replacement).rank_info ||
+           (*it_replacement).rank_info->rtt == 0 ||
+           (*it).rank_info->rtt < (*it_replacement).rank_info->rtt))
+        it_replacement = it;
+    }
+    UnValidatedContact replacement(*it_replacement);
+    replacements.erase(it_replacement);
+    if (kbucket_index_by_id_.insert(std::make_pair(replacement.node_id,
+                                    kKBucketIndex)).second) {
+      RoutingTableContact new_routing_table_contact(
+          replacement.contact, replacement.rank_info,
+          KDistanceTo(replacement.node_id), kKBucketIndex);
+      kbucket.push_back(new_routing_table_contact);
+      DLOG(INFO) << kDebugId_ << ": Promoted replacement node "
+                 << DebugId(replacement.contact) << ".";
+      break;
+    }
+  }
+  PublishSnapshot(kKBucketIndex, kKBucketIndex);
 }
 
 size_t RoutingTable::Size() {
   SharedLock shared_lock(shared_mutex_);
-  return contacts_.size();
+  return kbucket_index_by_id_.size();
 }
 
 void RoutingTable::Clear() {
   UniqueLock unique_lock(shared_mutex_);
   unvalidated_contacts_.clear();
-  contacts_.clear();
+  for (uint16_t i = 0; i <= bucket_of_holder_; ++i) {
+    kbuckets_[i].clear();
+    replacement_caches_[i] = ReplacementCache();
+    kbucket_last_activity_[i] = bptime::ptime();
+  }
+  kbucket_index_by_id_.clear();
+  public_keys_.clear();
   bucket_of_holder_ = 0;
+  PublishSnapshot(0, 0);
 }
 
 }  // namespace dht
@@ -32,6 +32,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "boost/date_time/posix_time/posix_time_types.hpp"
@@ -44,11 +46,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #  pragma warning(disable: 4244)
 #endif
 #include "boost/multi_index_container.hpp"
-#include "boost/multi_index/composite_key.hpp"
 #include "boost/multi_index/ordered_index.hpp"
-#include "boost/multi_index/identity.hpp"
 #include "boost/multi_index/member.hpp"
-#include "boost/multi_index/mem_fun.hpp"
 #ifdef __MSVC__
 #  pragma warning(pop)
 #endif
@@ -77,210 +76,139 @@ class ServicesTest;
 class RoutingTableSingleKTest_BEH_MutexTestWithMultipleThread_Test;
 }  // namespace test
 
-class KBucket;
-
+// Per-contact record held in a k-bucket.  The contact details are immutable
+// and shared; changing them replaces the pointer.
 struct RoutingTableContact {
   RoutingTableContact(const Contact &contact,
-                      const NodeId &holder_id,
                       const RankInfoPtr &rank_info,
-                      uint16_t common_leading_bits)
-      : contact(contact),
-        node_id(contact.node_id()),
-        public_key(),
-        num_failed_rpcs(0),
-        distance_to_this_id(holder_id ^ contact.node_id()),
-        common_leading_bits(common_leading_bits),
-        kbucket_index(0),
+                      uint16_t common_leading_bits,
+                      uint16_t kbucket_index)
+      : contact(new Contact(contact)),
+        rank_info(rank_info),
         last_seen(bptime::microsec_clock::universal_time()),
-        rank_info(rank_info) {}
-  RoutingTableContact(const Contact &contact,
-                      const NodeId &holder_id,
-                      uint16_t common_leading_bits)
-      : contact(contact),
-        node_id(contact.node_id()),
-        public_key(),
+        rtt_average(rank_info ? rank_info->rtt : 0),
+        rtt_variance(rtt_average / 2),
         num_failed_rpcs(0),
-        distance_to_this_id(holder_id ^ contact.node_id()),
         common_leading_bits(common_leading_bits),
-        kbucket_index(0),
-        last_seen(bptime::microsec_clock::universal_time()),
-        rank_info() {}
-  RoutingTableContact(const RoutingTableContact &other)
-      : contact(other.contact),
-        node_id(other.node_id),
-        public_key(other.public_key),
-        num_failed_rpcs(other.num_failed_rpcs),
-        distance_to_this_id(other.distance_to_this_id),
-        common_leading_bits(other.common_leading_bits),
-        kbucket_index(other.kbucket_index),
-        last_seen(other.last_seen),
-        rank_info(other.rank_info) {}
+        kbucket_index(kbucket_index) {}
   bool DirectConnected() const {
-    return contact.IsDirectlyConnected();
-  }
-  bool operator<(const RoutingTableContact &other) const {
-    return contact < other.contact;
+    return contact->IsDirectlyConnected();
   }
-  Contact contact;
-  NodeId node_id;
-  std::string public_key;
+  std::shared_ptr<const Contact> contact;
+  RankInfoPtr rank_info;
+  bptime::ptime last_seen;
+  // smoothed round trip time and its mean deviation in milliseconds, 0 if no
+  // RTT has been measured yet
+  double rtt_average;
+  double rtt_variance;
   uint16_t num_failed_rpcs;
-  NodeId distance_to_this_id;
   uint16_t common_leading_bits;
   // the index of the kbucket which is responsible for the contact
   uint16_t kbucket_index;
-  bptime::ptime last_seen;
-  RankInfoPtr rank_info;
-};
-
-struct ChangeContact {
-  explicit ChangeContact(const Contact &contact) : contact(contact) {}
-  // Anju: use nolint to satisfy multi-indexing
-  void operator()(RoutingTableContact &routing_table_contact) {  // NOLINT
-    routing_table_contact.contact = contact;
-  }
-  Contact contact;
 };
 
-struct ChangeKBucketIndex {
-  explicit ChangeKBucketIndex(const uint16_t &new_kbucket_index)
-      : new_kbucket_index(new_kbucket_index) {}
-  // Anju: use nolint to satisfy multi-indexing
+struct ChangeRtt {
+  explicit ChangeRtt(const uint32_t &new_rtt) : new_rtt(new_rtt) {}
   void operator()(RoutingTableContact &routing_table_contact) {  // NOLINT
-    routing_table_contact.kbucket_index = new_kbucket_index;
+    Update(new_rtt, &routing_table_contact.rtt_average,
+           &routing_table_contact.rtt_variance);
   }
-  uint16_t new_kbucket_index;
-};
-
-struct ChangePublicKey {
-  explicit ChangePublicKey(const std::string &new_public_key)
-      : new_public_key(new_public_key) {}
-  // Anju: use nolint to satisfy multi-indexing
-  void operator()(RoutingTableContact &routing_table_contact) {  // NOLINT
-    routing_table_contact.public_key = new_public_key;
-  }
-  std::string new_public_key;
-};
-
-struct ChangeRankInfo {
-  explicit ChangeRankInfo(RankInfoPtr new_rank_info)
-      : new_rank_info(new_rank_info) {}
-  // Anju: use nolint to satisfy multi-indexing
-  void operator()(RoutingTableContact &routing_table_contact) {  // NOLINT
-    routing_table_contact.rank_info = new_rank_info;
-  }
-  RankInfoPtr new_rank_info;
-};
-
-struct ChangeNumFailedRpc {
-  explicit ChangeNumFailedRpc(const uint16_t &new_num_failed_rpcs)
-      : new_num_failed_rpcs(new_num_failed_rpcs) {}
-  // Anju: use nolint to satisfy multi-indexing
-  void operator()(RoutingTableContact &routing_table_contact) {  // NOLINT
-    routing_table_contact.num_failed_rpcs = new_num_failed_rpcs;
+  // weighted as TCP's SRTT and RTTVAR (RFC 6298)
+  static void Update(const uint32_t &rtt, double *average, double *variance) {
+    if (*average == 0) {
+      *average = rtt;
+      *variance = rtt / 2.0;
+      return;
+    }
+    double deviation(*average - rtt);
+    *variance = 0.75 * *variance + 0.25 * (deviation < 0 ? -deviation :
+                                                           deviation);
+    *average = 0.875 * *average + 0.125 * rtt;
   }
-  uint16_t new_num_failed_rpcs;
+  uint32_t new_rtt;
 };
 
 struct ChangeLastSeen {
-  explicit ChangeLastSeen(const Contact &contact_in) : contact(contact_in) {}
-  // Anju: use nolint to satisfy multi-indexing
+  explicit ChangeLastSeen(const Contact &contact_in)
+      : contact(contact_in), accepted(false), contact_changed(false) {}
   void operator()(RoutingTableContact &routing_table_contact) {  // NOLINT
-    if (!asymm::MatchingPublicKeys(routing_table_contact.contact.public_key(),
+    const Contact &current(*routing_table_contact.contact);
+    if (!asymm::MatchingPublicKeys(current.public_key(),
                                    contact.public_key())) {
       DLOG(WARNING) << "Contacts have different public keys.";
       return;
     }
-    if (routing_table_contact.contact.public_key_id() !=
-        contact.public_key_id()) {
+    if (current.public_key_id() != contact.public_key_id()) {
       DLOG(WARNING) << "Contacts have different public key IDs.";
       return;
     }
 
+    accepted = true;
     routing_table_contact.last_seen = bptime::microsec_clock::universal_time();
     routing_table_contact.num_failed_rpcs = 0;
-    transport::Endpoint preferred =
-       routing_table_contact.contact.PreferredEndpoint();
-    routing_table_contact.contact = Contact(contact.node_id(),
-                                            contact.endpoint(),
-                                            contact.local_endpoints(),
-                                            contact.rendezvous_endpoint(),
-                                            contact.tcp443endpoint().ip != IP(),
-                                            contact.tcp80endpoint().ip != IP(),
-                                            contact.public_key_id(),
-                                            contact.public_key(),
-                                            contact.other_info());
-    routing_table_contact.contact.SetPreferredEndpoint(preferred.ip);
+    // the shared contact details are only replaced if they differ
+    if (SameDetails(current, contact))
+      return;
+    std::shared_ptr<Contact> updated(new Contact(contact.node_id(),
+        contact.endpoint(), contact.local_endpoints(),
+        contact.rendezvous_endpoint(), contact.tcp443endpoint().ip != IP(),
+        contact.tcp80endpoint().ip != IP(), contact.public_key_id(),
+        contact.public_key(), contact.other_info()));
+    updated->SetPreferredEndpoint(current.PreferredEndpoint().ip);
+    routing_table_contact.contact = updated;
+    contact_changed = true;
+  }
+  static bool SameEndpoint(const transport::Endpoint &lhs,
+                           const transport::Endpoint &rhs) {
+    return lhs.ip == rhs.ip && lhs.port == rhs.port;
+  }
+  static bool SameDetails(const Contact &lhs, const Contact &rhs) {
+    if (!SameEndpoint(lhs.endpoint(), rhs.endpoint()) ||
+        !SameEndpoint(lhs.rendezvous_endpoint(), rhs.rendezvous_endpoint()) ||
+        (lhs.tcp443endpoint().ip == IP()) !=
+            (rhs.tcp443endpoint().ip == IP()) ||
+        (lhs.tcp80endpoint().ip == IP()) != (rhs.tcp80endpoint().ip == IP()) ||
+        lhs.other_info() != rhs.other_info() ||
+        lhs.local_endpoints().size() != rhs.local_endpoints().size())
+      return false;
+    for (size_t i = 0; i < lhs.local_endpoints().size(); ++i) {
+      if (!SameEndpoint(lhs.local_endpoints()[i], rhs.local_endpoints()[i]))
+        return false;
+    }
+    return true;
   }
   Contact contact;
+  // set if the keys matched and the contact was marked as seen
+  bool accepted;
+  // set if the contact's details were replaced
+  bool contact_changed;
 };
 
 struct NodeIdTag;
-struct DistanceToThisIdTag;
-struct KBucketTag;
-struct KBucketLastSeenTag;
-struct KBucketDistanceToThisIdTag;
-struct TimeLastSeenTag;
-struct BootstrapTag;
-
-// Struct to allow initialisation of RoutingTableContactsContainer to accept
-// this node's ID as a parameter.
-struct KadCloserToThisId {
-  explicit KadCloserToThisId(const NodeId &id) : this_id(id) {}
-  bool operator()(const RoutingTableContact &x,
-                  const RoutingTableContact &y) const {
-    return NodeId::CloserToTarget(x.node_id, y.node_id, this_id);
-  }
-  NodeId this_id;
-};
 
-typedef boost::multi_index_container<
-  RoutingTableContact,
-  bmi::indexed_by<
-    bmi::ordered_unique<
-      bmi::tag<NodeIdTag>,
-      BOOST_MULTI_INDEX_MEMBER(RoutingTableContact, NodeId, node_id)
-    >,
-    bmi::ordered_non_unique<
-      bmi::tag<DistanceToThisIdTag>,
-      BOOST_MULTI_INDEX_MEMBER(RoutingTableContact, NodeId, distance_to_this_id)
-    >,
-    bmi::ordered_non_unique<
-      bmi::tag<KBucketTag>,
-      BOOST_MULTI_INDEX_MEMBER(RoutingTableContact, uint16_t, kbucket_index)
-    >,
-    bmi::ordered_non_unique<
-      bmi::tag<KBucketLastSeenTag>,
-      bmi::composite_key<
-        RoutingTableContact,
-        BOOST_MULTI_INDEX_MEMBER(RoutingTableContact, uint16_t, kbucket_index),
-        BOOST_MULTI_INDEX_MEMBER(RoutingTableContact, bptime::ptime, last_seen)
-      >
-    >,
-    bmi::ordered_non_unique<
-      bmi::tag<KBucketDistanceToThisIdTag>,
-      bmi::composite_key<
-        RoutingTableContact,
-        BOOST_MULTI_INDEX_MEMBER(RoutingTableContact, uint16_t, kbucket_index),
-        BOOST_MULTI_INDEX_MEMBER(RoutingTableContact, NodeId,
-                                 distance_to_this_id)
-      >
-    >,
-    bmi::ordered_non_unique<
-      bmi::tag<TimeLastSeenTag>,
-      BOOST_MULTI_INDEX_MEMBER(RoutingTableContact, bptime::ptime, last_seen)
-    >,
-    bmi::ordered_non_unique<
-      bmi::tag<BootstrapTag>,
-      bmi::const_mem_fun<RoutingTableContact, bool,
-                         &RoutingTableContact::DirectConnected>
-    >
-  >
-> RoutingTableContactsContainer;
+// Contacts of a single k-bucket held contiguously, least recently seen first.
+typedef std::vector<RoutingTableContact> KBucket;
+
+// Maps each contact's node ID to the index of the k-bucket holding it.
+typedef std::unordered_map<NodeId, uint16_t, NodeIdHash> KBucketIndexById;
+
+// The contacts of a single k-bucket as seen by readers, least recently seen
+// first.  The contacts are shared with the k-bucket itself.
+typedef std::vector<std::shared_ptr<const Contact>> KBucketView;
+
+// Immutable view of the k-buckets [0, bucket_of_holder_] handed to lock-free
+// readers.  K-buckets left untouched by a write are shared with the previous
+// view, and a view is freed once its last reader releases it.  Only
+// membership, order and contact details are visible; per-contact statistics
+// are read under the lock.
+struct RoutingTableSnapshot {
+  RoutingTableSnapshot() : kbuckets(), contact_count(0), version(0) {}
+  std::vector<std::shared_ptr<const KBucketView>> kbuckets;
+  size_t contact_count;
+  uint64_t version;
+};
 
-typedef RoutingTableContactsContainer::index<NodeIdTag>::type& ContactsById;
-typedef RoutingTableContactsContainer::index<DistanceToThisIdTag>::type&
-    ContactsByDistanceToThisId;
+typedef std::shared_ptr<const RoutingTableSnapshot> RoutingTableSnapshotPtr;
 
 struct UnValidatedContact {
   UnValidatedContact(const Contact &contact, const RankInfoPtr &rank_info)
@@ -305,6 +233,15 @@ typedef boost::multi_index_container<
 typedef UnValidatedContactsContainer::index<NodeIdTag>::type&
         UnValidatedContactsById;
 
+// Validated candidates for a full k-bucket, least recently seen first, along
+// with the outstanding ping of the k-bucket's oldest contact, if any.
+struct ReplacementCache {
+  ReplacementCache() : contacts(), probed_id(), probe_time() {}
+  std::vector<UnValidatedContact> contacts;
+  NodeId probed_id;
+  bptime::ptime probe_time;
+};
+
 
 typedef std::shared_ptr<boost::signals2::signal<void(const Contact&,
                                                      const Contact&,
@@ -326,9 +263,12 @@ class RoutingTable {
   /** Destructor. */
   ~RoutingTable();
   /** Add the given contact to the correct k-bucket; if it already
-   *  exists, its status will be updated.  If the given k-bucket is full and not
-   *  splittable, the signal ping_oldest_contact_ will be fired which will
-   *  ultimately resolve whether the contact is added or not.
+   *  exists, its status will be updated, including its average RTT if
+   *  rank_info carries a measured RTT.  If the given k-bucket is full and not
+   *  splittable, the contact is held in the k-bucket's replacement cache and
+   *  the signal ping_oldest_contact_ will be fired (unless a ping of the
+   *  oldest contact is already outstanding) which will ultimately resolve
+   *  whether the contact is added or not.
    *  @param[in] contact The new contact which needs to be added.
    *  @param[in] rank_info The contact's rank_info.
    *  @return Return code 0 for success, otherwise failure. */
@@ -373,7 +313,8 @@ class RoutingTable {
   int SetValidated(const NodeId &node_id, bool validated);
   /** Increase one node's failedRPC counter by one.  If the count exceeds the
    *  value of kFailedRpcTolerance, the contact is removed from the routing
-   *  table.
+   *  table and replaced by the contact with the lowest RTT in its k-bucket's
+   *  replacement cache, or the most recently seen if none has a measured RTT.
    *  @param[in] node_id The Kademlia ID of the target node.
    *  @return Return code 0 for success, otherwise failure. */
   int IncrementFailedRpcCount(const NodeId &node_id);
@@ -386,9 +327,40 @@ class RoutingTable {
    *  @param[in] contact The contact to find
    *  @return The localRankInfo of the contact */
   RankInfoPtr GetLocalRankInfo(const Contact &contact);
+  /** Get the smoothed round trip time measured to a contact.
+   *  @param[in] node_id The Kademlia ID of the target node.
+   *  @return The average RTT in milliseconds, or 0 if the contact isn't held
+   *  or no RTT has been measured to it. */
+  double GetAverageRtt(const NodeId &node_id);
+  /** Get the time within which a contact can be expected to respond, taken as
+   *  TCP's retransmission timeout (RFC 6298) over its round trip times.
+   *  @param[in] node_id The Kademlia ID of the target node.
+   *  @return The timeout in milliseconds, or 0 if the contact isn't held or no
+   *  RTT has been measured to it. */
+  double GetRttTimeout(const NodeId &node_id);
   /** Get all contacts in the routing table
    *  @param[out] contacts All contacts in the routing table */
   void GetAllContacts(std::vector<Contact> *contacts);
+  /** Picks a random ID within the range of each k-bucket which hasn't heard
+   *  from any of its contacts for at least max_idle, and marks those k-buckets
+   *  as active again.
+   *  @param[in] max_idle The time after which a k-bucket is stale.
+   *  @param[in] max_count The maximum number of IDs to return.
+   *  @param[out] refresh_ids One ID for each stale k-bucket, furthest first. */
+  void GetRefreshIds(const bptime::time_duration &max_idle,
+                     const size_t &max_count,
+                     std::vector<NodeId> *refresh_ids);
+  /** Saves all contacts, in k-bucket and last seen order, along with their
+   *  last seen times, failed RPC counts and RTT statistics.
+   *  @param[in] filename The file to write, replacing any existing one.
+   *  @return Return code 0 for success, otherwise failure. */
+  int WriteToFile(const fs::path &filename);
+  /** Replaces the routing table's contents with those saved by WriteToFile.
+   *  Fails if the file was written by a routing table with a different holder
+   *  ID or an incompatible version.
+   *  @param[in] filename The file to read.
+   *  @return Return code 0 for success, otherwise failure. */
+  int ReadFromFile(const fs::path &filename);
   /** Getter.
    *  @return The ping_oldest_contact_ signal. */
   PingOldestContactPtr ping_oldest_contact();
@@ -455,6 +427,26 @@ class RoutingTable {
                           const uint16_t &target_bucket,
                           RankInfoPtr rank_info,
                           std::shared_ptr<UpgradeLock> upgrade_lock);
+  /** Holds a new contact in a full k-bucket's replacement cache, evicting the
+   *  least recently seen candidate if the cache already holds k contacts.
+   *  @param[in] contact The new contact.
+   *  @param[in] rank_info The new contact's rank_info.
+   *  @param[in] kbucket_index The index of the full k-bucket.
+   *  @param[out] oldest_contact The k-bucket's oldest contact, to be pinged.
+   *  @param[in] upgrade_lock An UpgradeLock held on shared_mutex_
+   *  @return true if the oldest contact should be pinged, false if a ping of
+   *  it is already outstanding. */
+  bool CacheReplacement(const Contact &contact,
+                        RankInfoPtr rank_info,
+                        const uint16_t &kbucket_index,
+                        Contact *oldest_contact,
+                        std::shared_ptr<UpgradeLock> upgrade_lock);
+  /** Marks any outstanding ping of a k-bucket's oldest contact as answered if
+   *  the given contact is the one being pinged.  Must be called while holding
+   *  a unique lock on shared_mutex_.
+   *  @param[in] node_id The Kademlia ID of the contact.
+   *  @param[in] kbucket_index The index of the k-bucket holding the contact. */
+  void EndProbe(const NodeId &node_id, const uint16_t &kbucket_index);
   /** XOR KBucket distance between two kademlia IDs.
    *  Measured by the number of common leading bits.
    *  The less the value is, the further the distance (the wider range) is.
@@ -462,6 +454,35 @@ class RoutingTable {
    *  @return the number of common bits from the beginning */
   uint16_t KDistanceTo(const NodeId &rhs) const;
   int GetLeastCommonLeadingBitInKClosestContact();
+  /** Checks whether a candidate contact is in a GetCloseContacts exclusion
+   *  list.
+   *  @param[in] contact The candidate contact.
+   *  @param[in] exclude_ids The node IDs of exclude_contacts.
+   *  @param[in] exclude_contacts The exclusion list itself.
+   *  @return true if the contact is to be excluded. */
+  bool Excluded(const Contact &contact,
+                const std::unordered_set<NodeId, NodeIdHash> &exclude_ids,
+                const std::vector<Contact> &exclude_contacts) const;
+  /** Getter.  Safe to call without holding shared_mutex_.
+   *  @return The most recently published view of the k-buckets. */
+  RoutingTableSnapshotPtr Snapshot() const;
+  /** Publishes a new view of the k-buckets, rebuilding those in the given
+   *  range and sharing the rest with the current view.  Must be called while
+   *  holding a unique lock on shared_mutex_, and only when contacts were
+   *  added, removed, reordered or had their details replaced.
+   *  @param[in] first_kbucket_index The first k-bucket which has changed.
+   *  @param[in] last_kbucket_index The last k-bucket which has changed. */
+  void PublishSnapshot(const uint16_t &first_kbucket_index,
+                       const uint16_t &last_kbucket_index);
+  /** Finds a contact held in one of the k-buckets.
+   *  @param[in] node_id The Kademlia ID of the target node.
+   *  @return The contact's entry, or NULL if it isn't held. */
+  RoutingTableContact* FindContact(const NodeId &node_id);
+  /** Removes a contact from its k-bucket and from the index, then promotes
+   *  the contact with the lowest RTT in the k-bucket's replacement cache, or
+   *  the most recently seen if none has a measured RTT.
+   *  @param[in] node_id The Kademlia ID of the target node. */
+  void EraseContact(const NodeId &node_id);
 
   /** Getter.
    *  @return Num of contacts in the routing table. */
@@ -475,8 +496,20 @@ class RoutingTable {
   std::string kDebugId_;
   /** Kademlia k */
   const uint16_t k_;
-  /** Multi_index container of all contacts */
-  RoutingTableContactsContainer contacts_;
+  /** All k-buckets, indexed by the number of leading bits each bucket's
+   *  contacts have in common with the holder.  Only [0, bucket_of_holder_]
+   *  are in use. */
+  std::vector<KBucket> kbuckets_;
+  /** Index of the k-bucket holding each contact */
+  KBucketIndexById kbucket_index_by_id_;
+  /** Public keys given by SetPublicKey, kept apart from the k-buckets as they
+   *  are rarely set */
+  std::unordered_map<NodeId, std::string, NodeIdHash> public_keys_;
+  /** Replacement caches, indexed as kbuckets_ */
+  std::vector<ReplacementCache> replacement_caches_;
+  /** Time at which each k-bucket last heard from one of its contacts, indexed
+   *  as kbuckets_ */
+  std::vector<bptime::ptime> kbucket_last_activity_;
   /** Container of all un-validated contacts */
   UnValidatedContactsContainer unvalidated_contacts_;
   /** Signal to be fired when k-bucket is full and cannot be split.  In signal
@@ -500,8 +533,11 @@ class RoutingTable {
    *  the down contact twice (once to represent the notifier's failed attempt to
    *  reach the node). */
   PingDownContactPtr ping_down_contact_;
-  /** Thread safe mutex lock */
+  /** Thread safe mutex lock, serialising writers */
   boost::shared_mutex shared_mutex_;
+  /** View of the k-buckets read by GetCloseContacts, GetBootstrapContacts and
+   *  GetAllContacts.  Only accessed via std::atomic_load / std::atomic_store */
+  RoutingTableSnapshotPtr snapshot_;
   /** The index to the bucket that the holder shall sit in
    *  It shall always be the value that 1 greater than the brother bucket */
   uint16_t bucket_of_holder_;
@@ -42,6 +42,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "maidsafe/dht/node_id.h"
 #include "maidsafe/dht/message_handler.h"
+#include "maidsafe/dht/session_cache.h"
 #ifdef __MSVC__
 #  pragma warning(push)
 #  pragma warning(disable: 4127 4244 4267)
@@ -72,16 +73,19 @@ typedef std::function<void(RankInfoPtr,
                            const int&,
                            const std::vector<ValueAndSignature>&,
                            const std::vector<Contact>&,
-                           const Contact&)> RpcFindValueFunctor;
+                           const Contact&,
+                           const asymm::Identity&)> RpcFindValueFunctor;
 typedef std::function<void(RankInfoPtr,
                            const int&,
                            const std::vector<Contact>&)> RpcFindNodesFunctor;
 
 struct RpcsFailurePeer {
  public:
-  RpcsFailurePeer() : peer(), rpcs_failure(1) {}
+  RpcsFailurePeer() : peer(), rpcs_failure(1), send_time() {}
   Contact peer;
   uint16_t rpcs_failure;
+  // time at which the latest attempt of the RPC was sent
+  boost::posix_time::ptime send_time;
 };
 
 template <typename TransportType>
@@ -92,7 +96,8 @@ class Rpcs {
             kFailureTolerance_(2),
             contact_(),
             default_private_key_(private_key),
-            connected_objects_() {}
+            connected_objects_(),
+            session_cache_() {}
   virtual ~Rpcs() {}
   virtual void Ping(PrivateKeyPtr private_key,
                     const Contact &peer,
@@ -135,7 +140,39 @@ class Rpcs {
   virtual void Downlist(const std::vector<NodeId> &node_ids,
                         PrivateKeyPtr private_key,
                         const Contact &peer);
+  virtual void StoreCache(
+      const Key &key,
+      const std::vector<ValueAndSignature> &values_and_signatures,
+      const asymm::Identity &signer_public_key_id,
+      const boost::posix_time::seconds &ttl,
+      PrivateKeyPtr private_key,
+      const Contact &peer);
+  // The batched RPCs below carry several keys to one peer in a single message.
+  // callbacks[i] is invoked with the result for the ith key exactly as if it
+  // were the callback of the corresponding single-key RPC.
+  virtual void FindValueBatch(const std::vector<Key> &keys,
+                              const uint16_t &nodes_requested,
+                              PrivateKeyPtr private_key,
+                              const Contact &peer,
+                              std::vector<RpcFindValueFunctor> callbacks);
+  virtual void FindNodesBatch(const std::vector<Key> &keys,
+                              const uint16_t &nodes_requested,
+                              PrivateKeyPtr private_key,
+                              const Contact &peer,
+                              std::vector<RpcFindNodesFunctor> callbacks);
+  // Each of store_requests is a serialised store request and its signature as
+  // made by MakeStoreRequestAndSignature.  The batch itself isn't signed, so
+  // the same store requests may be sent to each peer without signing again.
+  virtual void StoreBatch(
+      const std::vector<std::pair<std::string, std::string>> &store_requests,
+      PrivateKeyPtr private_key,
+      const Contact &peer,
+      std::vector<RpcStoreFunctor> callbacks);
   void set_contact(const Contact &contact) { contact_ = contact; }
+  // Once set, unsigned requests are encrypted under cached session keys.
+  void set_session_cache(std::shared_ptr<SessionCache> session_cache) {
+    session_cache_ = session_cache;
+  }
 
   virtual void Prepare(PrivateKeyPtr private_key,
                        TransportPtr &transport,
@@ -161,6 +198,16 @@ class Rpcs {
  private:
   Rpcs(const Rpcs&);
   Rpcs& operator=(const Rpcs&);
+  // Returns a copy of info, with rtt set to the time since the latest attempt
+  // of the RPC was sent if the transport hasn't measured it.
+  RankInfoPtr RankInfo(const transport::Info &info,
+                       std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer);
+  // Sends the RPC held at index again after a failed attempt.  A request sent
+  // under a session is resent asymmetrically encrypted instead, in case the
+  // peer can't read session messages.
+  void Resend(const uint32_t &index,
+              const std::string &message,
+              std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer);
   void PingCallback(const std::string &random_data,
                     const transport::TransportCondition &transport_condition,
                     const transport::Info &info,
@@ -188,6 +235,15 @@ class Rpcs {
       const std::string &message,
       std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer);
 
+  // Pass the contents of a response received from peer to callback.
+  void HandleFindValueResponse(const protobuf::FindValueResponse &response,
+                               RankInfoPtr rank_info,
+                               const Contact &peer,
+                               RpcFindValueFunctor callback);
+  void HandleFindNodesResponse(const protobuf::FindNodesResponse &response,
+                               RankInfoPtr rank_info,
+                               RpcFindNodesFunctor callback);
+
   void StoreCallback(const transport::TransportCondition &transport_condition,
                      const transport::Info &info,
                      const protobuf::StoreResponse &response,
@@ -222,9 +278,37 @@ class Rpcs {
       const std::string &message,
       std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer);
 
+  void FindValueBatchCallback(
+      const transport::TransportCondition &transport_condition,
+      const transport::Info &info,
+      const protobuf::FindValueBatchResponse &response,
+      const uint32_t &index,
+      std::vector<RpcFindValueFunctor> callbacks,
+      const std::string &message,
+      std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer);
+
+  void FindNodesBatchCallback(
+      const transport::TransportCondition &transport_condition,
+      const transport::Info &info,
+      const protobuf::FindNodesBatchResponse &response,
+      const uint32_t &index,
+      std::vector<RpcFindNodesFunctor> callbacks,
+      const std::string &message,
+      std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer);
+
+  void StoreBatchCallback(
+      const transport::TransportCondition &transport_condition,
+      const transport::Info &info,
+      const protobuf::StoreBatchResponse &response,
+      const uint32_t &index,
+      std::vector<RpcStoreFunctor> callbacks,
+      const std::string &message,
+      std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer);
+
   Contact contact_;
   PrivateKeyPtr default_private_key_;
   ConnectedObjectsList connected_objects_;
+  std::shared_ptr<SessionCache> session_cache_;
 };
 
 
@@ -257,6 +341,8 @@ void Rpcs<TransportType>::Ping(PrivateKeyPtr private_key,
                 transport::Info(), protobuf::PingResponse(), object_indx,
                 callback, message, rpcs_failure_peer));
   DLOG(INFO) << "\t2 " << DebugId(contact_) << " PING to " << DebugId(peer);
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
   transport->Send(message,
                   peer.PreferredEndpoint(),
                   transport::kDefaultInitialTimeout);
@@ -292,6 +378,8 @@ void Rpcs<TransportType>::FindValue(const Key &key,
       protobuf::FindValueResponse(), object_indx, callback, message,
       rpcs_failure_peer));
   DLOG(INFO) << "\t" << DebugId(contact_) << " FIND_VALUE to " << DebugId(peer);
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
   transport->Send(message, peer.PreferredEndpoint(),
                   transport::kDefaultInitialTimeout);
 }
@@ -326,6 +414,8 @@ void Rpcs<TransportType>::FindNodes(const Key &key,
       protobuf::FindNodesResponse(), object_indx, callback, message,
       rpcs_failure_peer));
   DLOG(INFO) << "\t" << DebugId(contact_) << " FIND_NODES to " << DebugId(peer);
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
   transport->Send(message, peer.PreferredEndpoint(),
                   transport::kDefaultInitialTimeout);
 }
@@ -365,6 +455,8 @@ void Rpcs<TransportType>::Store(const Key &key,
       protobuf::StoreResponse(), object_indx, callback, message,
       rpcs_failure_peer));
   DLOG(INFO) << "\t" << DebugId(contact_) << " STORE to " << DebugId(peer);
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
   transport->Send(message, peer.PreferredEndpoint(),
                   transport::kDefaultInitialTimeout);
 }
@@ -402,6 +494,8 @@ void Rpcs<TransportType>::StoreRefresh(
       rpcs_failure_peer));
   DLOG(INFO) << "\t" << DebugId(contact_) << " STORE_REFRESH to "
              << DebugId(peer);
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
   transport->Send(message, peer.PreferredEndpoint(),
                   transport::kDefaultInitialTimeout);
 }
@@ -439,6 +533,8 @@ void Rpcs<TransportType>::Delete(const Key &key,
       protobuf::DeleteResponse(), object_indx, callback, message,
       rpcs_failure_peer));
   DLOG(INFO) << "\t" << DebugId(contact_) << " DELETE to " << DebugId(peer);
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
   transport->Send(message, peer.PreferredEndpoint(),
                   transport::kDefaultInitialTimeout);
 }
@@ -476,6 +572,8 @@ void Rpcs<TransportType>::DeleteRefresh(
       rpcs_failure_peer));
   DLOG(INFO) << "\t" << DebugId(contact_) << " DELETE_REFRESH to "
              << DebugId(peer);
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
   transport->Send(message, peer.PreferredEndpoint(),
                   transport::kDefaultInitialTimeout);
 }
@@ -505,6 +603,186 @@ void Rpcs<TransportType>::Downlist(const std::vector<NodeId> &node_ids,
                   transport::kDefaultInitialTimeout);
 }
 
+template <typename TransportType>
+void Rpcs<TransportType>::StoreCache(
+    const Key &key,
+    const std::vector<ValueAndSignature> &values_and_signatures,
+    const asymm::Identity &signer_public_key_id,
+    const boost::posix_time::seconds &ttl,
+    PrivateKeyPtr private_key,
+    const Contact &peer) {
+  TransportPtr transport;
+  MessageHandlerPtr message_handler;
+  Prepare(private_key, transport, message_handler);
+  connected_objects_.AddObject(transport, message_handler);
+  protobuf::StoreCacheNotification notification;
+  *notification.mutable_sender() = ToProtobuf(contact_);
+  notification.set_key(key.String());
+  for (size_t i = 0; i < values_and_signatures.size(); ++i) {
+    protobuf::SignedValue *signed_value = notification.add_signed_values();
+    signed_value->set_value(values_and_signatures[i].first);
+    signed_value->set_signature(values_and_signatures[i].second);
+  }
+  notification.set_ttl(ttl.total_seconds());
+  notification.set_signer_public_key_id(signer_public_key_id);
+  std::string message = message_handler->WrapMessage(notification,
+                                                     peer.public_key());
+  DLOG(INFO) << "\t" << DebugId(contact_) << " STORE_CACHE to "
+             << DebugId(peer);
+  transport->Send(message,
+                  peer.PreferredEndpoint(),
+                  transport::kDefaultInitialTimeout);
+}
+
+template <typename TransportType>
+void Rpcs<TransportType>::FindValueBatch(
+    const std::vector<Key> &keys,
+    const uint16_t &nodes_requested,
+    PrivateKeyPtr private_key,
+    const Contact &peer,
+    std::vector<RpcFindValueFunctor> callbacks) {
+  TransportPtr transport;
+  MessageHandlerPtr message_handler;
+  Prepare(private_key, transport, message_handler);
+  uint32_t object_indx =
+      connected_objects_.AddObject(transport, message_handler);
+
+  protobuf::FindValueBatchRequest request;
+  *request.mutable_sender() = ToProtobuf(contact_);
+  for (size_t i = 0; i < keys.size(); ++i)
+    request.add_keys(keys[i].String());
+  request.set_num_nodes_requested(nodes_requested);
+  std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer(new RpcsFailurePeer);
+  rpcs_failure_peer->peer = peer;
+
+  std::string message =
+      message_handler->WrapMessage(request, peer.public_key());
+  // Connect callback to message handler for incoming parsed response or error
+  message_handler->on_find_value_batch_response()->connect(std::bind(
+      &Rpcs::FindValueBatchCallback, this, transport::kSuccess, args::_1,
+      args::_2, object_indx, callbacks, message, rpcs_failure_peer));
+  message_handler->on_error()->connect(std::bind(
+      &Rpcs::FindValueBatchCallback, this, args::_1, transport::Info(),
+      protobuf::FindValueBatchResponse(), object_indx, callbacks, message,
+      rpcs_failure_peer));
+  DLOG(INFO) << "\t" << DebugId(contact_) << " FIND_VALUE_BATCH ("
+             << keys.size() << " keys) to " << DebugId(peer);
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
+  transport->Send(message, peer.PreferredEndpoint(),
+                  transport::kDefaultInitialTimeout);
+}
+
+template <typename TransportType>
+void Rpcs<TransportType>::FindNodesBatch(
+    const std::vector<Key> &keys,
+    const uint16_t &nodes_requested,
+    PrivateKeyPtr private_key,
+    const Contact &peer,
+    std::vector<RpcFindNodesFunctor> callbacks) {
+  TransportPtr transport;
+  MessageHandlerPtr message_handler;
+  Prepare(private_key, transport, message_handler);
+  uint32_t object_indx =
+      connected_objects_.AddObject(transport, message_handler);
+
+  protobuf::FindNodesBatchRequest request;
+  *request.mutable_sender() = ToProtobuf(contact_);
+  for (size_t i = 0; i < keys.size(); ++i)
+    request.add_keys(keys[i].String());
+  request.set_num_nodes_requested(nodes_requested);
+  std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer(new RpcsFailurePeer);
+  rpcs_failure_peer->peer = peer;
+
+  std::string message =
+      message_handler->WrapMessage(request, peer.public_key());
+  // Connect callback to message handler for incoming parsed response or error
+  message_handler->on_find_nodes_batch_response()->connect(std::bind(
+      &Rpcs::FindNodesBatchCallback, this, transport::kSuccess, args::_1,
+      args::_2, object_indx, callbacks, message, rpcs_failure_peer));
+  message_handler->on_error()->connect(std::bind(
+      &Rpcs::FindNodesBatchCallback, this, args::_1, transport::Info(),
+      protobuf::FindNodesBatchResponse(), object_indx, callbacks, message,
+      rpcs_failure_peer));
+  DLOG(INFO) << "\t" << DebugId(contact_) << " FIND_NODES_BATCH ("
+             << keys.size() << " keys) to " << DebugId(peer);
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
+  transport->Send(message, peer.PreferredEndpoint(),
+                  transport::kDefaultInitialTimeout);
+}
+
+template <typename TransportType>
+void Rpcs<TransportType>::StoreBatch(
+    const std::vector<std::pair<std::string, std::string>> &store_requests,
+    PrivateKeyPtr private_key,
+    const Contact &peer,
+    std::vector<RpcStoreFunctor> callbacks) {
+  TransportPtr transport;
+  MessageHandlerPtr message_handler;
+  Prepare(private_key, transport, message_handler);
+  uint32_t object_indx =
+      connected_objects_.AddObject(transport, message_handler);
+
+  protobuf::StoreBatchRequest request;
+  *request.mutable_sender() = ToProtobuf(contact_);
+  for (size_t i = 0; i < store_requests.size(); ++i) {
+    request.add_serialised_store_requests(store_requests[i].first);
+    request.add_serialised_store_request_signatures(store_requests[i].second);
+  }
+  std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer(new RpcsFailurePeer);
+  rpcs_failure_peer->peer = peer;
+
+  std::string message =
+      message_handler->WrapMessage(request, peer.public_key());
+  // Connect callback to message handler for incoming parsed response or error
+  message_handler->on_store_batch_response()->connect(std::bind(
+      &Rpcs::StoreBatchCallback, this, transport::kSuccess, args::_1,
+      args::_2, object_indx, callbacks, message, rpcs_failure_peer));
+  message_handler->on_error()->connect(std::bind(
+      &Rpcs::StoreBatchCallback, this, args::_1, transport::Info(),
+      protobuf::StoreBatchResponse(), object_indx, callbacks, message,
+      rpcs_failure_peer));
+  DLOG(INFO) << "\t" << DebugId(contact_) << " STORE_BATCH ("
+             << store_requests.size() << " keys) to " << DebugId(peer);
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
+  transport->Send(message, peer.PreferredEndpoint(),
+                  transport::kDefaultInitialTimeout);
+}
+
+template <typename TransportType>
+RankInfoPtr Rpcs<TransportType>::RankInfo(
+    const transport::Info &info,
+    std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
+  RankInfoPtr rank_info(new transport::Info(info));
+  if (rank_info->rtt == 0 &&
+      !rpcs_failure_peer->send_time.is_not_a_date_time()) {
+    rank_info->rtt = static_cast<uint32_t>(
+        (boost::posix_time::microsec_clock::universal_time() -
+         rpcs_failure_peer->send_time).total_milliseconds());
+  }
+  return rank_info;
+}
+
+template <typename TransportType>
+void Rpcs<TransportType>::Resend(
+    const uint32_t &index,
+    const std::string &message,
+    std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
+  ++(rpcs_failure_peer->rpcs_failure);
+  TransportPtr transport = connected_objects_.GetTransport(index);
+  MessageHandlerPtr message_handler =
+      connected_objects_.GetMessageHandler(index);
+  std::string fallback_message(
+      message_handler ? message_handler->WrapSessionFallback() : "");
+  rpcs_failure_peer->send_time =
+      boost::posix_time::microsec_clock::universal_time();
+  transport->Send(fallback_message.empty() ? message : fallback_message,
+                  rpcs_failure_peer->peer.PreferredEndpoint(),
+                  transport::kDefaultInitialTimeout);
+}
+
 template <typename TransportType>
 void Rpcs<TransportType>::PingCallback(
     const std::string &random_data,
@@ -519,21 +797,17 @@ void Rpcs<TransportType>::PingCallback(
              << DebugId(rpcs_failure_peer->peer);
   if ((transport_condition != transport::kSuccess) &&
       (rpcs_failure_peer->rpcs_failure < kFailureTolerance_)) {
-    ++(rpcs_failure_peer->rpcs_failure);
-    TransportPtr transport = connected_objects_.GetTransport(index);
-    transport->Send(message,
-                    rpcs_failure_peer->peer.PreferredEndpoint(),
-                    transport::kDefaultInitialTimeout);
+    Resend(index, message, rpcs_failure_peer);
   } else {
     connected_objects_.RemoveObject(index);
     if (transport_condition != transport::kSuccess) {
-      callback(RankInfoPtr(new transport::Info(info)), transport_condition);
+      callback(RankInfo(info, rpcs_failure_peer), transport_condition);
       return;
     }
     if (response.IsInitialized() && response.echo() == random_data) {
-      callback(RankInfoPtr(new transport::Info(info)), transport::kSuccess);
+      callback(RankInfo(info, rpcs_failure_peer), transport::kSuccess);
     } else {
-      callback(RankInfoPtr(new transport::Info(info)), transport::kError);
+      callback(RankInfo(info, rpcs_failure_peer), transport::kError);
     }
   }
 }
@@ -549,64 +823,69 @@ void Rpcs<TransportType>::FindValueCallback(
     std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
   if ((transport_condition != transport::kSuccess) &&
     (rpcs_failure_peer->rpcs_failure < kFailureTolerance_)) {
-    ++(rpcs_failure_peer->rpcs_failure);
-    TransportPtr transport = connected_objects_.GetTransport(index);
-    transport->Send(
-        message, rpcs_failure_peer->peer.PreferredEndpoint(),
-        transport::kDefaultInitialTimeout);
+    Resend(index, message, rpcs_failure_peer);
   } else {
     connected_objects_.RemoveObject(index);
-
-    std::vector<ValueAndSignature> values_and_signatures;
-    std::vector<Contact> contacts;
-    Contact cached_copy_holder;
-
     if (transport_condition != transport::kSuccess) {
-      callback(RankInfoPtr(new transport::Info(info)), transport_condition,
-               values_and_signatures, contacts, cached_copy_holder);
-      return;
-    }
-    if (!response.IsInitialized() || !response.result()) {
-      callback(RankInfoPtr(new transport::Info(info)), transport::kError,
-               values_and_signatures, contacts, cached_copy_holder);
+      callback(RankInfo(info, rpcs_failure_peer), transport_condition,
+               std::vector<ValueAndSignature>(), std::vector<Contact>(),
+               Contact(), asymm::Identity());
       return;
     }
+    HandleFindValueResponse(response, RankInfo(info, rpcs_failure_peer),
+                            rpcs_failure_peer->peer, callback);
+  }
+}
 
-    if (response.has_cached_copy_holder()) {
-      cached_copy_holder = FromProtobuf(response.cached_copy_holder());
-      callback(RankInfoPtr(new transport::Info(info)),
-               kFoundCachedCopyHolder, values_and_signatures, contacts,
-               cached_copy_holder);
-      return;
-    }
+template <typename TransportType>
+void Rpcs<TransportType>::HandleFindValueResponse(
+    const protobuf::FindValueResponse &response,
+    RankInfoPtr rank_info,
+    const Contact &peer,
+    RpcFindValueFunctor callback) {
+  std::vector<ValueAndSignature> values_and_signatures;
+  std::vector<Contact> contacts;
+  Contact cached_copy_holder;
+
+  if (!response.IsInitialized() || !response.result()) {
+    callback(rank_info, transport::kError, values_and_signatures, contacts,
+             cached_copy_holder, asymm::Identity());
+    return;
+  }
 
-    if (response.signed_values_size() != 0) {
-      for (int i = 0; i < response.signed_values_size(); ++i) {
-        values_and_signatures.push_back(
-            std::make_pair(response.signed_values(i).value(),
-                           response.signed_values(i).signature()));
-      }
-      DLOG(INFO) << "\t" << DebugId(contact_) << " FIND_VALUE response from "
-                 << DebugId(rpcs_failure_peer->peer) << " found "
-                 << values_and_signatures.size() << " values.";
-      callback(RankInfoPtr(new transport::Info(info)), kSuccess,
-               values_and_signatures, contacts, cached_copy_holder);
-      return;
-    }
+  if (response.has_cached_copy_holder()) {
+    cached_copy_holder = FromProtobuf(response.cached_copy_holder());
+    callback(rank_info, kFoundCachedCopyHolder, values_and_signatures,
+             contacts, cached_copy_holder, asymm::Identity());
+    return;
+  }
 
-    if (response.closest_nodes_size() != 0) {
-      for (int i = 0; i < response.closest_nodes_size(); ++i)
-        contacts.push_back(FromProtobuf(response.closest_nodes(i)));
-      DLOG(INFO) << "\t" << DebugId(contact_) << " FIND_VALUE response from "
-                 << DebugId(rpcs_failure_peer->peer) << " found "
-                 << contacts.size() << " contacts.";
-      callback(RankInfoPtr(new transport::Info(info)), kFailedToFindValue,
-               values_and_signatures, contacts, cached_copy_holder);
-      return;
+  if (response.signed_values_size() != 0) {
+    for (int i = 0; i < response.signed_values_size(); ++i) {
+      values_and_signatures.push_back(
+          std::make_pair(response.signed_values(i).value(),
+                         response.signed_values(i).signature()));
     }
-    callback(RankInfoPtr(new transport::Info(info)), kIterativeLookupFailed,
-             values_and_signatures, contacts, cached_copy_holder);
+    DLOG(INFO) << "\t" << DebugId(contact_) << " FIND_VALUE response from "
+               << DebugId(peer) << " found " << values_and_signatures.size()
+               << " values.";
+    callback(rank_info, kSuccess, values_and_signatures, contacts,
+             cached_copy_holder, response.signer_public_key_id());
+    return;
+  }
+
+  if (response.closest_nodes_size() != 0) {
+    for (int i = 0; i < response.closest_nodes_size(); ++i)
+      contacts.push_back(FromProtobuf(response.closest_nodes(i)));
+    DLOG(INFO) << "\t" << DebugId(contact_) << " FIND_VALUE response from "
+               << DebugId(peer) << " found " << contacts.size()
+               << " contacts.";
+    callback(rank_info, kFailedToFindValue, values_and_signatures, contacts,
+             cached_copy_holder, asymm::Identity());
+    return;
   }
+  callback(rank_info, kIterativeLookupFailed, values_and_signatures, contacts,
+           cached_copy_holder, asymm::Identity());
 }
 
 template <typename TransportType>
@@ -620,35 +899,37 @@ void Rpcs<TransportType>::FindNodesCallback(
     std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
   if ((transport_condition != transport::kSuccess) &&
       (rpcs_failure_peer->rpcs_failure < kFailureTolerance_)) {
-    ++(rpcs_failure_peer->rpcs_failure);
-    TransportPtr transport = connected_objects_.GetTransport(index);
-    transport->Send(
-        message, rpcs_failure_peer->peer.PreferredEndpoint(),
-        transport::kDefaultInitialTimeout);
+    Resend(index, message, rpcs_failure_peer);
   } else {
     connected_objects_.RemoveObject(index);
-    std::vector<Contact> contacts;
     if (transport_condition != transport::kSuccess) {
-      callback(RankInfoPtr(new transport::Info(info)), transport_condition,
-               contacts);
-      return;
-    }
-    if (!response.IsInitialized() || !response.result()) {
-      callback(RankInfoPtr(new transport::Info(info)), transport::kError,
-               contacts);
+      callback(RankInfo(info, rpcs_failure_peer), transport_condition,
+               std::vector<Contact>());
       return;
     }
+    HandleFindNodesResponse(response, RankInfo(info, rpcs_failure_peer),
+                            callback);
+  }
+}
 
-    if (response.closest_nodes_size() != 0) {
-      for (int i = 0; i < response.closest_nodes_size(); ++i)
-        contacts.push_back(FromProtobuf(response.closest_nodes(i)));
-      callback(RankInfoPtr(new transport::Info(info)), transport::kSuccess,
-               contacts);
-      return;
-    }
-    callback(RankInfoPtr(new transport::Info(info)), kIterativeLookupFailed,
-             contacts);
+template <typename TransportType>
+void Rpcs<TransportType>::HandleFindNodesResponse(
+    const protobuf::FindNodesResponse &response,
+    RankInfoPtr rank_info,
+    RpcFindNodesFunctor callback) {
+  std::vector<Contact> contacts;
+  if (!response.IsInitialized() || !response.result()) {
+    callback(rank_info, transport::kError, contacts);
+    return;
   }
+
+  if (response.closest_nodes_size() != 0) {
+    for (int i = 0; i < response.closest_nodes_size(); ++i)
+      contacts.push_back(FromProtobuf(response.closest_nodes(i)));
+    callback(rank_info, transport::kSuccess, contacts);
+    return;
+  }
+  callback(rank_info, kIterativeLookupFailed, contacts);
 }
 
 template <typename TransportType>
@@ -662,21 +943,17 @@ void Rpcs<TransportType>::StoreCallback(
     std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
   if ((transport_condition != transport::kSuccess) &&
       (rpcs_failure_peer->rpcs_failure < kFailureTolerance_)) {
-    ++(rpcs_failure_peer->rpcs_failure);
-    TransportPtr transport = connected_objects_.GetTransport(index);
-    transport->Send(
-        message, rpcs_failure_peer->peer.PreferredEndpoint(),
-        transport::kDefaultInitialTimeout);
+    Resend(index, message, rpcs_failure_peer);
   } else {
     connected_objects_.RemoveObject(index);
     if (transport_condition != transport::kSuccess) {
-      callback(RankInfoPtr(new transport::Info(info)), transport_condition);
+      callback(RankInfo(info, rpcs_failure_peer), transport_condition);
       return;
     }
     if (response.IsInitialized() && response.result())
-      callback(RankInfoPtr(new transport::Info(info)), transport::kSuccess);
+      callback(RankInfo(info, rpcs_failure_peer), transport::kSuccess);
     else
-      callback(RankInfoPtr(new transport::Info(info)), transport::kError);
+      callback(RankInfo(info, rpcs_failure_peer), transport::kError);
   }
 }
 
@@ -691,21 +968,17 @@ void Rpcs<TransportType>::StoreRefreshCallback(
     std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
   if ((transport_condition != transport::kSuccess) &&
       (rpcs_failure_peer->rpcs_failure < kFailureTolerance_)) {
-    ++(rpcs_failure_peer->rpcs_failure);
-    TransportPtr transport = connected_objects_.GetTransport(index);
-    transport->Send(
-        message, rpcs_failure_peer->peer.PreferredEndpoint(),
-        transport::kDefaultInitialTimeout);
+    Resend(index, message, rpcs_failure_peer);
   } else {
     connected_objects_.RemoveObject(index);
     if (transport_condition != transport::kSuccess) {
-      callback(RankInfoPtr(new transport::Info(info)), transport_condition);
+      callback(RankInfo(info, rpcs_failure_peer), transport_condition);
       return;
     }
     if (response.IsInitialized() && response.result())
-      callback(RankInfoPtr(new transport::Info(info)), transport::kSuccess);
+      callback(RankInfo(info, rpcs_failure_peer), transport::kSuccess);
     else
-      callback(RankInfoPtr(new transport::Info(info)), transport::kError);
+      callback(RankInfo(info, rpcs_failure_peer), transport::kError);
   }
 }
 
@@ -720,21 +993,17 @@ void Rpcs<TransportType>::DeleteCallback(
     std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
   if ((transport_condition != transport::kSuccess) &&
       (rpcs_failure_peer->rpcs_failure < kFailureTolerance_)) {
-    ++(rpcs_failure_peer->rpcs_failure);
-    TransportPtr transport = connected_objects_.GetTransport(index);
-    transport->Send(
-        message, rpcs_failure_peer->peer.PreferredEndpoint(),
-        transport::kDefaultInitialTimeout);
+    Resend(index, message, rpcs_failure_peer);
   } else {
     connected_objects_.RemoveObject(index);
     if (transport_condition != transport::kSuccess) {
-      callback(RankInfoPtr(new transport::Info(info)), transport_condition);
+      callback(RankInfo(info, rpcs_failure_peer), transport_condition);
       return;
     }
     if (response.IsInitialized() && response.result())
-      callback(RankInfoPtr(new transport::Info(info)), transport::kSuccess);
+      callback(RankInfo(info, rpcs_failure_peer), transport::kSuccess);
     else
-      callback(RankInfoPtr(new transport::Info(info)), transport::kError);
+      callback(RankInfo(info, rpcs_failure_peer), transport::kError);
   }
 }
 
@@ -749,21 +1018,106 @@ void Rpcs<TransportType>::DeleteRefreshCallback(
     std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
   if ((transport_condition != transport::kSuccess) &&
       (rpcs_failure_peer->rpcs_failure < kFailureTolerance_)) {
-    ++(rpcs_failure_peer->rpcs_failure);
-    TransportPtr transport = connected_objects_.GetTransport(index);
-    transport->Send(
-        message, rpcs_failure_peer->peer.PreferredEndpoint(),
-        transport::kDefaultInitialTimeout);
+    Resend(index, message, rpcs_failure_peer);
   } else {
     connected_objects_.RemoveObject(index);
     if (transport_condition != transport::kSuccess) {
-      callback(RankInfoPtr(new transport::Info(info)), transport_condition);
+      callback(RankInfo(info, rpcs_failure_peer), transport_condition);
       return;
     }
     if (response.IsInitialized() && response.result())
-      callback(RankInfoPtr(new transport::Info(info)), transport::kSuccess);
+      callback(RankInfo(info, rpcs_failure_peer), transport::kSuccess);
     else
-      callback(RankInfoPtr(new transport::Info(info)), transport::kError);
+      callback(RankInfo(info, rpcs_failure_peer), transport::kError);
+  }
+}
+
+template <typename TransportType>
+void Rpcs<TransportType>::FindValueBatchCallback(
+    const transport::TransportCondition &transport_condition,
+    const transport::Info &info,
+    const protobuf::FindValueBatchResponse &response,
+    const uint32_t &index,
+    std::vector<RpcFindValueFunctor> callbacks,
+    const std::string &message,
+    std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
+  if ((transport_condition != transport::kSuccess) &&
+      (rpcs_failure_peer->rpcs_failure < kFailureTolerance_)) {
+    Resend(index, message, rpcs_failure_peer);
+  } else {
+    connected_objects_.RemoveObject(index);
+    RankInfoPtr rank_info(RankInfo(info, rpcs_failure_peer));
+    bool valid(response.IsInitialized() && response.result() &&
+               response.responses_size() == static_cast<int>(callbacks.size()));
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+      if (transport_condition != transport::kSuccess) {
+        callbacks[i](rank_info, transport_condition,
+                     std::vector<ValueAndSignature>(), std::vector<Contact>(),
+                     Contact(), asymm::Identity());
+      } else {
+        HandleFindValueResponse(valid ? response.responses(i) :
+                                        protobuf::FindValueResponse(),
+                                rank_info, rpcs_failure_peer->peer,
+                                callbacks[i]);
+      }
+    }
+  }
+}
+
+template <typename TransportType>
+void Rpcs<TransportType>::FindNodesBatchCallback(
+    const transport::TransportCondition &transport_condition,
+    const transport::Info &info,
+    const protobuf::FindNodesBatchResponse &response,
+    const uint32_t &index,
+    std::vector<RpcFindNodesFunctor> callbacks,
+    const std::string &message,
+    std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
+  if ((transport_condition != transport::kSuccess) &&
+      (rpcs_failure_peer->rpcs_failure < kFailureTolerance_)) {
+    Resend(index, message, rpcs_failure_peer);
+  } else {
+    connected_objects_.RemoveObject(index);
+    RankInfoPtr rank_info(RankInfo(info, rpcs_failure_peer));
+    bool valid(response.IsInitialized() && response.result() &&
+               response.responses_size() == static_cast<int>(callbacks.size()));
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+      if (transport_condition != transport::kSuccess) {
+        callbacks[i](rank_info, transport_condition, std::vector<Contact>());
+      } else {
+        HandleFindNodesResponse(valid ? response.responses(i) :
+                                        protobuf::FindNodesResponse(),
+                                rank_info, callbacks[i]);
+      }
+    }
+  }
+}
+
+template <typename TransportType>
+void Rpcs<TransportType>::StoreBatchCallback(
+    const transport::TransportCondition &transport_condition,
+    const transport::Info &info,
+    const protobuf::StoreBatchResponse &response,
+    const uint32_t &index,
+    std::vector<RpcStoreFunctor> callbacks,
+    const std::string &message,
+    std::shared_ptr<RpcsFailurePeer> rpcs_failure_peer) {
+  if ((transport_condition != transport::kSuccess) &&
+      (rpcs_failure_peer->rpcs_failure < kFailureTolerance_)) {
+    Resend(index, message, rpcs_failure_peer);
+  } else {
+    connected_objects_.RemoveObject(index);
+    RankInfoPtr rank_info(RankInfo(info, rpcs_failure_peer));
+    bool valid(response.IsInitialized() && response.result() &&
+               response.responses_size() == static_cast<int>(callbacks.size()));
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+      if (transport_condition != transport::kSuccess)
+        callbacks[i](rank_info, transport_condition);
+      else if (valid && response.responses(i).result())
+        callbacks[i](rank_info, transport::kSuccess);
+      else
+        callbacks[i](rank_info, transport::kError);
+    }
   }
 }
 
@@ -771,9 +1125,15 @@ template <typename TransportType>
 void Rpcs<TransportType>::Prepare(PrivateKeyPtr private_key,
                                   TransportPtr &transport,
                                   MessageHandlerPtr &message_handler) {
+  // TODO(Team#5#): 2026-10-18 - Each RPC gets a new transport and so a new
+  //                connection.  Keeping per-peer connections open and
+  //                multiplexing RPCs over them needs a transport which holds
+  //                its connection and request IDs in the message framing.
   transport.reset(new TransportType(asio_service_));
   message_handler.reset(new MessageHandler(private_key ? private_key :
                                                         default_private_key_));
+  if (session_cache_)
+    message_handler->set_session_cache(session_cache_);
   // Connect message handler to transport for incoming raw messages
   transport->on_message_received()->connect(
       transport::OnMessageReceived::element_type::slot_type(
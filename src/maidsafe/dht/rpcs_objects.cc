@@ -76,6 +76,16 @@ TransportPtr ConnectedObjectsList::GetTransport(uint32_t index) {
   return (*it).transport_ptr;
 }
 
+MessageHandlerPtr ConnectedObjectsList::GetMessageHandler(uint32_t index) {
+  SharedLock shared_lock(shared_mutex_);
+  ConnectedObjectsContainer::index<TagIndexId>::type& index_by_index_id =
+      objects_container_->get<TagIndexId>();
+  auto it = index_by_index_id.find(index);
+  if (it == index_by_index_id.end())
+    return MessageHandlerPtr();
+  return (*it).message_handler_ptr;
+}
+
 size_t ConnectedObjectsList::Size() {
   SharedLock shared_lock(shared_mutex_);
   return objects_container_->size();
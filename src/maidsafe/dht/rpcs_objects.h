@@ -106,6 +106,9 @@ class ConnectedObjectsList  {
   // Return the TransportPtr of the index
   TransportPtr GetTransport(uint32_t index);
 
+  // Return the MessageHandlerPtr of the index
+  MessageHandlerPtr GetMessageHandler(uint32_t index);
+
   // Returns the size of the connected objects MI
   size_t Size();
 
@@ -64,30 +64,9 @@ bool SenderTask::AddTask(const KeyValueSignature &key_value_signature,
                          const asymm::Identity &public_key_id,
                          TaskCallback ops_callback,
                          bool *is_new_id) {
-  if (key_value_signature.key.empty()) {
-    DLOG(WARNING) << "Empty key.";
-    return false;
-  }
-  if (key_value_signature.value.empty()) {
-    DLOG(WARNING) << "Empty value.";
-    return false;
-  }
-  if (key_value_signature.signature.empty()) {
-    DLOG(WARNING) << "Empty signature.";
-    return false;
-  }
-  if (public_key_id.empty()) {
-    DLOG(WARNING) << "Empty public_key_id.";
+  if (!IsValidTask(key_value_signature, request_signature, public_key_id,
+                   ops_callback))
     return false;
-  }
-  if (request_signature.first.empty()) {
-    DLOG(WARNING) << "Empty request.";
-    return false;
-  }
-  if (!ops_callback) {
-    DLOG(WARNING) << "Invalid callback.";
-    return false;
-  }
 
   Task task(key_value_signature, info, request_signature, public_key_id,
             ops_callback);
@@ -116,6 +95,72 @@ bool SenderTask::AddTask(const KeyValueSignature &key_value_signature,
   return itr_return.second;
 }
 
+bool SenderTask::RunTask(const KeyValueSignature &key_value_signature,
+                         const transport::Info &info,
+                         const RequestAndSignature &request_signature,
+                         const asymm::Identity &public_key_id,
+                         TaskCallback ops_callback,
+                         const asymm::PublicKey &public_key,
+                         const asymm::ValidationToken &public_key_validation) {
+  if (!IsValidTask(key_value_signature, request_signature, public_key_id,
+                   ops_callback))
+    return false;
+  {
+    UpgradeLock upgrade_lock(shared_mutex_);
+    TaskIndex::index<TagTaskKey>::type& index_by_key =
+        task_index_->get<TagTaskKey>();
+    auto itr = index_by_key.find(key_value_signature.key);
+    if (itr != index_by_key.end() && (*itr).public_key_id != public_key_id) {
+      DLOG(WARNING) << "Stored key is associated with different public_key_id.";
+      return false;
+    }
+    // Tasks still pending for this public_key_id run first, so this one is
+    // held until SenderTaskCallback() runs them.
+    TaskIndex::index<TagPublicKeyId>::type& index_by_public_key_id =
+        task_index_->get<TagPublicKeyId>();
+    if (index_by_public_key_id.find(public_key_id) !=
+        index_by_public_key_id.end()) {
+      UpgradeToUniqueLock unique_lock(upgrade_lock);
+      return index_by_public_key_id.insert(Task(key_value_signature, info,
+          request_signature, public_key_id, ops_callback)).second;
+    }
+  }
+  ops_callback(key_value_signature, info, request_signature, public_key,
+               public_key_validation);
+  return true;
+}
+
+bool SenderTask::IsValidTask(const KeyValueSignature &key_value_signature,
+                             const RequestAndSignature &request_signature,
+                             const asymm::Identity &public_key_id,
+                             const TaskCallback &ops_callback) const {
+  if (key_value_signature.key.empty()) {
+    DLOG(WARNING) << "Empty key.";
+    return false;
+  }
+  if (key_value_signature.value.empty()) {
+    DLOG(WARNING) << "Empty value.";
+    return false;
+  }
+  if (key_value_signature.signature.empty()) {
+    DLOG(WARNING) << "Empty signature.";
+    return false;
+  }
+  if (public_key_id.empty()) {
+    DLOG(WARNING) << "Empty public_key_id.";
+    return false;
+  }
+  if (request_signature.first.empty()) {
+    DLOG(WARNING) << "Empty request.";
+    return false;
+  }
+  if (!ops_callback) {
+    DLOG(WARNING) << "Invalid callback.";
+    return false;
+  }
+  return true;
+}
+
 void SenderTask::SenderTaskCallback(
     asymm::Identity public_key_id,
     asymm::PublicKey public_key,
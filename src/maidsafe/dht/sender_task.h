@@ -109,6 +109,19 @@ class SenderTask  {
                const asymm::Identity &public_key_id,
                TaskCallback ops_callback,
                bool *is_new_id);
+  // Executes a task at once with an already known public key, rather than
+  // holding it for SenderTaskCallback().  As for AddTask(), the task isn't run
+  // if its key is held by a pending task with a different public_key_id.  If
+  // tasks are still pending for public_key_id, the task is added behind them
+  // instead, so that tasks by one sender run in the order they arrive.
+  // Returns true if the task was valid and has been executed or added.
+  bool RunTask(const KeyValueSignature &key_value_signature,
+               const transport::Info &info,
+               const RequestAndSignature &request_signature,
+               const asymm::Identity &public_key_id,
+               TaskCallback ops_callback,
+               const asymm::PublicKey &public_key,
+               const asymm::ValidationToken &public_key_validation);
 
  private:
   friend class Service;
@@ -124,6 +137,12 @@ class SenderTask  {
   typedef boost::upgrade_to_unique_lock<boost::shared_mutex>
           UpgradeToUniqueLock;
 
+  // Returns false if any of the task's fields is empty.
+  bool IsValidTask(const KeyValueSignature &key_value_signature,
+                   const RequestAndSignature &request_signature,
+                   const asymm::Identity &public_key_id,
+                   const TaskCallback &ops_callback) const;
+
   // Executes all the tasks present in the multi index under given
   // public_key_id and delete them from the multi index after the execution.
   // Does nothing if the public_key_id is empty or task for given public_key_id
@@ -30,6 +30,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "maidsafe/dht/service.h"
 
+#include "boost/lexical_cast.hpp"
+
 #include "maidsafe/common/crypto.h"
 
 #ifdef __MSVC__
@@ -53,12 +55,22 @@ namespace maidsafe {
 
 namespace dht {
 
+namespace {
+
+// Run on the crypto pool.
+void RunCheck(std::function<bool()> check, std::shared_ptr<bool> passed) {
+  *passed = check();
+}
+
+}  // unnamed namespace
+
 Service::Service(std::shared_ptr<RoutingTable> routing_table,
                  std::shared_ptr<DataStore> data_store,
                  PrivateKeyPtr private_key,
                  const uint16_t &k)
     : routing_table_(routing_table),
       datastore_(data_store),
+      value_cache_(new ValueCache(kMaxValueCacheSize)),
       private_key_(private_key),
       node_joined_(false),
       node_contact_(),
@@ -71,10 +83,80 @@ Service::Service(std::shared_ptr<RoutingTable> routing_table,
                                    args::_3)),
       validate_functor_(std::bind(&StubValidate, args::_1, args::_2,
                                   args::_3)),
-      check_cache_functor_() {}
+      check_cache_functor_(),
+      signature_cache_(),
+      functor_signature_cache_(new SignatureCache(kMaxSignatureCacheSize,
+                                                  kSignatureCacheTtl,
+                                                  validate_functor_)),
+      public_key_cache_(),
+      crypto_pool_(),
+      asio_service_(nullptr),
+      pending_checks_(),
+      pending_checks_mutex_() {}
 
 Service::~Service() {}
 
+void Service::set_validate(asymm::ValidateFunctor validate_functor) {
+  validate_functor_ = validate_functor;
+  // Validations made with the previous functor no longer apply.
+  functor_signature_cache_.reset(new SignatureCache(kMaxSignatureCacheSize,
+                                                    kSignatureCacheTtl,
+                                                    validate_functor_));
+}
+
+bool Service::AddSenderTask(const KeyValueSignature &key_value_signature,
+                            const transport::Info &info,
+                            const RequestAndSignature &request_signature,
+                            const asymm::Identity &public_key_id,
+                            TaskCallback ops_callback) {
+  asymm::PublicKey public_key;
+  asymm::ValidationToken public_key_validation;
+  if (public_key_cache_ && public_key_cache_->Get(public_key_id, &public_key,
+                                                  &public_key_validation)) {
+    return sender_task_->RunTask(key_value_signature, info, request_signature,
+                                 public_key_id, ops_callback, public_key,
+                                 public_key_validation);
+  }
+
+  // Only the first task for a public_key_id fetches the key; later ones wait
+  // in sender_task_ for the same result.
+  bool is_new_id = true;
+  if (!sender_task_->AddTask(key_value_signature, info, request_signature,
+                             public_key_id, ops_callback, &is_new_id))
+    return false;
+  if (is_new_id) {
+    asymm::GetPublicKeyAndValidationCallback callback;
+    if (public_key_cache_) {
+      callback = std::bind(&Service::CachePublicKeyAndRunTasks,
+                           public_key_cache_, sender_task_, public_key_id,
+                           args::_1, args::_2);
+    } else {
+      callback = std::bind(&SenderTask::SenderTaskCallback, sender_task_,
+                           public_key_id, args::_1, args::_2);
+    }
+    contact_validation_getter_(public_key_id, callback);
+  }
+  return true;
+}
+
+void Service::CachePublicKeyAndRunTasks(
+    std::shared_ptr<PublicKeyCache> public_key_cache,
+    std::shared_ptr<SenderTask> sender_task,
+    asymm::Identity public_key_id,
+    asymm::PublicKey public_key,
+    asymm::ValidationToken public_key_validation) {
+  public_key_cache->Add(public_key_id, public_key, public_key_validation);
+  sender_task->SenderTaskCallback(public_key_id, public_key,
+                                  public_key_validation);
+}
+
+bool Service::Validate(const asymm::PlainText &plain_text,
+                       const asymm::Signature &signature,
+                       const asymm::PublicKey &public_key) {
+  return functor_signature_cache_->Validate(plain_text, signature,
+                                            public_key);
+}
+
 void Service::ConnectToSignals(MessageHandlerPtr message_handler) {
   // Connect service to message handler for incoming parsed requests
   message_handler->on_ping_request()->connect(
@@ -109,6 +191,22 @@ void Service::ConnectToSignals(MessageHandlerPtr message_handler) {
       MessageHandler::DownlistNtfSigPtr::element_type::slot_type(
           &Service::Downlist, this, _1, _2, _3).track_foreign(
               shared_from_this()));
+  message_handler->on_store_cache_notification()->connect(
+      MessageHandler::StoreCacheNtfSigPtr::element_type::slot_type(
+          &Service::StoreCache, this, _1, _2, _3).track_foreign(
+              shared_from_this()));
+  message_handler->on_find_value_batch_request()->connect(
+      MessageHandler::FindValueBatchReqSigPtr::element_type::slot_type(
+          &Service::FindValueBatch, this, _1, _2, _3, _4).track_foreign(
+              shared_from_this()));
+  message_handler->on_find_nodes_batch_request()->connect(
+      MessageHandler::FindNodesBatchReqSigPtr::element_type::slot_type(
+          &Service::FindNodesBatch, this, _1, _2, _3, _4).track_foreign(
+              shared_from_this()));
+  message_handler->on_store_batch_request()->connect(
+      MessageHandler::StoreBatchReqSigPtr::element_type::slot_type(
+          &Service::StoreBatch, this, _1, _2, _3, _4).track_foreign(
+              shared_from_this()));
 }
 
 bool Service::CheckParameters(const std::string &method_name,
@@ -171,9 +269,25 @@ void Service::FindValue(const transport::Info &info,
     return;
   }
 
-  // Do we have the values?
+  // Do we have the values, or a cached copy of them?  Either way, pass on the
+  // signer's identity so the requester can have the values cached onwards.
   std::vector<ValueAndSignature> values_and_signatures;
+  RequestAndSignature request_signature;
+  asymm::Identity signer_public_key_id;
+  bool found(false);
   if (datastore_->GetValues(key.String(), &values_and_signatures)) {
+    protobuf::StoreRequest store_request;
+    if (datastore_->GetStoreRequest(key.String(), &request_signature) &&
+        store_request.ParseFromString(request_signature.first))
+      signer_public_key_id = store_request.sender().public_key_id();
+    found = true;
+  } else {
+    found = value_cache_->GetValues(key.String(), &values_and_signatures,
+                                    &signer_public_key_id);
+  }
+  if (found) {
+    if (!signer_public_key_id.empty())
+      response->set_signer_public_key_id(signer_public_key_id);
     for (unsigned int i = 0; i < values_and_signatures.size(); i++) {
       protobuf::SignedValue *signed_value = response->add_signed_values();
       signed_value->set_value(values_and_signatures[i].first);
@@ -231,6 +345,15 @@ void Service::Store(const transport::Info &info,
                     const std::string &message_signature,
                     protobuf::StoreResponse *response,
                     transport::Timeout*) {
+  AddStoreTask(info, request, message, message_signature, false, response);
+}
+
+void Service::AddStoreTask(const transport::Info &info,
+                           const protobuf::StoreRequest &request,
+                           const std::string &message,
+                           const std::string &message_signature,
+                           const bool from_batch,
+                           protobuf::StoreResponse *response) {
   response->set_result(false);
   Key key(request.key());
   if (!CheckParameters("Store", &key, &message, &message_signature))
@@ -252,18 +375,10 @@ void Service::Store(const transport::Info &info,
 
   RequestAndSignature request_signature(message, message_signature);
   TaskCallback store_cb = std::bind(&Service::StoreCallback, this, args::_1,
-                              request, args::_2, args::_3, args::_4, args::_5);
-  bool is_new_id = true;
-  if (sender_task_->AddTask(key_value_signature, info, request_signature,
-                            request.sender().public_key_id(), store_cb,
-                            &is_new_id)) {
-    if (is_new_id) {  // If public_key_id is new
-      asymm::Identity id(request.sender().public_key_id());
-      asymm::GetPublicKeyAndValidationCallback callback(std::bind(
-          &SenderTask::SenderTaskCallback, sender_task_, id, args::_1,
-          args::_2));
-      contact_validation_getter_(id, callback);
-    }
+                              request, args::_2, args::_3, args::_4, args::_5,
+                              from_batch);
+  if (AddSenderTask(key_value_signature, info, request_signature,
+                    request.sender().public_key_id(), store_cb)) {
     response->set_result(true);
   } else {
     DLOG(ERROR) << DebugId(node_contact_) << ": failed to add the store task.";
@@ -312,18 +427,9 @@ void Service::StoreRefresh(const transport::Info &info,
   TaskCallback store_refresh_cb = std::bind(&Service::StoreRefreshCallback,
                                             this, args::_1, request, args::_2,
                                             args::_3, args::_4, args::_5);
-  bool is_new_id = true;
-  if (sender_task_->AddTask(key_value_signature, info, request_signature,
-                            ori_store_request.sender().public_key_id(),
-                            store_refresh_cb, &is_new_id)) {
-    if (is_new_id) {
-      asymm::GetPublicKeyAndValidationCallback callback(
-          std::bind(&SenderTask::SenderTaskCallback, sender_task_,
-                    ori_store_request.sender().public_key_id(), args::_1,
-                    args::_2));
-      contact_validation_getter_(ori_store_request.sender().public_key_id(),
-                                 callback);
-    }
+  if (AddSenderTask(key_value_signature, info, request_signature,
+                    ori_store_request.sender().public_key_id(),
+                    store_refresh_cb)) {
     response->set_result(true);
   } else {
     DLOG(ERROR) << DebugId(node_contact_) << ": failed to add the store "
@@ -336,12 +442,15 @@ void Service::StoreCallback(KeyValueSignature key_value_signature,
                             transport::Info info,
                             RequestAndSignature request_signature,
                             asymm::PublicKey public_key,
-                            asymm::ValidationToken public_key_validation) {
-  if (ValidateAndStore(key_value_signature, request, info, request_signature,
-                       public_key, public_key_validation, false))
-    if (request.sender().node_id() != client_node_id_)
-      routing_table_->AddContact(FromProtobuf(request.sender()),
-                                 RankInfoPtr(new transport::Info(info)));
+                            asymm::ValidationToken public_key_validation,
+                            bool from_batch) {
+  CheckThenApply(key_value_signature.key,
+                 std::bind(&Service::ValidateStore, this, key_value_signature,
+                           request, request_signature, public_key,
+                           public_key_validation, false, from_batch),
+                 std::bind(&Service::StoreValidated, this, key_value_signature,
+                           request, info, request_signature, request.sender(),
+                           false));
 }
 
 void Service::StoreRefreshCallback(
@@ -353,21 +462,23 @@ void Service::StoreRefreshCallback(
     asymm::ValidationToken public_key_validation) {
   protobuf::StoreRequest ori_store_request;
   ori_store_request.ParseFromString(request.serialised_store_request());
-  if (ValidateAndStore(key_value_signature, ori_store_request, info,
-      request_signature, public_key, public_key_validation, true))
-    if (request.sender().node_id() != client_node_id_)
-      routing_table_->AddContact(FromProtobuf(request.sender()),
-                                 RankInfoPtr(new transport::Info(info)));
+  CheckThenApply(key_value_signature.key,
+                 std::bind(&Service::ValidateStore, this, key_value_signature,
+                           ori_store_request, request_signature, public_key,
+                           public_key_validation, true, false),
+                 std::bind(&Service::StoreValidated, this, key_value_signature,
+                           ori_store_request, info, request_signature,
+                           request.sender(), true));
 }
 
-bool Service::ValidateAndStore(
+bool Service::ValidateStore(
     const KeyValueSignature &key_value_signature,
     const protobuf::StoreRequest &request,
-    const transport::Info &/*info*/,
     const RequestAndSignature &request_signature,
     const asymm::PublicKey &public_key,
     const asymm::ValidationToken &public_key_validation,
-    const bool is_refresh) {
+    const bool is_refresh,
+    const bool from_batch) {
   if (!contact_validator_(request.sender().public_key_id(), public_key,
                           public_key_validation)) {
     DLOG(WARNING) << DebugId(node_contact_) << ": Failed to validate contact "
@@ -375,29 +486,56 @@ bool Service::ValidateAndStore(
                   << is_refresh << ")";
     return false;
   }
-  if (!validate_functor_(key_value_signature.value,
-                         key_value_signature.signature,
-                         public_key)) {
+  // The request signature is checked as the message handler would check that
+  // of a single Store request, so that the pair can later be refreshed.
+  if (from_batch) {
+    asymm::PublicKey sender_public_key;
+    asymm::DecodePublicKey(request.sender().public_key(), &sender_public_key);
+    std::string message(boost::lexical_cast<std::string>(kStoreRequest) +
+                        request_signature.first);
+    if (!(signature_cache_ ?
+          signature_cache_->Validate(message, request_signature.second,
+                                     sender_public_key) :
+          asymm::Validate(message, request_signature.second,
+                          sender_public_key))) {
+      DLOG(WARNING) << DebugId(node_contact_) << ": Failed to validate store "
+                    << "request in StoreBatch against its signature";
+      return false;
+    }
+  }
+  if (!Validate(key_value_signature.value, key_value_signature.signature,
+                public_key)) {
     DLOG(WARNING) << DebugId(node_contact_) << ": Failed to validate Store "
                   << "request for kademlia value (is_refresh = "
                   << std::boolalpha << is_refresh << ")";
     return false;
   }
-  if (is_refresh && !validate_functor_(request_signature.first,
-                                       request_signature.second,
-                                       public_key)) {
+  if (is_refresh && !Validate(request_signature.first,
+                              request_signature.second, public_key)) {
     DLOG(WARNING) << DebugId(node_contact_) << ": Failed to validate request "
                   << "against request signature";
     return false;
   }
+  return true;
+}
+
+void Service::StoreValidated(const KeyValueSignature &key_value_signature,
+                             const protobuf::StoreRequest &request,
+                             const transport::Info &info,
+                             const RequestAndSignature &request_signature,
+                             const protobuf::Contact &sender,
+                             const bool is_refresh) {
   if (datastore_->StoreValue(key_value_signature,
       boost::posix_time::seconds(request.ttl()), request_signature,
-      is_refresh) == kSuccess) {
-    return true;
-  } else {
+      is_refresh) != kSuccess) {
     DLOG(WARNING) << DebugId(node_contact_) << ": Failed to store Kad value.";
-    return false;
+    return;
   }
+  // The authoritative values now supersede any copy cached here.
+  value_cache_->Remove(key_value_signature.key);
+  if (sender.node_id() != client_node_id_)
+    routing_table_->AddContact(FromProtobuf(sender),
+                               RankInfoPtr(new transport::Info(info)));
 }
 
 void Service::Delete(const transport::Info &info,
@@ -434,16 +572,8 @@ void Service::Delete(const transport::Info &info,
   TaskCallback delete_cb = std::bind(&Service::DeleteCallback, this, args::_1,
                                      request, args::_2, args::_3, args::_4,
                                      args::_5);
-  bool is_new_id = true;
-  if (sender_task_->AddTask(key_value_signature, info, request_signature,
-                            request.sender().public_key_id(), delete_cb,
-                            &is_new_id)) {
-    if (is_new_id) {
-      asymm::GetPublicKeyAndValidationCallback callback(
-          std::bind(&SenderTask::SenderTaskCallback, sender_task_,
-                    request.sender().public_key_id(), args::_1, args::_2));
-      contact_validation_getter_(request.sender().public_key_id(), callback);
-    }
+  if (AddSenderTask(key_value_signature, info, request_signature,
+                    request.sender().public_key_id(), delete_cb)) {
     response->set_result(true);
   } else {
     DLOG(ERROR) << DebugId(node_contact_) << ": failed to add the delete task.";
@@ -494,18 +624,9 @@ void Service::DeleteRefresh(const transport::Info &info,
   TaskCallback delete_refresh_cb = std::bind(&Service::DeleteRefreshCallback,
                                              this, args::_1, request, args::_2,
                                              args::_3, args::_4, args::_5);
-  bool is_new_id = true;
-  if (sender_task_->AddTask(key_value_signature, info, request_signature,
-                            ori_delete_request.sender().public_key_id(),
-                            delete_refresh_cb, &is_new_id)) {
-    if (is_new_id) {
-      asymm::GetPublicKeyAndValidationCallback callback(
-          std::bind(&SenderTask::SenderTaskCallback, sender_task_,
-                    ori_delete_request.sender().public_key_id(), args::_1,
-                    args::_2));
-      contact_validation_getter_(ori_delete_request.sender().public_key_id(),
-                                 callback);
-    }
+  if (AddSenderTask(key_value_signature, info, request_signature,
+                    ori_delete_request.sender().public_key_id(),
+                    delete_refresh_cb)) {
     response->set_result(true);
   } else {
     DLOG(ERROR) << DebugId(node_contact_) << ": failed to add the delete "
@@ -519,11 +640,13 @@ void Service::DeleteCallback(KeyValueSignature key_value_signature,
                              RequestAndSignature request_signature,
                              asymm::PublicKey public_key,
                              asymm::ValidationToken public_key_validation) {
-  if (ValidateAndDelete(key_value_signature, request, info, request_signature,
-                        public_key, public_key_validation, false))
-    if (request.sender().node_id() != client_node_id_)
-      routing_table_->AddContact(FromProtobuf(request.sender()),
-                                 RankInfoPtr(new transport::Info(info)));
+  CheckThenApply(key_value_signature.key,
+                 std::bind(&Service::ValidateDelete, this, key_value_signature,
+                           request, request_signature, public_key,
+                           public_key_validation, false),
+                 std::bind(&Service::DeleteValidated, this,
+                           key_value_signature, info, request_signature,
+                           request.sender(), false));
 }
 
 void Service::DeleteRefreshCallback(
@@ -535,19 +658,18 @@ void Service::DeleteRefreshCallback(
     asymm::ValidationToken public_key_validation) {
   protobuf::DeleteRequest ori_delete_request;
   ori_delete_request.ParseFromString(request.serialised_delete_request());
-  if (ValidateAndDelete(key_value_signature, ori_delete_request, info,
-                        request_signature, public_key, public_key_validation,
-                        true)) {
-    if (request.sender().node_id() != client_node_id_)
-      routing_table_->AddContact(FromProtobuf(request.sender()),
-                                 RankInfoPtr(new transport::Info(info)));
-  }
+  CheckThenApply(key_value_signature.key,
+                 std::bind(&Service::ValidateDelete, this, key_value_signature,
+                           ori_delete_request, request_signature, public_key,
+                           public_key_validation, true),
+                 std::bind(&Service::DeleteValidated, this,
+                           key_value_signature, info, request_signature,
+                           request.sender(), true));
 }
 
-bool Service::ValidateAndDelete(
+bool Service::ValidateDelete(
     const KeyValueSignature &key_value_signature,
     const protobuf::DeleteRequest &request,
-    const transport::Info &/*info*/,
     const RequestAndSignature &request_signature,
     const asymm::PublicKey &public_key,
     const asymm::ValidationToken &public_key_validation,
@@ -559,30 +681,93 @@ bool Service::ValidateAndDelete(
                   << is_refresh << ")";
     return false;
   }
-  if (!validate_functor_(key_value_signature.value,
-                         key_value_signature.signature,
-                         public_key)) {
+  if (!Validate(key_value_signature.value, key_value_signature.signature,
+                public_key)) {
     DLOG(WARNING) << DebugId(node_contact_) << ": Failed to validate Delete "
                   << "request for kademlia value (is_refresh = "
                   << std::boolalpha << is_refresh << ")";
     return false;
   }
 
-  if (is_refresh && !validate_functor_(request_signature.first,
-                                       request_signature.second,
-                                       public_key)) {
+  if (is_refresh && !Validate(request_signature.first,
+                              request_signature.second, public_key)) {
     DLOG(WARNING) << DebugId(node_contact_) << ": Failed to validate request "
                   << "against request signature";
     return false;
   }
+  return true;
+}
 
-  if (datastore_->DeleteValue(key_value_signature, request_signature,
-                              is_refresh)) {
-    return true;
-  } else {
+void Service::DeleteValidated(const KeyValueSignature &key_value_signature,
+                              const transport::Info &info,
+                              const RequestAndSignature &request_signature,
+                              const protobuf::Contact &sender,
+                              const bool is_refresh) {
+  if (!datastore_->DeleteValue(key_value_signature, request_signature,
+                               is_refresh)) {
     DLOG(WARNING) << DebugId(node_contact_) << ": Failed to delete Kad value.";
-    return false;
+    return;
   }
+  // Any copy cached here is now stale.
+  value_cache_->Remove(key_value_signature.key);
+  if (sender.node_id() != client_node_id_)
+    routing_table_->AddContact(FromProtobuf(sender),
+                               RankInfoPtr(new transport::Info(info)));
+}
+
+void Service::CheckThenApply(const std::string &key,
+                             CheckFunctor check,
+                             ApplyFunctor apply) {
+  if (!crypto_pool_ || !asio_service_) {
+    if (check())
+      apply();
+    return;
+  }
+  {
+    boost::mutex::scoped_lock lock(pending_checks_mutex_);
+    std::deque<CheckAndApply> &pending(pending_checks_[key]);
+    pending.push_back(CheckAndApply(check, apply));
+    // Otherwise this is started once those ahead of it have been applied.
+    if (pending.size() != 1U)
+      return;
+  }
+  StartCheck(key, check);
+}
+
+void Service::StartCheck(const std::string &key, CheckFunctor check) {
+  std::shared_ptr<bool> passed(new bool(false));
+  ApplyFunctor check_done(std::bind(&Service::CheckDone, shared_from_this(),
+                                    key, passed));
+  if (crypto_pool_->Post(std::bind(&RunCheck, check, passed), *asio_service_,
+                         check_done))
+    return;
+  // The pool's queue is full.
+  *passed = check();
+  asio_service_->post(check_done);
+}
+
+void Service::CheckDone(const std::string &key, std::shared_ptr<bool> passed) {
+  ApplyFunctor apply;
+  {
+    boost::mutex::scoped_lock lock(pending_checks_mutex_);
+    apply = pending_checks_[key].front().second;
+  }
+  // The entry stays queued while it is applied, so that later ones for key
+  // wait for it.
+  if (*passed)
+    apply();
+  CheckFunctor next_check;
+  {
+    boost::mutex::scoped_lock lock(pending_checks_mutex_);
+    auto it(pending_checks_.find(key));
+    it->second.pop_front();
+    if (it->second.empty())
+      pending_checks_.erase(it);
+    else
+      next_check = it->second.front().first;
+  }
+  if (next_check)
+    StartCheck(key, next_check);
 }
 
 void Service::Downlist(const transport::Info &/*info*/,
@@ -611,6 +796,81 @@ void Service::Downlist(const transport::Info &/*info*/,
   }
 }
 
+void Service::StoreCache(const transport::Info &/*info*/,
+                         const protobuf::StoreCacheNotification &request,
+                         transport::Timeout*) {
+  Key key(request.key());
+  if (!CheckParameters("StoreCache", &key))
+    return;
+  if (request.ttl() <= 0 || request.signed_values_size() == 0 ||
+      request.signer_public_key_id().empty()) {
+    DLOG(WARNING) << DebugId(node_contact_) << ": Invalid StoreCache request.";
+    return;
+  }
+  // The values are already held authoritatively here.
+  if (datastore_->HasKey(key.String()))
+    return;
+
+  std::vector<ValueAndSignature> values_and_signatures;
+  values_and_signatures.reserve(request.signed_values_size());
+  for (int i = 0; i < request.signed_values_size(); ++i) {
+    values_and_signatures.push_back(
+        std::make_pair(request.signed_values(i).value(),
+                       request.signed_values(i).signature()));
+  }
+  boost::posix_time::time_duration ttl(
+      boost::posix_time::seconds(request.ttl()));
+  if (ttl > kMaxCachedValueTtl)
+    ttl = kMaxCachedValueTtl;
+
+  // Nothing is cached until the signer's key has been fetched and every value
+  // checked against it.
+  asymm::PublicKey public_key;
+  asymm::ValidationToken public_key_validation;
+  if (public_key_cache_ &&
+      public_key_cache_->Get(request.signer_public_key_id(), &public_key,
+                             &public_key_validation)) {
+    StoreCacheCallback(key.String(), values_and_signatures,
+                       request.signer_public_key_id(), ttl, false, public_key,
+                       public_key_validation);
+    return;
+  }
+  contact_validation_getter_(request.signer_public_key_id(),
+      std::bind(&Service::StoreCacheCallback, this, key.String(),
+                values_and_signatures, request.signer_public_key_id(), ttl,
+                true, args::_1, args::_2));
+}
+
+void Service::StoreCacheCallback(
+    std::string key,
+    std::vector<ValueAndSignature> values_and_signatures,
+    asymm::Identity signer_public_key_id,
+    boost::posix_time::time_duration ttl,
+    bool fetched_public_key,
+    asymm::PublicKey public_key,
+    asymm::ValidationToken public_key_validation) {
+  if (!contact_validator_(signer_public_key_id, public_key,
+                          public_key_validation)) {
+    DLOG(WARNING) << DebugId(node_contact_) << ": Failed to validate signer "
+                  << "for StoreCache request.";
+    return;
+  }
+  if (fetched_public_key && public_key_cache_)
+    public_key_cache_->Add(signer_public_key_id, public_key,
+                           public_key_validation);
+  for (size_t i = 0; i < values_and_signatures.size(); ++i) {
+    if (!Validate(values_and_signatures[i].first,
+                  values_and_signatures[i].second, public_key)) {
+      DLOG(WARNING) << DebugId(node_contact_) << ": Failed to validate value "
+                    << "for StoreCache request.";
+      return;
+    }
+  }
+  if (datastore_->HasKey(key))
+    return;
+  value_cache_->Add(key, values_and_signatures, signer_public_key_id, ttl);
+}
+
 void Service::AddContactToRoutingTable(const Contact &contact,
                                        const transport::Info &info) {
   if (contact.node_id().String() != client_node_id_) {
@@ -627,6 +887,88 @@ void Service::AddContactToRoutingTable(const Contact &contact,
 }
 
 
+void Service::FindValueBatch(const transport::Info &info,
+                             const protobuf::FindValueBatchRequest &request,
+                             protobuf::FindValueBatchResponse *response,
+                             transport::Timeout *timeout) {
+  response->set_result(false);
+  if (!CheckParameters("FindValueBatch"))
+    return;
+  if (request.keys_size() > kMaxRpcBatchSize) {
+    DLOG(WARNING) << DebugId(node_contact_) << ": FindValueBatch of "
+                  << request.keys_size() << " keys is too large.";
+    return;
+  }
+  protobuf::FindValueRequest find_value_request;
+  *find_value_request.mutable_sender() = request.sender();
+  if (request.has_num_nodes_requested())
+    find_value_request.set_num_nodes_requested(request.num_nodes_requested());
+  for (int i = 0; i < request.keys_size(); ++i) {
+    find_value_request.set_key(request.keys(i));
+    FindValue(info, find_value_request, response->add_responses(), timeout);
+  }
+  response->set_result(true);
+}
+
+void Service::FindNodesBatch(const transport::Info &info,
+                             const protobuf::FindNodesBatchRequest &request,
+                             protobuf::FindNodesBatchResponse *response,
+                             transport::Timeout *timeout) {
+  response->set_result(false);
+  if (!CheckParameters("FindNodesBatch"))
+    return;
+  if (request.keys_size() > kMaxRpcBatchSize) {
+    DLOG(WARNING) << DebugId(node_contact_) << ": FindNodesBatch of "
+                  << request.keys_size() << " keys is too large.";
+    return;
+  }
+  protobuf::FindNodesRequest find_nodes_request;
+  *find_nodes_request.mutable_sender() = request.sender();
+  if (request.has_num_nodes_requested())
+    find_nodes_request.set_num_nodes_requested(request.num_nodes_requested());
+  for (int i = 0; i < request.keys_size(); ++i) {
+    find_nodes_request.set_key(request.keys(i));
+    FindNodes(info, find_nodes_request, response->add_responses(), timeout);
+  }
+  response->set_result(true);
+}
+
+void Service::StoreBatch(const transport::Info &info,
+                         const protobuf::StoreBatchRequest &request,
+                         protobuf::StoreBatchResponse *response,
+                         transport::Timeout*) {
+  response->set_result(false);
+  if (!CheckParameters("StoreBatch"))
+    return;
+  if (request.serialised_store_requests_size() > kMaxRpcBatchSize ||
+      request.serialised_store_requests_size() !=
+          request.serialised_store_request_signatures_size()) {
+    DLOG(WARNING) << DebugId(node_contact_) << ": Invalid StoreBatch request.";
+    return;
+  }
+  for (int i = 0; i < request.serialised_store_requests_size(); ++i) {
+    const std::string &message(request.serialised_store_requests(i));
+    const std::string &message_signature(
+        request.serialised_store_request_signatures(i));
+    protobuf::StoreResponse *store_response(response->add_responses());
+    store_response->set_result(false);
+    // Each request's signature is checked along with its value's by
+    // ValidateStore.
+    protobuf::StoreRequest store_request;
+    if (!store_request.ParseFromString(message) ||
+        !store_request.IsInitialized() ||
+        store_request.sender().node_id() != request.sender().node_id() ||
+        store_request.sender().public_key() != request.sender().public_key()) {
+      DLOG(WARNING) << DebugId(node_contact_) << ": Invalid store request "
+                    << "in StoreBatch.";
+      continue;
+    }
+    AddStoreTask(info, store_request, message, message_signature, true,
+                 store_response);
+  }
+  response->set_result(true);
+}
+
 }  // namespace dht
 
 }  // namespace maidsafe
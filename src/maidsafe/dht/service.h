@@ -29,14 +29,25 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MAIDSAFE_DHT_SERVICE_H_
 
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "boost/asio/io_service.hpp"
+#include "boost/thread/mutex.hpp"
+
 #include "maidsafe/dht/config.h"
 #include "maidsafe/dht/contact.h"
+#include "maidsafe/dht/crypto_pool.h"
 #include "maidsafe/dht/data_store.h"
+#include "maidsafe/dht/public_key_cache.h"
 #include "maidsafe/dht/sender_task.h"
+#include "maidsafe/dht/signature_cache.h"
+#include "maidsafe/dht/value_cache.h"
 
 namespace maidsafe {
 
@@ -47,6 +58,7 @@ class RoutingTable;
 class MessageHandler;
 
 namespace protobuf {
+class Contact;
 class SignedValue;
 class PingRequest;
 class PingResponse;
@@ -63,6 +75,13 @@ class DeleteRefreshRequest;
 class DeleteRefreshResponse;
 class DeleteResponse;
 class DownlistNotification;
+class StoreCacheNotification;
+class FindValueBatchRequest;
+class FindValueBatchResponse;
+class FindNodesBatchRequest;
+class FindNodesBatchResponse;
+class StoreBatchRequest;
+class StoreBatchResponse;
 }  // namespace protobuf
 
 namespace test {
@@ -174,6 +193,45 @@ class Service : public std::enable_shared_from_this<Service> {
   void Downlist(const transport::Info &info,
                 const protobuf::DownlistNotification &request,
                 transport::Timeout *timeout);
+  /** Handle StoreCache request.
+   *  Caches the values, apart from the data store, for the requested time
+   *  capped at kMaxCachedValueTtl so that later FindValue requests passing
+   *  through this node can be answered from the cache.  The values are only
+   *  cached once validated against the key of their signer.
+   *  @param info The rank info.
+   *  @param request The request. */
+  void StoreCache(const transport::Info &info,
+                  const protobuf::StoreCacheNotification &request,
+                  transport::Timeout *timeout);
+  /** Handle FindValueBatch request.
+   *  Each key is handled as by FindValue, with the responses in key order.
+   *  @param[in] info The rank info.
+   *  @param[in] request The request.
+   *  @param[out] response To response. */
+  void FindValueBatch(const transport::Info &info,
+                      const protobuf::FindValueBatchRequest &request,
+                      protobuf::FindValueBatchResponse *response,
+                      transport::Timeout *timeout);
+  /** Handle FindNodesBatch request.
+   *  Each key is handled as by FindNodes, with the responses in key order.
+   *  @param[in] info The rank info.
+   *  @param[in] request The request.
+   *  @param[out] response To response. */
+  void FindNodesBatch(const transport::Info &info,
+                      const protobuf::FindNodesBatchRequest &request,
+                      protobuf::FindNodesBatchResponse *response,
+                      transport::Timeout *timeout);
+  /** Handle StoreBatch request.
+   *  Each serialised store request must be the sender's own, signed as for a
+   *  single Store RPC, and is then handled as by Store, with the responses in
+   *  request order.
+   *  @param[in] info The rank info.
+   *  @param[in] request The request.
+   *  @param[out] response The response. */
+  void StoreBatch(const transport::Info &info,
+                  const protobuf::StoreBatchRequest &request,
+                  protobuf::StoreBatchResponse *response,
+                  transport::Timeout *timeout);
   /** Set the status to be joined or not joined
    *  @param joined The bool switch. */
   void set_node_joined(bool joined) { node_joined_ = joined; }
@@ -187,6 +245,9 @@ class Service : public std::enable_shared_from_this<Service> {
   void set_contact_validation_getter(
       asymm::GetPublicKeyAndValidationFunctor contact_validation_getter) {
     contact_validation_getter_ = contact_validation_getter;
+    // Keys fetched by the previous getter no longer apply.
+    if (public_key_cache_)
+      public_key_cache_->Clear();
   }
 
   void set_contact_validator(
@@ -194,8 +255,31 @@ class Service : public std::enable_shared_from_this<Service> {
     contact_validator_ = contact_validator;
   }
 
-  void set_validate(asymm::ValidateFunctor validate_functor) {
-    validate_functor_ = validate_functor;
+  void set_validate(asymm::ValidateFunctor validate_functor);
+
+  /** Set the cache through which RSA signatures are validated
+   *  @param signature_cache Signatures already validated by this node with
+   *  asymm::Validate. */
+  void set_signature_cache(std::shared_ptr<SignatureCache> signature_cache) {
+    signature_cache_ = signature_cache;
+  }
+
+  /** Set the cache of senders' public keys
+   *  @param public_key_cache Results of contact_validation_getter_, used to
+   *  run tasks at once for senders whose keys were fetched recently. */
+  void set_public_key_cache(std::shared_ptr<PublicKeyCache> public_key_cache) {
+    public_key_cache_ = public_key_cache;
+  }
+
+  /** Set the pool on which stores and deletes are validated
+   *  @param crypto_pool Worker threads for signature checks.
+   *  @param asio_service Runs the data store and routing table work which
+   *  follows each check.  The service must be held by a shared_ptr while this
+   *  is set. */
+  void set_crypto_pool(std::shared_ptr<CryptoPool> crypto_pool,
+                       boost::asio::io_service &asio_service) {  // NOLINT
+    crypto_pool_ = crypto_pool;
+    asio_service_ = &asio_service;
   }
 
   void set_check_cache_functor(const CheckCacheFunctor &check_cache_functor) {
@@ -207,6 +291,9 @@ class Service : public std::enable_shared_from_this<Service> {
   friend class test::RpcsTest;
 
  private:
+  typedef std::function<bool()> CheckFunctor;
+  typedef std::function<void()> ApplyFunctor;
+  typedef std::pair<CheckFunctor, ApplyFunctor> CheckAndApply;
   /** Copy Constructor.
    *  @param Service The object to be copied. */
   Service(const Service&);
@@ -221,19 +308,35 @@ class Service : public std::enable_shared_from_this<Service> {
                        const Key *key = nullptr,
                        const std::string *message = nullptr,
                        const std::string *message_signature = nullptr) const;
+  /** Adds the sender task of a Store request, or of one from a StoreBatch.
+   *  @param[in] info The rank info.
+   *  @param[in] request The request.
+   *  @param[in] message The message to store.
+   *  @param[in] message_signature The signature of the message to store.
+   *  @param[in] from_batch Whether the request came in a StoreBatch, so that
+   *  its signature hasn't been checked by the message handler.
+   *  @param[out] response The response. */
+  void AddStoreTask(const transport::Info &info,
+                    const protobuf::StoreRequest &request,
+                    const std::string &message,
+                    const std::string &message_signature,
+                    const bool from_batch,
+                    protobuf::StoreResponse *response);
   /** Store Callback.
    *  @param[in] key_value_signature tuple of <key, value, signature>.
    *  @param[in] request The request.
    *  @param[in] info The rank info.
    *  @param[in] request_signature The request signature.
    *  @param[in] public_key public key
-   *  @param[in] public_key_validation public key validation */
+   *  @param[in] public_key_validation public key validation
+   *  @param[in] from_batch Whether the request came in a StoreBatch */
   void StoreCallback(KeyValueSignature key_value_signature,
                      protobuf::StoreRequest request,
                      transport::Info info,
                      RequestAndSignature request_signature,
                      asymm::PublicKey public_key,
-                     asymm::ValidationToken public_key_validation);
+                     asymm::ValidationToken public_key_validation,
+                     bool from_batch);
   /** Store Refresh Callback.
    *  @param[in] key_value_signature tuple of <key, value, signature>.
    *  @param[in] request The request.
@@ -247,23 +350,79 @@ class Service : public std::enable_shared_from_this<Service> {
                             RequestAndSignature request_signature,
                             asymm::PublicKey public_key,
                             asymm::ValidationToken public_key_validation);
-  /** Validate the request and then store the tuple.
+  /** Store Cache Callback.  Caches the values only if the signer's key is
+   *  valid and every value's signature checks out against it.
+   *  @param[in] key The Kademlia key.
+   *  @param[in] values_and_signatures The values to cache.
+   *  @param[in] signer_public_key_id The identity of the signer's key.
+   *  @param[in] ttl The time for which the values are cached.
+   *  @param[in] fetched_public_key Whether the key was fetched rather than
+   *             found in public_key_cache_.
+   *  @param[in] public_key public key
+   *  @param[in] public_key_validation public key validation */
+  void StoreCacheCallback(std::string key,
+                          std::vector<ValueAndSignature> values_and_signatures,
+                          asymm::Identity signer_public_key_id,
+                          boost::posix_time::time_duration ttl,
+                          bool fetched_public_key,
+                          asymm::PublicKey public_key,
+                          asymm::ValidationToken public_key_validation);
+  /** Runs the task at once if the sender's public key is cached, otherwise
+   *  holds it in sender_task_ until the key has been fetched.
+   *  @return Whether the task was accepted. */
+  bool AddSenderTask(const KeyValueSignature &key_value_signature,
+                     const transport::Info &info,
+                     const RequestAndSignature &request_signature,
+                     const asymm::Identity &public_key_id,
+                     TaskCallback ops_callback);
+  /** Caches a fetched public key and runs the tasks held for it.  Tasks for
+   *  the ID arriving meanwhile queue behind those still held.
+   *  @param[in] public_key_cache The cache to add the key to.
+   *  @param[in] sender_task The held tasks.
+   *  @param[in] public_key_id The identity of the key.
+   *  @param[in] public_key public key
+   *  @param[in] public_key_validation public key validation */
+  static void CachePublicKeyAndRunTasks(
+      std::shared_ptr<PublicKeyCache> public_key_cache,
+      std::shared_ptr<SenderTask> sender_task,
+      asymm::Identity public_key_id,
+      asymm::PublicKey public_key,
+      asymm::ValidationToken public_key_validation);
+  /** Validates signature through functor_signature_cache_.
+   *  @return Whether validate_functor_ accepts the signature. */
+  bool Validate(const asymm::PlainText &plain_text,
+                const asymm::Signature &signature,
+                const asymm::PublicKey &public_key);
+  /** Validate the sender's key and the signatures of a store.
    *  @param[in] key_value_signature tuple of <key, value, signature>.
    *  @param[in] request The request.
-   *  @param[in] info The rank info.
    *  @param[in] request_signature The request signature.
    *  @param[in] public_key public key
    *  @param[in] public_key_validation public key validation
    *  @param[in] is_refresh Indicating a publish or a refresh
-   *  @return Indicating validation succeed or not. The success of store will be
-   *          reflected in response.result() */
-  bool ValidateAndStore(const KeyValueSignature &key_value_signature,
-                        const protobuf::StoreRequest &request,
-                        const transport::Info &info,
-                        const RequestAndSignature &request_signature,
-                        const asymm::PublicKey &public_key,
-                        const asymm::ValidationToken &public_key_validation,
-                        const bool is_refresh);
+   *  @param[in] from_batch Whether the request came in a StoreBatch, and so
+   *  its request signature is to be checked too
+   *  @return Indicating validation succeed or not. */
+  bool ValidateStore(const KeyValueSignature &key_value_signature,
+                     const protobuf::StoreRequest &request,
+                     const RequestAndSignature &request_signature,
+                     const asymm::PublicKey &public_key,
+                     const asymm::ValidationToken &public_key_validation,
+                     const bool is_refresh,
+                     const bool from_batch);
+  /** Store the tuple once validated, and add the sender to the routing table.
+   *  @param[in] key_value_signature tuple of <key, value, signature>.
+   *  @param[in] request The request.
+   *  @param[in] info The rank info.
+   *  @param[in] request_signature The request signature.
+   *  @param[in] sender The sender of the store or refresh.
+   *  @param[in] is_refresh Indicating a publish or a refresh */
+  void StoreValidated(const KeyValueSignature &key_value_signature,
+                      const protobuf::StoreRequest &request,
+                      const transport::Info &info,
+                      const RequestAndSignature &request_signature,
+                      const protobuf::Contact &sender,
+                      const bool is_refresh);
   /** Delete Callback.
    *  @param[in] key_value_signature tuple of <key, value, signature>.
    *  @param[in] request The request.
@@ -290,23 +449,45 @@ class Service : public std::enable_shared_from_this<Service> {
                              RequestAndSignature request_signature,
                              asymm::PublicKey public_key,
                              asymm::ValidationToken public_key_validation);
-  /** Validate the request and then delete the tuple.
+  /** Validate the sender's key and the signatures of a delete.
    *  @param[in] key_value_signature tuple of <key, value, signature>.
    *  @param[in] request The request.
-   *  @param[in] info The rank info.
    *  @param[in] request_signature The request signature.
    *  @param[in] public_key public key
    *  @param[in] public_key_validation public key validation
    *  @param[in] is_refresh Indicating a publish or a refresh
-   *  @return Indicating validation succeed or not. The success of delete will
-   *          be reflected in response.result() */
-  bool ValidateAndDelete(const KeyValueSignature &key_value_signature,
-                         const protobuf::DeleteRequest &request,
-                         const transport::Info &info,
-                         const RequestAndSignature &request_signature,
-                         const asymm::PublicKey &public_key,
-                         const asymm::ValidationToken &public_key_validation,
-                         const bool is_refresh);
+   *  @return Indicating validation succeed or not. */
+  bool ValidateDelete(const KeyValueSignature &key_value_signature,
+                      const protobuf::DeleteRequest &request,
+                      const RequestAndSignature &request_signature,
+                      const asymm::PublicKey &public_key,
+                      const asymm::ValidationToken &public_key_validation,
+                      const bool is_refresh);
+  /** Delete the tuple once validated, and add the sender to the routing table.
+   *  @param[in] key_value_signature tuple of <key, value, signature>.
+   *  @param[in] info The rank info.
+   *  @param[in] request_signature The request signature.
+   *  @param[in] sender The sender of the delete or refresh.
+   *  @param[in] is_refresh Indicating a publish or a refresh */
+  void DeleteValidated(const KeyValueSignature &key_value_signature,
+                       const transport::Info &info,
+                       const RequestAndSignature &request_signature,
+                       const protobuf::Contact &sender,
+                       const bool is_refresh);
+  /** Runs check, then apply if check passed.  With crypto_pool_ set, check
+   *  runs on the pool and apply is posted to asio_service_, and the checks for
+   *  one key are run and applied one at a time in the order given.
+   *  @param[in] key The Kademlia key the check is for.
+   *  @param[in] check The signature checks.
+   *  @param[in] apply The data store and routing table work. */
+  void CheckThenApply(const std::string &key,
+                      CheckFunctor check,
+                      ApplyFunctor apply);
+  /** Hands the check at the front of key's queue to crypto_pool_. */
+  void StartCheck(const std::string &key, CheckFunctor check);
+  /** Applies the check at the front of key's queue if it passed, then starts
+   *  the next one for key. */
+  void CheckDone(const std::string &key, std::shared_ptr<bool> passed);
 
   void AddContactToRoutingTable(const Contact &contact,
                                 const transport::Info &info);
@@ -315,6 +496,8 @@ class Service : public std::enable_shared_from_this<Service> {
   std::shared_ptr<RoutingTable> routing_table_;
   /** data store */
   std::shared_ptr<DataStore> datastore_;
+  /** values cached by peers' lookups, held apart from the data store */
+  std::shared_ptr<ValueCache> value_cache_;
   /** Private Key */
   PrivateKeyPtr private_key_;
   /** bool switch of joined status */
@@ -331,6 +514,20 @@ class Service : public std::enable_shared_from_this<Service> {
   asymm::ValidatePublicKeyFunctor contact_validator_;
   asymm::ValidateFunctor validate_functor_;
   CheckCacheFunctor check_cache_functor_;
+  /** signatures already validated by asymm::Validate, shared with the data
+   *  store */
+  std::shared_ptr<SignatureCache> signature_cache_;
+  /** signatures already validated by validate_functor_ */
+  std::shared_ptr<SignatureCache> functor_signature_cache_;
+  /** senders' public keys fetched recently */
+  std::shared_ptr<PublicKeyCache> public_key_cache_;
+  /** runs the signature checks of stores and deletes off the asio threads */
+  std::shared_ptr<CryptoPool> crypto_pool_;
+  /** runs the work following each check on crypto_pool_ */
+  boost::asio::io_service *asio_service_;
+  /** checks not yet applied, by key, guarded by pending_checks_mutex_ */
+  std::map<std::string, std::deque<CheckAndApply>> pending_checks_;
+  boost::mutex pending_checks_mutex_;
 };
 
 }  // namespace dht
@@ -0,0 +1,242 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "maidsafe/dht/session_cache.h"
+
+#include "cryptopp/hmac.h"
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/utils.h"
+
+#ifdef __MSVC__
+#  pragma warning(push)
+#  pragma warning(disable: 4127 4244 4267)
+#endif
+#include "maidsafe/dht/rpcs.pb.h"
+#ifdef __MSVC__
+#  pragma warning(pop)
+#endif
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace {
+
+// A session key is an AES-256 key followed by a MAC key of the same length.
+const size_t kMacKeySize(32);
+const size_t kSessionKeySize(crypto::AES256_KeySize + kMacKeySize);
+
+typedef CryptoPP::HMAC<crypto::SHA512> Hmac;
+
+const unsigned char *Bytes(const std::string &data) {
+  return reinterpret_cast<const unsigned char*>(data.data());
+}
+
+// The MAC key is the part of the session key after the AES-256 key.
+std::string Mac(const std::string &session_key, const std::string &data) {
+  Hmac hmac(Bytes(session_key) + crypto::AES256_KeySize, kMacKeySize);
+  std::string mac(Hmac::DIGESTSIZE, 0);
+  hmac.CalculateDigest(reinterpret_cast<unsigned char*>(&mac[0]), Bytes(data),
+                       data.size());
+  return mac;
+}
+
+// Compares in time independent of where the MACs first differ.
+bool VerifyMac(const std::string &session_key,
+               const std::string &data,
+               const std::string &mac) {
+  if (mac.size() != static_cast<size_t>(Hmac::DIGESTSIZE))
+    return false;
+  Hmac hmac(Bytes(session_key) + crypto::AES256_KeySize, kMacKeySize);
+  return hmac.VerifyDigest(Bytes(mac), Bytes(data), data.size());
+}
+
+std::string MacInput(const bool &is_request,
+                     const protobuf::SessionMessage &session_message) {
+  return std::string(is_request ? "request" : "response") +
+         session_message.iv() + session_message.ciphertext();
+}
+
+}  // unnamed namespace
+
+SessionCache::SessionCache(PrivateKeyPtr private_key,
+                           const size_t &max_sessions,
+                           const bptime::time_duration &lifetime,
+                           const uint32_t &max_messages,
+                           const bptime::time_duration &fallback_period)
+    : private_key_(private_key),
+      kMaxSessions_(max_sessions),
+      kLifetime_(lifetime),
+      kMaxMessages_(max_messages),
+      kFallbackPeriod_(fallback_period),
+      outgoing_sessions_(max_sessions),
+      incoming_sessions_(max_sessions),
+      suspended_peers_(max_sessions),
+      mutex_() {}
+
+bool SessionCache::GetOutgoingSession(
+    const asymm::PublicKey &recipient_public_key,
+    std::string *session_key,
+    std::string *encrypted_session_key) {
+  if (!session_key || !encrypted_session_key)
+    return false;
+  std::string encoded_public_key;
+  asymm::EncodePublicKey(recipient_public_key, &encoded_public_key);
+  if (encoded_public_key.empty())
+    return false;
+  const bptime::ptime kNow(bptime::microsec_clock::universal_time());
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (suspended_peers_.Find(encoded_public_key, kNow))
+      return false;
+    Session *session(outgoing_sessions_.Find(encoded_public_key, kNow));
+    if (session) {
+      if (session->messages_remaining != 0) {
+        --session->messages_remaining;
+        *session_key = session->session_key;
+        *encrypted_session_key = session->encrypted_session_key;
+        return true;
+      }
+      outgoing_sessions_.Erase(encoded_public_key);
+    }
+  }
+
+  // Encrypt outside the lock, as this is the expensive step.
+  Session session;
+  session.session_key = RandomString(kSessionKeySize);
+  if (asymm::Encrypt(session.session_key, recipient_public_key,
+                     &session.encrypted_session_key) != kSuccess ||
+      session.encrypted_session_key.empty())
+    return false;
+  session.messages_remaining = kMaxMessages_ == 0 ? 0 : kMaxMessages_ - 1;
+  *session_key = session.session_key;
+  *encrypted_session_key = session.encrypted_session_key;
+  if (kMaxSessions_ == 0 || kMaxMessages_ == 0)
+    return true;
+  boost::mutex::scoped_lock lock(mutex_);
+  outgoing_sessions_.Insert(encoded_public_key, session, kNow + kLifetime_,
+                            kNow);
+  return true;
+}
+
+void SessionCache::SuspendOutgoingSessions(
+    const asymm::PublicKey &recipient_public_key) {
+  std::string encoded_public_key;
+  asymm::EncodePublicKey(recipient_public_key, &encoded_public_key);
+  if (encoded_public_key.empty())
+    return;
+  const bptime::ptime kNow(bptime::microsec_clock::universal_time());
+  boost::mutex::scoped_lock lock(mutex_);
+  outgoing_sessions_.Erase(encoded_public_key);
+  suspended_peers_.Insert(encoded_public_key, true, kNow + kFallbackPeriod_,
+                          kNow);
+}
+
+bool SessionCache::GetIncomingSession(const std::string &encrypted_session_key,
+                                      std::string *session_key) {
+  if (!session_key || encrypted_session_key.empty() || !private_key_)
+    return false;
+  const std::string kId(crypto::Hash<crypto::SHA512>(encrypted_session_key));
+  const bptime::ptime kNow(bptime::microsec_clock::universal_time());
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    const Session *session(incoming_sessions_.Find(kId, kNow));
+    if (session) {
+      *session_key = session->session_key;
+      return true;
+    }
+  }
+
+  Session session;
+  if (asymm::Decrypt(encrypted_session_key, *private_key_,
+                     &session.session_key) != kSuccess ||
+      session.session_key.size() != kSessionKeySize)
+    return false;
+  *session_key = session.session_key;
+  if (kMaxSessions_ == 0)
+    return true;
+  boost::mutex::scoped_lock lock(mutex_);
+  incoming_sessions_.Insert(kId, session, kNow + kLifetime_, kNow);
+  return true;
+}
+
+bool SessionCache::Seal(const std::string &session_key,
+                        const bool &is_request,
+                        const std::string &plain_text,
+                        protobuf::SessionMessage *session_message) {
+  if (session_key.size() != kSessionKeySize || !session_message)
+    return false;
+  session_message->set_iv(RandomString(crypto::AES256_IVSize));
+  session_message->set_ciphertext(crypto::SymmEncrypt(
+      plain_text,
+      session_key.substr(0, crypto::AES256_KeySize),
+      session_message->iv()));
+  if (session_message->ciphertext().empty())
+    return false;
+  session_message->set_mac(Mac(session_key,
+                               MacInput(is_request, *session_message)));
+  return true;
+}
+
+bool SessionCache::Open(const std::string &session_key,
+                        const bool &is_request,
+                        const protobuf::SessionMessage &session_message,
+                        std::string *plain_text) {
+  if (session_key.size() != kSessionKeySize || !plain_text ||
+      !session_message.IsInitialized() ||
+      session_message.iv().size() != crypto::AES256_IVSize)
+    return false;
+  if (!VerifyMac(session_key, MacInput(is_request, session_message),
+                 session_message.mac()))
+    return false;
+  *plain_text = crypto::SymmDecrypt(
+      session_message.ciphertext(),
+      session_key.substr(0, crypto::AES256_KeySize),
+      session_message.iv());
+  return !plain_text->empty();
+}
+
+void SessionCache::Clear() {
+  boost::mutex::scoped_lock lock(mutex_);
+  outgoing_sessions_.Clear();
+  incoming_sessions_.Clear();
+  suspended_peers_.Clear();
+}
+
+size_t SessionCache::OutgoingSize() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return outgoing_sessions_.Size();
+}
+
+size_t SessionCache::IncomingSize() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return incoming_sessions_.Size();
+}
+
+}  // namespace dht
+
+}  // namespace maidsafe
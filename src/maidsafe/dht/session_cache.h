@@ -0,0 +1,170 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAIDSAFE_DHT_SESSION_CACHE_H_
+#define MAIDSAFE_DHT_SESSION_CACHE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "boost/date_time/posix_time/posix_time_types.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include "maidsafe/dht/config.h"
+#include "maidsafe/dht/expiring_map.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace bptime = boost::posix_time;
+
+namespace protobuf {
+class SessionMessage;
+}  // namespace protobuf
+
+/**
+* @class SessionCache
+* Bounded, thread-safe cache of symmetric session keys, shared by all of a
+* node's RPCs.  The first message to a peer sets up a random session key and
+* encrypts it once to the peer's public key; later messages to that peer reuse
+* both, so only symmetric encryption is needed per message.  Likewise, a
+* received session key is decrypted with this node's private key only the
+* first time it is seen.  An outgoing session is replaced once its lifetime
+* passes or it has been used for its maximum number of messages.
+*/
+class SessionCache {
+ public:
+  /**
+  * @param[in] private_key This node's private key, used to decrypt the session
+  * keys chosen by peers.
+  * @param[in] max_sessions The maximum number of sessions held each way.  If
+  * 0, nothing is cached and every message sets up a new session.
+  * @param[in] lifetime The time for which a session key is used.
+  * @param[in] max_messages The number of messages after which an outgoing
+  * session key is replaced.
+  * @param[in] fallback_period The time for which no session is set up with a
+  * peer once SuspendOutgoingSessions has been called for it.
+  */
+  SessionCache(PrivateKeyPtr private_key,
+               const size_t &max_sessions,
+               const bptime::time_duration &lifetime,
+               const uint32_t &max_messages,
+               const bptime::time_duration &fallback_period);
+
+  /**
+  * Gets the session to use for a message to a peer, setting a new one up if
+  * there is no current one.
+  * @param[in] recipient_public_key The peer's public key.
+  * @param[out] session_key The symmetric session key.
+  * @param[out] encrypted_session_key session_key encrypted to the peer.
+  * @return True on success, false if sessions with the peer are suspended.
+  */
+  bool GetOutgoingSession(const asymm::PublicKey &recipient_public_key,
+                          std::string *session_key,
+                          std::string *encrypted_session_key);
+
+  /**
+  * Drops the outgoing session with a peer which didn't answer a session
+  * request, and sets up no other with it for the fallback period, so that
+  * messages to it go asymmetrically encrypted instead.
+  * @param[in] recipient_public_key The peer's public key.
+  */
+  void SuspendOutgoingSessions(const asymm::PublicKey &recipient_public_key);
+
+  /**
+  * Gets the session key chosen by a peer, decrypting it with this node's
+  * private key unless it has been seen already.
+  * @param[in] encrypted_session_key The session key as sent by the peer.
+  * @param[out] session_key The symmetric session key.
+  * @return True on success.
+  */
+  bool GetIncomingSession(const std::string &encrypted_session_key,
+                          std::string *session_key);
+
+  /**
+  * Encrypts plain_text under session_key with a fresh IV, then authenticates
+  * the IV and cipher text.  is_request is covered by the MAC, so a sealed
+  * request can't be replayed as a response or vice versa.
+  * @param[in] session_key The symmetric session key.
+  * @param[in] is_request Whether the message is a request.
+  * @param[in] plain_text The message to seal.
+  * @param[out] session_message The sealed message, without a session key.
+  * @return True on success.
+  */
+  static bool Seal(const std::string &session_key,
+                   const bool &is_request,
+                   const std::string &plain_text,
+                   protobuf::SessionMessage *session_message);
+
+  /**
+  * Authenticates and decrypts a message sealed by Seal.
+  * @param[in] session_key The symmetric session key.
+  * @param[in] is_request Whether the message is expected to be a request.
+  * @param[in] session_message The sealed message.
+  * @param[out] plain_text The message.
+  * @return True if the message is authentic and was decrypted.
+  */
+  static bool Open(const std::string &session_key,
+                   const bool &is_request,
+                   const protobuf::SessionMessage &session_message,
+                   std::string *plain_text);
+
+  void Clear();
+
+  size_t OutgoingSize();
+
+  size_t IncomingSize();
+
+ private:
+  struct Session {
+    Session()
+        : session_key(),
+          encrypted_session_key(),
+          messages_remaining(0) {}
+    std::string session_key, encrypted_session_key;
+    uint32_t messages_remaining;
+  };
+  typedef ExpiringMap<std::string, Session> SessionMap;
+  SessionCache(const SessionCache&);
+  SessionCache& operator=(const SessionCache&);
+  PrivateKeyPtr private_key_;
+  const size_t kMaxSessions_;
+  const bptime::time_duration kLifetime_;
+  const uint32_t kMaxMessages_;
+  const bptime::time_duration kFallbackPeriod_;
+  SessionMap outgoing_sessions_, incoming_sessions_;
+  // Peers with which sessions are suspended, keyed by encoded public key.
+  ExpiringMap<std::string, bool> suspended_peers_;
+  boost::mutex mutex_;
+};
+
+}  // namespace dht
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DHT_SESSION_CACHE_H_
@@ -0,0 +1,114 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "maidsafe/dht/signature_cache.h"
+
+#include "maidsafe/common/crypto.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace {
+
+bool RsaValidate(const asymm::PlainText &plain_text,
+                 const asymm::Signature &signature,
+                 const asymm::PublicKey &public_key) {
+  return asymm::Validate(plain_text, signature, public_key);
+}
+
+// Each component is hashed separately, so the fixed-length concatenation is
+// unambiguous.
+std::string SignatureId(const asymm::PlainText &plain_text,
+                        const asymm::Signature &signature,
+                        const asymm::PublicKey &public_key) {
+  std::string encoded_public_key;
+  asymm::EncodePublicKey(public_key, &encoded_public_key);
+  return crypto::Hash<crypto::SHA512>(plain_text) +
+         crypto::Hash<crypto::SHA512>(signature) +
+         crypto::Hash<crypto::SHA512>(encoded_public_key);
+}
+
+}  // unnamed namespace
+
+SignatureCache::SignatureCache(const size_t &max_size,
+                               const bptime::time_duration &time_to_live)
+    : kMaxSize_(max_size),
+      kTimeToLive_(time_to_live),
+      kValidateFunctor_(&RsaValidate),
+      entries_(max_size),
+      mutex_() {}
+
+SignatureCache::SignatureCache(const size_t &max_size,
+                               const bptime::time_duration &time_to_live,
+                               const asymm::ValidateFunctor &validate_functor)
+    : kMaxSize_(max_size),
+      kTimeToLive_(time_to_live),
+      kValidateFunctor_(validate_functor),
+      entries_(max_size),
+      mutex_() {}
+
+bool SignatureCache::Validate(const asymm::PlainText &plain_text,
+                              const asymm::Signature &signature,
+                              const asymm::PublicKey &public_key) {
+  if (kMaxSize_ == 0)
+    return kValidateFunctor_(plain_text, signature, public_key);
+  const std::string kId(SignatureId(plain_text, signature, public_key));
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (entries_.Find(kId, bptime::microsec_clock::universal_time()))
+      return true;
+  }
+
+  // Validate outside the lock, as this is the expensive step.
+  if (!kValidateFunctor_(plain_text, signature, public_key))
+    return false;
+
+  // A validator may accept a signature without checking it, e.g. the stub
+  // validate functor, so a pass against an invalid key isn't remembered.
+  if (!asymm::ValidateKey(public_key))
+    return true;
+
+  const bptime::ptime kNow(bptime::microsec_clock::universal_time());
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Insert(kId, true, kNow + kTimeToLive_, kNow);
+  return true;
+}
+
+void SignatureCache::Clear() {
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Clear();
+}
+
+size_t SignatureCache::Size() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return entries_.Size();
+}
+
+}  // namespace dht
+
+}  // namespace maidsafe
@@ -0,0 +1,103 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAIDSAFE_DHT_SIGNATURE_CACHE_H_
+#define MAIDSAFE_DHT_SIGNATURE_CACHE_H_
+
+#include <string>
+
+#include "boost/date_time/posix_time/posix_time_types.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include "maidsafe/dht/config.h"
+#include "maidsafe/dht/expiring_map.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace bptime = boost::posix_time;
+
+/**
+* @class SignatureCache
+* Bounded, thread-safe record of signatures which have already passed
+* validation by one validator.  A node's message handler, service and data
+* store share one which validates with asymm::Validate.  Each entry is keyed by
+* the digests of the signed data, the signature and the signer's public key,
+* so refreshes of the same signed store or delete from each of k peers cost a
+* single signature check per time to live.  Only successful validations
+* against a valid public key are recorded.
+*/
+class SignatureCache {
+ public:
+  /**
+  * @param[in] max_size The maximum number of signatures held.  If 0, nothing
+  * is ever held.
+  * @param[in] time_to_live The time for which each validation is reused.
+  */
+  SignatureCache(const size_t &max_size,
+                 const bptime::time_duration &time_to_live);
+
+  /**
+  * As above, validating with validate_functor rather than asymm::Validate.
+  * @param[in] validate_functor The check to run on a miss.
+  */
+  SignatureCache(const size_t &max_size,
+                 const bptime::time_duration &time_to_live,
+                 const asymm::ValidateFunctor &validate_functor);
+
+  /**
+  * Validates signature of plain_text against public_key using this cache's
+  * validator, unless this has already succeeded within the time to live.
+  * @param[in] plain_text The signed data.
+  * @param[in] signature The signature.
+  * @param[in] public_key The signer's public key.
+  * @return True if the signature is valid.
+  */
+  bool Validate(const asymm::PlainText &plain_text,
+                const asymm::Signature &signature,
+                const asymm::PublicKey &public_key);
+
+  void Clear();
+
+  size_t Size();
+
+ private:
+  SignatureCache(const SignatureCache&);
+  SignatureCache& operator=(const SignatureCache&);
+  const size_t kMaxSize_;
+  const bptime::time_duration kTimeToLive_;
+  const asymm::ValidateFunctor kValidateFunctor_;
+  ExpiringMap<std::string, bool> entries_;
+  boost::mutex mutex_;
+};
+
+}  // namespace dht
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DHT_SIGNATURE_CACHE_H_
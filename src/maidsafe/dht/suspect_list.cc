@@ -0,0 +1,91 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "maidsafe/dht/suspect_list.h"
+
+#include <functional>
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace {
+
+void AddSuspect(const Contact &contact, std::vector<Contact> *suspects) {
+  suspects->push_back(contact);
+}
+
+}  // unnamed namespace
+
+SuspectList::SuspectList(const size_t &max_size,
+                         const bptime::time_duration &time_to_live)
+    : kMaxSize_(max_size),
+      kTimeToLive_(time_to_live),
+      entries_(max_size),
+      mutex_() {}
+
+void SuspectList::Add(const Contact &contact) {
+  if (kMaxSize_ == 0)
+    return;
+  const bptime::ptime kNow(bptime::microsec_clock::universal_time());
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Insert(contact.node_id(), contact, kNow + kTimeToLive_, kNow);
+}
+
+void SuspectList::Remove(const NodeId &node_id) {
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Erase(node_id);
+}
+
+bool SuspectList::IsSuspect(const NodeId &node_id) {
+  boost::mutex::scoped_lock lock(mutex_);
+  return entries_.Find(node_id, bptime::microsec_clock::universal_time()) !=
+         NULL;
+}
+
+std::vector<Contact> SuspectList::GetSuspects() {
+  const bptime::ptime kNow(bptime::microsec_clock::universal_time());
+  std::vector<Contact> suspects;
+  boost::mutex::scoped_lock lock(mutex_);
+  suspects.reserve(entries_.Size());
+  entries_.ForEach(kNow, std::bind(&AddSuspect, args::_1, &suspects));
+  return suspects;
+}
+
+void SuspectList::Clear() {
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Clear();
+}
+
+size_t SuspectList::Size() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return entries_.Size();
+}
+
+}  // namespace dht
+
+}  // namespace maidsafe
@@ -0,0 +1,105 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAIDSAFE_DHT_SUSPECT_LIST_H_
+#define MAIDSAFE_DHT_SUSPECT_LIST_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "boost/date_time/posix_time/posix_time_types.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include "maidsafe/dht/contact.h"
+#include "maidsafe/dht/expiring_map.h"
+#include "maidsafe/dht/node_id.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace bptime = boost::posix_time;
+
+/**
+* @class SuspectList
+* Bounded, thread-safe set of contacts which recently failed to answer an RPC,
+* shared by all of a node's lookups.  A contact stops being a suspect once its
+* time to live passes or it next answers successfully.
+*/
+class SuspectList {
+ public:
+  /**
+  * @param[in] max_size The maximum number of suspects held.  If 0, nothing is
+  * ever held.
+  * @param[in] time_to_live The time for which each contact stays a suspect.
+  */
+  SuspectList(const size_t &max_size,
+              const bptime::time_duration &time_to_live);
+
+  /**
+  * Marks contact as a suspect, restarting its time to live if it already was.
+  * If full, expired suspects are purged, then the oldest is evicted.
+  * @param[in] contact The contact which has failed.
+  */
+  void Add(const Contact &contact);
+
+  /**
+  * Clears the given contact, e.g. after it has answered an RPC.
+  * @param[in] node_id The ID of the contact.
+  */
+  void Remove(const NodeId &node_id);
+
+  /**
+  * @param[in] node_id The ID of the contact.
+  * @return True if the contact is an unexpired suspect.
+  */
+  bool IsSuspect(const NodeId &node_id);
+
+  /**
+  * Gets all unexpired suspects, e.g. for use as routing table excludes.
+  * @return The suspect contacts.
+  */
+  std::vector<Contact> GetSuspects();
+
+  void Clear();
+
+  size_t Size();
+
+ private:
+  SuspectList(const SuspectList&);
+  SuspectList& operator=(const SuspectList&);
+  const size_t kMaxSize_;
+  const bptime::time_duration kTimeToLive_;
+  ExpiringMap<NodeId, Contact> entries_;
+  boost::mutex mutex_;
+};
+
+}  // namespace dht
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DHT_SUSPECT_LIST_H_
@@ -0,0 +1,112 @@
+/* Copyright (c) 2011 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/dht/closest_contacts_cache.h"
+#include "maidsafe/dht/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace test {
+
+namespace {
+const uint16_t g_kKademliaK = 8;
+}  // unnamed namespace
+
+class ClosestContactsCacheTest : public CreateContactAndNodeId,
+                                 public testing::Test {
+ public:
+  ClosestContactsCacheTest()
+      : CreateContactAndNodeId(g_kKademliaK),
+        cache_(3, bptime::hours(1)),
+        contacts_() {
+    for (Port port = 5000; port != 5000 + g_kKademliaK; ++port)
+      contacts_.push_back(ComposeContact(NodeId(NodeId::kRandomId), port));
+  }
+
+ protected:
+  ClosestContactsCache cache_;
+  std::vector<Contact> contacts_;
+};
+
+TEST_F(ClosestContactsCacheTest, BEH_AddAndGet) {
+  NodeId target(NodeId::kRandomId);
+  std::vector<Contact> result;
+  EXPECT_FALSE(cache_.Get(target, g_kKademliaK, &result));
+  EXPECT_FALSE(cache_.Get(target, g_kKademliaK, nullptr));
+  cache_.Add(target, std::vector<Contact>());
+  EXPECT_EQ(0U, cache_.Size());
+
+  cache_.Add(target, contacts_);
+  EXPECT_EQ(1U, cache_.Size());
+  EXPECT_TRUE(cache_.Get(target, g_kKademliaK, &result));
+  EXPECT_EQ(contacts_, result);
+  // fewer contacts are returned closest first, more are unavailable
+  EXPECT_TRUE(cache_.Get(target, 2, &result));
+  ASSERT_EQ(2U, result.size());
+  EXPECT_EQ(contacts_[0], result[0]);
+  EXPECT_EQ(contacts_[1], result[1]);
+  EXPECT_FALSE(cache_.Get(target, g_kKademliaK + 1, &result));
+  EXPECT_FALSE(cache_.Get(NodeId(NodeId::kRandomId), 1, &result));
+
+  // a later lookup replaces the entry
+  cache_.Add(target, std::vector<Contact>(1, contacts_.back()));
+  EXPECT_EQ(1U, cache_.Size());
+  EXPECT_TRUE(cache_.Get(target, 1, &result));
+  EXPECT_EQ(std::vector<Contact>(1, contacts_.back()), result);
+
+  cache_.Clear();
+  EXPECT_EQ(0U, cache_.Size());
+  EXPECT_FALSE(cache_.Get(target, 1, &result));
+}
+
+TEST_F(ClosestContactsCacheTest, BEH_Invalidate) {
+  NodeId target(NodeId::kRandomId), other_target(NodeId::kRandomId);
+  cache_.Add(target, contacts_);
+  cache_.Add(other_target,
+             std::vector<Contact>(contacts_.begin() + 1, contacts_.end()));
+  cache_.Invalidate(NodeId(NodeId::kRandomId));
+  EXPECT_EQ(2U, cache_.Size());
+  // only entries holding the failed contact are dropped
+  std::vector<Contact> result;
+  cache_.Invalidate(contacts_.front().node_id());
+  EXPECT_EQ(1U, cache_.Size());
+  EXPECT_FALSE(cache_.Get(target, 1, &result));
+  EXPECT_TRUE(cache_.Get(other_target, 1, &result));
+  cache_.Invalidate(contacts_.back().node_id());
+  EXPECT_EQ(0U, cache_.Size());
+}
+
+}  // namespace test
+
+}  // namespace dht
+
+}  // namespace maidsafe
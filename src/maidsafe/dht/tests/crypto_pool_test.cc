@@ -0,0 +1,104 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <functional>
+
+#include "boost/asio/io_service.hpp"
+#include "boost/thread/locks.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/dht/crypto_pool.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace test {
+
+namespace {
+
+void Increment(boost::mutex *mutex, int *count) {
+  boost::mutex::scoped_lock lock(*mutex);
+  ++(*count);
+}
+
+void Block(boost::mutex *mutex) {
+  boost::mutex::scoped_lock lock(*mutex);
+}
+
+}  // unnamed namespace
+
+TEST(CryptoPoolTest, BEH_PostAndComplete) {
+  boost::asio::io_service asio_service;
+  boost::mutex mutex;
+  int task_count(0), completion_count(0);
+  {
+    CryptoPool crypto_pool(2, 100, 4);
+    for (int i(0); i != 50; ++i) {
+      EXPECT_TRUE(crypto_pool.Post(std::bind(&Increment, &mutex, &task_count),
+                                   asio_service,
+                                   std::bind(&Increment, &mutex,
+                                             &completion_count)));
+    }
+    crypto_pool.Stop();
+    EXPECT_EQ(0U, crypto_pool.QueueSize());
+  }
+  EXPECT_EQ(50, task_count);
+  // Completions only run on the completion service
+  EXPECT_EQ(0, completion_count);
+  asio_service.run();
+  EXPECT_EQ(50, completion_count);
+}
+
+TEST(CryptoPoolTest, BEH_QueueBound) {
+  CryptoPool crypto_pool(1, 2, 1);
+  boost::mutex block_mutex, count_mutex;
+  int count(0);
+  {
+    boost::mutex::scoped_lock lock(block_mutex);
+    EXPECT_TRUE(crypto_pool.Post(std::bind(&Block, &block_mutex)));
+    // Wait for the worker to take the blocking task
+    while (crypto_pool.QueueSize() != 0)
+      boost::this_thread::yield();
+    EXPECT_TRUE(crypto_pool.Post(std::bind(&Increment, &count_mutex, &count)));
+    EXPECT_TRUE(crypto_pool.Post(std::bind(&Increment, &count_mutex, &count)));
+    EXPECT_FALSE(crypto_pool.Post(std::bind(&Increment, &count_mutex,
+                                            &count)));
+    EXPECT_EQ(2U, crypto_pool.QueueSize());
+  }
+  crypto_pool.Stop();
+  EXPECT_EQ(2, count);
+  EXPECT_FALSE(crypto_pool.Post(std::bind(&Increment, &count_mutex, &count)));
+  EXPECT_EQ(2, count);
+}
+
+}  // namespace test
+
+}  // namespace dht
+
+}  // namespace maidsafe
@@ -611,6 +611,10 @@ TEST_F(DataStoreTest, BEH_GetValues) {
   EXPECT_FALSE(data_store_->GetValues(common_key, &values));
   EXPECT_TRUE(values.empty());
   values.push_back(std::make_pair("a", "b"));
+  RequestAndSignature request_and_signature;
+  EXPECT_FALSE(data_store_->GetStoreRequest(common_key, nullptr));
+  EXPECT_FALSE(data_store_->GetStoreRequest(common_key,
+                                            &request_and_signature));
 
   // Store first key and create and store other values under same key
   EXPECT_EQ(kSuccess, data_store_->StoreValue(kvts.at(0).key_value_signature,
@@ -649,6 +653,9 @@ TEST_F(DataStoreTest, BEH_GetValues) {
     EXPECT_EQ(kvts.at(i).key_value_signature.value, values.at(i).first);
     EXPECT_EQ(kvts.at(i).key_value_signature.signature, values.at(i).second);
   }
+  EXPECT_TRUE(data_store_->GetStoreRequest(common_key,
+                                           &request_and_signature));
+  EXPECT_EQ(kvts.at(0).request_and_signature, request_and_signature);
 
   // Retrieve values for all other keys
   for (size_t i = kRepeatedValues; i != kvts.size(); ++i) {
@@ -677,6 +684,8 @@ TEST_F(DataStoreTest, BEH_GetValues) {
               kvts.at(kRepeatedValues - 1).request_and_signature, false));
   EXPECT_FALSE(data_store_->GetValues(common_key, &values));
   EXPECT_TRUE(values.empty());
+  EXPECT_FALSE(data_store_->GetStoreRequest(common_key,
+                                            &request_and_signature));
 
   // Delete other key,value pairs
   for (size_t i = kRepeatedValues; i != kvts.size(); ++i) {
@@ -0,0 +1,171 @@
+/* Copyright (c) 2011 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/dht/expiring_map.h"
+#include "maidsafe/dht/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace test {
+
+namespace {
+
+void Collect(const int &value, std::vector<int> *values) {
+  values->push_back(value);
+}
+
+bool IsEven(const int &value) {
+  return value % 2 == 0;
+}
+
+}  // unnamed namespace
+
+class ExpiringMapTest : public testing::Test {
+ public:
+  ExpiringMapTest()
+      : now_(bptime::time_from_string("2011-11-11 11:11:11")),
+        map_(3) {}
+
+ protected:
+  bptime::ptime now_;
+  ExpiringMap<std::string, int> map_;
+};
+
+TEST_F(ExpiringMapTest, BEH_InsertAndFind) {
+  EXPECT_EQ(NULL, map_.Find("a", now_));
+  int *value(map_.Insert("a", 1, now_ + bptime::seconds(10), now_));
+  ASSERT_NE(static_cast<int*>(NULL), value);
+  EXPECT_EQ(1, *value);
+  ASSERT_NE(static_cast<int*>(NULL), map_.Find("a", now_));
+  EXPECT_EQ(1, *map_.Find("a", now_));
+
+  // Values can be modified in place
+  *map_.Find("a", now_) = 2;
+  EXPECT_EQ(2, *map_.Find("a", now_));
+
+  // Re-inserting replaces both value and expiry time
+  map_.Insert("a", 3, now_ + bptime::seconds(20), now_);
+  EXPECT_EQ(1U, map_.Size());
+  ASSERT_NE(static_cast<int*>(NULL),
+            map_.Find("a", now_ + bptime::seconds(15)));
+  EXPECT_EQ(3, *map_.Find("a", now_ + bptime::seconds(15)));
+}
+
+TEST_F(ExpiringMapTest, BEH_Expiry) {
+  map_.Insert("a", 1, now_ + bptime::seconds(10), now_);
+  map_.Insert("b", 2, now_ + bptime::seconds(20), now_);
+  EXPECT_NE(static_cast<int*>(NULL),
+            map_.Find("a", now_ + bptime::seconds(9)));
+  EXPECT_EQ(NULL, map_.Find("a", now_ + bptime::seconds(10)));
+  EXPECT_EQ(1U, map_.Size());
+  EXPECT_EQ(NULL, map_.Find("a", now_));
+  EXPECT_NE(static_cast<int*>(NULL),
+            map_.Find("b", now_ + bptime::seconds(10)));
+}
+
+TEST_F(ExpiringMapTest, BEH_Eviction) {
+  map_.Insert("a", 1, now_ + bptime::seconds(30), now_);
+  map_.Insert("b", 2, now_ + bptime::seconds(10), now_);
+  map_.Insert("c", 3, now_ + bptime::seconds(20), now_);
+  EXPECT_EQ(3U, map_.Size());
+
+  // Replacing an existing key doesn't evict
+  map_.Insert("a", 4, now_ + bptime::seconds(30), now_);
+  EXPECT_EQ(3U, map_.Size());
+  EXPECT_NE(static_cast<int*>(NULL), map_.Find("b", now_));
+
+  // A new key evicts the entry closest to expiry
+  map_.Insert("d", 5, now_ + bptime::seconds(40), now_);
+  EXPECT_EQ(3U, map_.Size());
+  EXPECT_EQ(NULL, map_.Find("b", now_));
+  EXPECT_NE(static_cast<int*>(NULL), map_.Find("a", now_));
+  EXPECT_NE(static_cast<int*>(NULL), map_.Find("c", now_));
+  EXPECT_NE(static_cast<int*>(NULL), map_.Find("d", now_));
+
+  // Expired entries are purged before anything unexpired is evicted
+  map_.Insert("e", 6, now_ + bptime::seconds(50), now_ + bptime::seconds(35));
+  EXPECT_EQ(2U, map_.Size());
+  EXPECT_NE(static_cast<int*>(NULL),
+            map_.Find("d", now_ + bptime::seconds(35)));
+  EXPECT_NE(static_cast<int*>(NULL),
+            map_.Find("e", now_ + bptime::seconds(35)));
+
+  ExpiringMap<std::string, int> empty_map(0);
+  EXPECT_EQ(NULL, empty_map.Insert("a", 1, now_ + bptime::seconds(10), now_));
+  EXPECT_EQ(0U, empty_map.Size());
+  EXPECT_EQ(NULL, empty_map.Find("a", now_));
+}
+
+TEST_F(ExpiringMapTest, BEH_Erase) {
+  map_.Insert("a", 1, now_ + bptime::seconds(10), now_);
+  map_.Insert("b", 2, now_ + bptime::seconds(10), now_);
+  map_.Insert("c", 3, now_ + bptime::seconds(10), now_);
+  EXPECT_TRUE(map_.Erase("a"));
+  EXPECT_FALSE(map_.Erase("a"));
+  EXPECT_EQ(NULL, map_.Find("a", now_));
+  EXPECT_EQ(2U, map_.Size());
+
+  map_.EraseIf(&IsEven);
+  EXPECT_EQ(1U, map_.Size());
+  EXPECT_EQ(NULL, map_.Find("b", now_));
+  EXPECT_NE(static_cast<int*>(NULL), map_.Find("c", now_));
+
+  map_.Clear();
+  EXPECT_EQ(0U, map_.Size());
+}
+
+TEST_F(ExpiringMapTest, BEH_ForEach) {
+  map_.Insert("a", 1, now_ + bptime::seconds(10), now_);
+  map_.Insert("b", 2, now_ + bptime::seconds(20), now_);
+  map_.Insert("c", 3, now_ + bptime::seconds(30), now_);
+  std::vector<int> values;
+  map_.ForEach(now_, std::bind(&Collect, args::_1, &values));
+  ASSERT_EQ(3U, values.size());
+  EXPECT_EQ(1, values[0]);
+  EXPECT_EQ(2, values[1]);
+  EXPECT_EQ(3, values[2]);
+
+  values.clear();
+  map_.ForEach(now_ + bptime::seconds(20),
+               std::bind(&Collect, args::_1, &values));
+  ASSERT_EQ(1U, values.size());
+  EXPECT_EQ(3, values[0]);
+  EXPECT_EQ(1U, map_.Size());
+}
+
+}  // namespace test
+
+}  // namespace dht
+
+}  // namespace maidsafe
@@ -0,0 +1,188 @@
+/* Copyright (c) 2011 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <vector>
+
+#include "boost/asio/io_service.hpp"
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/dht/lookup_scheduler.h"
+
+namespace args = std::placeholders;
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace test {
+
+namespace {
+
+void HoldSlot(LookupScheduler::SlotPtr slot,
+              LookupScheduler::Priority priority,
+              std::vector<LookupScheduler::SlotPtr> *slots,
+              std::vector<LookupScheduler::Priority> *started) {
+  slots->push_back(slot);
+  started->push_back(priority);
+}
+
+}  // unnamed namespace
+
+class LookupSchedulerTest : public testing::Test {
+ public:
+  LookupSchedulerTest()
+      : asio_service_(),
+        scheduler_(new LookupScheduler(asio_service_, 4, 4, 2, 1,
+                                               4, 4, 2, 1)),
+        slots_(),
+        started_() {}
+
+ protected:
+  void Schedule(LookupScheduler::Priority priority) {
+    scheduler_->Schedule(priority, std::bind(&HoldSlot, args::_1, priority,
+                                             &slots_, &started_));
+  }
+  void ScheduleRpc(LookupScheduler::Priority priority) {
+    scheduler_->ScheduleRpc(priority, std::bind(&HoldSlot, args::_1, priority,
+                                                &slots_, &started_));
+  }
+  void QueueRpc(LookupScheduler::Priority priority) {
+    scheduler_->QueueRpc(priority, std::bind(&HoldSlot, args::_1, priority,
+                                             &slots_, &started_));
+  }
+  boost::asio::io_service asio_service_;
+  std::shared_ptr<LookupScheduler> scheduler_;
+  std::vector<LookupScheduler::SlotPtr> slots_;
+  std::vector<LookupScheduler::Priority> started_;
+};
+
+TEST_F(LookupSchedulerTest, BEH_PerClassLimits) {
+  // Lookups start immediately while their class and the total have room
+  Schedule(LookupScheduler::kMaintenance);
+  Schedule(LookupScheduler::kMaintenance);
+  Schedule(LookupScheduler::kMaintenance);
+  Schedule(LookupScheduler::kBulk);
+  Schedule(LookupScheduler::kBulk);
+  EXPECT_EQ(3U, started_.size());
+  EXPECT_EQ(2U, scheduler_->RunningCount(LookupScheduler::kMaintenance));
+  EXPECT_EQ(1U, scheduler_->QueuedCount(LookupScheduler::kMaintenance));
+  EXPECT_EQ(1U, scheduler_->RunningCount(LookupScheduler::kBulk));
+  EXPECT_EQ(1U, scheduler_->QueuedCount(LookupScheduler::kBulk));
+
+  // Interactive lookups aren't held up by the queued ones
+  Schedule(LookupScheduler::kInteractive);
+  EXPECT_EQ(4U, started_.size());
+  EXPECT_EQ(LookupScheduler::kInteractive, started_.back());
+
+  // Freeing a bulk slot starts the queued bulk lookup once posted
+  slots_.erase(slots_.begin() + 2);
+  EXPECT_EQ(4U, started_.size());
+  asio_service_.poll();
+  EXPECT_EQ(5U, started_.size());
+  EXPECT_EQ(LookupScheduler::kBulk, started_.back());
+  EXPECT_EQ(1U, scheduler_->QueuedCount(LookupScheduler::kMaintenance));
+  EXPECT_EQ(0U, scheduler_->QueuedCount(LookupScheduler::kBulk));
+}
+
+TEST_F(LookupSchedulerTest, BEH_WeightedDequeue) {
+  // Fill every slot, then queue plenty of each class
+  for (int i = 0; i != 4; ++i)
+    Schedule(LookupScheduler::kInteractive);
+  for (int i = 0; i != 8; ++i) {
+    Schedule(LookupScheduler::kInteractive);
+    Schedule(LookupScheduler::kMaintenance);
+    Schedule(LookupScheduler::kBulk);
+  }
+  ASSERT_EQ(4U, started_.size());
+  started_.clear();
+
+  // Free and refill one slot at a time, seven times over
+  for (int i = 0; i != 7; ++i) {
+    slots_.erase(slots_.begin());
+    asio_service_.poll();
+    asio_service_.reset();
+  }
+  ASSERT_EQ(7U, started_.size());
+  int counts[LookupScheduler::kPriorityCount] = {0, 0, 0};
+  for (auto it = started_.begin(); it != started_.end(); ++it)
+    ++counts[*it];
+  // Every class gets a turn, interactive most often
+  EXPECT_EQ(4, counts[LookupScheduler::kInteractive]);
+  EXPECT_EQ(2, counts[LookupScheduler::kMaintenance]);
+  EXPECT_EQ(1, counts[LookupScheduler::kBulk]);
+
+  // Slots may safely outlive the scheduler
+  scheduler_.reset();
+  slots_.clear();
+  EXPECT_EQ(0U, asio_service_.poll());
+}
+
+TEST_F(LookupSchedulerTest, BEH_RpcLimits) {
+  // RPCs are limited separately from lookups
+  for (int i = 0; i != 4; ++i)
+    Schedule(LookupScheduler::kInteractive);
+  ScheduleRpc(LookupScheduler::kMaintenance);
+  ScheduleRpc(LookupScheduler::kMaintenance);
+  EXPECT_EQ(6U, started_.size());
+  EXPECT_EQ(2U, scheduler_->RpcsInFlight(LookupScheduler::kMaintenance));
+
+  // A full class gets no slot, and its further RPCs are queued
+  EXPECT_FALSE(scheduler_->TryAcquireRpcSlot(LookupScheduler::kMaintenance));
+  ScheduleRpc(LookupScheduler::kMaintenance);
+  EXPECT_EQ(1U, scheduler_->QueuedRpcCount(LookupScheduler::kMaintenance));
+
+  // A queued RPC is only sent once posted, even if there is room for it
+  LookupScheduler::SlotPtr bulk_slot(
+      scheduler_->TryAcquireRpcSlot(LookupScheduler::kBulk));
+  ASSERT_TRUE(bulk_slot);
+  EXPECT_FALSE(scheduler_->TryAcquireRpcSlot(LookupScheduler::kBulk));
+  bulk_slot->Release();
+  bulk_slot->Release();
+  EXPECT_EQ(0U, scheduler_->RpcsInFlight(LookupScheduler::kBulk));
+  QueueRpc(LookupScheduler::kBulk);
+  EXPECT_EQ(6U, started_.size());
+  asio_service_.poll();
+  asio_service_.reset();
+  EXPECT_EQ(7U, started_.size());
+  EXPECT_EQ(LookupScheduler::kBulk, started_.back());
+
+  // Releasing a slot sends the queued RPC of its class, once only
+  slots_[4]->Release();
+  slots_[4]->Release();
+  asio_service_.poll();
+  EXPECT_EQ(8U, started_.size());
+  EXPECT_EQ(LookupScheduler::kMaintenance, started_.back());
+  EXPECT_EQ(2U, scheduler_->RpcsInFlight(LookupScheduler::kMaintenance));
+  EXPECT_EQ(0U, scheduler_->QueuedRpcCount(LookupScheduler::kMaintenance));
+  EXPECT_EQ(4U, scheduler_->RunningCount(LookupScheduler::kInteractive));
+}
+
+}  // namespace test
+
+}  // namespace dht
+
+}  // namespace maidsafe
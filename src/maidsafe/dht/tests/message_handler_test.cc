@@ -36,6 +36,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "maidsafe/dht/config.h"
 #include "maidsafe/dht/message_handler.h"
+#include "maidsafe/dht/session_cache.h"
 #include "maidsafe/dht/utils.h"
 
 #ifdef __MSVC__
@@ -261,6 +262,17 @@ class KademliaMessageHandlerTest: public testing::Test {
       ++((*it).second);
   }
 
+  void StoreBatchRequestSlot(const transport::Info&,
+                             const dht::protobuf::StoreBatchRequest&,
+                             dht::protobuf::StoreBatchResponse* response,
+                             transport::Timeout*) {
+    boost::mutex::scoped_lock lock(slots_mutex_);
+    auto it = invoked_slots_->find(kStoreBatchRequest);
+    if (it != invoked_slots_->end())
+      ++((*it).second);
+    response->set_result(true);
+  }
+
   void InitialiseMap() {
     invoked_slots_.reset(new std::map<MessageType, uint16_t>);
     for (int n = kPingRequest; n <= kDownlistNotification; ++n)
@@ -314,6 +326,9 @@ class KademliaMessageHandlerTest: public testing::Test {
     msg_hndlr_->on_downlist_notification()->connect(std::bind(
         &KademliaMessageHandlerTest::DownlistNotificationSlot, this, args::_1,
         args::_2));
+    msg_hndlr_->on_store_batch_request()->connect(std::bind(
+        &KademliaMessageHandlerTest::StoreBatchRequestSlot,
+        this, args::_1, args::_2, args::_3, args::_4));
   }
 
   std::vector<std::string> CreateMessages() {
@@ -1200,6 +1215,48 @@ TEST_F(KademliaMessageHandlerTest, BEH_ProcessSerialisedMessageFNodeRqst) {
   ASSERT_EQ(1U, total);
 }
 
+TEST_F(KademliaMessageHandlerTest, BEH_ProcessSerialisedMessageSBatchRqst) {
+  InitialiseMap();
+  invoked_slots_->insert(std::pair<MessageType, uint16_t>(kStoreBatchRequest,
+                                                          0));
+  ConnectToHandlerSignals();
+  transport::Info info;
+  dht::protobuf::Contact contact;
+  contact.set_node_id("test");
+  std::string encode_pub_key;
+  asymm::EncodePublicKey(rsa_keypair_.public_key, &encode_pub_key);
+  contact.set_public_key(encode_pub_key);
+  std::string message_signature;
+  std::string *message_response = new std::string;
+  transport::Timeout *timeout = new transport::Timeout;
+
+  int message_type = kStoreBatchRequest;
+  dht::protobuf::StoreBatchRequest request;
+  request.mutable_sender()->CopyFrom(contact);
+  request.add_serialised_store_requests("StoreBatch_request");
+  request.add_serialised_store_request_signatures("StoreBatch_signature");
+  std::string payload = request.SerializeAsString();
+  ASSERT_TRUE(request.IsInitialized());
+
+  // The batch isn't signed as a whole; its store requests carry signatures
+  asymm::Sign(boost::lexical_cast<std::string>(message_type) + payload,
+              rsa_keypair_.private_key, &message_signature);
+  msg_hndlr_->ProcessSerialisedMessage(message_type, payload,
+                                      kSign | kAsymmetricEncrypt,
+                                      message_signature, info,
+                                      message_response, timeout);
+  auto it = invoked_slots_->find(kStoreBatchRequest);
+  int total = (*it).second;
+  ASSERT_EQ(0U, total);
+
+  msg_hndlr_->ProcessSerialisedMessage(message_type, payload,
+                                      kAsymmetricEncrypt, "", info,
+                                      message_response, timeout);
+  it = invoked_slots_->find(kStoreBatchRequest);
+  total = (*it).second;
+  ASSERT_EQ(1U, total);
+}
+
 TEST_F(KademliaMessageHandlerTest, BEH_ProcessSerialisedMessageFNodeRsp) {
   InitialiseMap();
   ConnectToHandlerSignals();
@@ -1637,6 +1694,131 @@ TEST_F(KademliaMessageHandlerTest, BEH_ProcessSerialisedMessageDownlist) {
   ASSERT_EQ(1U, total);
 }
 
+TEST_F(KademliaMessageHandlerTest, BEH_ProcessSerialisedMessageSession) {
+  InitialiseMap();
+  ConnectToHandlerSignals();
+  transport::Info info;
+  dht::protobuf::Contact contact;
+  contact.set_node_id("test");
+  std::string encode_pub_key;
+  asymm::EncodePublicKey(rsa_keypair_.public_key, &encode_pub_key);
+  contact.set_public_key(encode_pub_key);
+  std::string message_response;
+  transport::Timeout timeout;
+
+  asymm::Keys sender_keys;
+  asymm::GenerateKeyPair(&sender_keys);
+  SessionCache sender_cache(
+      PrivateKeyPtr(new asymm::PrivateKey(sender_keys.private_key)),
+      kMaxSessionKeys, kSessionKeyLifetime, kMaxSessionMessages,
+      kSessionFallbackPeriod);
+  std::shared_ptr<SessionCache> receiver_cache(new SessionCache(
+      PrivateKeyPtr(new asymm::PrivateKey(rsa_keypair_.private_key)),
+      kMaxSessionKeys, kSessionKeyLifetime, kMaxSessionMessages,
+      kSessionFallbackPeriod));
+  std::string session_key, encrypted_session_key;
+  ASSERT_TRUE(sender_cache.GetOutgoingSession(rsa_keypair_.public_key,
+                                              &session_key,
+                                              &encrypted_session_key));
+
+  dht::protobuf::PingRequest request;
+  request.set_ping("ping");
+  request.mutable_sender()->CopyFrom(contact);
+  dht::protobuf::SessionPayload session_payload;
+  session_payload.set_message_type(kPingRequest);
+  session_payload.set_payload(request.SerializeAsString());
+  dht::protobuf::SessionMessage session_message;
+  ASSERT_TRUE(SessionCache::Seal(session_key, true,
+                                 session_payload.SerializeAsString(),
+                                 &session_message));
+  session_message.set_encrypted_session_key(encrypted_session_key);
+  std::string payload(session_message.SerializeAsString());
+
+  // Session requests can't be read without a session cache
+  msg_hndlr_->ProcessSerialisedMessage(kSessionRequest, payload, kNone, "",
+                                       info, &message_response, &timeout);
+  EXPECT_EQ(0U, (*invoked_slots_->find(kPingRequest)).second);
+  msg_hndlr_->set_session_cache(receiver_cache);
+  msg_hndlr_->ProcessSerialisedMessage(kSessionRequest, payload,
+                                       kAsymmetricEncrypt, "", info,
+                                       &message_response, &timeout);
+  EXPECT_EQ(0U, (*invoked_slots_->find(kPingRequest)).second);
+  msg_hndlr_->ProcessSerialisedMessage(kSessionRequest, payload, kNone, "",
+                                       info, &message_response, &timeout);
+  EXPECT_EQ(1U, (*invoked_slots_->find(kPingRequest)).second);
+  EXPECT_FALSE(message_response.empty());
+  EXPECT_EQ(1U, receiver_cache->IncomingSize());
+
+  // The session key is decrypted once and reused
+  msg_hndlr_->ProcessSerialisedMessage(kSessionRequest, payload, kNone, "",
+                                       info, &message_response, &timeout);
+  EXPECT_EQ(2U, (*invoked_slots_->find(kPingRequest)).second);
+  EXPECT_EQ(1U, receiver_cache->IncomingSize());
+
+  // Responses and signed messages can't be carried in a session request
+  dht::protobuf::PingResponse response;
+  response.set_echo("ping");
+  session_payload.set_message_type(kPingResponse);
+  session_payload.set_payload(response.SerializeAsString());
+  ASSERT_TRUE(SessionCache::Seal(session_key, true,
+                                 session_payload.SerializeAsString(),
+                                 &session_message));
+  msg_hndlr_->ProcessSerialisedMessage(kSessionRequest,
+                                       session_message.SerializeAsString(),
+                                       kNone, "", info, &message_response,
+                                       &timeout);
+  EXPECT_EQ(0U, (*invoked_slots_->find(kPingResponse)).second);
+  EXPECT_TRUE(message_response.empty());
+
+  // Tampered session requests are dropped
+  session_message.ParseFromString(payload);
+  session_message.set_mac(RandomString(session_message.mac().size()));
+  msg_hndlr_->ProcessSerialisedMessage(kSessionRequest,
+                                       session_message.SerializeAsString(),
+                                       kNone, "", info, &message_response,
+                                       &timeout);
+  EXPECT_EQ(2U, (*invoked_slots_->find(kPingRequest)).second);
+  EXPECT_TRUE(message_response.empty());
+}
+
+TEST_F(KademliaMessageHandlerTest, BEH_WrapSessionFallback) {
+  dht::protobuf::PingRequest request;
+  request.set_ping("ping");
+  dht::protobuf::Contact contact;
+  contact.set_node_id("test");
+  request.mutable_sender()->CopyFrom(contact);
+  asymm::Keys recipient_keys;
+  asymm::GenerateKeyPair(&recipient_keys);
+
+  // Without a session there is nothing to fall back from
+  std::string message(msg_hndlr_->WrapMessage(request,
+                                              recipient_keys.public_key));
+  ASSERT_FALSE(message.empty());
+  EXPECT_EQ(kAsymmetricEncrypt, message.at(0));
+  EXPECT_TRUE(msg_hndlr_->WrapSessionFallback().empty());
+
+  std::shared_ptr<SessionCache> session_cache(new SessionCache(
+      PrivateKeyPtr(new asymm::PrivateKey(rsa_keypair_.private_key)),
+      kMaxSessionKeys, kSessionKeyLifetime, kMaxSessionMessages,
+      kSessionFallbackPeriod));
+  msg_hndlr_->set_session_cache(session_cache);
+  message = msg_hndlr_->WrapMessage(request, recipient_keys.public_key);
+  ASSERT_FALSE(message.empty());
+  EXPECT_EQ(kNone, message.at(0));
+  EXPECT_EQ(1U, session_cache->OutgoingSize());
+
+  // The fallback carries the same request asymmetrically encrypted, and
+  // suspends sessions with the recipient
+  std::string fallback(msg_hndlr_->WrapSessionFallback());
+  ASSERT_FALSE(fallback.empty());
+  EXPECT_EQ(kAsymmetricEncrypt, fallback.at(0));
+  EXPECT_EQ(fallback, msg_hndlr_->WrapSessionFallback());
+  EXPECT_EQ(0U, session_cache->OutgoingSize());
+  message = msg_hndlr_->WrapMessage(request, recipient_keys.public_key);
+  ASSERT_FALSE(message.empty());
+  EXPECT_EQ(kAsymmetricEncrypt, message.at(0));
+}
+
 TEST_F(KademliaMessageHandlerTest, FUNC_ThreadedMessageHandling) {
   ConnectToHandlerSignals();
   InitialiseMap();
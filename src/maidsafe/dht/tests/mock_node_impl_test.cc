@@ -25,6 +25,7 @@ TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <algorithm>
 #include <bitset>
 
 #include "boost/lexical_cast.hpp"
@@ -46,6 +47,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "maidsafe/transport/transport.h"
 #include "maidsafe/transport/utils.h"
 
+#include "maidsafe/dht/closest_contacts_cache.h"
 #include "maidsafe/dht/contact.h"
 #include "maidsafe/dht/data_store.h"
 #include "maidsafe/dht/message_handler.h"
@@ -77,6 +79,7 @@ const uint16_t g_kKademliaK = 8;
 const uint16_t g_kAlpha = 3;
 const uint16_t g_kBeta = 2;
 const uint16_t g_kRandomNoResponseRate = 20;  // in percentage
+const int kAsioThreadCount = 3;
 
 
 ContactInfo::RpcState GetRandomRpcReplyState() {
@@ -110,6 +113,20 @@ void FindNodeCallback(RankInfoPtr/* rank_info */,
   cond_var->notify_one();
 }
 
+void CountFindNodesProgress(const std::vector<Contact> &contacts,
+                            std::vector<size_t> *progress_sizes) {
+  progress_sizes->push_back(contacts.size());
+}
+
+void CancelOnProgress(const std::vector<Contact> &/*contacts*/,
+                      OperationHandlePtr handle) {
+  handle->Cancel();
+}
+
+bool EnoughContacts(const std::vector<Contact> &contacts, size_t count) {
+  return contacts.size() >= count;
+}
+
 void FindValueCallback(FindValueReturns find_value_returns_in,
                        boost::condition_variable* cond_var,
                        FindValueReturns *find_value_returns_out,
@@ -119,6 +136,23 @@ void FindValueCallback(FindValueReturns find_value_returns_in,
   cond_var->notify_one();
 }
 
+void FindValuesCallback(std::vector<FindValueReturns> find_value_returns_in,
+                        boost::condition_variable* cond_var,
+                        std::vector<FindValueReturns> *find_value_returns_out,
+                        bool* done) {
+  *find_value_returns_out = find_value_returns_in;
+  *done = true;
+  cond_var->notify_one();
+}
+
+void WaitUntilReleased(boost::mutex *mutex,
+                       boost::condition_variable* cond_var,
+                       bool *released) {
+  boost::mutex::scoped_lock lock(*mutex);
+  while (!*released)
+    cond_var->wait(lock);
+}
+
 void ErrorCodeCallback(int error_code,
                        boost::condition_variable* cond_var,
                        int *response_code,
@@ -181,7 +215,10 @@ class MockRpcs : public Rpcs<TransportType>, public CreateContactAndNodeId {
         last_response_(true),
         respond_contacts_(),
         target_id_(),
-        threshold_((g_kKademliaK * 3) / 4) {}
+        threshold_((g_kKademliaK * 3) / 4),
+        request_times_(),
+        straggler_callbacks_(),
+        batch_sizes_() {}
   MOCK_METHOD3_T(Ping, void(PrivateKeyPtr private_key,
                             const Contact &peer,
                             RpcPingFunctor callback));
@@ -220,6 +257,31 @@ class MockRpcs : public Rpcs<TransportType>, public CreateContactAndNodeId {
                  PrivateKeyPtr private_key,
                  const Contact &peer,
                  RpcDeleteRefreshFunctor callback));
+  MOCK_METHOD6_T(StoreCache,
+                 void(const Key &key,
+                      const std::vector<ValueAndSignature> &values,
+                      const asymm::Identity &signer_public_key_id,
+                      const bptime::seconds &ttl,
+                      PrivateKeyPtr private_key,
+                      const Contact &peer));
+  MOCK_METHOD5_T(FindValueBatch,
+                 void(const std::vector<Key> &keys,
+                      const uint16_t &nodes_requested,
+                      PrivateKeyPtr private_key,
+                      const Contact &peer,
+                      std::vector<RpcFindValueFunctor> callbacks));
+  MOCK_METHOD5_T(FindNodesBatch,
+                 void(const std::vector<Key> &keys,
+                      const uint16_t &nodes_requested,
+                      PrivateKeyPtr private_key,
+                      const Contact &peer,
+                      std::vector<RpcFindNodesFunctor> callbacks));
+  MOCK_METHOD4_T(StoreBatch,
+                 void(const std::vector<std::pair<std::string,
+                                                  std::string>> &requests,
+                      PrivateKeyPtr private_key,
+                      const Contact &peer,
+                      std::vector<RpcStoreFunctor> callbacks));
 
   void StoreRefreshThread(RpcStoreRefreshFunctor callback) {
     RankInfoPtr rank_info;
@@ -254,9 +316,8 @@ class MockRpcs : public Rpcs<TransportType>, public CreateContactAndNodeId {
           ContactsById key_indx = respond_contacts_->get<NodeIdTag>();
           auto it = key_indx.find(node_list_[element].node_id());
           if (it == key_indx.end()) {
-            RoutingTableContact new_routing_table_contact(node_list_[element],
-                                                          target_id_, 0);
-            respond_contacts_->insert(new_routing_table_contact);
+            TestContact new_test_contact(node_list_[element], target_id_);
+            respond_contacts_->insert(new_test_contact);
           }
         }
       }
@@ -282,9 +343,8 @@ class MockRpcs : public Rpcs<TransportType>, public CreateContactAndNodeId {
     for (int n = 0; n < g_kKademliaK; ++n) {
       int element = RandomUint32() % node_list_.size();
       response_list.push_back(node_list_[element]);
-      RoutingTableContact new_routing_table_contact(node_list_[element],
-                                                    target_id_, 0);
-      respond_contacts_->insert(new_routing_table_contact);
+      TestContact new_test_contact(node_list_[element], target_id_);
+      respond_contacts_->insert(new_test_contact);
     }
     Rpcs<TransportType>::asio_service_.post(
         std::bind(&MockRpcs<TransportType>::FindNodeResponseThread,
@@ -315,6 +375,37 @@ class MockRpcs : public Rpcs<TransportType>, public CreateContactAndNodeId {
     ++num_of_acquired_;
   }
 
+  // The first g_kAlpha - g_kBeta + 1 RPCs, enough to stall the first
+  // iteration, are held unanswered until FailStragglers is called; the rest
+  // respond with an empty closest list.
+  void FindNodeFirstStraggle(RpcFindNodesFunctor callback) {
+    boost::mutex::scoped_lock lock(node_list_mutex_);
+    request_times_.push_back(bptime::microsec_clock::universal_time());
+    if (num_of_acquired_++ < g_kAlpha - g_kBeta + 1) {
+      straggler_callbacks_.push_back(callback);
+      return;
+    }
+    std::vector<Contact> response_list;
+    Rpcs<TransportType>::asio_service_.post(
+        std::bind(&MockRpcs<TransportType>::FindNodeResponseThread,
+                  this, callback, response_list));
+  }
+
+  // Times out the RPCs held by FindNodeFirstStraggle, as the transport would.
+  void FailStragglers() {
+    std::vector<RpcFindNodesFunctor> callbacks;
+    {
+      boost::mutex::scoped_lock lock(node_list_mutex_);
+      callbacks.swap(straggler_callbacks_);
+    }
+    std::vector<Contact> response_list;
+    for (auto it = callbacks.begin(); it != callbacks.end(); ++it) {
+      Rpcs<TransportType>::asio_service_.post(
+          std::bind(*it, rank_info_, transport::kReceiveTimeout,
+                    response_list));
+    }
+  }
+
   void FindNodeFirstAndLastNoResponse(RpcFindNodesFunctor callback) {
     boost::mutex::scoped_lock lock(node_list_mutex_);
     std::vector<Contact> response_list;
@@ -358,9 +449,8 @@ class MockRpcs : public Rpcs<TransportType>, public CreateContactAndNodeId {
     for (int n = 0; n < elements; ++n) {
       int element = RandomUint32() % node_list_.size();
       response_list.push_back(node_list_[element]);
-      RoutingTableContact new_routing_table_contact(node_list_[element],
-                                                    target_id_, 0);
-      respond_contacts_->insert(new_routing_table_contact);
+      TestContact new_test_contact(node_list_[element], target_id_);
+      respond_contacts_->insert(new_test_contact);
     }
     Rpcs<TransportType>::asio_service_.post(
         std::bind(&MockRpcs<TransportType>::FindNodeResponseThread,
@@ -425,10 +515,8 @@ class MockRpcs : public Rpcs<TransportType>, public CreateContactAndNodeId {
       for (int n = 0; n < elements; ++n) {
         int element = RandomUint32() % node_list_.size();
         response_contact_list.push_back(node_list_[element]);
-        RoutingTableContact new_routing_table_contact(node_list_[element],
-                                                      target_id_,
-                                                      0);
-        respond_contacts_->insert(new_routing_table_contact);
+        TestContact new_test_contact(node_list_[element], target_id_);
+        respond_contacts_->insert(new_test_contact);
       }
       Rpcs<TransportType>::asio_service_.post(
         std::bind(&MockRpcs<TransportType>::FindValueNoResponseThread,
@@ -467,7 +555,20 @@ class MockRpcs : public Rpcs<TransportType>, public CreateContactAndNodeId {
     Sleep(bptime::milliseconds(interval));
     Contact cache_holder;
     callback(rank_info_, transport::kSuccess, response_values_and_signatures,
-             response_contact_list, cache_holder);
+             response_contact_list, cache_holder, asymm::Identity());
+  }
+
+  // Records the number of keys in the batch, then answers each of them as
+  // FindValueNoResponse does.
+  void FindValueBatchNoResponse(const std::vector<Key> &keys,
+                                std::vector<RpcFindValueFunctor> callbacks) {
+    {
+      boost::mutex::scoped_lock lock(node_list_mutex_);
+      batch_sizes_.push_back(keys.size());
+    }
+    std::for_each(callbacks.begin(), callbacks.end(),
+                  std::bind(&MockRpcs<TransportType>::FindValueNoResponse,
+                            this, args::_1));
   }
 
   void FindValueNoResponseThread(
@@ -479,7 +580,7 @@ class MockRpcs : public Rpcs<TransportType>, public CreateContactAndNodeId {
     Sleep(bptime::milliseconds(interval));
     Contact cache_holder;
     callback(rank_info_, result, response_values_and_signatures,
-             response_contact_list, cache_holder);
+             response_contact_list, cache_holder, asymm::Identity());
   }
 
   void SingleDeleteResponse(RpcDeleteFunctor callback,
@@ -599,10 +700,13 @@ class MockRpcs : public Rpcs<TransportType>, public CreateContactAndNodeId {
   uint16_t no_respond_;
   bool last_response_;
 
-  std::shared_ptr<RoutingTableContactsContainer> respond_contacts_;
-  std::shared_ptr<RoutingTableContactsContainer> down_contacts_;
+  std::shared_ptr<TestContactsContainer> respond_contacts_;
+  std::shared_ptr<TestContactsContainer> down_contacts_;
   NodeId target_id_;
   int threshold_;
+  std::vector<bptime::ptime> request_times_;
+  std::vector<RpcFindNodesFunctor> straggler_callbacks_;
+  std::vector<size_t> batch_sizes_;
 };  // class MockRpcs
 
 }  // unnamed namespace
@@ -655,10 +759,16 @@ class MockNodeImplTest : public CreateContactAndNodeId, public testing::Test {
     node_->joined_ = true;
     node_->routing_table_ = routing_table_;
     local_node_->routing_table_ = routing_table_;
+    // Most tests repeat lookups for a key with different responses, so each
+    // must run a full lookup
+    node_->closest_contacts_cache_.reset(
+        new ClosestContactsCache(0, bptime::seconds(0)));
+    local_node_->closest_contacts_cache_.reset(
+        new ClosestContactsCache(0, bptime::seconds(0)));
   }
 
   void SetUp() {
-    asio_service_.Start(3);
+    asio_service_.Start(kAsioThreadCount);
   }
 
   void TearDown() {
@@ -680,6 +790,28 @@ class MockNodeImplTest : public CreateContactAndNodeId, public testing::Test {
                   std::bind(&AddContact, routing_table_, args::_1, rank_info_));
   }
 
+  void EnableClosestContactsCache() {
+    node_->closest_contacts_cache_.reset(new ClosestContactsCache(
+        kMaxClosestContactsCacheSize, kClosestContactsCacheTtl));
+  }
+
+  size_t ClosestContactsCacheSize() {
+    return node_->closest_contacts_cache_->Size();
+  }
+
+  void CreateDataStore() {
+    node_->data_store_.reset(new DataStore(bptime::seconds(3600)));
+    data_store_ = node_->data_store_;
+  }
+
+  size_t RunningLookupCount(LookupScheduler::Priority priority) {
+    return node_->lookup_scheduler_->RunningCount(priority);
+  }
+
+  size_t RpcsInFlight(LookupScheduler::Priority priority) {
+    return node_->lookup_scheduler_->RpcsInFlight(priority);
+  }
+
   template <typename TransportType>
   void SetRpcs(std::shared_ptr<Rpcs<TransportType>> rpcs) {
     node_->rpcs_ = rpcs;
@@ -730,8 +862,8 @@ TEST_F(MockNodeImplTest, BEH_GetContact) {
 
   int count = 10 * g_kKademliaK;
   new_rpcs->PopulateResponseCandidates(count, 499);
-  std::shared_ptr<RoutingTableContactsContainer> temp
-      (new RoutingTableContactsContainer());
+  std::shared_ptr<TestContactsContainer> temp
+      (new TestContactsContainer());
   new_rpcs->respond_contacts_ = temp;
 
   EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
@@ -866,8 +998,8 @@ TEST_F(MockNodeImplTest, BEH_Join) {
   new_rpcs->PopulateResponseCandidates(count, 499);
   NodeId target = GenerateRandomId(node_id_, 480);
   new_rpcs->target_id_ = target;
-  std::shared_ptr<RoutingTableContactsContainer> temp
-      (new RoutingTableContactsContainer());
+  std::shared_ptr<TestContactsContainer> temp
+      (new TestContactsContainer());
   new_rpcs->respond_contacts_ = temp;
   new_rpcs->SetCountersToZero();
 
@@ -1045,8 +1177,8 @@ TEST_F(MockNodeImplTest, BEH_Leave) {
   new_rpcs->PopulateResponseCandidates(count, 499);
   NodeId target = GenerateRandomId(node_id_, 480);
   new_rpcs->target_id_ = target;
-  std::shared_ptr<RoutingTableContactsContainer> temp
-      (new RoutingTableContactsContainer());
+  std::shared_ptr<TestContactsContainer> temp
+      (new TestContactsContainer());
   new_rpcs->respond_contacts_ = temp;
   new_rpcs->SetCountersToZero();
   int result(1);
@@ -1188,8 +1320,8 @@ TEST_F(MockNodeImplTest, BEH_FindNodes) {
   new_rpcs->PopulateResponseCandidates(count, 499);
   NodeId target = GenerateRandomId(node_id_, 498);
   new_rpcs->target_id_ = target;
-  std::shared_ptr<RoutingTableContactsContainer> temp
-      (new RoutingTableContactsContainer());
+  std::shared_ptr<TestContactsContainer> temp
+      (new TestContactsContainer());
   done = false;
   new_rpcs->respond_contacts_ = temp;
   {
@@ -1215,8 +1347,8 @@ TEST_F(MockNodeImplTest, BEH_FindNodes) {
     EXPECT_NE(lcontacts[0], lcontacts[g_kKademliaK / 2]);
     EXPECT_NE(lcontacts[0], lcontacts[g_kKademliaK - 1]);
 
-    ContactsByDistanceToThisId key_dist_indx
-      = new_rpcs->respond_contacts_->get<DistanceToThisIdTag>();
+    ContactsByDistanceToTarget key_dist_indx
+      = new_rpcs->respond_contacts_->get<DistanceToTargetTag>();
     auto it = key_dist_indx.begin();
     int step(0);
     while ((it != key_dist_indx.end()) && (step < g_kKademliaK)) {
@@ -1254,8 +1386,8 @@ TEST_F(MockNodeImplTest, BEH_FindNodes) {
   }
 
   new_rpcs->respond_contacts_->clear();
-  std::shared_ptr<RoutingTableContactsContainer> down_list
-      (new RoutingTableContactsContainer());
+  std::shared_ptr<TestContactsContainer> down_list
+      (new TestContactsContainer());
   done = false;
   new_rpcs->down_contacts_ = down_list;
   {
@@ -1282,8 +1414,8 @@ TEST_F(MockNodeImplTest, BEH_FindNodes) {
       EXPECT_NE(lcontacts[0], lcontacts[g_kKademliaK / 2]);
       EXPECT_NE(lcontacts[0], lcontacts[g_kKademliaK - 1]);
 
-      ContactsByDistanceToThisId key_dist_indx
-        = new_rpcs->respond_contacts_->get<DistanceToThisIdTag>();
+      ContactsByDistanceToTarget key_dist_indx
+        = new_rpcs->respond_contacts_->get<DistanceToTargetTag>();
       auto it = key_dist_indx.begin();
       int step(0);
       while ((it != key_dist_indx.end()) && (step < g_kKademliaK)) {
@@ -1300,6 +1432,258 @@ TEST_F(MockNodeImplTest, BEH_FindNodes) {
   }
 }
 
+TEST_F(MockNodeImplTest, BEH_CoalesceFindNodes) {
+  PopulateRoutingTable(g_kKademliaK, 500);
+  std::shared_ptr<MockRpcs<transport::TcpTransport>> new_rpcs(
+      new MockRpcs<transport::TcpTransport>(asio_service_.service(),
+                                            private_key_));
+  new_rpcs->set_node_id(node_id_);
+  SetRpcs<transport::TcpTransport>(new_rpcs);
+
+  // Each populated contact responds with an empty closest list, so a single
+  // lookup queries each of them at most once
+  EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
+                                   testing::_, testing::_))
+      .Times(testing::AtMost(g_kKademliaK))
+      .WillRepeatedly(testing::WithArgs<4>(testing::Invoke(
+          std::bind(&MockRpcs<transport::TcpTransport>::FindNodeResponseNoClose,
+                    new_rpcs.get(), args::_1))));
+  NodeId key = NodeId(NodeId::kRandomId);
+  bool done(false), other_done(false);
+  std::vector<Contact> lcontacts, other_lcontacts;
+  node_->FindNodes(key, std::bind(&FindNodeCallback, rank_info_, args::_1,
+                                  args::_2, &mutex_, &cond_var_, &lcontacts,
+                                  &done));
+  node_->FindNodes(key, std::bind(&FindNodeCallback, rank_info_, args::_1,
+                                  args::_2, &mutex_, &cond_var_,
+                                  &other_lcontacts, &other_done));
+  while (!done || !other_done) {
+    bool not_timed_out = cond_var_.timed_wait(unique_lock_, kTaskTimeout_);
+    if (!not_timed_out)
+      done = other_done = true;
+    EXPECT_TRUE(not_timed_out);
+  }
+  EXPECT_FALSE(lcontacts.empty());
+  EXPECT_EQ(lcontacts, other_lcontacts);
+}
+
+TEST_F(MockNodeImplTest, BEH_FindNodesWithProgress) {
+  PopulateRoutingTable(g_kKademliaK, 500);
+  std::shared_ptr<MockRpcs<transport::TcpTransport>> new_rpcs(
+      new MockRpcs<transport::TcpTransport>(asio_service_.service(),
+                                            private_key_));
+  new_rpcs->set_node_id(node_id_);
+  SetRpcs<transport::TcpTransport>(new_rpcs);
+
+  // Each populated contact responds with an empty closest list, so every
+  // response adds one to the contacts reported
+  EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
+                                   testing::_, testing::_))
+      .WillRepeatedly(testing::WithArgs<4>(testing::Invoke(
+          std::bind(&MockRpcs<transport::TcpTransport>::FindNodeResponseNoClose,
+                    new_rpcs.get(), args::_1))));
+  const size_t kEnough(3);
+  bool done(false);
+  std::vector<Contact> lcontacts;
+  std::vector<size_t> progress_sizes;
+  node_->FindNodesWithProgress(
+      NodeId(NodeId::kRandomId),
+      std::bind(&FindNodeCallback, rank_info_, args::_1, args::_2, &mutex_,
+                &cond_var_, &lcontacts, &done),
+      std::bind(&CountFindNodesProgress, args::_1, &progress_sizes),
+      std::bind(&EnoughContacts, args::_1, kEnough));
+  while (!done) {
+    bool not_timed_out = cond_var_.timed_wait(unique_lock_, kTaskTimeout_);
+    if (!not_timed_out)
+      done = true;
+    EXPECT_TRUE(not_timed_out);
+  }
+  // The lookup ends as soon as the predicate is met, well short of k contacts
+  EXPECT_EQ(kEnough, lcontacts.size());
+  ASSERT_FALSE(progress_sizes.empty());
+  EXPECT_EQ(kEnough, progress_sizes.back());
+  EXPECT_TRUE(std::is_sorted(progress_sizes.begin(), progress_sizes.end()));
+}
+
+TEST_F(MockNodeImplTest, BEH_CancelFromFindNodesProgress) {
+  PopulateRoutingTable(g_kKademliaK, 500);
+  std::shared_ptr<MockRpcs<transport::TcpTransport>> new_rpcs(
+      new MockRpcs<transport::TcpTransport>(asio_service_.service(),
+                                            private_key_));
+  new_rpcs->set_node_id(node_id_);
+  SetRpcs<transport::TcpTransport>(new_rpcs);
+
+  // The first progress report cancels the lookup, which must not deadlock
+  EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
+                                   testing::_, testing::_))
+      .WillRepeatedly(testing::WithArgs<4>(testing::Invoke(
+          std::bind(&MockRpcs<transport::TcpTransport>::FindNodeResponseNoClose,
+                    new_rpcs.get(), args::_1))));
+  bool done(false);
+  std::vector<Contact> lcontacts(1, node_->contact());
+  OperationHandlePtr handle(new OperationHandle);
+  node_->FindNodesWithProgress(
+      NodeId(NodeId::kRandomId),
+      std::bind(&FindNodeCallback, rank_info_, args::_1, args::_2, &mutex_,
+                &cond_var_, &lcontacts, &done),
+      std::bind(&CancelOnProgress, args::_1, handle),
+      FindNodesStopFunctor(), 0, bptime::pos_infin, handle);
+  while (!done) {
+    bool not_timed_out = cond_var_.timed_wait(unique_lock_, kTaskTimeout_);
+    if (!not_timed_out)
+      done = true;
+    EXPECT_TRUE(not_timed_out);
+  }
+  EXPECT_TRUE(handle->cancelled());
+  EXPECT_TRUE(lcontacts.empty());
+}
+
+TEST_F(MockNodeImplTest, BEH_FindNodesStragglingPeer) {
+  PopulateRoutingTable(g_kKademliaK, 500);
+  std::shared_ptr<MockRpcs<transport::TcpTransport>> new_rpcs(
+      new MockRpcs<transport::TcpTransport>(asio_service_.service(),
+                                            private_key_));
+  new_rpcs->set_node_id(node_id_);
+  SetRpcs<transport::TcpTransport>(new_rpcs);
+
+  // Too few of the first iteration's RPCs are answered to end it, so only the
+  // soft deadline of the stragglers lets the next closest contact be queried
+  EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
+                                   testing::_, testing::_))
+      .WillRepeatedly(testing::WithArgs<4>(testing::Invoke(
+          std::bind(&MockRpcs<transport::TcpTransport>::FindNodeFirstStraggle,
+                    new_rpcs.get(), args::_1))));
+  bool done(false);
+  std::vector<Contact> lcontacts;
+  bptime::ptime start(bptime::microsec_clock::universal_time());
+  node_->FindNodes(NodeId(NodeId::kRandomId),
+                   std::bind(&FindNodeCallback, rank_info_, args::_1,
+                             args::_2, &mutex_, &cond_var_, &lcontacts,
+                             &done));
+  bptime::ptime next_request_time;
+  while (next_request_time.is_not_a_date_time() &&
+         bptime::microsec_clock::universal_time() < start + kTaskTimeout_) {
+    Sleep(bptime::milliseconds(10));
+    boost::mutex::scoped_lock lock(new_rpcs->node_list_mutex_);
+    if (new_rpcs->request_times_.size() > g_kAlpha)
+      next_request_time = new_rpcs->request_times_[g_kAlpha];
+  }
+  ASSERT_FALSE(next_request_time.is_not_a_date_time());
+  EXPECT_LE(kMinLookupRpcSoftTimeout, next_request_time - start);
+  EXPECT_GT(transport::kDefaultInitialTimeout, next_request_time - start);
+
+  // once the stragglers time out, the lookup completes without them
+  new_rpcs->FailStragglers();
+  while (!done) {
+    bool not_timed_out = cond_var_.timed_wait(unique_lock_, kTaskTimeout_);
+    if (!not_timed_out)
+      done = true;
+    EXPECT_TRUE(not_timed_out);
+  }
+  EXPECT_FALSE(lcontacts.empty());
+}
+
+TEST_F(MockNodeImplTest, BEH_SlotReleasedOnCompletion) {
+  PopulateRoutingTable(g_kKademliaK, 500);
+  std::shared_ptr<MockRpcs<transport::TcpTransport>> new_rpcs(
+      new MockRpcs<transport::TcpTransport>(asio_service_.service(),
+                                            private_key_));
+  new_rpcs->set_node_id(node_id_);
+  SetRpcs<transport::TcpTransport>(new_rpcs);
+
+  // The stragglers' callbacks keep the lookup's arguments alive after the
+  // stop functor has ended it, but not its scheduler slot.  They do hold their
+  // RPC slots until answered.
+  EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
+                                   testing::_, testing::_))
+      .WillRepeatedly(testing::WithArgs<4>(testing::Invoke(
+          std::bind(&MockRpcs<transport::TcpTransport>::FindNodeFirstStraggle,
+                    new_rpcs.get(), args::_1))));
+  bool done(false);
+  std::vector<Contact> lcontacts;
+  node_->FindNodesWithProgress(
+      NodeId(NodeId::kRandomId),
+      std::bind(&FindNodeCallback, rank_info_, args::_1, args::_2, &mutex_,
+                &cond_var_, &lcontacts, &done),
+      FindNodesProgressFunctor(),
+      std::bind(&EnoughContacts, args::_1, 1));
+  while (!done) {
+    bool not_timed_out = cond_var_.timed_wait(unique_lock_, kTaskTimeout_);
+    if (!not_timed_out)
+      done = true;
+    EXPECT_TRUE(not_timed_out);
+  }
+  EXPECT_FALSE(lcontacts.empty());
+  {
+    boost::mutex::scoped_lock lock(new_rpcs->node_list_mutex_);
+    EXPECT_FALSE(new_rpcs->straggler_callbacks_.empty());
+  }
+  EXPECT_EQ(0U, RunningLookupCount(LookupScheduler::kInteractive));
+  EXPECT_LE(g_kAlpha - g_kBeta + 1U,
+            RpcsInFlight(LookupScheduler::kInteractive));
+  new_rpcs->FailStragglers();
+  bptime::ptime timeout(bptime::microsec_clock::universal_time() +
+                        kTaskTimeout_);
+  while (RpcsInFlight(LookupScheduler::kInteractive) != 0U &&
+         bptime::microsec_clock::universal_time() < timeout)
+    Sleep(bptime::milliseconds(10));
+  EXPECT_EQ(0U, RpcsInFlight(LookupScheduler::kInteractive));
+}
+
+TEST_F(MockNodeImplTest, BEH_OperationDeadlineAndCancellation) {
+  PopulateRoutingTable(g_kKademliaK, 500);
+  std::shared_ptr<MockRpcs<transport::TcpTransport>> new_rpcs(
+      new MockRpcs<transport::TcpTransport>(asio_service_.service(),
+                                            private_key_));
+  new_rpcs->set_node_id(node_id_);
+  SetRpcs<transport::TcpTransport>(new_rpcs);
+
+  // No contact ever responds, so only the deadline or cancellation can end
+  // each operation
+  EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
+                                   testing::_, testing::_))
+      .WillRepeatedly(testing::Return());
+  NodeId key = NodeId(NodeId::kRandomId);
+  asymm::Keys crypto_key_data;
+  asymm::GenerateKeyPair(&crypto_key_data);
+  KeyValueSignature kvs = MakeKVS(crypto_key_data, 1024, key.String(), "");
+  {
+    bool done(false);
+    int response_code(kGeneralError);
+    node_->Store(key, kvs.value, kvs.signature, bptime::pos_infin,
+                 private_key_,
+                 std::bind(&ErrorCodeCallback, args::_1, &cond_var_,
+                           &response_code, &done),
+                 bptime::milliseconds(200));
+    while (!done) {
+      bool not_timed_out = cond_var_.timed_wait(unique_lock_, kTaskTimeout_);
+      if (!not_timed_out)
+        done = true;
+      EXPECT_TRUE(not_timed_out);
+    }
+    EXPECT_EQ(kOperationDeadlineExpired, response_code);
+  }
+  {
+    bool done(false);
+    int response_code(kGeneralError);
+    OperationHandlePtr handle(new OperationHandle);
+    node_->Delete(key, kvs.value, kvs.signature, private_key_,
+                  std::bind(&ErrorCodeCallback, args::_1, &cond_var_,
+                            &response_code, &done),
+                  bptime::pos_infin, handle);
+    EXPECT_FALSE(handle->cancelled());
+    handle->Cancel();
+    EXPECT_TRUE(handle->cancelled());
+    while (!done) {
+      bool not_timed_out = cond_var_.timed_wait(unique_lock_, kTaskTimeout_);
+      if (!not_timed_out)
+        done = true;
+      EXPECT_TRUE(not_timed_out);
+    }
+    EXPECT_EQ(kOperationCancelled, response_code);
+  }
+}
+
 TEST_F(MockNodeImplTest, BEH_Store) {
   bool done(false);
   PopulateRoutingTable(g_kKademliaK * 2, 500);
@@ -1313,13 +1697,13 @@ TEST_F(MockNodeImplTest, BEH_Store) {
   new_rpcs->PopulateResponseCandidates(count, 499);
   NodeId target = GenerateRandomId(node_id_, 498);
   new_rpcs->target_id_ = target;
-  std::shared_ptr<RoutingTableContactsContainer> temp
-      (new RoutingTableContactsContainer());
+  std::shared_ptr<TestContactsContainer> temp
+      (new TestContactsContainer());
   new_rpcs->respond_contacts_ = temp;
   new_rpcs->SetCountersToZero();
 
-  std::shared_ptr<RoutingTableContactsContainer> down_list
-      (new RoutingTableContactsContainer());
+  std::shared_ptr<TestContactsContainer> down_list
+      (new TestContactsContainer());
   new_rpcs->down_contacts_ = down_list;
   EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
                                    testing::_, testing::_))
@@ -1490,6 +1874,58 @@ TEST_F(MockNodeImplTest, BEH_Store) {
   }
 }
 
+TEST_F(MockNodeImplTest, BEH_StoreWithCachedClosestContacts) {
+  EnableClosestContactsCache();
+  PopulateRoutingTable(g_kKademliaK * 2, 500);
+  std::shared_ptr<MockRpcs<transport::TcpTransport>> new_rpcs(
+      new MockRpcs<transport::TcpTransport>(asio_service_.service(),
+                                            private_key_));
+  new_rpcs->set_node_id(node_id_);
+  SetRpcs<transport::TcpTransport>(new_rpcs);
+
+  new_rpcs->PopulateResponseCandidates(10 * g_kKademliaK, 499);
+  NodeId target = GenerateRandomId(node_id_, 498);
+  new_rpcs->target_id_ = target;
+  new_rpcs->respond_contacts_.reset(new TestContactsContainer);
+  new_rpcs->SetCountersToZero();
+  EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
+                                   testing::_, testing::_))
+      .WillRepeatedly(testing::WithArgs<4>(testing::Invoke(
+          std::bind(&MockRpcs<transport::TcpTransport>::FindNodeResponseClose,
+                    new_rpcs.get(), args::_1))));
+  EXPECT_CALL(*new_rpcs, Store(testing::_, testing::_, testing::_,
+                               testing::_, testing::_, testing::_,
+                               testing::_))
+      .WillRepeatedly(testing::WithArgs<6>(testing::Invoke(std::bind(
+          &MockRpcs<transport::TcpTransport>::Response<RpcStoreFunctor>,
+          new_rpcs.get(), args::_1))));
+  NodeId key(GenerateRandomId(node_id_, 498));
+  asymm::Keys crypto_key_data;
+  asymm::GenerateKeyPair(&crypto_key_data);
+  KeyValueSignature kvs = MakeKVS(crypto_key_data, 1024, key.String(), "");
+  bptime::time_duration ttl(bptime::pos_infin);
+  for (int i = 0; i != 2; ++i) {
+    if (i == 1) {
+      // The second store goes straight to the contacts found by the first
+      EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
+                                       testing::_, testing::_)).Times(0);
+    }
+    bool done(false);
+    int response_code(-2);
+    node_->Store(key, kvs.value, kvs.signature, ttl, private_key_,
+                 std::bind(&ErrorCodeCallback, args::_1, &cond_var_,
+                           &response_code, &done));
+    while (!done) {
+      bool not_timed_out = cond_var_.timed_wait(unique_lock_, kTaskTimeout_);
+      if (!not_timed_out)
+        done = true;
+      EXPECT_TRUE(not_timed_out);
+    }
+    EXPECT_EQ(kSuccess, response_code);
+    EXPECT_EQ(1U, ClosestContactsCacheSize());
+  }
+}
+
 TEST_F(MockNodeImplTest, BEH_Delete) {
   bool done(false);
   PopulateRoutingTable(g_kKademliaK * 2, 500);
@@ -1503,8 +1939,8 @@ TEST_F(MockNodeImplTest, BEH_Delete) {
   new_rpcs->PopulateResponseCandidates(count, 499);
   NodeId target = GenerateRandomId(node_id_, 498);
   new_rpcs->target_id_ = target;
-  std::shared_ptr<RoutingTableContactsContainer> temp
-      (new RoutingTableContactsContainer());
+  std::shared_ptr<TestContactsContainer> temp
+      (new TestContactsContainer());
   new_rpcs->respond_contacts_ = temp;
 
   EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
@@ -1662,8 +2098,8 @@ TEST_F(MockNodeImplTest, BEH_Update) {
   new_rpcs->PopulateResponseCandidates(count, 499);
   NodeId target = GenerateRandomId(node_id_, 498);
   new_rpcs->target_id_ = target;
-  std::shared_ptr<RoutingTableContactsContainer> temp
-      (new RoutingTableContactsContainer());
+  std::shared_ptr<TestContactsContainer> temp
+      (new TestContactsContainer());
   new_rpcs->respond_contacts_ = temp;
 
   EXPECT_CALL(*new_rpcs, FindNodes(testing::_, testing::_, testing::_,
@@ -1882,6 +2318,92 @@ TEST_F(MockNodeImplTest, BEH_Update) {
   }
 }
 
+TEST_F(MockNodeImplTest, BEH_FindValuesBatchesRpcs) {
+  // With so few contacts this node is among the closest to every key, so
+  // each lookup checks its (empty) data store first
+  PopulateRoutingTable(g_kAlpha, 500);
+  CreateDataStore();
+  std::shared_ptr<MockRpcs<transport::TcpTransport>> new_rpcs(
+      new MockRpcs<transport::TcpTransport>(asio_service_.service(),
+                                            private_key_));
+  new_rpcs->set_node_id(node_id_);
+  SetRpcs<transport::TcpTransport>(new_rpcs);
+  const size_t kKeyCount(4);
+  std::vector<Key> keys;
+  for (size_t i = 0; i != kKeyCount; ++i)
+    keys.push_back(NodeId(NodeId::kRandomId));
+  {
+    // Holding every asio thread until all the lookups have queued their first
+    // RPCs means each peer gets all the keys in one batched RPC
+    EXPECT_CALL(*new_rpcs, FindValue(testing::_, testing::_, testing::_,
+                                     testing::_, testing::_))
+        .Times(0);
+    EXPECT_CALL(*new_rpcs, FindValueBatch(testing::_, testing::_, testing::_,
+                                          testing::_, testing::_))
+        .Times(g_kAlpha)
+        .WillRepeatedly(testing::WithArgs<0, 4>(testing::Invoke(std::bind(
+            &MockRpcs<transport::TcpTransport>::FindValueBatchNoResponse,
+            new_rpcs.get(), args::_1, args::_2))));
+    boost::mutex blocker_mutex;
+    boost::condition_variable blocker_cond_var;
+    bool released(false);
+    for (int i = 0; i != kAsioThreadCount; ++i) {
+      asio_service_.service().post(std::bind(&WaitUntilReleased,
+          &blocker_mutex, &blocker_cond_var, &released));
+    }
+    bool done(false);
+    std::vector<FindValueReturns> results;
+    node_->FindValues(keys, private_key_,
+                      std::bind(&FindValuesCallback, args::_1, &cond_var_,
+                                &results, &done));
+    {
+      boost::mutex::scoped_lock lock(blocker_mutex);
+      released = true;
+      blocker_cond_var.notify_all();
+    }
+    while (!done) {
+      bool not_timed_out = cond_var_.timed_wait(unique_lock_, kTaskTimeout_);
+      if (!not_timed_out)
+        done = true;
+      EXPECT_TRUE(not_timed_out);
+    }
+    ASSERT_EQ(kKeyCount, results.size());
+    for (auto it = results.begin(); it != results.end(); ++it)
+      EXPECT_EQ(kFailedToFindValue, (*it).return_code);
+    boost::mutex::scoped_lock lock(new_rpcs->node_list_mutex_);
+    EXPECT_EQ(std::vector<size_t>(g_kAlpha, kKeyCount),
+              new_rpcs->batch_sizes_);
+  }
+  // The failed contacts have been dropped from the routing table
+  PopulateRoutingTable(g_kAlpha, 500);
+  {
+    // Nothing ever responds, so only cancellation can end the lookups
+    EXPECT_CALL(*new_rpcs, FindValue(testing::_, testing::_, testing::_,
+                                     testing::_, testing::_))
+        .WillRepeatedly(testing::Return());
+    EXPECT_CALL(*new_rpcs, FindValueBatch(testing::_, testing::_, testing::_,
+                                          testing::_, testing::_))
+        .WillRepeatedly(testing::Return());
+    bool done(false);
+    std::vector<FindValueReturns> results;
+    OperationHandlePtr handle(new OperationHandle);
+    node_->FindValues(keys, private_key_,
+                      std::bind(&FindValuesCallback, args::_1, &cond_var_,
+                                &results, &done),
+                      0, true, bptime::pos_infin, handle);
+    handle->Cancel();
+    while (!done) {
+      bool not_timed_out = cond_var_.timed_wait(unique_lock_, kTaskTimeout_);
+      if (!not_timed_out)
+        done = true;
+      EXPECT_TRUE(not_timed_out);
+    }
+    ASSERT_EQ(kKeyCount, results.size());
+    for (auto it = results.begin(); it != results.end(); ++it)
+      EXPECT_EQ(kOperationCancelled, (*it).return_code);
+  }
+}
+
 TEST_F(MockNodeImplTest, BEH_FindValue) {
   bool done(false);
   PopulateRoutingTable(g_kKademliaK * 2, 500);
@@ -1942,8 +2464,8 @@ TEST_F(MockNodeImplTest, BEH_FindValue) {
   }
   done = false;
   new_rpcs->SetCountersToZero();
-  std::shared_ptr<RoutingTableContactsContainer> temp
-      (new RoutingTableContactsContainer());
+  std::shared_ptr<TestContactsContainer> temp
+      (new TestContactsContainer());
   new_rpcs->respond_contacts_ = temp;
   new_rpcs->target_id_ = key;
   {
@@ -2252,7 +2774,7 @@ TEST_F(MockNodeImplTest, BEH_RemoveDownlistedContacts) {
     ASSERT_EQ((*downlist_itr).second.providers.end(),
         std::find((*downlist_itr).second.providers.begin(),
                   (*downlist_itr).second.providers.end(),
-                  (*lookup_contact.begin()).first));
+                  (*lookup_contact.begin()).first.node_id()));
   }
 
 // Feed in Downlist = contacts for a full removal of contacts
@@ -2273,7 +2795,7 @@ TEST_F(MockNodeImplTest, BEH_RemoveDownlistedContacts) {
     ASSERT_NE((*downlist_itr).second.providers.end(),
         std::find((*downlist_itr).second.providers.begin(),
                   (*downlist_itr).second.providers.end(),
-                  (*lookup_contact.begin()).first));
+                  (*lookup_contact.begin()).first.node_id()));
   }
 
 // Feed in Random Downlist for a Live Sim
@@ -2317,7 +2839,7 @@ TEST_F(MockNodeImplTest, BEH_RemoveDownlistedContacts) {
       ASSERT_NE((*downlist_itr).second.providers.end(),
                 std::find((*downlist_itr).second.providers.begin(),
                           (*downlist_itr).second.providers.end(),
-                          (*lookup_contact.begin()).first));
+                          (*lookup_contact.begin()).first.node_id()));
     }
   }
 }
@@ -2480,7 +3002,7 @@ TEST_F(MockNodeImplTest, BEH_InsertCloseContacts) {
     ASSERT_NE((*it).second.providers.end(),
               std::find((*it).second.providers.begin(),
                         (*it).second.providers.end(),
-                        lookup_args->lookup_contacts.begin()->first));
+                        lookup_args->lookup_contacts.begin()->first.node_id()));
 
 // Insert Unique & Duplicate New Contacts to Live Contacts
   live_contacts.clear();
@@ -2508,10 +3030,10 @@ TEST_F(MockNodeImplTest, BEH_InsertCloseContacts) {
                                     random_num_contacts - 2,
                                     private_key));
   result_itr = lookup_args->lookup_contacts.end();
-  auto peer_itr(lookup_args->lookup_contacts.begin());
+  const NodeId kPeerId((*lookup_args->lookup_contacts.begin()).first.node_id());
   result_itr = node_->InsertCloseContacts(new_contacts,
                                           lookup_args,
-                                          peer_itr);
+                                          lookup_args->lookup_contacts.begin());
   ASSERT_EQ(random_num_contacts, lookup_args->lookup_contacts.size());
   ASSERT_EQ((*expected_bound), (*result_itr).first);
   for (auto it(lookup_args->lookup_contacts.begin());
@@ -2520,7 +3042,7 @@ TEST_F(MockNodeImplTest, BEH_InsertCloseContacts) {
     ASSERT_NE((*it).second.providers.end(),
               std::find((*it).second.providers.begin(),
                         (*it).second.providers.end(),
-                        (*peer_itr).first));
+                        kPeerId));
 }
 
 }  // namespace test
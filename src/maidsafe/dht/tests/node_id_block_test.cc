@@ -0,0 +1,110 @@
+/* Copyright (c) 2011 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/dht/node_id.h"
+#include "maidsafe/dht/node_id_block.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace test {
+
+TEST(NodeIdBlockTest, BEH_SelectClosest) {
+  NodeIdBlock block;
+  std::vector<size_t> indices;
+  NodeId target(NodeId::kRandomId);
+  block.SelectClosest(target, 4, &indices);
+  ASSERT_TRUE(indices.empty());
+
+  const size_t kCount(101);
+  std::vector<NodeId> node_ids;
+  for (size_t i = 0; i < kCount; ++i) {
+    node_ids.push_back(NodeId(NodeId::kRandomId));
+    block.Add(node_ids.back());
+  }
+  // Duplicate, and an ID sharing the first word of the target.
+  block.Add(node_ids[7]);
+  node_ids.push_back(node_ids[7]);
+  std::string raw_id(target.String());
+  raw_id[kKeySizeBytes - 1] ^= 1;
+  block.Add(NodeId(raw_id));
+  node_ids.push_back(NodeId(raw_id));
+  ASSERT_EQ(kCount + 2, block.Size());
+
+  std::vector<size_t> expected;
+  for (size_t i = 0; i < node_ids.size(); ++i)
+    expected.push_back(i);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    for (size_t j = i + 1; j < expected.size(); ++j) {
+      if (NodeId::CloserToTarget(node_ids[expected[j]], node_ids[expected[i]],
+                                 target))
+        std::swap(expected[i], expected[j]);
+    }
+  }
+
+  block.SelectClosest(target, node_ids.size(), &indices);
+  ASSERT_EQ(node_ids.size(), indices.size());
+  ASSERT_EQ(kCount + 1, indices.front());
+  for (size_t i = 0; i < indices.size(); ++i)
+    EXPECT_EQ(node_ids[expected[i]], node_ids[indices[i]]);
+
+  for (size_t count = 1; count < 20; ++count) {
+    block.SelectClosest(target, count, &indices);
+    ASSERT_EQ(count, indices.size());
+    for (size_t i = 0; i < count; ++i)
+      EXPECT_EQ(node_ids[expected[i]], node_ids[indices[i]]);
+  }
+
+  block.SelectClosest(NodeId(""), 4, &indices);
+  ASSERT_TRUE(indices.empty());
+  block.Clear();
+  ASSERT_EQ(0U, block.Size());
+}
+
+TEST(NodeIdBlockTest, BEH_SelectClosestSkipsInvalid) {
+  NodeIdBlock block;
+  block.Add(NodeId(""));
+  block.Add(NodeId(NodeId::kMaxId));
+  block.Add(NodeId(""));
+  block.Add(NodeId());
+  std::vector<size_t> indices;
+  block.SelectClosest(NodeId(), 10, &indices);
+  ASSERT_EQ(2U, indices.size());
+  EXPECT_EQ(3U, indices[0]);
+  EXPECT_EQ(1U, indices[1]);
+}
+
+}  // namespace test
+
+}  // namespace dht
+
+}  // namespace maidsafe
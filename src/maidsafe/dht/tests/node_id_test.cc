@@ -433,6 +433,54 @@ TEST(NodeIdTest, BEH_OperatorXOR) {
     ASSERT_EQ('\0', zero[i]);
 }
 
+TEST(NodeIdTest, BEH_CloserToTarget) {
+  NodeId target(NodeId::kRandomId);
+  for (int i = 0; i < 100; ++i) {
+    NodeId id1(NodeId::kRandomId), id2(NodeId::kRandomId);
+    std::string distance1((id1 ^ target).String());
+    std::string distance2((id2 ^ target).String());
+    ASSERT_EQ(distance1 < distance2,
+              NodeId::CloserToTarget(id1, id2, target));
+    ASSERT_EQ(distance2 < distance1,
+              NodeId::CloserToTarget(id2, id1, target));
+  }
+  // Differ only in the last bit of the first and of the final 64-bit word.
+  std::string raw(kZeroId);
+  raw[7] = 1;
+  NodeId first_word(raw);
+  raw[7] = 0;
+  raw[kKeySizeBytes - 1] = 1;
+  NodeId last_word(raw);
+  ASSERT_TRUE(NodeId::CloserToTarget(last_word, first_word, NodeId()));
+  ASSERT_FALSE(NodeId::CloserToTarget(first_word, last_word, NodeId()));
+  ASSERT_FALSE(NodeId::CloserToTarget(first_word, first_word, NodeId()));
+  ASSERT_TRUE(last_word < first_word);
+  ASSERT_FALSE(NodeId::CloserToTarget(NodeId(""), first_word, NodeId()));
+  ASSERT_FALSE(NodeId::CloserToTarget(first_word, NodeId(""), NodeId()));
+}
+
+TEST(NodeIdTest, BEH_CommonLeadingBits) {
+  NodeId id(NodeId::kRandomId);
+  ASSERT_EQ(kKeySizeBits, id.CommonLeadingBits(id));
+  ASSERT_EQ(0, id.CommonLeadingBits(NodeId("")));
+  ASSERT_EQ(0, NodeId("").CommonLeadingBits(id));
+  for (uint16_t i = 0; i < kKeySizeBits; ++i) {
+    NodeId other(id ^ NodeId(i));
+    ASSERT_EQ(kKeySizeBits - 1 - i, id.CommonLeadingBits(other));
+    ASSERT_EQ(kKeySizeBits - 1 - i, other.CommonLeadingBits(id));
+  }
+  for (int i = 0; i < 100; ++i) {
+    NodeId other(NodeId::kRandomId);
+    std::string binary_id(id.ToStringEncoded(NodeId::kBinary));
+    std::string binary_other(other.ToStringEncoded(NodeId::kBinary));
+    uint16_t expected(0);
+    while (expected < kKeySizeBits &&
+           binary_id[expected] == binary_other[expected])
+      ++expected;
+    ASSERT_EQ(expected, id.CommonLeadingBits(other));
+  }
+}
+
 TEST(NodeIdTest, BEH_OperatorEql) {
   NodeId kadid1(NodeId::kRandomId), kadid2;
   kadid2 = kadid1;
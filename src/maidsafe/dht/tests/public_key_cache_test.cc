@@ -0,0 +1,91 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <string>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/dht/public_key_cache.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace test {
+
+class PublicKeyCacheTest : public testing::Test {
+ public:
+  PublicKeyCacheTest()
+      : public_key_cache_(2, bptime::hours(1), bptime::milliseconds(100)),
+        keys_() {
+    asymm::GenerateKeyPair(&keys_);
+  }
+
+ protected:
+  PublicKeyCache public_key_cache_;
+  asymm::Keys keys_;
+};
+
+TEST_F(PublicKeyCacheTest, BEH_AddAndGet) {
+  asymm::PublicKey public_key;
+  asymm::ValidationToken validation_token;
+  EXPECT_FALSE(public_key_cache_.Get("id", &public_key, &validation_token));
+  public_key_cache_.Add("id", keys_.public_key, "token");
+  public_key_cache_.Add("", keys_.public_key, "token");
+  EXPECT_EQ(1U, public_key_cache_.Size());
+  ASSERT_TRUE(public_key_cache_.Get("id", &public_key, &validation_token));
+  EXPECT_TRUE(asymm::MatchingPublicKeys(keys_.public_key, public_key));
+  EXPECT_EQ("token", validation_token);
+  EXPECT_FALSE(public_key_cache_.Get("id", nullptr, &validation_token));
+
+  public_key_cache_.Remove("id");
+  EXPECT_FALSE(public_key_cache_.Get("id", &public_key, &validation_token));
+  public_key_cache_.Add("id", keys_.public_key, "token");
+  public_key_cache_.Clear();
+  EXPECT_EQ(0U, public_key_cache_.Size());
+}
+
+TEST_F(PublicKeyCacheTest, BEH_NegativeTimeToLive) {
+  asymm::PublicKey public_key;
+  asymm::ValidationToken validation_token;
+  // An invalid key is cached for the negative time to live only
+  public_key_cache_.Add("unknown", asymm::PublicKey(), "");
+  public_key_cache_.Add("known", keys_.public_key, "");
+  EXPECT_TRUE(public_key_cache_.Get("unknown", &public_key,
+                                    &validation_token));
+  EXPECT_FALSE(asymm::ValidateKey(public_key));
+  Sleep(bptime::milliseconds(200));
+  EXPECT_FALSE(public_key_cache_.Get("unknown", &public_key,
+                                     &validation_token));
+  EXPECT_TRUE(public_key_cache_.Get("known", &public_key, &validation_token));
+}
+
+}  // namespace test
+
+}  // namespace dht
+
+}  // namespace maidsafe
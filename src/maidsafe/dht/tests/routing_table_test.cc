@@ -65,7 +65,8 @@ class RoutingTableTest : public CreateContactAndNodeId,
         k_(static_cast<uint16_t>(GetParam())),
         routing_table_(holder_id_, k_),
         contact_(ComposeContact(NodeId(NodeId::kRandomId), 6101)),
-        thread_barrier_(new boost::barrier(kThreadBarrierSize)) {}
+        thread_barrier_(new boost::barrier(kThreadBarrierSize)),
+        pinged_contacts_() {}
 
   // Methods for multithreaded test
   void DoAddContact(Contact contact) {
@@ -106,6 +107,12 @@ class RoutingTableTest : public CreateContactAndNodeId,
     EXPECT_EQ(0, routing_table_.SetPreferredEndpoint(node_id, ip));
   }
 
+  void PingOldestContact(const Contact &oldest_contact,
+                         const Contact &/*replacement_contact*/,
+                         RankInfoPtr /*replacement_rank_info*/) {
+    pinged_contacts_.push_back(oldest_contact);
+  }
+
   void DoAddRemoveContact(Contact contact) {
     routing_table_.AddContact(contact, rank_info_);
     thread_barrier_->wait();
@@ -124,8 +131,37 @@ class RoutingTableTest : public CreateContactAndNodeId,
     return routing_table_.KBucketSizeForKey(key);
   }
 
-  RoutingTableContactsContainer GetContainer() {
-    return routing_table_.contacts_;
+  Contact GetLastSeenContact(const uint16_t &kbucket_index) {
+    return routing_table_.GetLastSeenContact(kbucket_index);
+  }
+
+  const RoutingTableContact* GetRoutingTableContact(const NodeId &node_id) {
+    return routing_table_.FindContact(node_id);
+  }
+
+  KBucket GetKBucket(const uint16_t &kbucket_index) {
+    return GetKBucket(routing_table_, kbucket_index);
+  }
+
+  KBucket GetKBucket(const RoutingTable &routing_table,
+                     const uint16_t &kbucket_index) {
+    return routing_table.kbuckets_[kbucket_index];
+  }
+
+  NodeId GetFurthestDistanceInKBucket(const uint16_t &kbucket_index) {
+    const KBucket &kbucket(routing_table_.kbuckets_[kbucket_index]);
+    NodeId furthest_distance;
+    for (auto it = kbucket.begin(); it != kbucket.end(); ++it) {
+      NodeId distance(holder_id_ ^ (*it).contact->node_id());
+      if (furthest_distance < distance)
+        furthest_distance = distance;
+    }
+    return furthest_distance;
+  }
+
+  std::string GetPublicKey(const NodeId &node_id) {
+    auto it = routing_table_.public_keys_.find(node_id);
+    return it == routing_table_.public_keys_.end() ? "" : (*it).second;
   }
 
   UnValidatedContactsContainer GetUnValidatedContactsContainer() {
@@ -133,7 +169,19 @@ class RoutingTableTest : public CreateContactAndNodeId,
   }
 
   size_t GetSize() {
-    return routing_table_.Size();
+    return GetSize(routing_table_);
+  }
+
+  size_t GetSize(RoutingTable &routing_table) {
+    return routing_table.Size();
+  }
+
+  RoutingTableSnapshotPtr GetSnapshot() const {
+    return GetSnapshot(routing_table_);
+  }
+
+  RoutingTableSnapshotPtr GetSnapshot(const RoutingTable &routing_table) const {
+    return routing_table.Snapshot();
   }
 
   void Clear() {
@@ -183,6 +231,7 @@ class RoutingTableTest : public CreateContactAndNodeId,
   RoutingTable routing_table_;
   Contact contact_;
   std::shared_ptr<boost::barrier> thread_barrier_;
+  std::vector<Contact> pinged_contacts_;
 };
 
 class RoutingTableSingleKTest : public RoutingTableTest {
@@ -264,25 +313,25 @@ TEST_P(RoutingTableTest, BEH_SetValidated) {
   Contact contact = ComposeContact(contact_id, 5001);
   routing_table_.AddContact(contact, rank_info_);
   ASSERT_EQ(1U, GetUnValidatedContactsContainer().size());
-  ASSERT_EQ(0U, GetContainer().size());
+  ASSERT_EQ(0U, GetSize());
   routing_table_.SetValidated(contact_id, true);
   ASSERT_EQ(0U, GetUnValidatedContactsContainer().size());
-  ASSERT_EQ(1U, GetContainer().size());
+  ASSERT_EQ(1U, GetSize());
 
   // Set the entry to in-valid
   routing_table_.SetValidated(contact_id, false);
   ASSERT_EQ(0U, GetUnValidatedContactsContainer().size());
-  ASSERT_EQ(0U, GetContainer().size());
+  ASSERT_EQ(0U, GetSize());
 
   // Add the entry again
   routing_table_.AddContact(contact, rank_info_);
   ASSERT_EQ(1U, GetUnValidatedContactsContainer().size());
-  ASSERT_EQ(0U, GetContainer().size());
+  ASSERT_EQ(0U, GetSize());
 
   // Set the entry to in-valid, this shall remove the entry
   routing_table_.SetValidated(contact_id, false);
   ASSERT_EQ(0U, GetUnValidatedContactsContainer().size());
-  ASSERT_EQ(0U, GetContainer().size());
+  ASSERT_EQ(0U, GetSize());
 }
 
 TEST_P(RoutingTableTest, BEH_AddContactForRandomCommonLeadingBits) {
@@ -361,10 +410,12 @@ TEST_P(RoutingTableSingleKTest, FUNC_ForceKAcceptNewPeer) {
 
     // remove contact from bucket with common_leading_bit(507, 506)
     for (int i = 0; i < k_ - (k_ / 2 - 2); ++i) {
-      auto pit_2 = routing_table_.contacts_.get<KBucketTag>().equal_range(4);
-      routing_table_.SetValidated((*pit_2.first).node_id, false);
-      pit_2 = routing_table_.contacts_.get<KBucketTag>().equal_range(5);
-      routing_table_.SetValidated((*pit_2.first).node_id, false);
+      KBucket kbucket(GetKBucket(4));
+      if (!kbucket.empty())
+        routing_table_.SetValidated(kbucket.front().contact->node_id(), false);
+      kbucket = GetKBucket(5);
+      if (!kbucket.empty())
+        routing_table_.SetValidated(kbucket.front().contact->node_id(), false);
     }
     // Adding contact to bucket having kclosest contact
     bool fail_check(false);
@@ -373,12 +424,7 @@ TEST_P(RoutingTableSingleKTest, FUNC_ForceKAcceptNewPeer) {
       NodeId node_id = GenerateUniqueRandomId(holder_id_, 508);
       Contact contact = ComposeContact(node_id, 5678);
       RankInfoPtr rank_info;
-      auto pit =
-          routing_table_.contacts_.get<KBucketDistanceToThisIdTag>().equal_range
-          (boost::make_tuple(3));
-      auto it_end = pit.second;
-      --it_end;
-      NodeId furthest_distance = (*it_end).distance_to_this_id;
+      NodeId furthest_distance = GetFurthestDistanceInKBucket(3);
       NodeId distance_to_node = routing_table_.kThisId_ ^ node_id;
       if (distance_to_node >= furthest_distance) {
         int force_result = routing_table_.ForceKAcceptNewPeer(contact, 3,
@@ -395,7 +441,7 @@ TEST_P(RoutingTableSingleKTest, FUNC_ForceKAcceptNewPeer) {
         break;
       ++retry;
     }
-    EXPECT_EQ(k_, routing_table_.contacts_.get<KBucketTag>().count(3));
+    EXPECT_EQ(k_, GetKBucket(3).size());
   }
   Clear();
   for (int i = 0; i < k_; ++i) {
@@ -442,12 +488,7 @@ TEST_P(RoutingTableSingleKTest, FUNC_ForceKAcceptNewPeer) {
     NodeId node_id = GenerateUniqueRandomId(holder_id_, 510);
     Contact contact = ComposeContact(node_id, 5678);
     RankInfoPtr rank_info;
-    auto pit =
-        routing_table_.contacts_.get<KBucketDistanceToThisIdTag>().equal_range(
-        boost::make_tuple(1));
-    auto it_end = pit.second;
-    --it_end;
-    NodeId furthest_distance = (*it_end).distance_to_this_id;
+    NodeId furthest_distance = GetFurthestDistanceInKBucket(1);
     NodeId distance_to_node = routing_table_.kThisId_ ^ node_id;
     if (distance_to_node >= furthest_distance) {
       int force_result = routing_table_.ForceKAcceptNewPeer(contact, 1,
@@ -477,15 +518,12 @@ TEST_P(RoutingTableTest, BEH_AddContact) {
     Contact contact = ComposeContact(contact_id, 5000);
     AddContact(contact);
     routing_table_.IncrementFailedRpcCount(contact_id);
-    bptime::ptime old_last_seen = (*(GetContainer().get<NodeIdTag>().find(
-        contact_.node_id()))).last_seen;
-    ASSERT_EQ(1U, (*(GetContainer().get<NodeIdTag>().find(
-        contact_id))).num_failed_rpcs);
+    bptime::ptime old_last_seen =
+        GetRoutingTableContact(contact_id)->last_seen;
+    ASSERT_EQ(1U, GetRoutingTableContact(contact_id)->num_failed_rpcs);
     AddContact(contact);
-    ASSERT_EQ(0U, (*(GetContainer().get<NodeIdTag>().find(
-        contact_id))).num_failed_rpcs);
-    ASSERT_NE(old_last_seen, (*(GetContainer().get<NodeIdTag>().find(
-        contact_id))).last_seen);
+    ASSERT_EQ(0U, GetRoutingTableContact(contact_id)->num_failed_rpcs);
+    ASSERT_NE(old_last_seen, GetRoutingTableContact(contact_id)->last_seen);
   }
   Clear();
   uint16_t i(0);
@@ -717,14 +755,13 @@ TEST_P(RoutingTableTest, BEH_GetCloseContacts) {
 
     // Initialize a routing table having the target to be the holder
     NodeId target_id = GenerateUniqueRandomId(holder_id_, 505);
-    RoutingTableContactsContainer target_routingtable;
+    OrderedContacts target_routingtable(CreateOrderedContacts(target_id));
 
     for (int num_contact = 0; num_contact < k_; ++num_contact) {
       NodeId contact_id = GenerateUniqueRandomId(holder_id_, 400);
       Contact contact = ComposeContact(contact_id, 5000);
       AddContact(contact);
-      RoutingTableContact new_contact(contact, target_id, 0);
-      target_routingtable.insert(new_contact);
+      target_routingtable.insert(contact);
     }
 
     for (int common_head = 0; common_head < 16; ++common_head) {
@@ -733,8 +770,7 @@ TEST_P(RoutingTableTest, BEH_GetCloseContacts) {
                                                    511 - common_head);
         Contact contact = ComposeContact(contact_id, 5000);
         AddContact(contact);
-        RoutingTableContact new_contact(contact, target_id, 0);
-        target_routingtable.insert(new_contact);
+        target_routingtable.insert(contact);
       }
     }
     EXPECT_EQ(k_ + (16 * 2), GetSize());
@@ -751,18 +787,45 @@ TEST_P(RoutingTableTest, BEH_GetCloseContacts) {
                                                &close_contacts);
     EXPECT_EQ(k_ + 21, close_contacts.size());
 
-    ContactsByDistanceToThisId key_dist_indx
-      = target_routingtable.get<DistanceToThisIdTag>();
     uint32_t counter(0);
-    auto it = key_dist_indx.begin();
-    while ((counter < (k_ + 21u)) && (it != key_dist_indx.end())) {
+    auto it = target_routingtable.begin();
+    while ((counter < (k_ + 21u)) && (it != target_routingtable.end())) {
       ASSERT_NE(close_contacts.end(), std::find(close_contacts.begin(),
                                                 close_contacts.end(),
-                                                (*it).contact));
+                                                *it));
       ++counter;
       ++it;
     }
   }
+  Clear();
+  {
+    // exclude every other contact of a filled routing table and check the
+    // result against a brute force ranking of the remaining contacts
+    NodeId target_id(NodeId::kRandomId);
+    std::vector<Contact> all_contacts, exclude_contacts;
+    for (int i = 0; i < 4 * k_; ++i) {
+      NodeId contact_id = GenerateUniqueRandomId(holder_id_, 511 - (i % 8));
+      Contact contact = ComposeContact(contact_id, 5000);
+      AddContact(contact);
+    }
+    routing_table_.GetAllContacts(&all_contacts);
+    OrderedContacts expected_routingtable(CreateOrderedContacts(target_id));
+    for (size_t i = 0; i < all_contacts.size(); ++i) {
+      if (i % 2 == 0)
+        exclude_contacts.push_back(all_contacts[i]);
+      else
+        expected_routingtable.insert(all_contacts[i]);
+    }
+
+    std::vector<Contact> close_contacts;
+    routing_table_.GetCloseContacts(target_id, k_, exclude_contacts,
+                                    &close_contacts);
+    ASSERT_EQ(std::min(static_cast<size_t>(k_), expected_routingtable.size()),
+              close_contacts.size());
+    auto it = expected_routingtable.begin();
+    for (size_t i = 0; i < close_contacts.size(); ++i, ++it)
+      EXPECT_EQ(*it, close_contacts[i]);
+  }
 }
 
 TEST_P(RoutingTableTest, BEH_SetPublicKey) {
@@ -771,12 +834,13 @@ TEST_P(RoutingTableTest, BEH_SetPublicKey) {
   EXPECT_EQ(kFailedToFindContact,
             routing_table_.SetPublicKey(NodeId(NodeId::kRandomId),
                                         new_public_key));
-  EXPECT_NE(new_public_key , (*(GetContainer().get<NodeIdTag>().find(
-      contact_.node_id()))).public_key);
+  EXPECT_NE(new_public_key, GetPublicKey(contact_.node_id()));
   ASSERT_EQ(0, routing_table_.SetPublicKey(contact_.node_id(),
                                            new_public_key));
-  ASSERT_EQ(new_public_key , (*(GetContainer().get<NodeIdTag>().find(
-      contact_.node_id()))).public_key);
+  ASSERT_EQ(new_public_key, GetPublicKey(contact_.node_id()));
+  // the key is dropped along with the contact
+  routing_table_.SetValidated(contact_.node_id(), false);
+  EXPECT_TRUE(GetPublicKey(contact_.node_id()).empty());
 
   Clear();
   {
@@ -798,8 +862,8 @@ TEST_P(RoutingTableTest, BEH_UpdateRankInfo) {
                                           new_rank_info));
   ASSERT_EQ(0, routing_table_.UpdateRankInfo(contact_.node_id(),
                                              new_rank_info));
-  ASSERT_EQ(new_rank_info->rtt, (*(GetContainer().get<NodeIdTag>().find(
-      contact_.node_id()))).rank_info->rtt);
+  ASSERT_EQ(new_rank_info->rtt,
+            GetRoutingTableContact(contact_.node_id())->rank_info->rtt);
 
   Clear();
   {
@@ -818,8 +882,8 @@ TEST_P(RoutingTableTest, BEH_SetPreferredEndpoint) {
   EXPECT_EQ(kFailedToFindContact,
             routing_table_.SetPreferredEndpoint(NodeId(NodeId::kRandomId), ip));
   ASSERT_EQ(0, routing_table_.SetPreferredEndpoint(contact_.node_id(), ip));
-  ASSERT_EQ(ip, (*(GetContainer().get<NodeIdTag>().find(
-    contact_.node_id()))).contact.PreferredEndpoint().ip);
+  ASSERT_EQ(ip, GetRoutingTableContact(contact_.node_id())->
+                    contact->PreferredEndpoint().ip);
 
   Clear();
   {
@@ -836,12 +900,11 @@ TEST_P(RoutingTableTest, BEH_IncrementFailedRpcCount) {
   this->FillContactToRoutingTable();
   EXPECT_EQ(kFailedToFindContact, routing_table_.IncrementFailedRpcCount(
       NodeId(NodeId::kRandomId)));
-  EXPECT_EQ(uint16_t(0), (*(GetContainer().get<NodeIdTag>().find(
-     contact_.node_id()))).num_failed_rpcs);
+  EXPECT_EQ(uint16_t(0),
+            GetRoutingTableContact(contact_.node_id())->num_failed_rpcs);
   ASSERT_EQ(kSuccess,
             routing_table_.IncrementFailedRpcCount(contact_.node_id()));
-  ASSERT_EQ(1, (*(GetContainer().get<NodeIdTag>().find(
-               contact_.node_id()))).num_failed_rpcs);
+  ASSERT_EQ(1, GetRoutingTableContact(contact_.node_id())->num_failed_rpcs);
   {
     // keep increasing one contact's failed RPC counter
     // till it gets removed
@@ -910,6 +973,290 @@ TEST_P(RoutingTableTest, BEH_GetAllContacts) {
   }
 }
 
+TEST_P(RoutingTableTest, BEH_AverageRtt) {
+  EXPECT_EQ(0, routing_table_.GetAverageRtt(contact_.node_id()));
+  EXPECT_EQ(0, routing_table_.GetRttTimeout(contact_.node_id()));
+  AddContact(contact_);
+  EXPECT_EQ(0, routing_table_.GetAverageRtt(contact_.node_id()));
+  EXPECT_EQ(0, routing_table_.GetRttTimeout(contact_.node_id()));
+  // the first measured RTT is taken as is
+  RankInfoPtr rank_info(new transport::Info);
+  rank_info->rtt = 80;
+  routing_table_.AddContact(contact_, rank_info);
+  EXPECT_DOUBLE_EQ(80, routing_table_.GetAverageRtt(contact_.node_id()));
+  EXPECT_DOUBLE_EQ(240, routing_table_.GetRttTimeout(contact_.node_id()));
+  // later ones are folded in with a weight of 1/8
+  rank_info->rtt = 160;
+  routing_table_.AddContact(contact_, rank_info);
+  EXPECT_DOUBLE_EQ(90, routing_table_.GetAverageRtt(contact_.node_id()));
+  EXPECT_DOUBLE_EQ(290, routing_table_.GetRttTimeout(contact_.node_id()));
+  // unmeasured RTTs are ignored
+  routing_table_.AddContact(contact_, RankInfoPtr());
+  rank_info->rtt = 0;
+  routing_table_.AddContact(contact_, rank_info);
+  EXPECT_DOUBLE_EQ(90, routing_table_.GetAverageRtt(contact_.node_id()));
+  RoutingTableContact routing_table_contact(
+      *GetRoutingTableContact(contact_.node_id()));
+  EXPECT_DOUBLE_EQ(90, routing_table_contact.rtt_average);
+  EXPECT_DOUBLE_EQ(50, routing_table_contact.rtt_variance);
+}
+
+TEST_P(RoutingTableTest, BEH_ReplacementCache) {
+  routing_table_.ping_oldest_contact()->connect(
+      std::bind(&RoutingTableTest::PingOldestContact, this,
+                std::placeholders::_1, std::placeholders::_2,
+                std::placeholders::_3));
+  // fill k-buckets 0, 1 and 2; k-bucket 0 is then neither the brother k-bucket
+  // nor holds any of the k closest contacts, so can't accept new contacts
+  std::vector<Contact> kbucket_0_contacts;
+  for (int pos = 511; pos >= 509; --pos) {
+    for (int i = 0; i < k_; ++i) {
+      Contact contact(ComposeContact(GenerateUniqueRandomId(holder_id_, pos),
+                                     5000 + i));
+      AddContact(contact);
+      if (pos == 511)
+        kbucket_0_contacts.push_back(contact);
+    }
+  }
+  ASSERT_EQ(3U * k_, GetSize());
+  ASSERT_EQ(k_, GetKBucketSizeForKey(0));
+  EXPECT_TRUE(pinged_contacts_.empty());
+
+  // only the first candidate for the full k-bucket triggers a ping
+  std::vector<Contact> candidates;
+  for (int i = 0; i < k_; ++i) {
+    candidates.push_back(ComposeContact(GenerateUniqueRandomId(holder_id_, 511),
+                                        6000 + i));
+    AddContact(candidates.back());
+  }
+  EXPECT_EQ(3U * k_, GetSize());
+  ASSERT_EQ(1U, pinged_contacts_.size());
+  EXPECT_EQ(kbucket_0_contacts.front().node_id(),
+            pinged_contacts_.front().node_id());
+  Contact result;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    routing_table_.GetContact(candidates[i].node_id(), &result);
+    EXPECT_EQ(Contact(), result);
+  }
+
+  // once the oldest contact answers, the next candidate triggers a new ping
+  AddContact(kbucket_0_contacts.front());
+  AddContact(candidates.front());
+  ASSERT_EQ(2U, pinged_contacts_.size());
+  EXPECT_EQ(kbucket_0_contacts[1].node_id(),
+            pinged_contacts_.back().node_id());
+
+  // evicting a contact promotes the most recently seen candidate
+  for (int i = 0; i <= kFailedRpcTolerance; ++i)
+    routing_table_.IncrementFailedRpcCount(pinged_contacts_.back().node_id());
+  EXPECT_EQ(3U * k_, GetSize());
+  routing_table_.GetContact(pinged_contacts_.back().node_id(), &result);
+  EXPECT_EQ(Contact(), result);
+  routing_table_.GetContact(candidates.front().node_id(), &result);
+  EXPECT_EQ(candidates.front().node_id(), result.node_id());
+}
+
+TEST_P(RoutingTableTest, BEH_AddContactWithDifferentKey) {
+  routing_table_.ping_oldest_contact()->connect(
+      std::bind(&RoutingTableTest::PingOldestContact, this,
+                std::placeholders::_1, std::placeholders::_2,
+                std::placeholders::_3));
+  asymm::Keys keys, other_keys;
+  asymm::GenerateKeyPair(&keys);
+  asymm::GenerateKeyPair(&other_keys);
+  // fill k-buckets 0, 1 and 2 so that k-bucket 0 can't accept new contacts
+  std::vector<Contact> kbucket_0_contacts;
+  for (int pos = 511; pos >= 509; --pos) {
+    for (int i = 0; i < k_; ++i) {
+      Contact contact(ComposeContactWithKey(
+          GenerateUniqueRandomId(holder_id_, pos), 5000 + i, keys));
+      AddContact(contact);
+      if (pos == 511)
+        kbucket_0_contacts.push_back(contact);
+    }
+  }
+  ASSERT_EQ(k_, GetKBucketSizeForKey(0));
+  const Contact kOldest(kbucket_0_contacts.front());
+  ASSERT_EQ(kOldest.node_id(), GetLastSeenContact(0).node_id());
+
+  // the same ID with a different key is neither seen nor moved
+  Contact impostor(ComposeContactWithKey(kOldest.node_id(), 7000,
+                                         other_keys));
+  RoutingTableSnapshotPtr snapshot(GetSnapshot());
+  EXPECT_EQ(kFailedToUpdateLastSeenTime,
+            routing_table_.AddContact(impostor, rank_info_));
+  EXPECT_EQ(kOldest.node_id(), GetLastSeenContact(0).node_id());
+  EXPECT_EQ(snapshot, GetSnapshot());
+  Contact result;
+  routing_table_.GetContact(kOldest.node_id(), &result);
+  EXPECT_EQ(kOldest.endpoint().port, result.endpoint().port);
+
+  // nor does it end the probe of the oldest contact
+  AddContact(ComposeContactWithKey(GenerateUniqueRandomId(holder_id_, 511),
+                                   6000, keys));
+  ASSERT_EQ(1U, pinged_contacts_.size());
+  EXPECT_EQ(kOldest.node_id(), pinged_contacts_.front().node_id());
+  routing_table_.AddContact(impostor, rank_info_);
+  AddContact(ComposeContactWithKey(GenerateUniqueRandomId(holder_id_, 511),
+                                   6001, keys));
+  EXPECT_EQ(1U, pinged_contacts_.size());
+
+  // whereas the real contact does
+  EXPECT_EQ(kSuccess, routing_table_.AddContact(kOldest, rank_info_));
+  EXPECT_NE(kOldest.node_id(), GetLastSeenContact(0).node_id());
+  AddContact(ComposeContactWithKey(GenerateUniqueRandomId(holder_id_, 511),
+                                   6002, keys));
+  EXPECT_EQ(2U, pinged_contacts_.size());
+}
+
+TEST_P(RoutingTableTest, BEH_GetRefreshIds) {
+  for (int pos = 511; pos >= 509; --pos) {
+    for (int i = 0; i < k_; ++i)
+      AddContact(ComposeContact(GenerateUniqueRandomId(holder_id_, pos), 5000));
+  }
+  const uint16_t kKBucketCount(GetKBucketCount());
+  ASSERT_LT(1U, kKBucketCount);
+  std::vector<NodeId> refresh_ids;
+  // every k-bucket has just heard from its contacts
+  routing_table_.GetRefreshIds(bptime::hours(1), kKBucketCount, &refresh_ids);
+  EXPECT_TRUE(refresh_ids.empty());
+
+  // only max_count IDs are returned, furthest k-buckets first
+  Sleep(bptime::milliseconds(10));
+  routing_table_.GetRefreshIds(bptime::milliseconds(1), 1, &refresh_ids);
+  ASSERT_EQ(1U, refresh_ids.size());
+  EXPECT_EQ(0U, holder_id_.CommonLeadingBits(refresh_ids[0]));
+
+  routing_table_.GetRefreshIds(bptime::milliseconds(1), kKBucketCount,
+                               &refresh_ids);
+  ASSERT_EQ(kKBucketCount - 1U, refresh_ids.size());
+  for (uint16_t i = 0; i < refresh_ids.size(); ++i) {
+    if (i + 1U < refresh_ids.size())
+      EXPECT_EQ(i + 1U, holder_id_.CommonLeadingBits(refresh_ids[i]));
+    else
+      EXPECT_LE(i + 1U, holder_id_.CommonLeadingBits(refresh_ids[i]));
+  }
+
+  // refreshed k-buckets are active again
+  routing_table_.GetRefreshIds(bptime::hours(1), kKBucketCount, &refresh_ids);
+  EXPECT_TRUE(refresh_ids.empty());
+}
+
+TEST_P(RoutingTableTest, BEH_Snapshot) {
+  RoutingTableSnapshotPtr empty_snapshot(GetSnapshot());
+  ASSERT_EQ(1U, empty_snapshot->kbuckets.size());
+  EXPECT_TRUE(empty_snapshot->kbuckets[0]->empty());
+  EXPECT_EQ(0U, empty_snapshot->contact_count);
+
+  // a view taken before a write is unaffected by it
+  this->FillContactToRoutingTable();
+  RoutingTableSnapshotPtr full_snapshot(GetSnapshot());
+  EXPECT_TRUE(empty_snapshot->kbuckets[0]->empty());
+  EXPECT_EQ(0U, empty_snapshot->contact_count);
+  EXPECT_LT(empty_snapshot->version, full_snapshot->version);
+  EXPECT_EQ(GetSize(), full_snapshot->contact_count);
+  EXPECT_EQ(GetKBucketCount(), full_snapshot->kbuckets.size());
+
+  // statistics and a refresh of the most recently seen contact aren't visible
+  // to readers, so they publish no new view
+  NodeId node_id(GenerateUniqueRandomId(holder_id_, 1));
+  Contact contact(ComposeContact(node_id, 5000));
+  AddContact(contact);
+  RoutingTableSnapshotPtr split_snapshot(GetSnapshot());
+  ASSERT_LT(1U, split_snapshot->kbuckets.size());
+  EXPECT_EQ(0, routing_table_.UpdateRankInfo(node_id, rank_info_));
+  EXPECT_EQ(0, routing_table_.IncrementFailedRpcCount(node_id));
+  EXPECT_EQ(0, routing_table_.AddContact(contact, rank_info_));
+  EXPECT_EQ(split_snapshot, GetSnapshot());
+
+  // only the k-bucket holding the changed contact is rebuilt, and it shares
+  // the unchanged contacts with the previous view
+  EXPECT_EQ(0, routing_table_.SetPreferredEndpoint(node_id,
+                                                   contact.endpoint().ip));
+  RoutingTableSnapshotPtr updated_snapshot(GetSnapshot());
+  EXPECT_EQ(split_snapshot->version + 1, updated_snapshot->version);
+  ASSERT_EQ(split_snapshot->kbuckets.size(), updated_snapshot->kbuckets.size());
+  uint16_t kbucket_index(static_cast<uint16_t>(
+      std::min<size_t>(kKeySizeBits - 2, split_snapshot->kbuckets.size() - 1)));
+  for (uint16_t i = 0; i < updated_snapshot->kbuckets.size(); ++i) {
+    if (i == kbucket_index)
+      EXPECT_NE(split_snapshot->kbuckets[i], updated_snapshot->kbuckets[i]);
+    else
+      EXPECT_EQ(split_snapshot->kbuckets[i], updated_snapshot->kbuckets[i]);
+  }
+  const KBucketView &kbucket(*split_snapshot->kbuckets[kbucket_index]);
+  const KBucketView &updated_kbucket(
+      *updated_snapshot->kbuckets[kbucket_index]);
+  ASSERT_EQ(kbucket.size(), updated_kbucket.size());
+  for (size_t i = 0; i < kbucket.size(); ++i) {
+    if (kbucket[i]->node_id() == node_id)
+      EXPECT_NE(kbucket[i], updated_kbucket[i]);
+    else
+      EXPECT_EQ(kbucket[i], updated_kbucket[i]);
+  }
+
+  Clear();
+  EXPECT_EQ(1U, GetSnapshot()->kbuckets.size());
+  EXPECT_EQ(k_, full_snapshot->contact_count);
+}
+
+TEST_P(RoutingTableTest, BEH_WriteAndReadFile) {
+  boost::system::error_code error_code;
+  fs::path file_path(fs::temp_directory_path() /
+      ("maidsafe/dht/" + EncodeToBase32(RandomString(10U))));
+  fs::create_directories(file_path, error_code);
+  ASSERT_EQ(0, error_code.value());
+  fs::path file(file_path / "routing_table");
+  EXPECT_EQ(kFailedToLoadRoutingTable, routing_table_.ReadFromFile(file));
+
+  // close_contact stays alone in the holder's k-bucket, so it can't be
+  // displaced by the contacts filling the far k-buckets
+  Contact close_contact(ComposeContact(GenerateUniqueRandomId(holder_id_, 500),
+                                       6101));
+  RankInfoPtr rank_info(new transport::Info);
+  rank_info->rtt = 80;
+  routing_table_.AddContact(close_contact, rank_info);
+  routing_table_.SetValidated(close_contact.node_id(), true);
+  for (int pos = 511; pos >= 509; --pos) {
+    for (int i = 0; i < k_; ++i)
+      AddContact(ComposeContact(GenerateUniqueRandomId(holder_id_, pos), 5000));
+  }
+  routing_table_.IncrementFailedRpcCount(close_contact.node_id());
+  EXPECT_EQ(kSuccess, routing_table_.WriteToFile(file));
+
+  // a routing table with the same holder reloads the contacts in order
+  RoutingTable reloaded_table(holder_id_, k_);
+  EXPECT_EQ(kSuccess, reloaded_table.ReadFromFile(file));
+  RoutingTableSnapshotPtr snapshot(GetSnapshot());
+  RoutingTableSnapshotPtr reloaded_snapshot(GetSnapshot(reloaded_table));
+  EXPECT_EQ(snapshot->contact_count, reloaded_snapshot->contact_count);
+  ASSERT_EQ(snapshot->kbuckets.size(), reloaded_snapshot->kbuckets.size());
+  for (uint16_t i = 0; i < snapshot->kbuckets.size(); ++i) {
+    KBucket kbucket(GetKBucket(i));
+    KBucket reloaded_kbucket(GetKBucket(reloaded_table, i));
+    ASSERT_EQ(kbucket.size(), reloaded_kbucket.size());
+    for (size_t j = 0; j < kbucket.size(); ++j) {
+      EXPECT_EQ(*kbucket[j].contact, *reloaded_kbucket[j].contact);
+      EXPECT_EQ(kbucket[j].kbucket_index, reloaded_kbucket[j].kbucket_index);
+      EXPECT_EQ(kbucket[j].last_seen, reloaded_kbucket[j].last_seen);
+      EXPECT_EQ(kbucket[j].num_failed_rpcs,
+                reloaded_kbucket[j].num_failed_rpcs);
+      EXPECT_DOUBLE_EQ(kbucket[j].rtt_average, reloaded_kbucket[j].rtt_average);
+      EXPECT_DOUBLE_EQ(kbucket[j].rtt_variance,
+                       reloaded_kbucket[j].rtt_variance);
+    }
+  }
+  EXPECT_DOUBLE_EQ(80, reloaded_table.GetAverageRtt(close_contact.node_id()));
+
+  // a routing table with a different holder rejects the file untouched
+  RoutingTable other_table(NodeId(NodeId::kRandomId), k_);
+  other_table.AddContact(close_contact, rank_info);
+  other_table.SetValidated(close_contact.node_id(), true);
+  EXPECT_EQ(kFailedToLoadRoutingTable, other_table.ReadFromFile(file));
+  EXPECT_EQ(1U, GetSize(other_table));
+  fs::remove_all(file_path);
+}
+
 TEST_P(RoutingTableTest, BEH_GetLocalRankInfo) {
   {
     NodeId contact_id(NodeId::kRandomId);
@@ -1036,15 +1383,13 @@ TEST_P(RoutingTableSingleKTest, BEH_MutexTestWithMultipleThread) {
   }
   // Checking changed attributes
   for (int i = 0; i < kIterartorSize; ++i) {
-    EXPECT_EQ(stored_attrs[i].get<0>(),
-              (*(GetContainer().get<NodeIdTag>().find(node_ids_stored[i]))).
-                  public_key);
+    const RoutingTableContact *routing_table_contact(
+        GetRoutingTableContact(node_ids_stored[i]));
+    EXPECT_EQ(stored_attrs[i].get<0>(), GetPublicKey(node_ids_stored[i]));
     EXPECT_EQ(stored_attrs[i].get<1>()->rtt,
-              (*(GetContainer().get<NodeIdTag>().find(node_ids_stored[i]))).
-                  rank_info->rtt);
+              routing_table_contact->rank_info->rtt);
     EXPECT_EQ(stored_attrs[i].get<2>(),
-              (*(GetContainer().get<NodeIdTag>().find(node_ids_stored[i]))).
-                  contact.PreferredEndpoint().ip);
+              routing_table_contact->contact->PreferredEndpoint().ip);
   }
 }
 
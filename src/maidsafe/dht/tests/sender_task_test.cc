@@ -50,6 +50,7 @@ class SenderTaskTest: public testing::Test {
         sender_task_(new SenderTask),
         count_callback_1_(0),
         count_callback_2_(0),
+        run_keys_(),
         asio_thread_group_() {
   }
 
@@ -90,6 +91,19 @@ class SenderTaskTest: public testing::Test {
                          asymm::PublicKey,
                          asymm::ValidationToken) { ++count_callback_2_; }
 
+  void RecordTaskCallBack(KeyValueSignature key_value_signature,
+                          transport::Info,
+                          RequestAndSignature,
+                          asymm::PublicKey,
+                          asymm::ValidationToken) {
+    run_keys_.push_back(key_value_signature.key);
+  }
+
+  void RunHeldTasks(const std::string &public_key_id) {
+    sender_task_->SenderTaskCallback(public_key_id, asymm::PublicKey(),
+                                     "public_key_validation");
+  }
+
   size_t GetSenderTaskSize() {
     return sender_task_->task_index_->size();
   }
@@ -118,6 +132,7 @@ class SenderTaskTest: public testing::Test {
   transport::Info info_;
   std::shared_ptr<SenderTask> sender_task_;
   volatile uint16_t count_callback_1_, count_callback_2_;
+  std::vector<std::string> run_keys_;
   boost::thread_group asio_thread_group_;
 };
 
@@ -197,6 +212,48 @@ TEST_F(SenderTaskTest, BEH_AddTask) {
   }
 }
 
+TEST_F(SenderTaskTest, BEH_RunTask) {
+  asymm::Keys crypto_key_data;
+  asymm::GenerateKeyPair(&crypto_key_data);
+  RequestAndSignature request_signature("message", "message_signature");
+  TaskCallback task_cb = std::bind(&SenderTaskTest::RecordTaskCallBack, this,
+                                   args::_1, args::_2, args::_3, args::_4,
+                                   args::_5);
+  std::vector<KeyValueSignature> kvs;
+  for (int i = 0; i != 3; ++i)
+    kvs.push_back(MakeKVS(crypto_key_data, 1024, "", ""));
+  // Invalid task
+  EXPECT_FALSE(sender_task_->RunTask(kvs[0], info_, request_signature, "",
+                                     task_cb, asymm::PublicKey(), ""));
+  // Nothing held for the ID, so the task runs at once
+  EXPECT_TRUE(sender_task_->RunTask(kvs[0], info_, request_signature,
+                                    "public_key_id_1", task_cb,
+                                    asymm::PublicKey(), ""));
+  ASSERT_EQ(1U, run_keys_.size());
+  EXPECT_EQ(kvs[0].key, run_keys_[0]);
+  run_keys_.clear();
+
+  // A task for an ID with tasks held queues behind them
+  bool is_new_id(false);
+  EXPECT_TRUE(sender_task_->AddTask(kvs[1], info_, request_signature,
+                                    "public_key_id_1", task_cb, &is_new_id));
+  EXPECT_TRUE(is_new_id);
+  EXPECT_TRUE(sender_task_->RunTask(kvs[2], info_, request_signature,
+                                    "public_key_id_1", task_cb,
+                                    asymm::PublicKey(), ""));
+  EXPECT_TRUE(run_keys_.empty());
+  EXPECT_EQ(size_t(2), GetSenderTaskSize());
+  // A key held by a task for a different ID isn't run
+  EXPECT_FALSE(sender_task_->RunTask(kvs[1], info_, request_signature,
+                                     "public_key_id_2", task_cb,
+                                     asymm::PublicKey(), ""));
+  RunHeldTasks("public_key_id_1");
+  EXPECT_EQ(size_t(0), GetSenderTaskSize());
+  ASSERT_EQ(2U, run_keys_.size());
+  EXPECT_EQ(kvs[1].key, run_keys_[0]);
+  EXPECT_EQ(kvs[2].key, run_keys_[1]);
+}
+
 TEST_F(SenderTaskTest, FUNC_SenderTaskCallback) {
   asymm::Keys crypto_key_data;
   RequestAndSignature request_signature("message", "message_signature");
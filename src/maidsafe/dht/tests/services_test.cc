@@ -40,6 +40,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "maidsafe/common/utils.h"
 #include "maidsafe/transport/transport.h"
 #include "maidsafe/dht/log.h"
+#include "maidsafe/dht/crypto_pool.h"
 #include "maidsafe/dht/data_store.h"
 #include "maidsafe/dht/service.h"
 #include "maidsafe/dht/message_handler.h"
@@ -112,7 +113,13 @@ class ServicesTest: public CreateContactAndNodeId, public testing::Test {
         rank_info_(),
         service_(new Service(routing_table_, data_store_,
                              GetPrivateKeyPtr(key_pair_), g_kKademliaK)),
-        num_of_pings_(0) {
+        num_of_pings_(0),
+        validations_(0),
+        validating_threads_(),
+        asio_thread_id_(),
+        asio_thread_held_(false),
+        hold_mutex_(),
+        hold_cond_var_() {
     service_->set_node_joined(true);
     service_->set_contact_validation_getter(std::bind(
         &DummyContactValidationGetter, args::_1, args::_2));
@@ -229,6 +236,38 @@ class ServicesTest: public CreateContactAndNodeId, public testing::Test {
     return delete_refresh_response.result();
   }
 
+  bool CountingValidate(const asymm::PlainText&,
+                        const asymm::Signature&,
+                        const asymm::PublicKey&) {
+    boost::mutex::scoped_lock lock(hold_mutex_);
+    ++validations_;
+    validating_threads_.insert(boost::this_thread::get_id());
+    hold_cond_var_.notify_all();
+    return true;
+  }
+
+  bool WaitForValidations(int count) {
+    boost::mutex::scoped_lock lock(hold_mutex_);
+    return hold_cond_var_.timed_wait(lock, bptime::seconds(5),
+        std::bind(&ServicesTest::ValidationsReached, this, count));
+  }
+
+  bool ValidationsReached(int count) const { return validations_ >= count; }
+
+  void HoldAsioThread() {
+    boost::mutex::scoped_lock lock(hold_mutex_);
+    asio_thread_id_ = boost::this_thread::get_id();
+    asio_thread_held_ = true;
+    while (asio_thread_held_)
+      hold_cond_var_.wait(lock);
+  }
+
+  void ReleaseAsioThread() {
+    boost::mutex::scoped_lock lock(hold_mutex_);
+    asio_thread_held_ = false;
+    hold_cond_var_.notify_all();
+  }
+
   void DoOps(std::function<bool()> ops, bool expectation, std::string op) {
     EXPECT_EQ(expectation, ops()) <<"For: " << op;
   }
@@ -284,6 +323,10 @@ class ServicesTest: public CreateContactAndNodeId, public testing::Test {
     return data_store_->key_value_index_->size();
   }
 
+  std::shared_ptr<ValueCache> GetValueCache() const {
+    return service_->value_cache_;
+  }
+
   size_t CountPendingOperations() const {
     return 0;
   }
@@ -329,6 +372,12 @@ class ServicesTest: public CreateContactAndNodeId, public testing::Test {
   RankInfoPtr rank_info_;
   std::shared_ptr<Service> service_;
   int num_of_pings_;
+  int validations_;
+  std::set<boost::thread::id> validating_threads_;
+  boost::thread::id asio_thread_id_;
+  bool asio_thread_held_;
+  boost::mutex hold_mutex_;
+  boost::condition_variable hold_cond_var_;
 };
 
 
@@ -465,6 +514,148 @@ TEST_F(ServicesTest, BEH_Store) {
   }
 }
 
+TEST_F(ServicesTest, BEH_StoreWithPublicKeyCache) {
+  asymm::Keys crypto_key_data;
+  asymm::GenerateKeyPair(&crypto_key_data);
+  NodeId sender_id = GenerateUniqueRandomId(node_id_, 502);
+  Contact sender = ComposeContactWithKey(sender_id, 5001, crypto_key_data);
+  AddTestValidation(key_pair_, sender_id.String(), crypto_key_data.public_key);
+  std::shared_ptr<PublicKeyCache> public_key_cache(
+      new PublicKeyCache(8, bptime::hours(1), bptime::seconds(30)));
+  service_->set_public_key_cache(public_key_cache);
+
+  // The first store from the sender waits for its public key to be fetched
+  KeyValueSignature kvs = MakeKVS(crypto_key_data, 1024, "", "");
+  protobuf::StoreRequest store_request = MakeStoreRequest(sender, kvs);
+  std::string message = store_request.SerializeAsString();
+  std::string message_sig;
+  asymm::Sign(message, crypto_key_data.private_key, &message_sig);
+  protobuf::StoreResponse store_response;
+  service_->Store(info_, store_request, message, message_sig,
+                  &store_response, &time_out);
+  EXPECT_TRUE(store_response.result());
+  EXPECT_EQ(1U, GetSenderTaskSize());
+  Sleep(kNetworkDelay * 2);
+  EXPECT_EQ(0U, GetSenderTaskSize());
+  EXPECT_EQ(1U, GetDataStoreSize());
+  EXPECT_EQ(1U, public_key_cache->Size());
+
+  // Later stores from the same sender complete at once
+  kvs = MakeKVS(crypto_key_data, 1024, "", "");
+  store_request = MakeStoreRequest(sender, kvs);
+  message = store_request.SerializeAsString();
+  asymm::Sign(message, crypto_key_data.private_key, &message_sig);
+  store_response.Clear();
+  service_->Store(info_, store_request, message, message_sig,
+                  &store_response, &time_out);
+  EXPECT_TRUE(store_response.result());
+  EXPECT_EQ(0U, GetSenderTaskSize());
+  EXPECT_EQ(2U, GetDataStoreSize());
+
+  // Invalid tasks are still rejected
+  store_response.Clear();
+  service_->Store(info_, store_request, "", message_sig, &store_response,
+                  &time_out);
+  EXPECT_FALSE(store_response.result());
+  EXPECT_EQ(2U, GetDataStoreSize());
+
+  // A new getter invalidates the cached keys
+  service_->set_contact_validation_getter(std::bind(
+      &DummyContactValidationGetter, args::_1, args::_2));
+  EXPECT_EQ(0U, public_key_cache->Size());
+}
+
+TEST_F(ServicesTest, BEH_ValidateOnCryptoPool) {
+  AsioService asio_service;
+  asio_service.Start(1);
+  std::shared_ptr<CryptoPool> crypto_pool(new CryptoPool(2, 16, 1));
+  service_->set_crypto_pool(crypto_pool, asio_service.service());
+  service_->set_validate(std::bind(&ServicesTest::CountingValidate, this,
+                                   args::_1, args::_2, args::_3));
+  // While the asio thread is held, nothing validated can be stored
+  asio_service.service().post(std::bind(&ServicesTest::HoldAsioThread, this));
+
+  asymm::Keys crypto_key_data;
+  asymm::GenerateKeyPair(&crypto_key_data);
+  NodeId sender_id = GenerateUniqueRandomId(node_id_, 502);
+  KeyValueSignature k1_v1 = MakeKVS(crypto_key_data, 1024, "", "");
+  KeyValueSignature k1_v2 = MakeKVS(crypto_key_data, 1024, k1_v1.key, "");
+  KeyValueSignature k2_v1 = MakeKVS(crypto_key_data, 1024, "", "");
+  EXPECT_TRUE(DoStore(sender_id, k1_v1, crypto_key_data));
+  EXPECT_TRUE(DoStore(sender_id, k1_v2, crypto_key_data));
+  EXPECT_TRUE(DoStore(sender_id, k2_v1, crypto_key_data));
+
+  // The checks for different keys run together, but the second for k1 waits
+  // until the first has been stored
+  EXPECT_TRUE(WaitForValidations(2));
+  Sleep(bptime::milliseconds(100));
+  {
+    boost::mutex::scoped_lock lock(hold_mutex_);
+    EXPECT_EQ(2, validations_);
+  }
+  EXPECT_EQ(0U, GetDataStoreSize());
+
+  ReleaseAsioThread();
+  EXPECT_TRUE(WaitForValidations(3));
+  for (int i = 0; i != 50 && GetDataStoreSize() != 3U; ++i)
+    Sleep(bptime::milliseconds(100));
+  EXPECT_EQ(3U, GetDataStoreSize());
+  EXPECT_TRUE(IsKeyValueInDataStore(k1_v1));
+  EXPECT_TRUE(IsKeyValueInDataStore(k1_v2));
+  EXPECT_TRUE(IsKeyValueInDataStore(k2_v1));
+  {
+    boost::mutex::scoped_lock lock(hold_mutex_);
+    EXPECT_EQ(3, validations_);
+    EXPECT_EQ(0U, validating_threads_.count(asio_thread_id_));
+    EXPECT_EQ(0U, validating_threads_.count(boost::this_thread::get_id()));
+  }
+  asio_service.Stop();
+}
+
+TEST_F(ServicesTest, BEH_StoreBatchOnCryptoPool) {
+  AsioService asio_service;
+  asio_service.Start(1);
+  std::shared_ptr<CryptoPool> crypto_pool(new CryptoPool(2, 16, 1));
+  service_->set_crypto_pool(crypto_pool, asio_service.service());
+
+  asymm::Keys crypto_key_data;
+  asymm::GenerateKeyPair(&crypto_key_data);
+  NodeId sender_id = GenerateUniqueRandomId(node_id_, 502);
+  Contact sender = ComposeContactWithKey(sender_id, 5001, crypto_key_data);
+  KeyValueSignature good_kvs = MakeKVS(crypto_key_data, 1024, "", "");
+  KeyValueSignature bad_kvs = MakeKVS(crypto_key_data, 1024, "", "");
+  protobuf::StoreBatchRequest request;
+  *request.mutable_sender() = ToProtobuf(sender);
+  std::string message(MakeStoreRequest(sender, good_kvs).SerializeAsString());
+  std::string message_sig;
+  asymm::Sign(boost::lexical_cast<std::string>(kStoreRequest) + message,
+              crypto_key_data.private_key, &message_sig);
+  request.add_serialised_store_requests(message);
+  request.add_serialised_store_request_signatures(message_sig);
+  // The second request's signature doesn't cover the message type
+  message = MakeStoreRequest(sender, bad_kvs).SerializeAsString();
+  asymm::Sign(message, crypto_key_data.private_key, &message_sig);
+  request.add_serialised_store_requests(message);
+  request.add_serialised_store_request_signatures(message_sig);
+
+  // Both requests' signatures are checked along with their values', so both
+  // are accepted here
+  protobuf::StoreBatchResponse response;
+  service_->StoreBatch(info_, request, &response, &time_out);
+  EXPECT_TRUE(response.result());
+  ASSERT_EQ(2, response.responses_size());
+  EXPECT_TRUE(response.responses(0).result());
+  EXPECT_TRUE(response.responses(1).result());
+
+  for (int i = 0; i != 50 && GetDataStoreSize() == 0U; ++i)
+    Sleep(bptime::milliseconds(100));
+  Sleep(kNetworkDelay * 2);
+  EXPECT_EQ(1U, GetDataStoreSize());
+  EXPECT_TRUE(IsKeyValueInDataStore(good_kvs));
+  EXPECT_FALSE(IsKeyValueInDataStore(bad_kvs));
+  asio_service.Stop();
+}
+
 TEST_F(ServicesTest, BEH_Delete) {
   asymm::Keys crypto_key_data;
   asymm::GenerateKeyPair(&crypto_key_data);
@@ -1250,6 +1441,116 @@ TEST_F(ServicesTest, BEH_Downlist) {
   EXPECT_TRUE(pinged_node_ids.empty());
 }
 
+TEST_F(ServicesTest, BEH_StoreCache) {
+  asymm::Keys crypto_key_data;
+  asymm::GenerateKeyPair(&crypto_key_data);
+  NodeId signer_id(NodeId::kRandomId);
+  KeyValueSignature kvs(MakeKVS(crypto_key_data, 100, "", ""));
+  Contact sender = ComposeContact(NodeId(NodeId::kRandomId), 5001);
+  protobuf::StoreCacheNotification store_cache_notification;
+  store_cache_notification.mutable_sender()->CopyFrom(ToProtobuf(sender));
+  store_cache_notification.set_key(kvs.key);
+  store_cache_notification.set_ttl(3600);
+
+  protobuf::FindValueRequest find_value_req;
+  find_value_req.mutable_sender()->CopyFrom(ToProtobuf(sender));
+  find_value_req.set_key(kvs.key);
+
+  // Invalid notifications are ignored
+  service_->StoreCache(info_, store_cache_notification, &time_out);
+  EXPECT_EQ(0U, GetValueCache()->Size());
+  protobuf::SignedValue *signed_value =
+      store_cache_notification.add_signed_values();
+  signed_value->set_value(kvs.value);
+  signed_value->set_signature(kvs.signature);
+  service_->StoreCache(info_, store_cache_notification, &time_out);
+  EXPECT_EQ(0U, GetValueCache()->Size());
+  store_cache_notification.set_signer_public_key_id(signer_id.String());
+  store_cache_notification.set_ttl(0);
+  service_->StoreCache(info_, store_cache_notification, &time_out);
+  EXPECT_EQ(0U, GetValueCache()->Size());
+  store_cache_notification.set_ttl(3600);
+  service_->set_node_joined(false);
+  service_->StoreCache(info_, store_cache_notification, &time_out);
+  EXPECT_EQ(0U, GetValueCache()->Size());
+  service_->set_node_joined(true);
+
+  // Values failing validation against the signer's key are not cached
+  service_->set_validate(std::bind(&ValidateFalse, args::_1, args::_2,
+                                   args::_3));
+  service_->StoreCache(info_, store_cache_notification, &time_out);
+  Sleep(kNetworkDelay * 2);
+  EXPECT_EQ(0U, GetValueCache()->Size());
+  service_->set_validate(std::bind(&StubValidate, args::_1, args::_2,
+                                   args::_3));
+
+  // A valid notification makes the values available to FindValue
+  service_->StoreCache(info_, store_cache_notification, &time_out);
+  Sleep(kNetworkDelay * 2);
+  EXPECT_EQ(1U, GetValueCache()->Size());
+  protobuf::FindValueResponse find_value_rsp;
+  service_->FindValue(info_, find_value_req, &find_value_rsp, &time_out);
+  ASSERT_TRUE(find_value_rsp.result());
+  ASSERT_EQ(1, find_value_rsp.signed_values_size());
+  EXPECT_EQ(kvs.value, find_value_rsp.signed_values(0).value());
+  EXPECT_EQ(kvs.signature, find_value_rsp.signed_values(0).signature());
+  EXPECT_EQ(signer_id.String(), find_value_rsp.signer_public_key_id());
+  EXPECT_EQ(0, find_value_rsp.closest_nodes_size());
+
+  // Storing the key authoritatively drops the cached copy
+  EXPECT_TRUE(DoStore(signer_id, kvs, crypto_key_data));
+  Sleep(kNetworkDelay * 2);
+  EXPECT_EQ(1U, GetDataStoreSize());
+  EXPECT_EQ(0U, GetValueCache()->Size());
+  find_value_rsp.Clear();
+  service_->FindValue(info_, find_value_req, &find_value_rsp, &time_out);
+  ASSERT_TRUE(find_value_rsp.result());
+  EXPECT_EQ(signer_id.String(), find_value_rsp.signer_public_key_id());
+
+  // Nor is a copy of values already held authoritatively cached
+  service_->StoreCache(info_, store_cache_notification, &time_out);
+  Sleep(kNetworkDelay * 2);
+  EXPECT_EQ(0U, GetValueCache()->Size());
+  Clear();
+}
+
+TEST_F(ServicesTest, BEH_FindValueBatch) {
+  NodeId cached_key(NodeId::kRandomId), missing_key(NodeId::kRandomId);
+  Contact sender = ComposeContact(NodeId(NodeId::kRandomId), 5001);
+  std::vector<ValueAndSignature> values(
+      1, ValueAndSignature(RandomString(100), RandomString(64)));
+  GetValueCache()->Add(cached_key.String(), values, NodeId().String(),
+                       bptime::seconds(3600));
+  protobuf::FindValueBatchRequest find_value_batch_req;
+  find_value_batch_req.mutable_sender()->CopyFrom(ToProtobuf(sender));
+  {
+    // Batches larger than kMaxRpcBatchSize are rejected outright
+    for (uint16_t i = 0; i <= kMaxRpcBatchSize; ++i)
+      find_value_batch_req.add_keys(cached_key.String());
+    protobuf::FindValueBatchResponse find_value_batch_rsp;
+    service_->FindValueBatch(info_, find_value_batch_req,
+                             &find_value_batch_rsp, &time_out);
+    EXPECT_FALSE(find_value_batch_rsp.result());
+    EXPECT_EQ(0, find_value_batch_rsp.responses_size());
+    find_value_batch_req.clear_keys();
+  }
+  {
+    // Each key gets its own response, in request order
+    find_value_batch_req.add_keys(missing_key.String());
+    find_value_batch_req.add_keys(cached_key.String());
+    protobuf::FindValueBatchResponse find_value_batch_rsp;
+    service_->FindValueBatch(info_, find_value_batch_req,
+                             &find_value_batch_rsp, &time_out);
+    ASSERT_TRUE(find_value_batch_rsp.result());
+    ASSERT_EQ(2, find_value_batch_rsp.responses_size());
+    EXPECT_EQ(0, find_value_batch_rsp.responses(0).signed_values_size());
+    ASSERT_EQ(1, find_value_batch_rsp.responses(1).signed_values_size());
+    EXPECT_EQ(values[0].first,
+              find_value_batch_rsp.responses(1).signed_values(0).value());
+  }
+  GetValueCache()->Clear();
+}
+
 TEST_F(ServicesTest, BEH_Ping) {
   protobuf::PingRequest ping_request;
   NodeId contact_id(NodeId::kRandomId);
@@ -0,0 +1,220 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <memory>
+#include <string>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/dht/session_cache.h"
+#ifdef __MSVC__
+#  pragma warning(push)
+#  pragma warning(disable: 4127 4244 4267)
+#endif
+#include "maidsafe/dht/rpcs.pb.h"
+#ifdef __MSVC__
+#  pragma warning(pop)
+#endif
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace test {
+
+class SessionCacheTest : public testing::Test {
+ public:
+  SessionCacheTest()
+      : sender_keys_(),
+        receiver_keys_(),
+        sender_cache_(),
+        receiver_cache_() {
+    asymm::GenerateKeyPair(&sender_keys_);
+    asymm::GenerateKeyPair(&receiver_keys_);
+    sender_cache_.reset(new SessionCache(
+        PrivateKeyPtr(new asymm::PrivateKey(sender_keys_.private_key)),
+        2, bptime::hours(1), 3, bptime::hours(1)));
+    receiver_cache_.reset(new SessionCache(
+        PrivateKeyPtr(new asymm::PrivateKey(receiver_keys_.private_key)),
+        2, bptime::hours(1), 3, bptime::hours(1)));
+  }
+
+ protected:
+  asymm::Keys sender_keys_, receiver_keys_;
+  std::shared_ptr<SessionCache> sender_cache_, receiver_cache_;
+};
+
+TEST_F(SessionCacheTest, BEH_OutgoingAndIncoming) {
+  std::string session_key, encrypted_session_key;
+  ASSERT_TRUE(sender_cache_->GetOutgoingSession(receiver_keys_.public_key,
+                                                &session_key,
+                                                &encrypted_session_key));
+  EXPECT_FALSE(session_key.empty());
+  EXPECT_NE(session_key, encrypted_session_key);
+  EXPECT_EQ(1U, sender_cache_->OutgoingSize());
+
+  // The session is reused until its message count runs out
+  std::string session_key2, encrypted_session_key2;
+  ASSERT_TRUE(sender_cache_->GetOutgoingSession(receiver_keys_.public_key,
+                                                &session_key2,
+                                                &encrypted_session_key2));
+  EXPECT_EQ(session_key, session_key2);
+  EXPECT_EQ(encrypted_session_key, encrypted_session_key2);
+  ASSERT_TRUE(sender_cache_->GetOutgoingSession(receiver_keys_.public_key,
+                                                &session_key2,
+                                                &encrypted_session_key2));
+  EXPECT_EQ(session_key, session_key2);
+  ASSERT_TRUE(sender_cache_->GetOutgoingSession(receiver_keys_.public_key,
+                                                &session_key2,
+                                                &encrypted_session_key2));
+  EXPECT_NE(session_key, session_key2);
+  EXPECT_NE(encrypted_session_key, encrypted_session_key2);
+  EXPECT_EQ(1U, sender_cache_->OutgoingSize());
+
+  // Only the intended recipient can recover the key
+  std::string received_key;
+  EXPECT_FALSE(sender_cache_->GetIncomingSession(encrypted_session_key2,
+                                                 &received_key));
+  EXPECT_EQ(0U, sender_cache_->IncomingSize());
+  ASSERT_TRUE(receiver_cache_->GetIncomingSession(encrypted_session_key2,
+                                                  &received_key));
+  EXPECT_EQ(session_key2, received_key);
+  EXPECT_EQ(1U, receiver_cache_->IncomingSize());
+  ASSERT_TRUE(receiver_cache_->GetIncomingSession(encrypted_session_key2,
+                                                  &received_key));
+  EXPECT_EQ(session_key2, received_key);
+  EXPECT_EQ(1U, receiver_cache_->IncomingSize());
+  EXPECT_FALSE(receiver_cache_->GetIncomingSession(RandomString(256),
+                                                   &received_key));
+
+  sender_cache_->Clear();
+  receiver_cache_->Clear();
+  EXPECT_EQ(0U, sender_cache_->OutgoingSize());
+  EXPECT_EQ(0U, receiver_cache_->IncomingSize());
+}
+
+TEST_F(SessionCacheTest, BEH_NoRoomForSessions) {
+  std::string session_key, encrypted_session_key;
+  ASSERT_TRUE(sender_cache_->GetOutgoingSession(receiver_keys_.public_key,
+                                                &session_key,
+                                                &encrypted_session_key));
+  // With no room, nothing is cached, but sessions still work
+  SessionCache uncached(
+      PrivateKeyPtr(new asymm::PrivateKey(receiver_keys_.private_key)),
+      0, bptime::hours(1), 100, bptime::hours(1));
+  std::string received_key;
+  ASSERT_TRUE(uncached.GetIncomingSession(encrypted_session_key,
+                                          &received_key));
+  EXPECT_EQ(session_key, received_key);
+  EXPECT_EQ(0U, uncached.IncomingSize());
+}
+
+TEST_F(SessionCacheTest, BEH_SuspendOutgoingSessions) {
+  asymm::Keys other_keys;
+  asymm::GenerateKeyPair(&other_keys);
+  std::string session_key, encrypted_session_key;
+  ASSERT_TRUE(sender_cache_->GetOutgoingSession(receiver_keys_.public_key,
+                                                &session_key,
+                                                &encrypted_session_key));
+  EXPECT_EQ(1U, sender_cache_->OutgoingSize());
+
+  // Only the suspended peer goes without a session
+  sender_cache_->SuspendOutgoingSessions(receiver_keys_.public_key);
+  EXPECT_EQ(0U, sender_cache_->OutgoingSize());
+  EXPECT_FALSE(sender_cache_->GetOutgoingSession(receiver_keys_.public_key,
+                                                 &session_key,
+                                                 &encrypted_session_key));
+  EXPECT_TRUE(sender_cache_->GetOutgoingSession(other_keys.public_key,
+                                                &session_key,
+                                                &encrypted_session_key));
+
+  // The suspension lasts only for the fallback period
+  SessionCache short_suspension_cache(
+      PrivateKeyPtr(new asymm::PrivateKey(sender_keys_.private_key)),
+      2, bptime::hours(1), 3, bptime::milliseconds(100));
+  short_suspension_cache.SuspendOutgoingSessions(receiver_keys_.public_key);
+  EXPECT_FALSE(short_suspension_cache.GetOutgoingSession(
+      receiver_keys_.public_key, &session_key, &encrypted_session_key));
+  Sleep(bptime::milliseconds(200));
+  EXPECT_TRUE(short_suspension_cache.GetOutgoingSession(
+      receiver_keys_.public_key, &session_key, &encrypted_session_key));
+
+  sender_cache_->Clear();
+  EXPECT_TRUE(sender_cache_->GetOutgoingSession(receiver_keys_.public_key,
+                                                &session_key,
+                                                &encrypted_session_key));
+}
+
+TEST_F(SessionCacheTest, BEH_SealAndOpen) {
+  std::string session_key, encrypted_session_key;
+  ASSERT_TRUE(sender_cache_->GetOutgoingSession(receiver_keys_.public_key,
+                                                &session_key,
+                                                &encrypted_session_key));
+  const std::string kPlainText(RandomString(1000));
+  protobuf::SessionMessage session_message;
+  ASSERT_TRUE(SessionCache::Seal(session_key, true, kPlainText,
+                                 &session_message));
+  EXPECT_EQ(std::string::npos,
+            session_message.ciphertext().find(kPlainText.substr(0, 100)));
+  std::string opened;
+  ASSERT_TRUE(SessionCache::Open(session_key, true, session_message, &opened));
+  EXPECT_EQ(kPlainText, opened);
+
+  // A fresh IV is used for each message
+  protobuf::SessionMessage session_message2;
+  ASSERT_TRUE(SessionCache::Seal(session_key, true, kPlainText,
+                                 &session_message2));
+  EXPECT_NE(session_message.iv(), session_message2.iv());
+  EXPECT_NE(session_message.ciphertext(), session_message2.ciphertext());
+
+  // A request can't be opened as a response, nor with another key
+  EXPECT_FALSE(SessionCache::Open(session_key, false, session_message,
+                                  &opened));
+  std::string other_key, other_encrypted_key;
+  sender_cache_->Clear();
+  ASSERT_TRUE(sender_cache_->GetOutgoingSession(receiver_keys_.public_key,
+                                                &other_key,
+                                                &other_encrypted_key));
+  EXPECT_FALSE(SessionCache::Open(other_key, true, session_message, &opened));
+
+  // Tampering is detected
+  protobuf::SessionMessage tampered(session_message);
+  std::string ciphertext(tampered.ciphertext());
+  ciphertext[0] = ciphertext[0] ^ 1;
+  tampered.set_ciphertext(ciphertext);
+  EXPECT_FALSE(SessionCache::Open(session_key, true, tampered, &opened));
+  tampered = session_message;
+  tampered.set_iv(session_message2.iv());
+  EXPECT_FALSE(SessionCache::Open(session_key, true, tampered, &opened));
+  EXPECT_FALSE(SessionCache::Seal("", true, kPlainText, &session_message));
+}
+
+}  // namespace test
+
+}  // namespace dht
+
+}  // namespace maidsafe
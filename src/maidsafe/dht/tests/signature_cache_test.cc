@@ -0,0 +1,141 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <functional>
+#include <string>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/dht/signature_cache.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace test {
+
+namespace args = std::placeholders;
+
+class SignatureCacheTest : public testing::Test {
+ public:
+  SignatureCacheTest()
+      : signature_cache_(2, bptime::hours(1), Counter()),
+        keys_(),
+        plain_text_(RandomString(100)),
+        signature_(),
+        validations_(0) {
+    asymm::GenerateKeyPair(&keys_);
+    asymm::Sign(plain_text_, keys_.private_key, &signature_);
+  }
+
+  bool CountingValidate(const asymm::PlainText &plain_text,
+                        const asymm::Signature &signature,
+                        const asymm::PublicKey &public_key) {
+    ++validations_;
+    return asymm::Validate(plain_text, signature, public_key);
+  }
+
+  bool CountingAcceptAll(const asymm::PlainText&,
+                         const asymm::Signature&,
+                         const asymm::PublicKey&) {
+    ++validations_;
+    return true;
+  }
+
+ protected:
+  asymm::ValidateFunctor Counter() {
+    return std::bind(&SignatureCacheTest::CountingValidate, this, args::_1,
+                     args::_2, args::_3);
+  }
+  SignatureCache signature_cache_;
+  asymm::Keys keys_;
+  std::string plain_text_, signature_;
+  int validations_;
+};
+
+TEST_F(SignatureCacheTest, BEH_Validate) {
+  EXPECT_TRUE(signature_cache_.Validate(plain_text_, signature_,
+                                        keys_.public_key));
+  EXPECT_EQ(1, validations_);
+  EXPECT_EQ(1U, signature_cache_.Size());
+  EXPECT_TRUE(signature_cache_.Validate(plain_text_, signature_,
+                                        keys_.public_key));
+  EXPECT_EQ(1, validations_);
+
+  // Failures are never cached
+  std::string other_text(RandomString(100));
+  EXPECT_FALSE(signature_cache_.Validate(other_text, signature_,
+                                         keys_.public_key));
+  EXPECT_FALSE(signature_cache_.Validate(other_text, signature_,
+                                         keys_.public_key));
+  EXPECT_EQ(3, validations_);
+  asymm::Keys other_keys;
+  asymm::GenerateKeyPair(&other_keys);
+  EXPECT_FALSE(signature_cache_.Validate(plain_text_, signature_,
+                                         other_keys.public_key));
+  EXPECT_EQ(1U, signature_cache_.Size());
+
+  signature_cache_.Clear();
+  EXPECT_EQ(0U, signature_cache_.Size());
+  EXPECT_TRUE(signature_cache_.Validate(plain_text_, signature_,
+                                        keys_.public_key));
+  EXPECT_EQ(5, validations_);
+}
+
+TEST_F(SignatureCacheTest, BEH_ValidatorsDontShareResults) {
+  SignatureCache accept_all_cache(2, bptime::hours(1),
+      std::bind(&SignatureCacheTest::CountingAcceptAll, this, args::_1,
+                args::_2, args::_3));
+  std::string other_text(RandomString(100));
+  EXPECT_TRUE(accept_all_cache.Validate(other_text, signature_,
+                                        keys_.public_key));
+  EXPECT_EQ(1U, accept_all_cache.Size());
+  EXPECT_FALSE(signature_cache_.Validate(other_text, signature_,
+                                         keys_.public_key));
+  EXPECT_EQ(2, validations_);
+
+  // A pass against an invalid key isn't remembered
+  asymm::PublicKey invalid_key;
+  EXPECT_TRUE(accept_all_cache.Validate(plain_text_, signature_,
+                                        invalid_key));
+  EXPECT_TRUE(accept_all_cache.Validate(plain_text_, signature_,
+                                        invalid_key));
+  EXPECT_EQ(4, validations_);
+  EXPECT_EQ(1U, accept_all_cache.Size());
+
+  // The default validator is asymm::Validate
+  SignatureCache rsa_cache(2, bptime::hours(1));
+  EXPECT_TRUE(rsa_cache.Validate(plain_text_, signature_, keys_.public_key));
+  EXPECT_FALSE(rsa_cache.Validate(other_text, signature_, keys_.public_key));
+  EXPECT_EQ(1U, rsa_cache.Size());
+}
+
+}  // namespace test
+
+}  // namespace dht
+
+}  // namespace maidsafe
@@ -0,0 +1,91 @@
+/* Copyright (c) 2011 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <algorithm>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/dht/suspect_list.h"
+#include "maidsafe/dht/tests/test_utils.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace test {
+
+namespace {
+const uint16_t g_kKademliaK = 8;
+}  // unnamed namespace
+
+class SuspectListTest : public CreateContactAndNodeId,
+                        public testing::Test {
+ public:
+  SuspectListTest()
+      : CreateContactAndNodeId(g_kKademliaK),
+        suspect_list_(3, bptime::hours(1)),
+        contacts_() {
+    for (Port port = 5000; port != 5000 + g_kKademliaK; ++port)
+      contacts_.push_back(ComposeContact(NodeId(NodeId::kRandomId), port));
+  }
+
+ protected:
+  SuspectList suspect_list_;
+  std::vector<Contact> contacts_;
+};
+
+TEST_F(SuspectListTest, BEH_AddAndRemove) {
+  EXPECT_FALSE(suspect_list_.IsSuspect(contacts_[0].node_id()));
+  EXPECT_TRUE(suspect_list_.GetSuspects().empty());
+  suspect_list_.Add(contacts_[0]);
+  suspect_list_.Add(contacts_[1]);
+  suspect_list_.Add(contacts_[0]);
+  EXPECT_EQ(2U, suspect_list_.Size());
+  EXPECT_TRUE(suspect_list_.IsSuspect(contacts_[0].node_id()));
+  EXPECT_TRUE(suspect_list_.IsSuspect(contacts_[1].node_id()));
+  EXPECT_FALSE(suspect_list_.IsSuspect(contacts_[2].node_id()));
+  std::vector<Contact> suspects(suspect_list_.GetSuspects());
+  ASSERT_EQ(2U, suspects.size());
+  EXPECT_NE(suspects.end(),
+            std::find(suspects.begin(), suspects.end(), contacts_[1]));
+
+  // a successful contact clears the suspect
+  suspect_list_.Remove(contacts_[0].node_id());
+  EXPECT_FALSE(suspect_list_.IsSuspect(contacts_[0].node_id()));
+  suspect_list_.Remove(contacts_[2].node_id());
+  EXPECT_EQ(1U, suspect_list_.Size());
+
+  suspect_list_.Clear();
+  EXPECT_EQ(0U, suspect_list_.Size());
+  EXPECT_FALSE(suspect_list_.IsSuspect(contacts_[1].node_id()));
+}
+
+}  // namespace test
+
+}  // namespace dht
+
+}  // namespace maidsafe
@@ -131,7 +131,7 @@ Contact CreateContactAndNodeId::GenerateUniqueContact(
     const NodeId &holder,
     const int &pos,
     const NodeId &target,
-    RoutingTableContactsContainer *generated_nodes) {
+    TestContactsContainer *generated_nodes) {
   std::string holder_id = holder.ToStringEncoded(NodeId::kBinary);
   std::bitset<kKeySizeBits> holder_id_binary_bitset(holder_id);
   NodeId new_node;
@@ -156,8 +156,7 @@ Contact CreateContactAndNodeId::GenerateUniqueContact(
     auto it = key_indx.find(new_node);
     if (it == key_indx.end()) {
       new_contact = ComposeContact(new_node, 5000);
-      RoutingTableContact new_routing_table_contact(new_contact, target, 0);
-      generated_nodes->insert(new_routing_table_contact);
+      generated_nodes->insert(TestContact(new_contact, target));
       repeat = false;
     }
     ++times_of_try;
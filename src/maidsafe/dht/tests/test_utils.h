@@ -50,6 +50,37 @@ namespace dht {
 
 namespace test {
 
+// A contact generated by a test, along with its distance to the test's target.
+struct TestContact {
+  TestContact(const Contact &contact, const NodeId &target_id)
+      : contact(contact),
+        node_id(contact.node_id()),
+        distance_to_target(target_id ^ contact.node_id()) {}
+  Contact contact;
+  NodeId node_id;
+  NodeId distance_to_target;
+};
+
+struct DistanceToTargetTag;
+
+typedef boost::multi_index_container<
+  TestContact,
+  bmi::indexed_by<
+    bmi::ordered_unique<
+      bmi::tag<NodeIdTag>,
+      BOOST_MULTI_INDEX_MEMBER(TestContact, NodeId, node_id)
+    >,
+    bmi::ordered_non_unique<
+      bmi::tag<DistanceToTargetTag>,
+      BOOST_MULTI_INDEX_MEMBER(TestContact, NodeId, distance_to_target)
+    >
+  >
+> TestContactsContainer;
+
+typedef TestContactsContainer::index<NodeIdTag>::type& ContactsById;
+typedef TestContactsContainer::index<DistanceToTargetTag>::type&
+    ContactsByDistanceToTarget;
+
 class AsymGetPublicKeyAndValidation {
  public:
   AsymGetPublicKeyAndValidation(const asymm::Identity &public_key_id,
@@ -83,7 +114,7 @@ class CreateContactAndNodeId {
   Contact GenerateUniqueContact(const NodeId &holder,
                                 const int &pos,
                                 const NodeId &target,
-                                RoutingTableContactsContainer *generated_nodes);
+                                TestContactsContainer *generated_nodes);
   NodeId GenerateRandomId(const NodeId &holder, const int &pos);
   Contact ComposeContact(const NodeId &node_id, const Port &port);
   Contact ComposeContactWithKey(const NodeId &node_id,
@@ -0,0 +1,102 @@
+/* Copyright (c) 2011 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/dht/value_cache.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace test {
+
+class ValueCacheTest : public testing::Test {
+ public:
+  ValueCacheTest()
+      : cache_(3),
+        values_and_signatures_(),
+        signer_(RandomString(64)) {
+    for (int i = 0; i != 4; ++i) {
+      values_and_signatures_.push_back(
+          std::make_pair(RandomString(100), RandomString(64)));
+    }
+  }
+
+ protected:
+  ValueCache cache_;
+  std::vector<ValueAndSignature> values_and_signatures_;
+  asymm::Identity signer_;
+};
+
+TEST_F(ValueCacheTest, BEH_AddAndGet) {
+  std::string key(RandomString(64));
+  std::vector<ValueAndSignature> result;
+  EXPECT_FALSE(cache_.GetValues(key, &result));
+  EXPECT_FALSE(cache_.GetValues(key, nullptr));
+  cache_.Add(key, std::vector<ValueAndSignature>(), signer_,
+             bptime::hours(1));
+  cache_.Add(key, values_and_signatures_, signer_, bptime::seconds(0));
+  EXPECT_EQ(0U, cache_.Size());
+
+  cache_.Add(key, values_and_signatures_, signer_, bptime::hours(1));
+  EXPECT_EQ(1U, cache_.Size());
+  asymm::Identity signer;
+  EXPECT_TRUE(cache_.GetValues(key, &result, &signer));
+  EXPECT_EQ(values_and_signatures_, result);
+  EXPECT_EQ(signer_, signer);
+  EXPECT_FALSE(cache_.GetValues(RandomString(64), &result));
+
+  // a later copy replaces the entry
+  std::vector<ValueAndSignature> single(1, values_and_signatures_.back());
+  cache_.Add(key, single, signer_, bptime::hours(1));
+  EXPECT_EQ(1U, cache_.Size());
+  EXPECT_TRUE(cache_.GetValues(key, &result));
+  EXPECT_EQ(single, result);
+
+  cache_.Remove(RandomString(64));
+  EXPECT_EQ(1U, cache_.Size());
+  cache_.Remove(key);
+  EXPECT_EQ(0U, cache_.Size());
+  EXPECT_FALSE(cache_.GetValues(key, &result));
+
+  cache_.Add(key, single, signer_, bptime::hours(1));
+  cache_.Clear();
+  EXPECT_EQ(0U, cache_.Size());
+  EXPECT_FALSE(cache_.GetValues(key, &result));
+}
+
+}  // namespace test
+
+}  // namespace dht
+
+}  // namespace maidsafe
@@ -41,8 +41,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #  pragma warning(pop)
 #endif
 #include "maidsafe/dht/node_id.h"
+#include "maidsafe/dht/node_id_block.h"
 
-namespace args = std::placeholders;
 
 namespace maidsafe {
 
@@ -125,11 +125,27 @@ bool IsListeningOnTCP(const Contact &contact) {
 void SortContacts(const NodeId &target_key, std::vector<Contact> *contacts) {
   if (!contacts || contacts->empty())
     return;
-  std::sort(contacts->begin(), contacts->end(),
-      std::bind(static_cast<bool(*)(const Contact&,  // NOLINT
-                                    const Contact&,
-                                    const NodeId&)>(&CloserToTarget),
-                args::_1, args::_2, target_key));
+  NodeIdBlock node_ids;
+  node_ids.Reserve(contacts->size());
+  for (auto it = contacts->begin(); it != contacts->end(); ++it)
+    node_ids.Add((*it).node_id());
+  std::vector<size_t> closest;
+  node_ids.SelectClosest(target_key, contacts->size(), &closest);
+  if (closest.empty())
+    return;
+  // Contacts with invalid IDs can't be ranked, so they go to the back.
+  std::vector<bool> ranked(contacts->size(), false);
+  std::vector<Contact> sorted_contacts;
+  sorted_contacts.reserve(contacts->size());
+  for (size_t i = 0; i < closest.size(); ++i) {
+    sorted_contacts.push_back((*contacts)[closest[i]]);
+    ranked[closest[i]] = true;
+  }
+  for (size_t i = 0; i < contacts->size(); ++i) {
+    if (!ranked[i])
+      sorted_contacts.push_back((*contacts)[i]);
+  }
+  contacts->swap(sorted_contacts);
 }
 
 void StubContactValidationGetter(
@@ -0,0 +1,89 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "maidsafe/dht/value_cache.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+ValueCache::ValueCache(const size_t &max_size)
+    : kMaxSize_(max_size),
+      entries_(max_size),
+      mutex_() {}
+
+void ValueCache::Add(
+    const std::string &key,
+    const std::vector<ValueAndSignature> &values_and_signatures,
+    const asymm::Identity &signer_public_key_id,
+    const bptime::time_duration &time_to_live) {
+  if (kMaxSize_ == 0 || values_and_signatures.empty() ||
+      time_to_live <= bptime::time_duration())
+    return;
+  Entry entry;
+  entry.values_and_signatures = values_and_signatures;
+  entry.signer_public_key_id = signer_public_key_id;
+  const bptime::ptime kNow(bptime::microsec_clock::universal_time());
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Insert(key, entry, kNow + time_to_live, kNow);
+}
+
+bool ValueCache::GetValues(
+    const std::string &key,
+    std::vector<ValueAndSignature> *values_and_signatures,
+    asymm::Identity *signer_public_key_id) {
+  if (!values_and_signatures)
+    return false;
+  boost::mutex::scoped_lock lock(mutex_);
+  const Entry *cached(
+      entries_.Find(key, bptime::microsec_clock::universal_time()));
+  if (!cached)
+    return false;
+  *values_and_signatures = cached->values_and_signatures;
+  if (signer_public_key_id)
+    *signer_public_key_id = cached->signer_public_key_id;
+  return true;
+}
+
+void ValueCache::Remove(const std::string &key) {
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Erase(key);
+}
+
+void ValueCache::Clear() {
+  boost::mutex::scoped_lock lock(mutex_);
+  entries_.Clear();
+}
+
+size_t ValueCache::Size() {
+  boost::mutex::scoped_lock lock(mutex_);
+  return entries_.Size();
+}
+
+}  // namespace dht
+
+}  // namespace maidsafe
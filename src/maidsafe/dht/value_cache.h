@@ -0,0 +1,113 @@
+/* Copyright (c) 2010 maidsafe.net limited
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+    * Neither the name of the maidsafe.net limited nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR
+TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAIDSAFE_DHT_VALUE_CACHE_H_
+#define MAIDSAFE_DHT_VALUE_CACHE_H_
+
+#include <string>
+#include <vector>
+
+#include "boost/date_time/posix_time/posix_time_types.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include "maidsafe/dht/config.h"
+#include "maidsafe/dht/expiring_map.h"
+
+namespace maidsafe {
+
+namespace dht {
+
+namespace bptime = boost::posix_time;
+
+/**
+* @class ValueCache
+* Bounded, thread-safe store of values cached at this node by peers whose
+* lookups passed through it.  Cached copies are held apart from the
+* authoritative DataStore: they are never refreshed or republished, and simply
+* expire after the time to live they were given.
+*/
+class ValueCache {
+ public:
+  /**
+  * @param[in] max_size The maximum number of keys held.  If 0, nothing is ever
+  * cached.
+  */
+  explicit ValueCache(const size_t &max_size);
+
+  /**
+  * Caches the values under key, replacing any existing entry.  If full,
+  * expired entries are purged, then the one closest to expiry is evicted.
+  * @param[in] key The Kademlia key.
+  * @param[in] values_and_signatures The values and their signatures.
+  * @param[in] signer_public_key_id The identity of the key which signed them.
+  * @param[in] time_to_live The time for which the values are served.
+  */
+  void Add(const std::string &key,
+           const std::vector<ValueAndSignature> &values_and_signatures,
+           const asymm::Identity &signer_public_key_id,
+           const bptime::time_duration &time_to_live);
+
+  /**
+  * Gets the values cached under key if they haven't expired.
+  * @param[in] key The Kademlia key.
+  * @param[out] values_and_signatures The cached values and their signatures.
+  * @param[out] signer_public_key_id If not NULL, the identity of the key which
+  * signed the values.
+  * @return True if the values were found.
+  */
+  bool GetValues(const std::string &key,
+                 std::vector<ValueAndSignature> *values_and_signatures,
+                 asymm::Identity *signer_public_key_id = NULL);
+
+  /**
+  * Drops any copy cached under key, e.g. once the authoritative values change.
+  * @param[in] key The Kademlia key.
+  */
+  void Remove(const std::string &key);
+
+  void Clear();
+
+  size_t Size();
+
+ private:
+  ValueCache(const ValueCache&);
+  ValueCache& operator=(const ValueCache&);
+  struct Entry {
+    Entry() : values_and_signatures(), signer_public_key_id() {}
+    std::vector<ValueAndSignature> values_and_signatures;
+    asymm::Identity signer_public_key_id;
+  };
+  const size_t kMaxSize_;
+  ExpiringMap<std::string, Entry> entries_;
+  boost::mutex mutex_;
+};
+
+}  // namespace dht
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_DHT_VALUE_CACHE_H_